@@ -0,0 +1,169 @@
+#include "ArenaBenchmark.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameArena.h"
+#include "JobSystem.h"
+
+namespace
+{
+    const uint32_t DRAWS_PER_JOB = 2000;
+    const uint32_t JOBS_PER_FRAME = 4;
+    const uint32_t MATERIAL_COUNT = 64;
+    //Frames left out of the per frame numbers, the arenas are still growing during these
+    const uint32_t WARMUP_FRAMES = 8;
+    const uint32_t SLOT_COUNT = 2;
+
+    struct DrawItem
+    {
+        uint32_t m_mesh;
+        uint32_t m_material;
+        float m_transform[12];
+        float m_depth;
+    };
+
+    //Counts what reaches the heap, the number the arena is supposed to take to zero
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+        uint64_t GetAllocations() const { return m_allocations.load(std::memory_order_relaxed); }
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            m_allocations.fetch_add(1, std::memory_order_relaxed);
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    private:
+        std::atomic<uint64_t> m_allocations = { 0 };
+    };
+
+    //Roughly what a frame's worth of scene processing does: gather, cull, batch by material.
+    //Deliberately no reserve calls, that's how most of this code gets written.
+    uint64_t BuildFrameData(uint32_t frame, uint32_t job, std::pmr::memory_resource* resource)
+    {
+        std::pmr::vector<DrawItem> draws(resource);
+        for (uint32_t i = 0; i < DRAWS_PER_JOB; i++)
+        {
+            DrawItem draw = {};
+            draw.m_mesh = i;
+            draw.m_material = (i * 7 + job) % MATERIAL_COUNT;
+            draw.m_depth = static_cast<float>((i * 2654435761u + frame) % 1000);
+            draws.push_back(draw);
+        }
+
+        std::pmr::vector<uint32_t> visible(resource);
+        for (uint32_t i = 0; i < draws.size(); i++)
+        {
+            if (draws[i].m_depth < 700.0f)
+            {
+                visible.push_back(i);
+            }
+        }
+
+        std::pmr::unordered_map<uint32_t, std::pmr::vector<uint32_t>> batches(resource);
+        for (uint32_t index : visible)
+        {
+            batches[draws[index].m_material].push_back(index);
+        }
+
+        //Something the compiler can't throw away
+        uint64_t checksum = 0;
+        for (const auto& batch : batches)
+        {
+            checksum += batch.first * batch.second.size();
+        }
+
+        return checksum;
+    }
+
+    struct BenchmarkResult
+    {
+        double m_allocationsPerFrame = 0.0;
+        double m_msPerFrame = 0.0;
+        uint64_t m_checksum = 0;
+    };
+
+    BenchmarkResult RunFrames(uint32_t frames, CountingResource& counter, const std::function<std::pmr::memory_resource*()>& getResource, const std::function<void(uint32_t)>& beginFrame)
+    {
+        JobSystem* jobs = JobSystem::GetInstance();
+        std::atomic<uint64_t> checksum = { 0 };
+        uint64_t allocationsAtStart = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t frame = 0; frame < WARMUP_FRAMES + frames; frame++)
+        {
+            if (frame == WARMUP_FRAMES)
+            {
+                allocationsAtStart = counter.GetAllocations();
+                start = std::chrono::steady_clock::now();
+            }
+
+            beginFrame(frame % SLOT_COUNT);
+
+            std::vector<JobHandle> handles;
+            for (uint32_t job = 1; job < JOBS_PER_FRAME; job++)
+            {
+                handles.push_back(jobs->Submit("ArenaBenchmarkJob", [&, frame, job]()
+                {
+                    checksum += BuildFrameData(frame, job, getResource());
+                }));
+            }
+            checksum += BuildFrameData(frame, 0, getResource());
+
+            for (const JobHandle& handle : handles)
+            {
+                jobs->Wait(handle);
+            }
+        }
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        BenchmarkResult result;
+        result.m_allocationsPerFrame = static_cast<double>(counter.GetAllocations() - allocationsAtStart) / frames;
+        result.m_msPerFrame = elapsed.count() / frames;
+        result.m_checksum = checksum;
+
+        return result;
+    }
+}
+
+void RunArenaBenchmark(std::ostream& out, uint32_t frames)
+{
+    CountingResource heapCounter;
+    BenchmarkResult heap = RunFrames(frames, heapCounter,
+        [&heapCounter]() { return &heapCounter; },
+        [](uint32_t) { });
+
+    CountingResource arenaCounter;
+    FrameArena arena;
+    arena.Init(SLOT_COUNT, LinearArena::DEFAULT_BLOCK_SIZE, &arenaCounter);
+    BenchmarkResult frameArena = RunFrames(frames, arenaCounter,
+        [&arena]() { return arena.GetResource(); },
+        [&arena](uint32_t slot) { arena.BeginFrame(slot); });
+
+    if (heap.m_checksum != frameArena.m_checksum)
+    {
+        out << "arena benchmark: results differ between heap and arena!" << std::endl;
+    }
+
+    out << "arena benchmark: " << frames << " frames, " << JOBS_PER_FRAME << " jobs x " << DRAWS_PER_JOB << " draws" << std::endl;
+    out << "\theap:  " << heap.m_allocationsPerFrame << " heap allocations/frame, " << heap.m_msPerFrame << "ms/frame" << std::endl;
+    out << "\tarena: " << frameArena.m_allocationsPerFrame << " heap allocations/frame, " << frameArena.m_msPerFrame << "ms/frame, peak "
+        << arena.GetPeakFrameBytes() / 1024 << " KiB/frame in " << arena.GetUpstreamAllocations() << " blocks" << std::endl;
+
+    arena.Destroy();
+}
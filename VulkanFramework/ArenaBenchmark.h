@@ -0,0 +1,14 @@
+#ifndef __ARENA_BENCHMARK_H__
+#define __ARENA_BENCHMARK_H__
+
+#include <cstdint>
+#include <ostream>
+
+//Builds the same per-frame data (draw lists, culling output, batching) every frame, on the
+//main thread and on the job system, once from the heap and once from a FrameArena, and
+//reports heap allocations and time per frame for both.
+//Heap allocations are counted by the memory resource the containers draw from, so nothing
+//global is replaced.
+void RunArenaBenchmark(std::ostream& out, uint32_t frames);
+
+#endif // !__ARENA_BENCHMARK_H__
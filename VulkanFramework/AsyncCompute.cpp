@@ -0,0 +1,236 @@
+#include "AsyncCompute.h"
+
+#include <stdexcept>
+
+#include "Profiler.h"
+
+void AsyncCompute::Init(VkDevice device, VkQueue queue, uint32_t queueFamily, bool dedicated, uint32_t framesInFlight, bool timelineSemaphores)
+{
+    m_device = device;
+    m_queue = queue;
+    m_queueFamily = queueFamily;
+    m_dedicated = dedicated;
+
+    //Command buffers are re-recorded every frame
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute command pool!");
+    }
+
+    m_timeline.Init(m_device, m_queue, timelineSemaphores);
+
+    m_frames.resize(framesInFlight);
+    for (FrameResources& frame : m_frames)
+    {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &frame.m_commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate compute command buffer!");
+        }
+
+        if (!m_timeline.IsNative())
+        {
+            VkSemaphoreCreateInfo semaphoreInfo = {};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &frame.m_finished) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create compute semaphore!");
+            }
+        }
+    }
+}
+
+void AsyncCompute::Destroy()
+{
+    for (FrameResources& frame : m_frames)
+    {
+        if (frame.m_finished != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(m_device, frame.m_finished, nullptr);
+        }
+    }
+    m_frames.clear();
+
+    m_timeline.Destroy();
+
+    //Frees the command buffers with it
+    if (m_commandPool != VK_NULL_HANDLE)
+    {
+        vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+        m_commandPool = VK_NULL_HANDLE;
+    }
+}
+
+void AsyncCompute::AddJob(const std::string& name, VkPipelineStageFlags consumerStage, RecordFunc record)
+{
+    m_jobs.push_back({ name, std::move(record) });
+    m_consumerStages |= consumerStage;
+}
+
+SyncPoint AsyncCompute::Submit(uint32_t frame, const SyncPoint& wait, VkPipelineStageFlags waitStage)
+{
+    PROFILE_SCOPE("ComputeSubmit");
+
+    FrameResources& resources = m_frames[frame];
+
+    //Normally long done, graphics already waited for this frame's previous use
+    m_timeline.Wait(resources.m_value);
+
+    vkResetCommandBuffer(resources.m_commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(resources.m_commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording compute command buffer!");
+    }
+
+    for (const Job& job : m_jobs)
+    {
+        job.m_record(resources.m_commandBuffer, frame);
+    }
+
+    if (vkEndCommandBuffer(resources.m_commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record compute command buffer!");
+    }
+
+    QueueTimeline::Batch batch;
+    if (wait.m_semaphore != VK_NULL_HANDLE)
+    {
+        batch.Wait(wait, waitStage);
+    }
+    batch.m_commandBuffers = &resources.m_commandBuffer;
+    batch.m_commandBufferCount = 1;
+    if (resources.m_finished != VK_NULL_HANDLE)
+    {
+        batch.Signal(resources.m_finished);
+    }
+
+    resources.m_value = m_timeline.Submit(batch);
+
+    return m_timeline.IsNative() ? m_timeline.GetSyncPoint(resources.m_value) : SyncPoint{ resources.m_finished, 0 };
+}
+
+QueueOwnershipTransfer AsyncCompute::PlanTransfer(const QueueUse& from, const QueueUse& to, VkSharingMode sharingMode)
+{
+    QueueOwnershipTransfer transfer;
+    transfer.m_srcStage = from.m_stage;
+    transfer.m_dstStage = to.m_stage;
+    transfer.m_srcAccess = from.m_access;
+    transfer.m_dstAccess = to.m_access;
+    transfer.m_oldLayout = from.m_layout;
+    transfer.m_newLayout = to.m_layout;
+
+    if (sharingMode == VK_SHARING_MODE_EXCLUSIVE && from.m_family != to.m_family)
+    {
+        transfer.m_release = true;
+        transfer.m_acquire = true;
+        transfer.m_srcFamily = from.m_family;
+        transfer.m_dstFamily = to.m_family;
+    }
+    else
+    {
+        //The semaphore already makes the writes visible, only a layout change is left
+        transfer.m_acquire = from.m_layout != to.m_layout;
+    }
+
+    return transfer;
+}
+
+VkBufferMemoryBarrier QueueOwnershipTransfer::GetBufferRelease(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size) const
+{
+    //The destination access is ignored on a release, the acquire makes the data visible
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = m_srcAccess;
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = m_srcFamily;
+    barrier.dstQueueFamilyIndex = m_dstFamily;
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+    return barrier;
+}
+
+VkBufferMemoryBarrier QueueOwnershipTransfer::GetBufferAcquire(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size) const
+{
+    //The source access is ignored on an acquire, the release made the data available
+    VkBufferMemoryBarrier barrier = GetBufferRelease(buffer, offset, size);
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = m_dstAccess;
+    return barrier;
+}
+
+VkImageMemoryBarrier QueueOwnershipTransfer::GetImageRelease(VkImage image, const VkImageSubresourceRange& range) const
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = m_srcAccess;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = m_oldLayout;
+    barrier.newLayout = m_newLayout;
+    barrier.srcQueueFamilyIndex = m_srcFamily;
+    barrier.dstQueueFamilyIndex = m_dstFamily;
+    barrier.image = image;
+    barrier.subresourceRange = range;
+    return barrier;
+}
+
+VkImageMemoryBarrier QueueOwnershipTransfer::GetImageAcquire(VkImage image, const VkImageSubresourceRange& range) const
+{
+    VkImageMemoryBarrier barrier = GetImageRelease(image, range);
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = m_dstAccess;
+    return barrier;
+}
+
+void QueueOwnershipTransfer::RecordRelease(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size) const
+{
+    if (m_release)
+    {
+        VkBufferMemoryBarrier barrier = GetBufferRelease(buffer, offset, size);
+        vkCmdPipelineBarrier(cmd, m_srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+}
+
+void QueueOwnershipTransfer::RecordAcquire(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size) const
+{
+    //Starting at the stage the semaphore is waited at chains the barrier to the wait
+    if (m_acquire)
+    {
+        VkBufferMemoryBarrier barrier = GetBufferAcquire(buffer, offset, size);
+        vkCmdPipelineBarrier(cmd, m_dstStage, m_dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+}
+
+void QueueOwnershipTransfer::RecordRelease(VkCommandBuffer cmd, VkImage image, const VkImageSubresourceRange& range) const
+{
+    if (m_release)
+    {
+        VkImageMemoryBarrier barrier = GetImageRelease(image, range);
+        vkCmdPipelineBarrier(cmd, m_srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+void QueueOwnershipTransfer::RecordAcquire(VkCommandBuffer cmd, VkImage image, const VkImageSubresourceRange& range) const
+{
+    if (m_acquire)
+    {
+        VkImageMemoryBarrier barrier = GetImageAcquire(image, range);
+        vkCmdPipelineBarrier(cmd, m_dstStage, m_dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef __ASYNC_COMPUTE_H__
+#define __ASYNC_COMPUTE_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "QueueTimeline.h"
+
+//How one queue uses a resource handed between queues: its family, and the stage, access and
+//(images only) layout of the use
+struct QueueUse
+{
+    uint32_t m_family = 0;
+    VkPipelineStageFlags m_stage = 0;
+    VkAccessFlags m_access = 0;
+    VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+//Barriers handing a resource from one queue to another, see AsyncCompute::PlanTransfer.
+//The release is recorded on the source queue after its last use, the acquire on the
+//destination queue before its first, in a submit that waits on the source's at m_dstStage.
+//Both halves carry the same families and layouts, the layout changes once.
+struct QueueOwnershipTransfer
+{
+    //Only for an exclusive resource changing queue family
+    bool m_release = false;
+    //Also without an ownership change when an image changes layout
+    bool m_acquire = false;
+    uint32_t m_srcFamily = VK_QUEUE_FAMILY_IGNORED;
+    uint32_t m_dstFamily = VK_QUEUE_FAMILY_IGNORED;
+    VkPipelineStageFlags m_srcStage = 0;
+    VkPipelineStageFlags m_dstStage = 0;
+    VkAccessFlags m_srcAccess = 0;
+    VkAccessFlags m_dstAccess = 0;
+    VkImageLayout m_oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout m_newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    //A range of the buffer, for buffers whose regions change queue independently
+    VkBufferMemoryBarrier GetBufferRelease(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+    VkBufferMemoryBarrier GetBufferAcquire(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+    VkImageMemoryBarrier GetImageRelease(VkImage image, const VkImageSubresourceRange& range) const;
+    VkImageMemoryBarrier GetImageAcquire(VkImage image, const VkImageSubresourceRange& range) const;
+
+    //Nothing is recorded for a half that isn't needed
+    void RecordRelease(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+    void RecordAcquire(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+    void RecordRelease(VkCommandBuffer cmd, VkImage image, const VkImageSubresourceRange& range) const;
+    void RecordAcquire(VkCommandBuffer cmd, VkImage image, const VkImageSubresourceRange& range) const;
+};
+
+//Compute work (particle simulation, culling, light binning...) submitted every frame to its
+//own queue, ahead of the graphics submit that consumes it. The graphics submit waits on the
+//compute timeline (or a binary semaphore without timeline semaphores) at the first stage
+//that reads the results, so everything before that stage, and the previous frame's raster
+//work, overlaps the compute.
+//Without a compute-only queue family the same submits go to the graphics queue, the
+//semaphores keep the ordering and nothing else changes for the jobs.
+//Resources shared with graphics are easiest made VK_SHARING_MODE_CONCURRENT over both
+//families, exclusive ones need queue family ownership transfers (PlanTransfer) recorded by
+//the jobs and the graphics passes reading their results.
+class AsyncCompute
+{
+public:
+    using RecordFunc = std::function<void(VkCommandBuffer cmd, uint32_t frame)>;
+
+    //dedicated says whether queue is separate from the graphics queue, timelineSemaphores
+    //whether VK_KHR_timeline_semaphore is enabled and loaded
+    void Init(VkDevice device, VkQueue queue, uint32_t queueFamily, bool dedicated, uint32_t framesInFlight, bool timelineSemaphores);
+    void Destroy();
+
+    //Recorded every frame in the order added. consumerStage is the first graphics stage
+    //that reads what the job writes.
+    void AddJob(const std::string& name, VkPipelineStageFlags consumerStage, RecordFunc record);
+    bool HasJobs() const { return !m_jobs.empty(); }
+
+    bool IsDedicated() const { return m_dedicated; }
+    uint32_t GetQueueFamily() const { return m_queueFamily; }
+
+    //Records and submits this frame's jobs. The returned point has to be waited on by the
+    //frame's graphics submit at GetConsumerStages(). wait (optional) is waited on first,
+    //for jobs reading something graphics produced.
+    SyncPoint Submit(uint32_t frame, const SyncPoint& wait = SyncPoint(), VkPipelineStageFlags waitStage = 0);
+    VkPipelineStageFlags GetConsumerStages() const { return m_consumerStages; }
+
+    //The barriers taking a resource of the given sharing mode from one use to the next. Only
+    //an exclusive resource moving between different families changes owner, everything
+    //else is ordered by the semaphore between the submits and at most changes layout.
+    static QueueOwnershipTransfer PlanTransfer(const QueueUse& from, const QueueUse& to, VkSharingMode sharingMode);
+
+private:
+    struct Job
+    {
+        std::string m_name;
+        RecordFunc m_record;
+    };
+
+    struct FrameResources
+    {
+        VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+        //Only without timeline semaphores, graphics waits on the timeline otherwise
+        VkSemaphore m_finished = VK_NULL_HANDLE;
+        //Timeline value of the command buffer's last submit
+        uint64_t m_value = 0;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    uint32_t m_queueFamily = 0;
+    bool m_dedicated = false;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    QueueTimeline m_timeline;
+    std::vector<FrameResources> m_frames;
+    std::vector<Job> m_jobs;
+    VkPipelineStageFlags m_consumerStages = 0;
+};
+
+#endif // !__ASYNC_COMPUTE_H__
@@ -0,0 +1,39 @@
+#include "Camera.h"
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+void Camera::SetPerspective(float fovY, float aspect, float zNear, float zFar)
+{
+    m_projection = MakeReverseZPerspective(fovY, aspect, zNear, zFar);
+}
+
+void Camera::LookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up)
+{
+    m_view = glm::lookAtRH(eye, target, up);
+}
+
+glm::mat4 Camera::MakeReverseZPerspective(float fovY, float aspect, float zNear, float zFar)
+{
+    //Passing far as near (and vice versa) to the zero to one projection is all reversing takes
+    glm::mat4 projection = glm::perspectiveRH_ZO(fovY, aspect, zFar, zNear);
+
+    //Vulkan's clip space Y points down
+    projection[1][1] *= -1.0f;
+
+    return projection;
+}
+
+glm::mat4 Camera::MakeReverseZInfinitePerspective(float fovY, float aspect, float zNear)
+{
+    //Limit of the reversed projection as far goes to infinity: z_clip = near, w_clip = -z_view
+    const float focal = 1.0f / glm::tan(fovY * 0.5f);
+
+    glm::mat4 projection(0.0f);
+    projection[0][0] = focal / aspect;
+    projection[1][1] = -focal;
+    projection[2][3] = -1.0f;
+    projection[3][2] = zNear;
+
+    return projection;
+}
@@ -0,0 +1,30 @@
+#ifndef __CAMERA_H__
+#define __CAMERA_H__
+
+#include <glm/glm.hpp>
+
+//Perspective camera using reversed-Z: the near plane maps to depth 1 and the far plane to 0.
+//Floating point depth is most precise near 0, so flipping the range spreads that precision
+//over the distance instead of bunching it up right in front of the camera.
+//Pair with a float depth buffer cleared to 0 and a GREATER depth test.
+class Camera
+{
+public:
+    void SetPerspective(float fovY, float aspect, float zNear, float zFar);
+    void LookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up = glm::vec3(0.0f, 1.0f, 0.0f));
+
+    const glm::mat4& GetView() const { return m_view; }
+    const glm::mat4& GetProjection() const { return m_projection; }
+    glm::mat4 GetViewProjection() const { return m_projection * m_view; }
+
+    //Zero to one depth with near and far swapped, Y flipped for Vulkan's clip space
+    static glm::mat4 MakeReverseZPerspective(float fovY, float aspect, float zNear, float zFar);
+    //Same thing with the far plane at infinity, depth only reaches 0 in the limit
+    static glm::mat4 MakeReverseZInfinitePerspective(float fovY, float aspect, float zNear);
+
+private:
+    glm::mat4 m_view = glm::mat4(1.0f);
+    glm::mat4 m_projection = glm::mat4(1.0f);
+};
+
+#endif // !__CAMERA_H__
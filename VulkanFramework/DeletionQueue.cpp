@@ -0,0 +1,118 @@
+#include "DeletionQueue.h"
+
+#include <stdexcept>
+
+#include "Profiler.h"
+#include "QueueTimeline.h"
+
+void DeletionQueue::Init(VkDevice device, QueueTimeline* timeline)
+{
+    m_device = device;
+    m_timeline = timeline;
+}
+
+uint64_t DeletionQueue::GetNextValue() const
+{
+    if (m_timeline == nullptr)
+    {
+        throw std::runtime_error("Deletion queue used before Init!");
+    }
+
+    return m_timeline->GetLastSubmitted() + 1;
+}
+
+void DeletionQueue::Push(Type type, uint64_t handle, uint64_t value)
+{
+    //Destroying a null handle is a no-op anyway
+    if (handle == 0)
+    {
+        return;
+    }
+
+    Insert({ value, type, handle, 0 });
+}
+
+void DeletionQueue::Defer(std::function<void()> destroy, uint64_t value)
+{
+    uint32_t callback;
+    if (!m_freeCallbacks.empty())
+    {
+        callback = m_freeCallbacks.back();
+        m_freeCallbacks.pop_back();
+        m_callbacks[callback] = std::move(destroy);
+    }
+    else
+    {
+        callback = static_cast<uint32_t>(m_callbacks.size());
+        m_callbacks.push_back(std::move(destroy));
+    }
+
+    Insert({ value, Type::Callback, 0, callback });
+}
+
+void DeletionQueue::Insert(const Entry& entry)
+{
+    //Walk back past anything retiring later, equal values keep the order they were queued in
+    //so a framebuffer queued before its views still goes first
+    auto it = m_entries.end();
+    while (it != m_entries.begin() && (it - 1)->m_value > entry.m_value)
+    {
+        it--;
+    }
+
+    m_entries.insert(it, entry);
+}
+
+void DeletionQueue::Drain()
+{
+    if (m_entries.empty())
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("DrainDeletions");
+
+    uint64_t completed = m_timeline->GetCompletedValue();
+    while (!m_entries.empty() && m_entries.front().m_value <= completed)
+    {
+        DestroyEntry(m_entries.front());
+        m_entries.pop_front();
+    }
+}
+
+void DeletionQueue::Flush()
+{
+    for (const Entry& entry : m_entries)
+    {
+        DestroyEntry(entry);
+    }
+
+    m_entries.clear();
+    m_callbacks.clear();
+    m_freeCallbacks.clear();
+}
+
+void DeletionQueue::DestroyEntry(const Entry& entry)
+{
+    switch (entry.m_type)
+    {
+    case Type::Buffer: vkDestroyBuffer(m_device, (VkBuffer)entry.m_handle, nullptr); break;
+    case Type::Image: vkDestroyImage(m_device, (VkImage)entry.m_handle, nullptr); break;
+    case Type::ImageView: vkDestroyImageView(m_device, (VkImageView)entry.m_handle, nullptr); break;
+    case Type::Memory: vkFreeMemory(m_device, (VkDeviceMemory)entry.m_handle, nullptr); break;
+    case Type::Sampler: vkDestroySampler(m_device, (VkSampler)entry.m_handle, nullptr); break;
+    case Type::Framebuffer: vkDestroyFramebuffer(m_device, (VkFramebuffer)entry.m_handle, nullptr); break;
+    case Type::Pipeline: vkDestroyPipeline(m_device, (VkPipeline)entry.m_handle, nullptr); break;
+    case Type::PipelineLayout: vkDestroyPipelineLayout(m_device, (VkPipelineLayout)entry.m_handle, nullptr); break;
+    case Type::ShaderModule: vkDestroyShaderModule(m_device, (VkShaderModule)entry.m_handle, nullptr); break;
+    case Type::DescriptorPool: vkDestroyDescriptorPool(m_device, (VkDescriptorPool)entry.m_handle, nullptr); break;
+    case Type::QueryPool: vkDestroyQueryPool(m_device, (VkQueryPool)entry.m_handle, nullptr); break;
+    case Type::Callback:
+        m_callbacks[entry.m_callback]();
+        m_callbacks[entry.m_callback] = nullptr;
+        m_freeCallbacks.push_back(entry.m_callback);
+        break;
+    }
+
+    m_destroyedCount++;
+}
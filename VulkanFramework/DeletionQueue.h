@@ -0,0 +1,105 @@
+#ifndef __DELETION_QUEUE_H__
+#define __DELETION_QUEUE_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+class QueueTimeline;
+
+//Destroys resources once the GPU is done with them instead of when the CPU is. Every
+//destroy is queued with the graphics timeline value of the last submit that can use the
+//resource, Drain (once a frame) then destroys everything the timeline has passed in one go.
+//Swapchain recreation, hot reload and streaming can drop resources mid-frame this way
+//without vkDeviceWaitIdle.
+//By default a destroy waits for the submit that follows it, i.e. the frame being recorded.
+//Resources that were never submitted can pass the timeline's completed value instead.
+class DeletionQueue
+{
+public:
+    void Init(VkDevice device, QueueTimeline* timeline);
+
+    //Retire after the next submit on the timeline
+    void DestroyBuffer(VkBuffer buffer) { DestroyBuffer(buffer, GetNextValue()); }
+    void DestroyImage(VkImage image) { DestroyImage(image, GetNextValue()); }
+    void DestroyImageView(VkImageView view) { DestroyImageView(view, GetNextValue()); }
+    void FreeMemory(VkDeviceMemory memory) { FreeMemory(memory, GetNextValue()); }
+    void DestroySampler(VkSampler sampler) { DestroySampler(sampler, GetNextValue()); }
+    void DestroyFramebuffer(VkFramebuffer framebuffer) { DestroyFramebuffer(framebuffer, GetNextValue()); }
+    void DestroyPipeline(VkPipeline pipeline) { DestroyPipeline(pipeline, GetNextValue()); }
+    void DestroyPipelineLayout(VkPipelineLayout layout) { DestroyPipelineLayout(layout, GetNextValue()); }
+    void DestroyShaderModule(VkShaderModule module) { DestroyShaderModule(module, GetNextValue()); }
+    void DestroyDescriptorPool(VkDescriptorPool pool) { DestroyDescriptorPool(pool, GetNextValue()); }
+    void DestroyQueryPool(VkQueryPool pool) { DestroyQueryPool(pool, GetNextValue()); }
+    //Anything the typed ones don't cover
+    void Defer(std::function<void()> destroy) { Defer(std::move(destroy), GetNextValue()); }
+
+    //Retire once the timeline reaches value
+    void DestroyBuffer(VkBuffer buffer, uint64_t value) { Push(Type::Buffer, (uint64_t)buffer, value); }
+    void DestroyImage(VkImage image, uint64_t value) { Push(Type::Image, (uint64_t)image, value); }
+    void DestroyImageView(VkImageView view, uint64_t value) { Push(Type::ImageView, (uint64_t)view, value); }
+    void FreeMemory(VkDeviceMemory memory, uint64_t value) { Push(Type::Memory, (uint64_t)memory, value); }
+    void DestroySampler(VkSampler sampler, uint64_t value) { Push(Type::Sampler, (uint64_t)sampler, value); }
+    void DestroyFramebuffer(VkFramebuffer framebuffer, uint64_t value) { Push(Type::Framebuffer, (uint64_t)framebuffer, value); }
+    void DestroyPipeline(VkPipeline pipeline, uint64_t value) { Push(Type::Pipeline, (uint64_t)pipeline, value); }
+    void DestroyPipelineLayout(VkPipelineLayout layout, uint64_t value) { Push(Type::PipelineLayout, (uint64_t)layout, value); }
+    void DestroyShaderModule(VkShaderModule module, uint64_t value) { Push(Type::ShaderModule, (uint64_t)module, value); }
+    void DestroyDescriptorPool(VkDescriptorPool pool, uint64_t value) { Push(Type::DescriptorPool, (uint64_t)pool, value); }
+    void DestroyQueryPool(VkQueryPool pool, uint64_t value) { Push(Type::QueryPool, (uint64_t)pool, value); }
+    void Defer(std::function<void()> destroy, uint64_t value);
+
+    //Destroys everything the GPU has finished with, never blocks
+    void Drain();
+    //Destroys everything regardless, the device has to be idle
+    void Flush();
+
+    size_t GetPendingCount() const { return m_entries.size(); }
+    uint64_t GetDestroyedCount() const { return m_destroyedCount; }
+
+private:
+    enum class Type : uint8_t
+    {
+        Buffer,
+        Image,
+        ImageView,
+        Memory,
+        Sampler,
+        Framebuffer,
+        Pipeline,
+        PipelineLayout,
+        ShaderModule,
+        DescriptorPool,
+        QueryPool,
+        Callback
+    };
+
+    struct Entry
+    {
+        uint64_t m_value;
+        Type m_type;
+        uint64_t m_handle;
+        //Callback only, index into m_callbacks
+        uint32_t m_callback;
+    };
+
+    uint64_t GetNextValue() const;
+    void Push(Type type, uint64_t handle, uint64_t value);
+    void Insert(const Entry& entry);
+    void DestroyEntry(const Entry& entry);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    QueueTimeline* m_timeline = nullptr;
+
+    //Sorted by value, entries are almost always pushed in order so inserting is a push_back
+    std::deque<Entry> m_entries;
+    //Slots of drained callbacks are reused
+    std::vector<std::function<void()>> m_callbacks;
+    std::vector<uint32_t> m_freeCallbacks;
+    uint64_t m_destroyedCount = 0;
+};
+
+#endif // !__DELETION_QUEUE_H__
@@ -0,0 +1,88 @@
+#include "DeviceCaps.h"
+
+//Last format of the core (non extension) range
+static const VkFormat LAST_CORE_FORMAT = VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+
+void DeviceCaps::Query(VkPhysicalDevice physicalDevice)
+{
+    m_physicalDevice = physicalDevice;
+
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &m_properties);
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &m_features);
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+    m_queueFamilies.resize(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, m_queueFamilies.data());
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    m_extensions.clear();
+    for (const auto& extension : extensions)
+    {
+        m_extensions.insert(extension.extensionName);
+    }
+
+    //A couple of hundred cheap calls, and format checks never hit the driver again
+    m_formats.resize(LAST_CORE_FORMAT + 1);
+    for (uint32_t format = 0; format <= LAST_CORE_FORMAT; format++)
+    {
+        vkGetPhysicalDeviceFormatProperties(m_physicalDevice, static_cast<VkFormat>(format), &m_formats[format]);
+    }
+}
+
+void DeviceCaps::RefreshSurface(VkSurfaceKHR surface)
+{
+    //The vectors keep their capacity, a refresh normally doesn't allocate
+    m_surfaceSupport.m_capabilities = {};
+    m_surfaceSupport.m_formats.clear();
+    m_surfaceSupport.m_presentModes.clear();
+    m_presentSupport.assign(m_queueFamilies.size(), VK_FALSE);
+
+    if (surface == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, surface, &m_surfaceSupport.m_capabilities);
+
+    uint32_t formatCount = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(m_physicalDevice, surface, &formatCount, nullptr);
+    m_surfaceSupport.m_formats.resize(formatCount);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(m_physicalDevice, surface, &formatCount, m_surfaceSupport.m_formats.data());
+
+    uint32_t presentModeCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, surface, &presentModeCount, nullptr);
+    m_surfaceSupport.m_presentModes.resize(presentModeCount);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, surface, &presentModeCount, m_surfaceSupport.m_presentModes.data());
+
+    for (uint32_t i = 0; i < m_queueFamilies.size(); i++)
+    {
+        vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, i, surface, &m_presentSupport[i]);
+    }
+}
+
+VkFormatProperties DeviceCaps::GetFormatProperties(VkFormat format) const
+{
+    if (format >= 0 && static_cast<size_t>(format) < m_formats.size())
+    {
+        return m_formats[format];
+    }
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+
+    return properties;
+}
+
+bool DeviceCaps::SupportsFormat(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) const
+{
+    VkFormatProperties properties = GetFormatProperties(format);
+    VkFormatFeatureFlags supported = tiling == VK_IMAGE_TILING_LINEAR ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+
+    return (supported & features) == features;
+}
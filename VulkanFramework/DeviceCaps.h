@@ -0,0 +1,59 @@
+#ifndef __DEVICE_CAPS_H__
+#define __DEVICE_CAPS_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct SwapChainSupportDetails {
+    VkSurfaceCapabilitiesKHR m_capabilities;
+    std::vector<VkSurfaceFormatKHR> m_formats;
+    std::vector<VkPresentModeKHR> m_presentModes;
+};
+
+//Everything the renderer asks a physical device, queried once when the device is looked at
+//instead of on every use. Only the surface part can go stale (the window resizes, moves to
+//another monitor...), RefreshSurface re-queries just that before a swapchain is (re)created.
+class DeviceCaps
+{
+public:
+    //Properties, features, memory, queue families, extensions and the format table
+    void Query(VkPhysicalDevice physicalDevice);
+    //Surface capabilities, formats, present modes and which families can present to it.
+    //A null surface clears it, so headless devices have no present support at all.
+    void RefreshSurface(VkSurfaceKHR surface);
+
+    VkPhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
+    const VkPhysicalDeviceProperties& GetProperties() const { return m_properties; }
+    const VkPhysicalDeviceLimits& GetLimits() const { return m_properties.limits; }
+    const VkPhysicalDeviceFeatures& GetFeatures() const { return m_features; }
+    const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const { return m_memoryProperties; }
+    const std::vector<VkQueueFamilyProperties>& GetQueueFamilies() const { return m_queueFamilies; }
+
+    bool HasExtension(const std::string& name) const { return m_extensions.count(name) != 0; }
+
+    //Core formats come from the table, anything from an extension is queried on the spot
+    VkFormatProperties GetFormatProperties(VkFormat format) const;
+    bool SupportsFormat(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) const;
+
+    const SwapChainSupportDetails& GetSurfaceSupport() const { return m_surfaceSupport; }
+    bool CanPresent(uint32_t queueFamily) const { return queueFamily < m_presentSupport.size() && m_presentSupport[queueFamily]; }
+
+private:
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_properties = {};
+    VkPhysicalDeviceFeatures m_features = {};
+    VkPhysicalDeviceMemoryProperties m_memoryProperties = {};
+    std::vector<VkQueueFamilyProperties> m_queueFamilies;
+    std::unordered_set<std::string> m_extensions;
+    //Indexed by VkFormat, every core format up to the last ASTC one
+    std::vector<VkFormatProperties> m_formats;
+
+    SwapChainSupportDetails m_surfaceSupport = {};
+    std::vector<VkBool32> m_presentSupport;
+};
+
+#endif // !__DEVICE_CAPS_H__
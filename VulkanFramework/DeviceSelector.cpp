@@ -0,0 +1,226 @@
+#include "DeviceSelector.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+const char* const DeviceSelector::OVERRIDE_ENV = "VF_DEVICE";
+
+namespace
+{
+    //Device type dwarfs everything else, a discrete GPU with nothing optional still beats
+    //an integrated one with everything
+    const int64_t TYPE_DISCRETE = 1000000;
+    const int64_t TYPE_INTEGRATED = 500000;
+    const int64_t TYPE_VIRTUAL = 200000;
+    const int64_t FEATURE_POINTS = 20000;
+    const int64_t QUEUE_POINTS = 10000;
+    //One point per MiB, capped so VRAM can't outweigh the device type
+    const int64_t MAX_VRAM_POINTS = 256 * 1024;
+
+    const char* GetTypeName(VkPhysicalDeviceType type)
+    {
+        switch (type)
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+        default: return "other";
+        }
+    }
+
+    std::string ToLower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+}
+
+DeviceCandidate DeviceCandidate::FromCaps(const DeviceCaps& caps)
+{
+    DeviceCandidate candidate;
+    candidate.m_name = caps.GetProperties().deviceName;
+    candidate.m_type = caps.GetProperties().deviceType;
+
+    const VkPhysicalDeviceMemoryProperties& memProperties = caps.GetMemoryProperties();
+    for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++)
+    {
+        if (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        {
+            candidate.m_deviceLocalBytes += memProperties.memoryHeaps[i].size;
+        }
+    }
+
+    candidate.m_timelineSemaphore = caps.HasExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    candidate.m_descriptorIndexing = caps.HasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    candidate.m_drawIndirectCount = caps.HasExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+    for (const auto& queueFamily : caps.GetQueueFamilies())
+    {
+        bool graphics = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        bool compute = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+        bool transfer = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0;
+
+        candidate.m_asyncComputeQueue |= compute && !graphics;
+        candidate.m_transferQueue |= transfer && !graphics && !compute;
+    }
+
+    return candidate;
+}
+
+DeviceSelection DeviceSelector::Select(const std::vector<DeviceCandidate>& candidates, const DeviceRequirements& requirements, const std::string& deviceOverride)
+{
+    DeviceSelection selection;
+
+    for (uint32_t i = 0; i < candidates.size(); i++)
+    {
+        selection.m_scores.push_back(Score(candidates[i], requirements));
+
+        //Ties go to the first one, that's the order the driver lists them in
+        const DeviceScore& score = selection.m_scores.back();
+        if (!score.m_rejected && (selection.m_chosen < 0 || score.m_score > selection.m_scores[selection.m_chosen].m_score))
+        {
+            selection.m_chosen = static_cast<int32_t>(i);
+        }
+    }
+
+    if (deviceOverride.empty())
+    {
+        return selection;
+    }
+
+    int32_t overridden = FindOverride(candidates, deviceOverride);
+    if (overridden < 0)
+    {
+        selection.m_overrideWarning = "no device matches \"" + deviceOverride + "\"";
+    }
+    else if (selection.m_scores[overridden].m_rejected)
+    {
+        selection.m_overrideWarning = candidates[overridden].m_name + " was asked for but is rejected";
+    }
+    else
+    {
+        selection.m_chosen = overridden;
+        selection.m_overridden = true;
+    }
+
+    return selection;
+}
+
+DeviceScore DeviceSelector::Score(const DeviceCandidate& candidate, const DeviceRequirements& requirements)
+{
+    DeviceScore score;
+
+    auto reject = [&score](const std::string& reason)
+    {
+        score.m_rejected = true;
+        score.m_reason = reason;
+        return score;
+    };
+
+    if (!candidate.m_unsupportedReason.empty())
+    {
+        return reject(candidate.m_unsupportedReason);
+    }
+    if (requirements.m_timelineSemaphore && !candidate.m_timelineSemaphore)
+    {
+        return reject("no timeline semaphores");
+    }
+    if (requirements.m_descriptorIndexing && !candidate.m_descriptorIndexing)
+    {
+        return reject("no descriptor indexing");
+    }
+    if (requirements.m_drawIndirectCount && !candidate.m_drawIndirectCount)
+    {
+        return reject("no draw indirect count");
+    }
+
+    switch (candidate.m_type)
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score.m_score += TYPE_DISCRETE; break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score.m_score += TYPE_INTEGRATED; break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score.m_score += TYPE_VIRTUAL; break;
+    default: break;
+    }
+
+    int64_t vramMiB = static_cast<int64_t>(candidate.m_deviceLocalBytes / (1024 * 1024));
+    score.m_score += std::min(vramMiB, MAX_VRAM_POINTS);
+    score.m_reason = std::string(GetTypeName(candidate.m_type)) + ", " + std::to_string(vramMiB) + " MiB";
+
+    auto addPoints = [&score](bool has, int64_t points, const char* name)
+    {
+        if (has)
+        {
+            score.m_score += points;
+            score.m_reason += std::string(", ") + name;
+        }
+    };
+    addPoints(candidate.m_timelineSemaphore, FEATURE_POINTS, "timeline semaphores");
+    addPoints(candidate.m_descriptorIndexing, FEATURE_POINTS, "descriptor indexing");
+    addPoints(candidate.m_drawIndirectCount, FEATURE_POINTS, "draw indirect count");
+    addPoints(candidate.m_asyncComputeQueue, QUEUE_POINTS, "async compute");
+    addPoints(candidate.m_transferQueue, QUEUE_POINTS, "transfer queue");
+
+    return score;
+}
+
+int32_t DeviceSelector::FindOverride(const std::vector<DeviceCandidate>& candidates, const std::string& deviceOverride)
+{
+    //All digits is an index, anything else is matched against the names
+    if (std::all_of(deviceOverride.begin(), deviceOverride.end(), [](unsigned char c) { return std::isdigit(c) != 0; }))
+    {
+        size_t index = std::stoul(deviceOverride);
+        return index < candidates.size() ? static_cast<int32_t>(index) : -1;
+    }
+
+    std::string wanted = ToLower(deviceOverride);
+    for (uint32_t i = 0; i < candidates.size(); i++)
+    {
+        if (ToLower(candidates[i].m_name).find(wanted) != std::string::npos)
+        {
+            return static_cast<int32_t>(i);
+        }
+    }
+
+    return -1;
+}
+
+std::string DeviceSelector::GetEnvironmentOverride()
+{
+    const char* value = std::getenv(OVERRIDE_ENV);
+
+    return value != nullptr ? value : "";
+}
+
+void DeviceSelector::PrintSelection(std::ostream& out, const std::vector<DeviceCandidate>& candidates, const DeviceSelection& selection)
+{
+    if (!selection.m_overrideWarning.empty())
+    {
+        out << "device override ignored: " << selection.m_overrideWarning << std::endl;
+    }
+
+    for (uint32_t i = 0; i < candidates.size(); i++)
+    {
+        const DeviceScore& score = selection.m_scores[i];
+
+        if (static_cast<int32_t>(i) == selection.m_chosen)
+        {
+            out << "device " << i << " chosen" << (selection.m_overridden ? " (override)" : "") << ": ";
+        }
+        else
+        {
+            out << "device " << i << (score.m_rejected ? " rejected: " : " passed over: ");
+        }
+
+        out << candidates[i].m_name;
+        if (score.m_rejected)
+        {
+            out << " (" << score.m_reason << ")" << std::endl;
+        }
+        else
+        {
+            out << " (score " << score.m_score << ": " << score.m_reason << ")" << std::endl;
+        }
+    }
+}
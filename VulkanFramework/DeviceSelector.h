@@ -0,0 +1,86 @@
+#ifndef __DEVICE_SELECTOR_H__
+#define __DEVICE_SELECTOR_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DeviceCaps.h"
+
+//What device selection knows about one physical device. Plain data so selection can be
+//run on a made up list without a driver.
+struct DeviceCandidate
+{
+    std::string m_name;
+    VkPhysicalDeviceType m_type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+    VkDeviceSize m_deviceLocalBytes = 0;
+
+    //Optional features, detected by their extensions since the instance is Vulkan 1.0
+    bool m_timelineSemaphore = false;
+    bool m_descriptorIndexing = false;
+    bool m_drawIndirectCount = false;
+
+    //Queue families without graphics, so compute and copies can overlap rendering
+    bool m_asyncComputeQueue = false;
+    bool m_transferQueue = false;
+
+    //Why the renderer can't run on it at all (no swapchain, no graphics queue...), empty if it can
+    std::string m_unsupportedReason;
+
+    static DeviceCandidate FromCaps(const DeviceCaps& caps);
+};
+
+//Features a device is rejected without
+struct DeviceRequirements
+{
+    bool m_timelineSemaphore = false;
+    bool m_descriptorIndexing = false;
+    bool m_drawIndirectCount = false;
+};
+
+struct DeviceScore
+{
+    int64_t m_score = 0;
+    bool m_rejected = false;
+    //Why it was rejected, or what it scored for
+    std::string m_reason;
+};
+
+struct DeviceSelection
+{
+    //Index into the candidates, -1 if none can be used
+    int32_t m_chosen = -1;
+    //One per candidate, same order
+    std::vector<DeviceScore> m_scores;
+    bool m_overridden = false;
+    //Set when an override was given but couldn't be honoured
+    std::string m_overrideWarning;
+};
+
+//Ranks devices: discrete over integrated over virtual over CPU, then VRAM, optional
+//features and dedicated queues. The override (a device index or part of its name)
+//wins over the score as long as the device isn't rejected.
+class DeviceSelector
+{
+public:
+    //Environment variable the override is read from when there's none in the settings
+    static const char* const OVERRIDE_ENV;
+
+    static DeviceSelection Select(const std::vector<DeviceCandidate>& candidates, const DeviceRequirements& requirements, const std::string& deviceOverride);
+
+    //The override from OVERRIDE_ENV, empty if it isn't set
+    static std::string GetEnvironmentOverride();
+
+    //One line per device, chosen or rejected and why
+    static void PrintSelection(std::ostream& out, const std::vector<DeviceCandidate>& candidates, const DeviceSelection& selection);
+
+private:
+    static DeviceScore Score(const DeviceCandidate& candidate, const DeviceRequirements& requirements);
+    static int32_t FindOverride(const std::vector<DeviceCandidate>& candidates, const std::string& deviceOverride);
+};
+
+#endif // !__DEVICE_SELECTOR_H__
@@ -0,0 +1,175 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    static_assert(FrameArena::MAX_THREADS <= 64, "thread indices are bits of a uint64_t");
+
+    //Bit per thread index a live thread holds
+    std::atomic<uint64_t> s_threadIndices = { 0 };
+
+    //Lives in thread local storage, so the index is handed back when its thread exits.
+    //A thread that takes it over later also takes over that thread's arenas, which is fine,
+    //nothing allocated from them can outlive the thread that allocated it.
+    struct ThreadIndex
+    {
+        ThreadIndex()
+        {
+            uint64_t used = s_threadIndices.load(std::memory_order_relaxed);
+            do
+            {
+                if (used == UINT64_MAX >> (64 - FrameArena::MAX_THREADS))
+                {
+                    throw std::runtime_error("Too many threads allocating from frame arenas!");
+                }
+
+                m_index = 0;
+                while (used & (1ull << m_index))
+                {
+                    m_index++;
+                }
+            } while (!s_threadIndices.compare_exchange_weak(used, used | (1ull << m_index), std::memory_order_acquire, std::memory_order_relaxed));
+        }
+
+        ~ThreadIndex()
+        {
+            s_threadIndices.fetch_and(~(1ull << m_index), std::memory_order_release);
+        }
+
+        uint32_t m_index = 0;
+    };
+}
+
+LinearArena::LinearArena(size_t blockSize, std::pmr::memory_resource* upstream) :
+    m_upstream(upstream),
+    m_blockSize(blockSize)
+{
+}
+
+LinearArena::~LinearArena()
+{
+    for (const Block& block : m_blocks)
+    {
+        m_upstream->deallocate(block.m_data, block.m_size, alignof(std::max_align_t));
+    }
+}
+
+void LinearArena::Reset()
+{
+    m_currentBlock = 0;
+    m_offset = 0;
+    m_used = 0;
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+{
+    //Walks forward until something fits, blocks skipped here are only lost until the next Reset
+    for (; m_currentBlock < m_blocks.size(); m_currentBlock++, m_offset = 0)
+    {
+        const Block& block = m_blocks[m_currentBlock];
+        uintptr_t address = reinterpret_cast<uintptr_t>(block.m_data) + m_offset;
+        size_t padding = (alignment - address % alignment) % alignment;
+
+        if (m_offset + padding + bytes <= block.m_size)
+        {
+            m_offset += padding + bytes;
+            m_used += bytes;
+            return reinterpret_cast<void*>(address + padding);
+        }
+    }
+
+    //Out of blocks, oversized requests get a block of their own
+    Block block;
+    block.m_size = std::max(m_blockSize, bytes + alignment);
+    block.m_data = static_cast<std::byte*>(m_upstream->allocate(block.m_size, alignof(std::max_align_t)));
+    m_blocks.push_back(block);
+    m_capacity += block.m_size;
+    m_upstreamAllocations++;
+
+    m_currentBlock = m_blocks.size() - 1;
+    m_offset = 0;
+
+    return do_allocate(bytes, alignment);
+}
+
+void FrameArena::Init(uint32_t slotCount, size_t blockSize, std::pmr::memory_resource* upstream)
+{
+    m_slots = std::vector<Slot>(slotCount);
+    m_currentSlot = 0;
+    m_blockSize = blockSize;
+    m_upstream = upstream;
+    m_peakFrameBytes = 0;
+}
+
+void FrameArena::Destroy()
+{
+    m_slots.clear();
+}
+
+void FrameArena::BeginFrame(uint32_t slot)
+{
+    //What the frame that's about to be overwritten ended up using
+    m_peakFrameBytes = std::max(m_peakFrameBytes, GetFrameBytes());
+
+    for (auto& arena : m_slots.at(slot).m_threadArenas)
+    {
+        if (arena != nullptr)
+        {
+            arena->Reset();
+        }
+    }
+
+    m_currentSlot.store(slot, std::memory_order_release);
+}
+
+LinearArena& FrameArena::GetThreadArena()
+{
+    Slot& slot = m_slots[m_currentSlot.load(std::memory_order_acquire)];
+    std::unique_ptr<LinearArena>& arena = slot.m_threadArenas[GetThreadIndex()];
+
+    //Only ever created by its own thread, the first time it allocates in this slot
+    if (arena == nullptr)
+    {
+        arena = std::make_unique<LinearArena>(m_blockSize, m_upstream);
+    }
+
+    return *arena;
+}
+
+size_t FrameArena::GetFrameBytes() const
+{
+    if (m_slots.empty())
+    {
+        return 0;
+    }
+
+    size_t bytes = 0;
+    for (const auto& arena : m_slots[m_currentSlot.load(std::memory_order_acquire)].m_threadArenas)
+    {
+        bytes += arena != nullptr ? arena->GetUsed() : 0;
+    }
+
+    return bytes;
+}
+
+uint64_t FrameArena::GetUpstreamAllocations() const
+{
+    uint64_t allocations = 0;
+    for (const Slot& slot : m_slots)
+    {
+        for (const auto& arena : slot.m_threadArenas)
+        {
+            allocations += arena != nullptr ? arena->GetUpstreamAllocations() : 0;
+        }
+    }
+
+    return allocations;
+}
+
+uint32_t FrameArena::GetThreadIndex()
+{
+    thread_local ThreadIndex index;
+    return index.m_index;
+}
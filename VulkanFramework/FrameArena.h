@@ -0,0 +1,105 @@
+#ifndef __FRAME_ARENA_H__
+#define __FRAME_ARENA_H__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+//Bump allocator over a chain of fixed size blocks. Deallocation does nothing, Reset rewinds
+//to the first block and keeps every block for reuse, so once the arena has grown to what a
+//frame needs it never goes back to the upstream resource.
+//Single threaded, every thread gets its own (see FrameArena).
+class LinearArena : public std::pmr::memory_resource
+{
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    explicit LinearArena(size_t blockSize = DEFAULT_BLOCK_SIZE, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~LinearArena();
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    //Everything allocated before is gone, doesn't touch the blocks themselves
+    void Reset();
+
+    //Bytes handed out since the last Reset
+    size_t GetUsed() const { return m_used; }
+    size_t GetCapacity() const { return m_capacity; }
+    //Blocks requested from upstream over the arena's life
+    uint64_t GetUpstreamAllocations() const { return m_upstreamAllocations; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override { }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    struct Block
+    {
+        std::byte* m_data;
+        size_t m_size;
+    };
+
+    std::pmr::memory_resource* m_upstream;
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    //Block being bumped, and the offset into it
+    size_t m_currentBlock = 0;
+    size_t m_offset = 0;
+    size_t m_used = 0;
+    size_t m_capacity = 0;
+    uint64_t m_upstreamAllocations = 0;
+};
+
+//Per frame in flight scratch memory: draw lists, culling output, uniform staging, recording
+//scratch. Everything allocated during a frame is released at once when that frame slot comes
+//around again, which is only safe after the wait on the slot's previous submit.
+//Each thread gets its own arena per slot, so allocating never locks. Hand GetResource() to
+//std::pmr containers; they must not outlive the frame.
+class FrameArena
+{
+public:
+    //Threads that can allocate from frame arenas at the same time, the main thread included.
+    //A thread's index goes back to the pool when it exits.
+    static const uint32_t MAX_THREADS = 64;
+
+    void Init(uint32_t slotCount, size_t blockSize = LinearArena::DEFAULT_BLOCK_SIZE, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    void Destroy();
+
+    //Main thread, once the GPU is done with everything slot was used for. Rewinds every
+    //thread's arena of that slot and makes it current.
+    void BeginFrame(uint32_t slot);
+
+    //Calling thread's arena for the current frame. Workers have to be done with the frame
+    //before the slot's next BeginFrame, the job system waits make sure of that.
+    std::pmr::memory_resource* GetResource() { return &GetThreadArena(); }
+    LinearArena& GetThreadArena();
+
+    //Over every thread, for the current frame
+    size_t GetFrameBytes() const;
+    //Highest GetFrameBytes seen at BeginFrame
+    size_t GetPeakFrameBytes() const { return m_peakFrameBytes; }
+    uint64_t GetUpstreamAllocations() const;
+
+private:
+    struct Slot
+    {
+        std::array<std::unique_ptr<LinearArena>, MAX_THREADS> m_threadArenas;
+    };
+
+    //Lowest index no live thread holds, claimed on the thread's first call
+    static uint32_t GetThreadIndex();
+
+    std::vector<Slot> m_slots;
+    std::atomic<uint32_t> m_currentSlot = { 0 };
+    size_t m_blockSize = LinearArena::DEFAULT_BLOCK_SIZE;
+    std::pmr::memory_resource* m_upstream = nullptr;
+    size_t m_peakFrameBytes = 0;
+};
+
+#endif // !__FRAME_ARENA_H__
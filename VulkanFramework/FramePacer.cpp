@@ -0,0 +1,272 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    //Sleeps are cut into slices so completions are still noticed close to when they happen
+    const uint64_t SLEEP_SLICE = 1000000;
+    //Never hold a frame back longer than this, whatever the prediction says
+    const uint64_t MAX_HOLD = 50000000;
+    const double BLEND = 0.1;
+}
+
+FramePacer::FramePacer()
+{
+    SetClock(nullptr, nullptr);
+}
+
+void FramePacer::SetClock(ClockFunc clock, SleepFunc sleep)
+{
+    if (clock)
+    {
+        m_clock = std::move(clock);
+    }
+    else
+    {
+        m_clock = []()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        };
+    }
+
+    if (sleep)
+    {
+        m_sleep = std::move(sleep);
+    }
+    else
+    {
+        m_sleep = [](uint64_t nanoseconds) { std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds)); };
+    }
+}
+
+void FramePacer::SetGpuProgress(ProgressFunc completedValue)
+{
+    m_completedValue = std::move(completedValue);
+}
+
+void FramePacer::SetPresentProgress(ProgressFunc presentedFrame)
+{
+    m_presentedFrame = std::move(presentedFrame);
+    m_lastPresented = m_lastComplete;
+}
+
+uint64_t FramePacer::BeginFrame()
+{
+    Update();
+
+    uint64_t now = m_clock();
+    uint64_t slept = 0;
+
+    if (m_enabled)
+    {
+        uint64_t start = std::min(PredictStart(now), now + MAX_HOLD);
+        while (now < start)
+        {
+            m_sleep(std::min(start - now, SLEEP_SLICE));
+            Update();
+
+            uint64_t woke = m_clock();
+            slept += woke - now;
+            now = woke;
+        }
+    }
+    Blend(m_sleepTime, static_cast<double>(slept));
+
+    m_frame++;
+    FrameRecord& record = GetRecord(m_frame);
+    record = FrameRecord();
+    record.m_frame = m_frame;
+    record.m_startTime = now;
+    record.m_inputTime = now;
+
+    return m_frame;
+}
+
+void FramePacer::MarkInputSampled()
+{
+    GetRecord(m_frame).m_inputTime = m_clock();
+}
+
+void FramePacer::MarkWaitBegin()
+{
+    GetRecord(m_frame).m_waitBegin = m_clock();
+}
+
+void FramePacer::MarkWaitEnd()
+{
+    FrameRecord& record = GetRecord(m_frame);
+    if (record.m_waitBegin != 0)
+    {
+        record.m_waitTime += m_clock() - record.m_waitBegin;
+        record.m_waitBegin = 0;
+    }
+}
+
+void FramePacer::MarkSubmitted(uint64_t gpuValue)
+{
+    //Nothing to attach it to if BeginFrame isn't being called
+    if (m_frame == 0)
+    {
+        return;
+    }
+
+    FrameRecord& record = GetRecord(m_frame);
+    record.m_submitTime = m_clock();
+    record.m_gpuValue = gpuValue;
+    record.m_submitted = true;
+
+    uint64_t busy = record.m_submitTime - record.m_startTime;
+    Blend(m_cpuTime, static_cast<double>(busy - std::min(busy, record.m_waitTime)));
+
+    Update();
+}
+
+void FramePacer::Update()
+{
+    uint64_t now = m_clock();
+
+    uint64_t completed = m_completedValue ? m_completedValue() : 0;
+    while (m_lastComplete < m_frame)
+    {
+        FrameRecord& record = GetRecord(m_lastComplete + 1);
+        if (record.m_frame != m_lastComplete + 1)
+        {
+            //Fell out of the history before it was seen finishing
+            m_lastComplete++;
+            continue;
+        }
+        if (!record.m_submitted || record.m_gpuValue > completed)
+        {
+            break;
+        }
+
+        OnComplete(record, now);
+        m_lastComplete++;
+    }
+
+    if (!m_presentedFrame)
+    {
+        m_lastPresented = m_lastComplete;
+        return;
+    }
+
+    //A frame can't be shown before it's done, the clamp keeps the order when polling races
+    uint64_t presented = std::min(m_presentedFrame(), m_lastComplete);
+    while (m_lastPresented < presented)
+    {
+        m_lastPresented++;
+
+        FrameRecord& record = GetRecord(m_lastPresented);
+        if (record.m_frame == m_lastPresented)
+        {
+            OnPresent(record, now);
+        }
+    }
+}
+
+void FramePacer::OnComplete(FrameRecord& record, uint64_t now)
+{
+    record.m_completeTime = now;
+
+    //The GPU starts on a frame once it's submitted and the previous one is done
+    uint64_t gpuStart = std::max(record.m_submitTime, m_lastCompleteTime);
+    Blend(m_gpuTime, static_cast<double>(now - std::min(now, gpuStart)));
+    m_lastCompleteTime = now;
+
+    if (!m_presentedFrame)
+    {
+        OnPresent(record, now);
+    }
+}
+
+void FramePacer::OnPresent(FrameRecord& record, uint64_t now)
+{
+    record.m_presentTime = now;
+
+    if (m_lastPresentTime != 0)
+    {
+        m_intervals[m_nextInterval] = now - m_lastPresentTime;
+        m_nextInterval = (m_nextInterval + 1) % INTERVAL_WINDOW;
+        if (m_intervalCount < INTERVAL_WINDOW)
+        {
+            m_intervalCount++;
+        }
+    }
+    m_lastPresentTime = now;
+
+    m_lastLatency = static_cast<double>(now - record.m_inputTime);
+    Blend(m_latency, m_lastLatency);
+}
+
+uint64_t FramePacer::PredictStart(uint64_t now) const
+{
+    //Nothing to predict from yet
+    if (m_cpuTime == 0.0 || m_gpuTime == 0.0)
+    {
+        return now;
+    }
+
+    uint64_t cpuTime = static_cast<uint64_t>(m_cpuTime);
+    uint64_t gpuTime = static_cast<uint64_t>(m_gpuTime);
+
+    //When the GPU gets through everything already submitted
+    uint64_t gpuFree = m_lastCompleteTime;
+    for (uint64_t frame = m_lastComplete + 1; frame <= m_frame; frame++)
+    {
+        const FrameRecord& record = m_history[frame % HISTORY_SIZE];
+        if (record.m_frame == frame && record.m_submitted)
+        {
+            gpuFree = std::max(gpuFree, record.m_submitTime) + gpuTime;
+        }
+    }
+
+    //Submit right as the GPU frees up
+    uint64_t lead = cpuTime + m_margin;
+    uint64_t start = gpuFree > lead ? gpuFree - lead : 0;
+
+    //Finish right before the vblank this frame can make at the earliest. Only with real present
+    //times, GPU completion isn't aligned to vblank.
+    uint64_t refresh = static_cast<uint64_t>(GetRefreshIntervalMs() * 1e6);
+    if (m_refreshLimited && m_presentedFrame && refresh != 0 && m_lastPresentTime != 0)
+    {
+        uint64_t queued = m_frame - m_lastPresented;
+        uint64_t vblank = m_lastPresentTime + refresh * (queued + 1);
+
+        lead += gpuTime;
+        if (vblank > lead)
+        {
+            start = std::max(start, vblank - lead);
+        }
+    }
+
+    return start;
+}
+
+double FramePacer::GetRefreshIntervalMs() const
+{
+    if (m_intervalCount == 0)
+    {
+        return 0.0;
+    }
+
+    return *std::min_element(m_intervals.begin(), m_intervals.begin() + m_intervalCount) / 1e6;
+}
+
+void FramePacer::Blend(double& average, double sample)
+{
+    average = average == 0.0 ? sample : average + (sample - average) * BLEND;
+}
+
+void FramePacer::PrintReport(std::ostream& out) const
+{
+    out << "pacing" << (m_enabled ? "" : " (off)") << ": cpu " << GetCpuTimeMs() << "ms, gpu " << GetGpuTimeMs() << "ms";
+    if (m_refreshLimited && GetRefreshIntervalMs() != 0.0)
+    {
+        out << ", refresh " << GetRefreshIntervalMs() << "ms";
+    }
+    out << ", held back " << GetSleepMs() << "ms, input to " << (HasPresentTiming() ? "present " : "GPU done (estimate) ")
+        << GetLatencyMs() << "ms" << std::endl;
+}
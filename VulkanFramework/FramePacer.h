@@ -0,0 +1,129 @@
+#ifndef __FRAME_PACER_H__
+#define __FRAME_PACER_H__
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+//Holds the start of each frame back so input is read as late as possible. Without it the
+//main loop polls input, records and submits as fast as it can, and the frame then sits in
+//the queue behind earlier ones (or behind vblank) while its input gets older.
+//
+//From past frames it predicts how long the CPU part takes (input to submit), how long the
+//GPU needs per frame and, when presentation is the limit, the refresh interval. BeginFrame
+//then sleeps until starting leaves just enough time for the frame to reach the GPU as it
+//frees up, or to finish right before the next vblank, whichever is later.
+//
+//GPU progress is the graphics timeline. Present progress is whatever SetPresentProgress is
+//given, the backend has nothing to give it yet, so it falls back to GPU completion. Both
+//are polled, so times are as exact as the polling, which happens at every mark and while
+//sleeping.
+//Time, sleeping and progress are all injectable, the pacing can run against a simulated GPU.
+class FramePacer
+{
+public:
+    //Monotonic nanoseconds
+    using ClockFunc = std::function<uint64_t()>;
+    using SleepFunc = std::function<void(uint64_t nanoseconds)>;
+    //Highest value done so far, timeline values for the GPU and frame numbers for presents
+    using ProgressFunc = std::function<uint64_t()>;
+
+    FramePacer();
+
+    void SetClock(ClockFunc clock, SleepFunc sleep);
+    void SetGpuProgress(ProgressFunc completedValue);
+    //Null when presents can't be tracked, GPU completion stands in for them then
+    void SetPresentProgress(ProgressFunc presentedFrame);
+    //Presents are locked to the refresh rate (FIFO), so waiting for vblank counts as well
+    void SetRefreshLimited(bool refreshLimited) { m_refreshLimited = refreshLimited; }
+    //Still measures when disabled, it just never sleeps
+    void SetEnabled(bool enabled) { m_enabled = enabled; }
+    bool IsEnabled() const { return m_enabled; }
+    //Slack for prediction error and sleep overshoot
+    void SetMargin(uint64_t nanoseconds) { m_margin = nanoseconds; }
+
+    //Sleeps until the predicted start time and returns the frame's number, the one present
+    //progress reports. Read input right after.
+    uint64_t BeginFrame();
+    void MarkInputSampled();
+    //Around anything the frame blocks on (frame slot, acquire), so waiting isn't mistaken for CPU work
+    void MarkWaitBegin();
+    void MarkWaitEnd();
+    //gpuValue is the timeline value the frame's submit signals
+    void MarkSubmitted(uint64_t gpuValue);
+    //Picks up finished and presented frames, the marks call it too
+    void Update();
+
+    //Frame started by the last BeginFrame, 0 before the first
+    uint64_t GetFrame() const { return m_frame; }
+    //When the next frame should start, asked at now. BeginFrame holds it back to this, but
+    //never by more than 50ms.
+    uint64_t PredictStart(uint64_t now) const;
+
+    double GetCpuTimeMs() const { return m_cpuTime / 1e6; }
+    double GetGpuTimeMs() const { return m_gpuTime / 1e6; }
+    //Shortest recent present interval, 0 until there are presents
+    double GetRefreshIntervalMs() const;
+    double GetSleepMs() const { return m_sleepTime / 1e6; }
+    //Input sampled to presented (or GPU done without present tracking)
+    double GetLatencyMs() const { return m_latency / 1e6; }
+    double GetLastLatencyMs() const { return m_lastLatency / 1e6; }
+    bool HasPresentTiming() const { return static_cast<bool>(m_presentedFrame); }
+
+    void PrintReport(std::ostream& out) const;
+
+private:
+    static const uint32_t HISTORY_SIZE = 8;
+    static const uint32_t INTERVAL_WINDOW = 32;
+
+    struct FrameRecord
+    {
+        uint64_t m_frame = 0;
+        uint64_t m_gpuValue = 0;
+        uint64_t m_inputTime = 0;
+        uint64_t m_startTime = 0;
+        uint64_t m_submitTime = 0;
+        uint64_t m_waitBegin = 0;
+        uint64_t m_waitTime = 0;
+        uint64_t m_completeTime = 0;
+        uint64_t m_presentTime = 0;
+        bool m_submitted = false;
+    };
+
+    FrameRecord& GetRecord(uint64_t frame) { return m_history[frame % HISTORY_SIZE]; }
+    void OnComplete(FrameRecord& record, uint64_t now);
+    void OnPresent(FrameRecord& record, uint64_t now);
+    static void Blend(double& average, double sample);
+
+    ClockFunc m_clock;
+    SleepFunc m_sleep;
+    ProgressFunc m_completedValue;
+    ProgressFunc m_presentedFrame;
+    bool m_refreshLimited = false;
+    bool m_enabled = true;
+    uint64_t m_margin = 1000000;
+
+    //Frame 0 is never used, so 0 can mean nothing yet
+    uint64_t m_frame = 0;
+    uint64_t m_lastComplete = 0;
+    uint64_t m_lastPresented = 0;
+    std::array<FrameRecord, HISTORY_SIZE> m_history = {};
+
+    //Moving averages, in nanoseconds
+    double m_cpuTime = 0.0;
+    double m_gpuTime = 0.0;
+    double m_sleepTime = 0.0;
+    double m_latency = 0.0;
+    double m_lastLatency = 0.0;
+    uint64_t m_lastCompleteTime = 0;
+    uint64_t m_lastPresentTime = 0;
+
+    //Present intervals, the shortest one is the refresh interval. A missed vblank makes one
+    //interval twice as long, the minimum keeps that from pushing the next frames back too.
+    std::array<uint64_t, INTERVAL_WINDOW> m_intervals = {};
+    uint32_t m_intervalCount = 0;
+    uint32_t m_nextInterval = 0;
+};
+
+#endif // !__FRAME_PACER_H__
@@ -1,19 +1,240 @@
 #include "Game.h"
 
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+#include "ArenaBenchmark.h"
+
+void Game::ParseArguments(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--headless")
+        {
+            m_renderSettings.m_headless = true;
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            m_headlessFrames = std::stoull(argv[++i]);
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            m_outputPath = argv[++i];
+        }
+        else if (arg == "--profile")
+        {
+            //CPU scopes and GPU timestamps, with a report every few seconds
+            Profiler::SetEnabled(true);
+            m_renderSettings.m_gpuTimestamps = true;
+            m_profileReportInterval = 300;
+        }
+        else if (arg == "--trace" && hasValue)
+        {
+            //Chrome trace of the whole run, written on exit
+            Profiler::SetEnabled(true);
+            m_renderSettings.m_gpuTimestamps = true;
+            m_tracePath = argv[++i];
+        }
+        else if (arg == "--device" && hasValue)
+        {
+            //Index or name, see DeviceSelector
+            m_renderSettings.m_deviceOverride = argv[++i];
+        }
+        else if (arg == "--present" && hasValue)
+        {
+            //vsync, low-latency, adaptive or uncapped
+            std::string name = argv[++i];
+            if (!ParsePresentPolicy(name, m_renderSettings.m_presentPolicy))
+            {
+                std::cerr << "Unknown present policy: " << name << std::endl;
+            }
+        }
+        else if (arg == "--present-stats")
+        {
+            //Present-to-present intervals and pacing, with the profiler report and on exit
+            m_presentStats = true;
+        }
+        else if (arg == "--tick-rate" && hasValue)
+        {
+            //Simulation steps per second, independent of the frame rate
+            m_tickRate = std::stod(argv[++i]);
+        }
+        else if (arg == "--bench-arena")
+        {
+            //Heap vs frame arena allocations for typical per frame data, runs instead of the renderer
+            m_arenaBenchmarkFrames = 1000;
+            if (hasValue && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+            {
+                m_arenaBenchmarkFrames = std::stoul(argv[++i]);
+            }
+        }
+        else if (arg == "--convert-texture" && i + 2 < argc)
+        {
+            //PPM/PAM image to a texture file with every mip encoded, runs instead of the renderer.
+            //Codec defaults to bc7, see TextureCompression.h for the rest.
+            m_convertInput = argv[++i];
+            m_convertOutput = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                std::string name = argv[++i];
+                if (!ParseTextureCodec(name, m_convertOptions.m_codec))
+                {
+                    std::cerr << "Unknown texture codec: " << name << std::endl;
+                }
+            }
+        }
+        else if (arg == "--srgb")
+        {
+            //The converted texture is color, filtered in linear space and stored as sRGB
+            m_convertOptions.m_srgb = true;
+        }
+        else if (arg == "--no-mips")
+        {
+            m_convertOptions.m_generateMips = false;
+        }
+        else if (arg == "--texture" && hasValue)
+        {
+            //Loaded once the renderer is up, to check a converted file on the device
+            m_texturePath = argv[++i];
+        }
+        else if (arg == "--stream-texture")
+        {
+            //--texture starts at its lowest mips, the rest stream in as it gets bigger on screen
+            m_streamTexture = true;
+        }
+        else if (arg == "--vram-budget" && hasValue)
+        {
+            //Megabytes of device local memory to stay under, mips are dropped to get there
+            m_renderSettings.m_memoryBudget = std::stoull(argv[++i]) * 1024 * 1024;
+        }
+        else if (arg == "--memory-report")
+        {
+            //Device memory per category, texture streaming and sampler counts
+            m_memoryReport = true;
+        }
+        else if (arg == "--virtual-texture" && hasValue)
+        {
+            //Streams a converted texture's pages on demand, see VirtualTexture
+            m_renderSettings.m_virtualTexturePath = argv[++i];
+        }
+        else if (arg == "--meshlets" && hasValue)
+        {
+            //Grid of n x n spheres split into meshlets and culled per meshlet, see MeshletGeometry
+            m_renderSettings.m_meshletGridSize = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--lighting" && hasValue)
+        {
+            //unlit, lambert or blinn-phong, picks the fragment shader permutation
+            std::string name = argv[++i];
+            if (!ParseLightingModel(name, m_renderSettings.m_lightingModel))
+            {
+                std::cerr << "Unknown lighting model: " << name << std::endl;
+            }
+        }
+        else if (arg == "--meshlet-cpu-cull")
+        {
+            //Culls the meshlets on the CPU instead of with Shaders/MeshletCull.comp
+            m_renderSettings.m_meshletGpuCulling = false;
+        }
+        else if (arg == "--no-pacing")
+        {
+            //Frames start as soon as the previous one is submitted
+            m_renderSettings.m_framePacing = false;
+        }
+        else if (arg == "--startup-report")
+        {
+            //Stage timings and the critical path, printed once the first frame is submitted
+            m_startupReport = true;
+        }
+        else if (arg == "--verbose")
+        {
+            Log::SetLevel(LogLevel::Verbose);
+        }
+        else if (arg == "--quiet")
+        {
+            Log::SetLevel(LogLevel::Warning);
+        }
+        else if (arg == "--trace-threads" && hasValue)
+        {
+            //Init, loading and jobs from every thread, flushed on exit
+            Tracer::SetEnabled(true);
+            m_threadTracePath = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+        }
+    }
+}
+
 void Game::Run()
 {
+    if (m_arenaBenchmarkFrames != 0)
+    {
+        RunArenaBenchmark(std::cout, m_arenaBenchmarkFrames);
+        JobSystem::CleanupInstance();
+        return;
+    }
+
+    if (!m_convertInput.empty())
+    {
+        ConvertTexture(m_convertInput, m_convertOutput, m_convertOptions, std::cout);
+        JobSystem::CleanupInstance();
+        return;
+    }
+
+    if (!m_tracePath.empty())
+    {
+        Profiler::GetInstance()->StartCapture();
+    }
+    if (Tracer::IsEnabled())
+    {
+        Tracer::SetThreadName("Main");
+    }
+
+    //Time to first frame is measured from here
+    StartupTimeline& startup = VulkanBackend::GetInstance()->GetStartupTimeline();
+    startup.Begin();
+
     //Initializes window
-    InitWindow();
+    startup.RunStage("InitWindow", [this]() { InitWindow(); });
     //Initializes vulkan
-    VulkanBackend::GetInstance()->InitVulkan(m_window, m_width, m_height);
+    VulkanBackend::GetInstance()->InitVulkan(m_window, m_width, m_height, m_renderSettings);
+    //Fixed rate simulation, stepped on the job system
+    startup.RunStage("InitSimulation", [this]() { InitSimulation(); });
+    if (!m_texturePath.empty())
+    {
+        startup.RunStage("LoadTexture", [this]() { LoadTexture(); });
+    }
+    TRACE_INSTANT("InitComplete");
     //Our main loop, handles everything for the program.
-    MainLoop();
+    if (m_renderSettings.m_headless)
+    {
+        HeadlessLoop();
+    }
+    else
+    {
+        MainLoop();
+    }
     //Cleans up upon exit.
     Cleanup();
 }
 
 void Game::InitWindow()
 {
+    TRACE_SCOPE("InitWindow");
+
+    //No window system at all in headless mode, it has to run on machines without one
+    if (m_renderSettings.m_headless)
+    {
+        return;
+    }
+
     //Initializes glfw
     glfwInit();
 
@@ -25,25 +246,247 @@ void Game::InitWindow()
     m_window = glfwCreateWindow(m_width, m_height, m_windowName.c_str(), nullptr, nullptr);
 }
 
+void Game::InitSimulation()
+{
+    TRACE_SCOPE("InitSimulation");
+
+    //Starts the workers now rather than in the middle of the first frame
+    JobSystem::GetInstance();
+
+    m_camera.SetPerspective(glm::radians(60.0f), static_cast<float>(m_width) / m_height, 0.1f, 100.0f);
+
+    //Slow orbit around the origin, something that visibly depends on the tick rate being honored
+    m_simulation.Init(m_tickRate, [](SimulationState& state, double stepTime)
+    {
+        const float orbitSpeed = glm::radians(45.0f);
+        float angle = static_cast<float>(state.m_time + stepTime) * orbitSpeed;
+        state.m_cameraPosition = glm::vec3(std::sin(angle), 0.5f, std::cos(angle)) * 2.0f;
+        state.m_cameraTarget = glm::vec3(0.0f);
+    });
+}
+
+void Game::LoadTexture()
+{
+    if (m_streamTexture)
+    {
+        TextureStreamer& streamer = VulkanBackend::GetInstance()->GetTextureStreamer();
+        m_streamedTexture = streamer.Add(m_texturePath);
+        const Texture& texture = streamer.Get(m_streamedTexture);
+
+        if (Log::IsEnabled(LogLevel::Info))
+        {
+            std::cout << "texture: " << m_texturePath << ", streaming from " << texture.m_extent.width << "x" << texture.m_extent.height
+                << " (level " << texture.m_firstLevel << ")" << std::endl;
+        }
+        return;
+    }
+
+    m_texture = VulkanBackend::GetInstance()->LoadTexture(m_texturePath);
+
+    if (Log::IsEnabled(LogLevel::Info))
+    {
+        std::cout << "texture: " << m_texturePath << ", format " << m_texture.m_format << (m_texture.m_decoded ? " (decoded on the CPU)" : "")
+            << ", " << m_texture.m_extent.width << "x" << m_texture.m_extent.height << ", " << m_texture.m_mipLevels << " levels" << std::endl;
+    }
+}
+
 void Game::MainLoop()
 {
+    FramePacer& pacer = VulkanBackend::GetInstance()->GetFramePacer();
+    auto lastFrame = std::chrono::steady_clock::now();
+
     //While the window ***isn't*** closing
     while (!glfwWindowShouldClose(m_window)) 
     {
-        //Check events (input etc)
-        glfwPollEvents();
-        DrawFrame();
+        {
+            PROFILE_SCOPE("Frame");
+            //Sleeps until input can be read as late as the GPU allows
+            {
+                PROFILE_SCOPE("FramePacing");
+                pacer.BeginFrame();
+            }
+            //Check events (input etc)
+            glfwPollEvents();
+            pacer.MarkInputSampled();
+
+            auto now = std::chrono::steady_clock::now();
+            std::chrono::duration<double> frameTime = now - lastFrame;
+            lastFrame = now;
+
+            //Steps run on a worker while this frame records and submits
+            m_simulation.BeginFrame(frameTime.count());
+            m_renderState = m_simulation.GetRenderState();
+            DrawFrame();
+        }
+        EndFrame();
+    }
+}
+
+void Game::HeadlessLoop()
+{
+    //Readbacks arrive a few frames late, the last one shows up during cleanup
+    VulkanBackend::GetInstance()->SetReadbackCallback([this](uint64_t frame, const uint8_t* pixels, uint32_t width, uint32_t height, VkFormat format)
+    {
+        if (frame + 1 == m_headlessFrames && !m_outputPath.empty())
+        {
+            WriteImage(m_outputPath, pixels, width, height, format);
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < m_headlessFrames; i++)
+    {
+        {
+            PROFILE_SCOPE("Frame");
+            //A fixed frame length, so the same frame always shows the same simulation state
+            m_simulation.BeginFrame(HEADLESS_FRAME_TIME);
+            m_renderState = m_simulation.GetRenderState();
+            DrawFrame();
+        }
+        EndFrame();
+    }
+
+    VulkanBackend::GetInstance()->WaitForIdle();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (Log::IsEnabled(LogLevel::Info))
+    {
+        std::cout << "headless: " << m_headlessFrames << " frames in " << elapsed.count() << "s ("
+            << m_headlessFrames / elapsed.count() << " fps)" << std::endl;
+    }
+}
+
+void Game::WriteImage(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height, VkFormat format)
+{
+    //Binary PPM, no dependencies and every image tool reads it
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "failed to open " << path << std::endl;
+        return;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    bool bgra = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    std::vector<char> row(width * 3);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* src = pixels + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            row[x * 3 + 0] = src[x * 4 + (bgra ? 2 : 0)];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + (bgra ? 0 : 2)];
+        }
+        file.write(row.data(), row.size());
     }
 }
 
 void Game::DrawFrame()
 {
-    VulkanBackend::GetInstance()->DrawFrame();
+    VulkanBackend* backend = VulkanBackend::GetInstance();
+
+    //Copied into the uniform ring by the backend, nothing here touches Vulkan
+    m_camera.LookAt(m_renderState.m_cameraPosition, m_renderState.m_cameraTarget);
+    FrameUniforms frameUniforms;
+    frameUniforms.m_viewProjection = m_camera.GetViewProjection();
+    frameUniforms.m_cameraPosition = glm::vec4(m_renderState.m_cameraPosition, static_cast<float>(m_renderState.m_time));
+    backend->SetFrameUniforms(frameUniforms);
+
+    //Sized as a unit quad at the camera target that fills the window height from a distance of 1
+    if (m_streamTexture && !m_texturePath.empty())
+    {
+        float distance = glm::length(m_renderState.m_cameraPosition - m_renderState.m_cameraTarget);
+        backend->GetTextureStreamer().SetScreenSize(m_streamedTexture, static_cast<float>(m_height) / std::max(distance, 0.01f));
+    }
+
+    //The first frame closes out startup
+    if (!m_firstFrameDrawn)
+    {
+        StartupTimeline& startup = backend->GetStartupTimeline();
+        startup.RunStage("FirstFrame", [backend]() { backend->DrawFrame(); });
+        m_firstFrameDrawn = true;
+
+        if (m_startupReport)
+        {
+            startup.PrintReport(std::cout);
+        }
+        return;
+    }
+
+    backend->DrawFrame();
+}
+
+void Game::EndFrame()
+{
+    Profiler* profiler = Profiler::GetInstance();
+    profiler->EndFrame();
+
+    if (m_profileReportInterval != 0 && profiler->GetFrameIndex() % m_profileReportInterval == 0)
+    {
+        profiler->PrintReport(std::cout);
+        if (m_presentStats)
+        {
+            VulkanBackend::GetInstance()->GetPresentStats().PrintReport(std::cout);
+            VulkanBackend::GetInstance()->GetFramePacer().PrintReport(std::cout);
+        }
+        if (m_memoryReport)
+        {
+            VulkanBackend::GetInstance()->GetMemoryBudget().PrintReport(std::cout);
+            VulkanBackend::GetInstance()->GetTextureStreamer().PrintReport(std::cout);
+            VulkanBackend::GetInstance()->GetSamplerCache().PrintReport(std::cout);
+        }
+    }
 }
 
 void Game::Cleanup()
 {
+    m_simulation.Shutdown();
+    JobSystem::CleanupInstance();
+
+    //Nothing is presented in headless mode
+    if (m_presentStats && !m_renderSettings.m_headless)
+    {
+        VulkanBackend::GetInstance()->GetPresentStats().PrintReport(std::cout);
+        VulkanBackend::GetInstance()->GetFramePacer().PrintReport(std::cout);
+    }
+
+    if (!m_renderSettings.m_virtualTexturePath.empty())
+    {
+        VulkanBackend::GetInstance()->GetVirtualTexture().PrintReport(std::cout);
+    }
+
+    if (m_renderSettings.m_meshletGridSize != 0)
+    {
+        VulkanBackend::GetInstance()->GetMeshletGeometry().PrintReport(std::cout);
+    }
+
+    if (m_memoryReport)
+    {
+        VulkanBackend::GetInstance()->GetMemoryBudget().PrintReport(std::cout);
+        VulkanBackend::GetInstance()->GetTextureStreamer().PrintReport(std::cout);
+        VulkanBackend::GetInstance()->GetSamplerCache().PrintReport(std::cout);
+    }
+
+    //Goes through the deletion queue, which CleanupVulkan flushes
+    if (m_streamTexture && !m_texturePath.empty())
+    {
+        VulkanBackend::GetInstance()->GetTextureStreamer().Remove(m_streamedTexture);
+    }
+    VulkanBackend::GetInstance()->DestroyTexture(m_texture);
     VulkanBackend::GetInstance()->CleanupVulkan();
+
+    if (!m_tracePath.empty() && !Profiler::GetInstance()->WriteChromeTrace(m_tracePath))
+    {
+        std::cerr << "failed to write trace to " << m_tracePath << std::endl;
+    }
+    if (!m_threadTracePath.empty() && !Tracer::Flush(m_threadTracePath))
+    {
+        std::cerr << "failed to write trace to " << m_threadTracePath << std::endl;
+    }
+    Profiler::CleanupInstance();
     
     //Destroys window
     if (m_window != nullptr)
@@ -53,5 +496,8 @@ void Game::Cleanup()
     }
 
     //Closes GLFW
-    glfwTerminate();
+    if (!m_renderSettings.m_headless)
+    {
+        glfwTerminate();
+    }
 }
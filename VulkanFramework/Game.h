@@ -2,23 +2,82 @@
 #define __GAME_H__
 
 #include "VulkanBackend.h"
+#include "Simulation.h"
+#include "Camera.h"
+#include "TextureConverter.h"
+
+#include <string>
 
 class Game {
 public:
+    //Reads command line options, has to happen before Run
+    void ParseArguments(int argc, char** argv);
+
     //Runs our application
     void Run();
 
 private:
     void InitWindow();
+    void InitSimulation();
+    void LoadTexture();
     void MainLoop();
+    void HeadlessLoop();
     void DrawFrame();
+    void EndFrame();
     void Cleanup();
+    void WriteImage(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height, VkFormat format);
 
     //Window variables
     GLFWwindow* m_window = nullptr;
     std::string m_windowName = "Vulkan";
     const int m_width = 800;
     const int m_height = 600;
+
+    //Renderer options, handed to the backend on init
+    RenderSettings m_renderSettings;
+
+    //Headless runs render a fixed number of frames and optionally save the last one
+    uint64_t m_headlessFrames = 100;
+    std::string m_outputPath;
+
+    //Profiler report interval in frames, 0 turns it off
+    uint64_t m_profileReportInterval = 0;
+    std::string m_tracePath;
+    //Every thread's trace events, .json or Perfetto protobuf
+    std::string m_threadTracePath;
+
+    //Prints where startup time went after the first frame
+    bool m_startupReport = false;
+    bool m_firstFrameDrawn = false;
+
+    //Prints present-to-present intervals, to check pacing under the present policy
+    bool m_presentStats = false;
+
+    //Simulation steps per second
+    double m_tickRate = 120.0;
+    Simulation m_simulation;
+    //What this frame draws, blended between the last two simulation steps
+    SimulationState m_renderState;
+    Camera m_camera;
+    //Headless frames advance the simulation by this much, whatever they really take
+    static constexpr double HEADLESS_FRAME_TIME = 1.0 / 60.0;
+
+    //--convert-texture runs the converter instead of the renderer
+    std::string m_convertInput;
+    std::string m_convertOutput;
+    TextureConvertOptions m_convertOptions;
+    //--texture, loaded after init and released on exit
+    std::string m_texturePath;
+    Texture m_texture;
+    //--stream-texture loads it through the TextureStreamer instead
+    bool m_streamTexture = false;
+    StreamedTextureHandle m_streamedTexture = 0;
+
+    //Prints device memory per category, texture streaming and sampler stats with the other reports
+    bool m_memoryReport = false;
+
+    //Frames for --bench-arena, 0 runs the renderer as usual
+    uint32_t m_arenaBenchmarkFrames = 0;
 };
 
 #endif // !__GAME_H__
\ No newline at end of file
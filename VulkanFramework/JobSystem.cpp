@@ -0,0 +1,140 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <string>
+
+#include "Tracer.h"
+
+JobSystem* JobSystem::m_singletonInst = nullptr;
+
+JobSystem* JobSystem::GetInstance()
+{
+    if (m_singletonInst == nullptr)
+    {
+        m_singletonInst = new JobSystem();
+    }
+
+    return m_singletonInst;
+}
+
+void JobSystem::CleanupInstance()
+{
+    if (m_singletonInst != nullptr)
+    {
+        delete m_singletonInst;
+        m_singletonInst = nullptr;
+    }
+}
+
+JobSystem::JobSystem()
+{
+    //The main thread works too while it waits, so one core is left for it
+    uint32_t workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_jobQueued.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+JobHandle JobSystem::Submit(const char* name, std::function<void()> job)
+{
+    JobHandle handle;
+    handle.m_state = std::make_shared<JobHandle::State>();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back({ name, std::move(job), handle.m_state });
+    }
+    m_jobQueued.notify_one();
+
+    return handle;
+}
+
+void JobSystem::Wait(const JobHandle& handle)
+{
+    if (!handle.IsValid())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!handle.m_state->m_done.load(std::memory_order_acquire))
+    {
+        if (!m_queue.empty())
+        {
+            Job job = std::move(m_queue.front());
+            m_queue.pop_front();
+            Run(job, lock);
+        }
+        else
+        {
+            m_jobFinished.wait(lock);
+        }
+    }
+    lock.unlock();
+
+    if (handle.m_state->m_error)
+    {
+        std::rethrow_exception(handle.m_state->m_error);
+    }
+}
+
+void JobSystem::WorkerLoop(uint32_t index)
+{
+    if (Tracer::IsEnabled())
+    {
+        Tracer::SetThreadName("Worker " + std::to_string(index));
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_jobQueued.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+
+        //Drains the queue before quitting, nothing submitted is left hanging
+        if (m_queue.empty())
+        {
+            return;
+        }
+
+        Job job = std::move(m_queue.front());
+        m_queue.pop_front();
+        Run(job, lock);
+    }
+}
+
+void JobSystem::Run(Job& job, std::unique_lock<std::mutex>& lock)
+{
+    lock.unlock();
+    {
+        TRACE_SCOPE(job.m_name);
+
+        try
+        {
+            job.m_func();
+        }
+        catch (...)
+        {
+            job.m_state->m_error = std::current_exception();
+        }
+    }
+    lock.lock();
+
+    job.m_state->m_done.store(true, std::memory_order_release);
+    m_jobFinished.notify_all();
+}
@@ -0,0 +1,81 @@
+#ifndef __JOB_SYSTEM_H__
+#define __JOB_SYSTEM_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Refers to a submitted job, copies refer to the same one
+class JobHandle
+{
+public:
+    bool IsValid() const { return m_state != nullptr; }
+
+private:
+    friend class JobSystem;
+
+    struct State
+    {
+        std::atomic<bool> m_done = { false };
+        //Rethrown by Wait
+        std::exception_ptr m_error;
+    };
+
+    std::shared_ptr<State> m_state;
+};
+
+//Worker threads running jobs off one queue. Meant for coarse jobs (a whole simulation
+//step, loading a file), not thousands of tiny ones, so a single locked queue is plenty.
+//Whoever waits on a job runs queued jobs in the meantime instead of just blocking.
+class JobSystem
+{
+public:
+    //Get singleton job system instance, the workers start on first use
+    static JobSystem* GetInstance();
+    //Finishes whatever is queued and joins the workers
+    static void CleanupInstance();
+
+    //name shows up in thread traces, it has to outlive the job (a literal)
+    JobHandle Submit(const char* name, std::function<void()> job);
+    //Blocks until the job is done, rethrows anything it threw
+    void Wait(const JobHandle& handle);
+    bool IsDone(const JobHandle& handle) const { return !handle.IsValid() || handle.m_state->m_done.load(std::memory_order_acquire); }
+
+    uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+    struct Job
+    {
+        const char* m_name;
+        std::function<void()> m_func;
+        std::shared_ptr<JobHandle::State> m_state;
+    };
+
+    JobSystem();
+    ~JobSystem();
+    JobSystem(JobSystem&) = delete;
+
+    void WorkerLoop(uint32_t index);
+    //Runs the job with m_mutex unlocked, locks it again before returning
+    void Run(Job& job, std::unique_lock<std::mutex>& lock);
+
+    static JobSystem* m_singletonInst;
+
+    std::mutex m_mutex;
+    //Workers sleep on this while the queue is empty
+    std::condition_variable m_jobQueued;
+    //Waiters sleep on this while their job runs somewhere else
+    std::condition_variable m_jobFinished;
+    std::deque<Job> m_queue;
+    std::vector<std::thread> m_workers;
+    bool m_quit = false;
+};
+
+#endif // !__JOB_SYSTEM_H__
@@ -0,0 +1,3 @@
+#include "Log.h"
+
+LogLevel Log::m_level = LogLevel::Info;
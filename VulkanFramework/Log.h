@@ -0,0 +1,28 @@
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <cstdint>
+
+//How much goes to stdout, everything up to and including the level is printed
+enum class LogLevel : uint32_t
+{
+    Error = 0,
+    Warning = 1,
+    Info = 2,
+    Verbose = 3
+};
+
+class Log
+{
+public:
+    static void SetLevel(LogLevel level) { m_level = level; }
+    static LogLevel GetLevel() { return m_level; }
+
+    //Wrap output in this so nothing gets formatted when it wouldn't be printed
+    static bool IsEnabled(LogLevel level) { return level <= m_level; }
+
+private:
+    static LogLevel m_level;
+};
+
+#endif // !__LOG_H__
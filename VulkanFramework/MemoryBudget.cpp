@@ -0,0 +1,142 @@
+#include "MemoryBudget.h"
+
+#include <algorithm>
+
+#include "VulkanImport.h"
+
+namespace
+{
+    //Share of the device local heaps aimed for when the driver can't say, the rest is left
+    //for other processes, the driver and the swapchain
+    const double DEFAULT_HEAP_SHARE = 0.8;
+
+    double ToMegabytes(VkDeviceSize bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+const char* GetMemoryCategoryName(MemoryCategory category)
+{
+    switch (category)
+    {
+    case MemoryCategory::Texture: return "textures";
+    case MemoryCategory::Mesh: return "meshes";
+    case MemoryCategory::RenderTarget: return "render targets";
+    case MemoryCategory::Other: return "other";
+    default: return "unknown";
+    }
+}
+
+void MemoryBudget::Init(VkInstance instance, const DeviceCaps* caps, bool budgetExtension, VkDeviceSize budgetBytes)
+{
+    m_instance = instance;
+    m_caps = caps;
+    m_budgetExtension = budgetExtension;
+    m_configuredBudget = budgetBytes;
+    std::fill(std::begin(m_usage), std::end(m_usage), 0);
+    std::fill(std::begin(m_peak), std::end(m_peak), 0);
+
+    Refresh();
+}
+
+void MemoryBudget::Track(MemoryCategory category, VkDeviceSize size)
+{
+    size_t index = static_cast<size_t>(category);
+    m_usage[index] += size;
+    m_peak[index] = std::max(m_peak[index], m_usage[index]);
+}
+
+void MemoryBudget::Release(MemoryCategory category, VkDeviceSize size)
+{
+    size_t index = static_cast<size_t>(category);
+    m_usage[index] -= std::min(size, m_usage[index]);
+}
+
+void MemoryBudget::Refresh()
+{
+    const VkPhysicalDeviceMemoryProperties& memProperties = m_caps->GetMemoryProperties();
+
+#if defined(VK_EXT_memory_budget) && defined(VK_KHR_get_physical_device_properties2)
+    if (m_budgetExtension)
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+        budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2KHR properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+        properties.pNext = &budget;
+        VulkanImport::GetPhysicalDeviceMemoryProperties2KHR(m_instance, m_caps->GetPhysicalDevice(), &properties);
+
+        m_deviceBudget = 0;
+        m_deviceUsage = 0;
+        for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++)
+        {
+            if (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            {
+                m_deviceBudget += budget.heapBudget[i];
+                m_deviceUsage += budget.heapUsage[i];
+            }
+        }
+
+        //Some drivers leave the struct alone when they don't really support it
+        if (m_deviceBudget != 0)
+        {
+            return;
+        }
+    }
+#endif //VK_EXT_memory_budget
+
+    VkDeviceSize heapSize = 0;
+    for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++)
+    {
+        if (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        {
+            heapSize += memProperties.memoryHeaps[i].size;
+        }
+    }
+
+    m_deviceBudget = static_cast<VkDeviceSize>(static_cast<double>(heapSize) * DEFAULT_HEAP_SHARE);
+    m_deviceUsage = 0;
+    m_budgetExtension = false;
+}
+
+VkDeviceSize MemoryBudget::GetTrackedBytes() const
+{
+    VkDeviceSize total = 0;
+    for (VkDeviceSize usage : m_usage)
+    {
+        total += usage;
+    }
+    return total;
+}
+
+VkDeviceSize MemoryBudget::GetDeviceUsage() const
+{
+    //Allocations since the last Refresh aren't in the driver's number yet
+    return std::max(m_deviceUsage, GetTrackedBytes());
+}
+
+VkDeviceSize MemoryBudget::GetBudget() const
+{
+    return m_configuredBudget != 0 ? std::min(m_configuredBudget, m_deviceBudget) : m_deviceBudget;
+}
+
+VkDeviceSize MemoryBudget::GetHeadroom() const
+{
+    VkDeviceSize usage = GetDeviceUsage();
+    VkDeviceSize budget = GetBudget();
+    return usage < budget ? budget - usage : 0;
+}
+
+void MemoryBudget::PrintReport(std::ostream& out) const
+{
+    out << "memory: " << ToMegabytes(GetDeviceUsage()) << " of " << ToMegabytes(GetBudget()) << " MB budget ("
+        << (m_budgetExtension ? "VK_EXT_memory_budget" : "estimated from heap sizes")
+        << (m_configuredBudget != 0 ? ", capped by settings" : "") << ")" << std::endl;
+
+    for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); i++)
+    {
+        out << "memory: " << GetMemoryCategoryName(static_cast<MemoryCategory>(i)) << " " << ToMegabytes(m_usage[i])
+            << " MB, peak " << ToMegabytes(m_peak[i]) << " MB" << std::endl;
+    }
+}
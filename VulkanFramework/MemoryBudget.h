@@ -0,0 +1,71 @@
+#ifndef __MEMORY_BUDGET_H__
+#define __MEMORY_BUDGET_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <ostream>
+
+#include "DeviceCaps.h"
+
+enum class MemoryCategory
+{
+    Texture,
+    Mesh,
+    RenderTarget,
+    Other,
+    Count
+};
+
+const char* GetMemoryCategoryName(MemoryCategory category);
+
+//Device memory the renderer allocates, counted per category, and how much it may still allocate.
+//Counters are what the allocating code reports with Track/Release, so they only cover what
+//goes through here (not the driver's own allocations, not swapchain images).
+//The budget is the smaller of the configured one and the device's: VK_EXT_memory_budget
+//knows what other processes leave over, without it 80% of the device local heaps is used as
+//a guess. With the extension the usage side comes from the driver too, so memory that was
+//released but is still waiting in the deletion queue counts until it's actually freed.
+class MemoryBudget
+{
+public:
+    //budgetBytes caps device local memory use, 0 leaves it to the device. budgetExtension
+    //says VK_EXT_memory_budget is enabled, it's queried through instance.
+    void Init(VkInstance instance, const DeviceCaps* caps, bool budgetExtension, VkDeviceSize budgetBytes);
+
+    void Track(MemoryCategory category, VkDeviceSize size);
+    void Release(MemoryCategory category, VkDeviceSize size);
+
+    //Re-queries the device's budget and usage, once a frame is plenty
+    void Refresh();
+
+    VkDeviceSize GetUsage(MemoryCategory category) const { return m_usage[static_cast<size_t>(category)]; }
+    VkDeviceSize GetPeak(MemoryCategory category) const { return m_peak[static_cast<size_t>(category)]; }
+    VkDeviceSize GetTrackedBytes() const;
+
+    //Device local memory in use by this process from the extension, the tracked total without it
+    VkDeviceSize GetDeviceUsage() const;
+    VkDeviceSize GetBudget() const;
+    //What can still be allocated before going over, 0 once over
+    VkDeviceSize GetHeadroom() const;
+    bool IsOverBudget() const { return GetDeviceUsage() > GetBudget(); }
+    bool HasDeviceBudget() const { return m_budgetExtension; }
+
+    void PrintReport(std::ostream& out) const;
+
+private:
+    VkInstance m_instance = VK_NULL_HANDLE;
+    const DeviceCaps* m_caps = nullptr;
+    bool m_budgetExtension = false;
+    VkDeviceSize m_configuredBudget = 0;
+
+    //Summed over the device local heaps as of the last Refresh
+    VkDeviceSize m_deviceBudget = 0;
+    VkDeviceSize m_deviceUsage = 0;
+
+    VkDeviceSize m_usage[static_cast<size_t>(MemoryCategory::Count)] = {};
+    VkDeviceSize m_peak[static_cast<size_t>(MemoryCategory::Count)] = {};
+};
+
+#endif // !__MEMORY_BUDGET_H__
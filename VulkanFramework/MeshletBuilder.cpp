@@ -0,0 +1,223 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    const uint32_t NO_LOCAL_INDEX = UINT32_MAX;
+}
+
+std::vector<uint32_t> MeshletData::BuildIndexBuffer() const
+{
+    std::vector<uint32_t> indices(m_triangles.size());
+
+    for (const Meshlet& meshlet : m_meshlets)
+    {
+        for (uint32_t i = 0; i < meshlet.m_triangleCount * 3; i++)
+        {
+            size_t index = static_cast<size_t>(meshlet.m_triangleOffset) * 3 + i;
+            indices[index] = m_vertices[meshlet.m_vertexOffset + m_triangles[index]];
+        }
+    }
+
+    return indices;
+}
+
+MeshletData BuildMeshlets(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+    uint32_t maxVertices, uint32_t maxTriangles)
+{
+    //Local indices are stored in a byte
+    if (maxVertices < 3 || maxVertices > 256 || maxTriangles < 1)
+    {
+        throw std::runtime_error("meshlet limits out of range!");
+    }
+    if (indexCount % 3 != 0)
+    {
+        throw std::runtime_error("meshlet index count isn't a triangle list!");
+    }
+
+    MeshletData data;
+    data.m_meshlets.reserve(indexCount / 3 / maxTriangles + 1);
+    data.m_vertices.reserve(indexCount / 3);
+    data.m_triangles.reserve(indexCount);
+
+    //Mesh vertex to local index in the meshlet being filled, reset for each new meshlet
+    std::vector<uint32_t> localIndex(vertexCount, NO_LOCAL_INDEX);
+    Meshlet current;
+
+    auto finish = [&]()
+    {
+        if (current.m_triangleCount == 0)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < current.m_vertexCount; i++)
+        {
+            localIndex[data.m_vertices[current.m_vertexOffset + i]] = NO_LOCAL_INDEX;
+        }
+        data.m_meshlets.push_back(current);
+
+        current = Meshlet();
+        current.m_vertexOffset = static_cast<uint32_t>(data.m_vertices.size());
+        current.m_triangleOffset = static_cast<uint32_t>(data.m_triangles.size() / 3);
+    };
+
+    for (size_t t = 0; t < indexCount; t += 3)
+    {
+        const uint32_t* triangle = indices + t;
+        if (triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount)
+        {
+            throw std::runtime_error("meshlet index out of range!");
+        }
+
+        uint32_t newVertices = 0;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            //A vertex repeated within the triangle only counts once
+            bool repeated = (i > 0 && triangle[i] == triangle[0]) || (i > 1 && triangle[i] == triangle[1]);
+            if (localIndex[triangle[i]] == NO_LOCAL_INDEX && !repeated)
+            {
+                newVertices++;
+            }
+        }
+
+        if (current.m_vertexCount + newVertices > maxVertices || current.m_triangleCount + 1 > maxTriangles)
+        {
+            finish();
+        }
+
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            uint32_t& local = localIndex[triangle[i]];
+            if (local == NO_LOCAL_INDEX)
+            {
+                local = current.m_vertexCount++;
+                data.m_vertices.push_back(triangle[i]);
+            }
+            data.m_triangles.push_back(static_cast<uint8_t>(local));
+        }
+        current.m_triangleCount++;
+    }
+    finish();
+
+    data.m_bounds.reserve(data.m_meshlets.size());
+    for (const Meshlet& meshlet : data.m_meshlets)
+    {
+        data.m_bounds.push_back(ComputeMeshletBounds(data, meshlet, positions));
+    }
+
+    return data;
+}
+
+MeshletBounds ComputeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, const glm::vec3* positions)
+{
+    MeshletBounds bounds;
+    if (meshlet.m_vertexCount == 0)
+    {
+        return bounds;
+    }
+
+    //Box center and the farthest vertex from it, a little looser than a minimal sphere but exact enough to cull with
+    glm::vec3 minimum = positions[data.m_vertices[meshlet.m_vertexOffset]];
+    glm::vec3 maximum = minimum;
+    for (uint32_t i = 1; i < meshlet.m_vertexCount; i++)
+    {
+        const glm::vec3& position = positions[data.m_vertices[meshlet.m_vertexOffset + i]];
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+
+    bounds.m_center = (minimum + maximum) * 0.5f;
+    for (uint32_t i = 0; i < meshlet.m_vertexCount; i++)
+    {
+        const glm::vec3& position = positions[data.m_vertices[meshlet.m_vertexOffset + i]];
+        bounds.m_radius = std::max(bounds.m_radius, glm::length(position - bounds.m_center));
+    }
+
+    //Normal cone: the axis averages the unit normals, the widest normal around it sets the cutoff
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.m_triangleCount);
+    glm::vec3 axis = glm::vec3(0.0f);
+    for (uint32_t t = 0; t < meshlet.m_triangleCount; t++)
+    {
+        const uint8_t* triangle = &data.m_triangles[(static_cast<size_t>(meshlet.m_triangleOffset) + t) * 3];
+        const glm::vec3& a = positions[data.m_vertices[meshlet.m_vertexOffset + triangle[0]]];
+        const glm::vec3& b = positions[data.m_vertices[meshlet.m_vertexOffset + triangle[1]]];
+        const glm::vec3& c = positions[data.m_vertices[meshlet.m_vertexOffset + triangle[2]]];
+
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        //Degenerate triangles face nowhere, they can't be back facing either
+        if (length <= 1e-12f)
+        {
+            continue;
+        }
+
+        normals.push_back(normal / length);
+        axis += normals.back();
+    }
+
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength <= 1e-6f)
+    {
+        return bounds;
+    }
+    axis /= axisLength;
+
+    float minimumDot = 1.0f;
+    for (const glm::vec3& normal : normals)
+    {
+        minimumDot = std::min(minimumDot, glm::dot(normal, axis));
+    }
+
+    //Past 90 degrees some triangle faces every position, nothing to cull
+    bounds.m_coneAxis = axis;
+    bounds.m_coneCutoff = minimumDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minimumDot * minimumDot);
+
+    return bounds;
+}
+
+MeshletFrustum ExtractFrustum(const glm::mat4& viewProjection)
+{
+    //Rows of the matrix, glm stores columns
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    //Left, right, bottom, top, then z >= 0 and z <= w
+    MeshletFrustum frustum;
+    frustum.m_planes[0] = rows[3] + rows[0];
+    frustum.m_planes[1] = rows[3] - rows[0];
+    frustum.m_planes[2] = rows[3] + rows[1];
+    frustum.m_planes[3] = rows[3] - rows[1];
+    frustum.m_planes[4] = rows[2];
+    frustum.m_planes[5] = rows[3] - rows[2];
+
+    for (glm::vec4& plane : frustum.m_planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        plane = length > 1e-6f ? plane / length : glm::vec4(0.0f);
+    }
+
+    return frustum;
+}
+
+bool IsMeshletVisible(const MeshletBounds& bounds, const MeshletFrustum& frustum, const glm::vec3& cameraPosition)
+{
+    for (const glm::vec4& plane : frustum.m_planes)
+    {
+        if (glm::dot(glm::vec3(plane), bounds.m_center) + plane.w < -bounds.m_radius)
+        {
+            return false;
+        }
+    }
+
+    //Every triangle faces away from anywhere inside the cone behind the sphere
+    glm::vec3 toCenter = bounds.m_center - cameraPosition;
+    return glm::dot(toCenter, bounds.m_coneAxis) < bounds.m_coneCutoff * glm::length(toCenter) + bounds.m_radius;
+}
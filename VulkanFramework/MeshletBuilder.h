@@ -0,0 +1,73 @@
+#ifndef __MESHLET_BUILDER_H__
+#define __MESHLET_BUILDER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//64 vertices and 124 triangles keep a meshlet's outputs in what NVIDIA's mesh shader path
+//handles best, and leave the triangle list a multiple of 4 bytes
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet
+{
+    //Into MeshletData::m_vertices
+    uint32_t m_vertexOffset = 0;
+    //Into MeshletData::m_triangles, in triangles (three bytes each)
+    uint32_t m_triangleOffset = 0;
+    uint32_t m_vertexCount = 0;
+    uint32_t m_triangleCount = 0;
+};
+
+//What culling needs of a meshlet, laid out the way the cull shader reads it (two vec4s)
+struct MeshletBounds
+{
+    glm::vec3 m_center = glm::vec3(0.0f);
+    float m_radius = 0.0f;
+    //Average facing of the triangles. The meshlet is back facing from everywhere the
+    //center is seen at less than the cutoff angle to the axis, see IsMeshletVisible.
+    //A cutoff of 1 means the triangles face too many ways for the test to ever cull.
+    glm::vec3 m_coneAxis = glm::vec3(0.0f);
+    float m_coneCutoff = 1.0f;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> m_meshlets;
+    //Parallel to m_meshlets
+    std::vector<MeshletBounds> m_bounds;
+    //Mesh vertex index of each meshlet local vertex
+    std::vector<uint32_t> m_vertices;
+    //Three meshlet local vertex indices per triangle
+    std::vector<uint8_t> m_triangles;
+
+    //Every meshlet's triangles with mesh vertex indices, for indexed draws.
+    //Meshlet i's start at index m_triangleOffset * 3.
+    std::vector<uint32_t> BuildIndexBuffer() const;
+};
+
+//Splits an indexed triangle list into meshlets, in index order. Index buffers that were
+//optimized for the vertex cache already keep neighbouring triangles together, which is
+//what keeps the meshlets small and their bounds tight. Triangles wind counter-clockwise
+//seen from the front.
+MeshletData BuildMeshlets(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+    uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+MeshletBounds ComputeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, const glm::vec3* positions);
+
+//Planes pointing inwards, xyz normalized. Near and far come from a [0, 1] depth range, so
+//the reversed-Z projections from Camera work as they are; an infinite far plane comes out
+//as a zero plane that culls nothing.
+struct MeshletFrustum
+{
+    glm::vec4 m_planes[6];
+};
+
+MeshletFrustum ExtractFrustum(const glm::mat4& viewProjection);
+//Frustum and backface cone test, the same one the cull shader does. Everything in the space
+//the meshlets were built in.
+bool IsMeshletVisible(const MeshletBounds& bounds, const MeshletFrustum& frustum, const glm::vec3& cameraPosition);
+
+#endif // !__MESHLET_BUILDER_H__
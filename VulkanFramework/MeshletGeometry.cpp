@@ -0,0 +1,694 @@
+#include "MeshletGeometry.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Profiler.h"
+#include "Tracer.h"
+#include "Util.h"
+#include "VulkanImport.h"
+
+namespace
+{
+    VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    //The draw count sits at the start of each region, the commands follow aligned to 16
+    const VkDeviceSize DRAW_COMMAND_OFFSET = 16;
+    //Has to match local_size_x in Shaders/MeshletCull.comp
+    const uint32_t CULL_GROUP_SIZE = 64;
+}
+
+const char* GetMeshShaderSupportName(MeshShaderSupport support)
+{
+    switch (support)
+    {
+    case MeshShaderSupport::NV:
+        return "VK_NV_mesh_shader";
+    case MeshShaderSupport::EXT:
+        return "VK_EXT_mesh_shader";
+    default:
+        return "none";
+    }
+}
+
+void MeshletGeometry::Init(VkDevice device, const DeviceCaps* caps, VkCommandPool commandPool, QueueTimeline* timeline, DeletionQueue* deletionQueue,
+    MemoryBudget* budget, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, uint32_t slotCount,
+    const std::vector<char>& cullShader, bool drawIndirectCount, bool multiDrawIndirect, uint32_t cullFamily, uint32_t drawFamily)
+{
+    TRACE_SCOPE("InitMeshletGeometry");
+
+    if (indices.empty())
+    {
+        throw std::runtime_error("meshlet geometry has no triangles!");
+    }
+
+    m_device = device;
+    m_caps = caps;
+    m_deletionQueue = deletionQueue;
+    m_budget = budget;
+    //The count variant can only draw more than once with multiDrawIndirect
+    m_drawIndirectCount = drawIndirectCount && multiDrawIndirect;
+    m_multiDrawIndirect = multiDrawIndirect;
+    m_cullFamily = cullFamily;
+    m_drawFamily = drawFamily;
+    m_meshShaderSupport = GetMeshShaderSupport(*caps);
+    m_trackedBytes = 0;
+    m_visibleMeshlets = 0;
+
+    MeshletData data = BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size());
+    m_bounds = data.m_bounds;
+    m_meshletCount = data.m_meshlets.size();
+    m_indexCount = static_cast<uint32_t>(data.m_triangles.size());
+    m_vertexCount = static_cast<uint32_t>(positions.size());
+    m_meshletVertexCount = data.m_vertices.size();
+
+    m_cullData.resize(m_meshletCount);
+    for (size_t i = 0; i < m_meshletCount; i++)
+    {
+        const MeshletBounds& bounds = m_bounds[i];
+        MeshletCullData& cullData = m_cullData[i];
+        cullData = {};
+        cullData.m_sphere[0] = bounds.m_center.x;
+        cullData.m_sphere[1] = bounds.m_center.y;
+        cullData.m_sphere[2] = bounds.m_center.z;
+        cullData.m_sphere[3] = bounds.m_radius;
+        cullData.m_cone[0] = bounds.m_coneAxis.x;
+        cullData.m_cone[1] = bounds.m_coneAxis.y;
+        cullData.m_cone[2] = bounds.m_coneAxis.z;
+        cullData.m_cone[3] = bounds.m_coneCutoff;
+        cullData.m_indexCount = data.m_meshlets[i].m_triangleCount * 3;
+        cullData.m_firstIndex = data.m_meshlets[i].m_triangleOffset * 3;
+    }
+
+    Upload(data, positions, commandPool, timeline);
+    CreateDrawBuffers(slotCount, !cullShader.empty());
+    CreateDescriptorSets();
+    if (!cullShader.empty())
+    {
+        CreateCullPipeline(cullShader);
+
+        //Every frame's draws are written from scratch, the cull never has to take them back
+        QueueUse cull;
+        cull.m_family = m_cullFamily;
+        cull.m_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        cull.m_access = VK_ACCESS_SHADER_WRITE_BIT;
+        QueueUse draw;
+        draw.m_family = m_drawFamily;
+        draw.m_stage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        draw.m_access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        m_drawTransfer = AsyncCompute::PlanTransfer(cull, draw, VK_SHARING_MODE_EXCLUSIVE);
+
+        //The cull queue doesn't wait on the upload, it has to be done before the first cull
+        if (m_cullFamily != m_drawFamily)
+        {
+            timeline->Wait(timeline->GetLastSubmitted());
+        }
+    }
+}
+
+void MeshletGeometry::Destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    if (m_cullPipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(m_device, m_cullPipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_cullPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(m_device, m_cullSetLayout, nullptr);
+    }
+    //Freeing the pool frees the sets with it
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+
+    if (m_constantBuffer != VK_NULL_HANDLE)
+    {
+        vkUnmapMemory(m_device, m_constantMemory);
+        vkDestroyBuffer(m_device, m_constantBuffer, nullptr);
+        vkFreeMemory(m_device, m_constantMemory, nullptr);
+    }
+    if (m_mappedDraws != nullptr)
+    {
+        vkUnmapMemory(m_device, m_drawMemory);
+    }
+    vkDestroyBuffer(m_device, m_drawBuffer, nullptr);
+    vkFreeMemory(m_device, m_drawMemory, nullptr);
+    vkDestroyBuffer(m_device, m_meshletBuffer, nullptr);
+    vkFreeMemory(m_device, m_meshletMemory, nullptr);
+    vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
+    vkFreeMemory(m_device, m_indexMemory, nullptr);
+    vkDestroyBuffer(m_device, m_positionBuffer, nullptr);
+    vkFreeMemory(m_device, m_positionMemory, nullptr);
+
+    if (m_budget != nullptr)
+    {
+        m_budget->Release(MemoryCategory::Mesh, m_trackedBytes);
+    }
+
+    *this = MeshletGeometry();
+}
+
+MeshShaderSupport MeshletGeometry::GetMeshShaderSupport(const DeviceCaps& caps)
+{
+    //The bundled headers predate the EXT extension, so it's looked up by name
+    if (caps.HasExtension("VK_EXT_mesh_shader"))
+    {
+        return MeshShaderSupport::EXT;
+    }
+#ifdef VK_NV_mesh_shader
+    if (caps.HasExtension(VK_NV_MESH_SHADER_EXTENSION_NAME))
+    {
+        return MeshShaderSupport::NV;
+    }
+#endif //VK_NV_mesh_shader
+
+    return MeshShaderSupport::None;
+}
+
+void MeshletGeometry::Update(uint32_t slot, const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition)
+{
+    PROFILE_SCOPE("MeshletCull");
+
+    //Planes and camera come into the mesh's space, so the bounds never have to be transformed
+    MeshletFrustum frustum = ExtractFrustum(viewProjection * model);
+    glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+    if (m_cullPipeline == VK_NULL_HANDLE)
+    {
+        Cull(slot, frustum, localCamera);
+        return;
+    }
+
+    MeshletCullConstants constants = {};
+    std::copy(std::begin(frustum.m_planes), std::end(frustum.m_planes), constants.m_planes);
+    constants.m_cameraPosition = glm::vec4(localCamera, 0.0f);
+    constants.m_meshletCount = static_cast<uint32_t>(m_meshletCount);
+    std::memcpy(m_mappedConstants + slot * m_constantRegionSize, &constants, sizeof(constants));
+}
+
+void MeshletGeometry::RecordCull(VkCommandBuffer cmd, uint32_t slot) const
+{
+    if (m_cullPipeline == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    VkDeviceSize regionOffset = slot * m_drawRegionSize;
+
+    //Compaction counts up from zero, the non-compacted draws ignore it
+    vkCmdFillBuffer(cmd, m_drawBuffer, regionOffset, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clearBarrier = {};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    //Dynamic offsets go in binding order
+    uint32_t dynamicOffsets[] = { static_cast<uint32_t>(slot * m_constantRegionSize), static_cast<uint32_t>(regionOffset) };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &m_cullSet, 2, dynamicOffsets);
+    vkCmdDispatch(cmd, static_cast<uint32_t>((m_meshletCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+
+    //Another family takes the region over in RecordAcquire. On the same family the semaphore
+    //the draw queue waits on would do, the barrier also covers a cull recorded with the draws.
+    if (m_drawTransfer.m_release)
+    {
+        m_drawTransfer.RecordRelease(cmd, m_drawBuffer, regionOffset, m_drawRegionSize);
+        return;
+    }
+
+    VkMemoryBarrier drawBarrier = {};
+    drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void MeshletGeometry::RecordAcquire(VkCommandBuffer cmd, uint32_t slot) const
+{
+    if (m_cullPipeline != VK_NULL_HANDLE)
+    {
+        m_drawTransfer.RecordAcquire(cmd, m_drawBuffer, slot * m_drawRegionSize, m_drawRegionSize);
+    }
+}
+
+void MeshletGeometry::RecordDraw(VkCommandBuffer cmd, uint32_t slot) const
+{
+    VkDeviceSize regionOffset = slot * m_drawRegionSize;
+    VkDeviceSize commandOffset = regionOffset + DRAW_COMMAND_OFFSET;
+    uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    uint32_t meshletCount = static_cast<uint32_t>(m_meshletCount);
+
+    vkCmdBindIndexBuffer(cmd, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+#ifdef VK_KHR_draw_indirect_count
+    //Only the draws that survived culling, compacted to the front
+    if (m_drawIndirectCount)
+    {
+        uint32_t maxDrawCount = std::min(meshletCount, m_caps->GetLimits().maxDrawIndirectCount);
+        VulkanImport::CmdDrawIndexedIndirectCountKHR(cmd, m_drawBuffer, commandOffset, m_drawBuffer, regionOffset, maxDrawCount, stride);
+        return;
+    }
+#endif //VK_KHR_draw_indirect_count
+
+    //Every meshlet's draw, culled ones have no instances
+    uint32_t batchSize = m_multiDrawIndirect ? std::max(m_caps->GetLimits().maxDrawIndirectCount, 1u) : 1;
+    for (uint32_t first = 0; first < meshletCount; first += batchSize)
+    {
+        uint32_t count = std::min(batchSize, meshletCount - first);
+        vkCmdDrawIndexedIndirect(cmd, m_drawBuffer, commandOffset + static_cast<VkDeviceSize>(first) * stride, count, stride);
+    }
+}
+
+void MeshletGeometry::PrintReport(std::ostream& out) const
+{
+    size_t meshletCount = std::max<size_t>(m_meshletCount, 1);
+    out << "meshlets: " << m_meshletCount << " for " << GetTriangleCount() << " triangles and " << m_vertexCount << " vertices, "
+        << static_cast<double>(GetTriangleCount()) / meshletCount << " triangles and "
+        << static_cast<double>(m_meshletVertexCount) / meshletCount << " vertices per meshlet" << std::endl;
+
+    const char* drawPath = m_drawIndirectCount ? "indirect count" : (m_multiDrawIndirect ? "multi draw indirect" : "indirect draw per meshlet");
+    out << "meshlet culling: " << (IsGpuCulled() ? "compute" : "cpu") << ", " << drawPath
+        << ", mesh shaders " << GetMeshShaderSupportName(m_meshShaderSupport) << " (unused)";
+    if (!IsGpuCulled())
+    {
+        out << ", " << m_visibleMeshlets << " visible last frame";
+    }
+    out << std::endl;
+}
+
+void MeshletGeometry::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory,
+    bool shared)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    uint32_t families[2] = { m_drawFamily, m_cullFamily };
+    if (shared && m_cullFamily != m_drawFamily)
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = families;
+    }
+
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create meshlet buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        properties |= VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    }
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = Util::FindMemoryType(m_caps->GetMemoryProperties(), requirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate meshlet memory!");
+    }
+
+    vkBindBufferMemory(m_device, buffer, memory, 0);
+
+    //Staging and the small per slot buffers aren't what the budget is about
+    if (m_budget != nullptr && (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+    {
+        m_budget->Track(MemoryCategory::Mesh, requirements.size);
+        m_trackedBytes += requirements.size;
+    }
+}
+
+void MeshletGeometry::Upload(const MeshletData& data, const std::vector<glm::vec3>& positions, VkCommandPool commandPool, QueueTimeline* timeline)
+{
+    //vec4 positions, std430 would pad vec3s to 16 bytes anyway
+    std::vector<glm::vec4> paddedPositions(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        paddedPositions[i] = glm::vec4(positions[i], 1.0f);
+    }
+    std::vector<uint32_t> indices = data.BuildIndexBuffer();
+
+    VkDeviceSize positionSize = paddedPositions.size() * sizeof(glm::vec4);
+    VkDeviceSize indexSize = indices.size() * sizeof(uint32_t);
+    VkDeviceSize meshletSize = m_cullData.size() * sizeof(MeshletCullData);
+    VkDeviceSize indexOffset = AlignUp(positionSize, 16);
+    VkDeviceSize meshletOffset = AlignUp(indexOffset + indexSize, 16);
+
+    VkBuffer staging = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    CreateBuffer(meshletOffset + meshletSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, staging, stagingMemory);
+
+    void* mapped = nullptr;
+    if (vkMapMemory(m_device, stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map meshlet staging memory!");
+    }
+    uint8_t* bytes = static_cast<uint8_t*>(mapped);
+    std::memcpy(bytes, paddedPositions.data(), positionSize);
+    std::memcpy(bytes + indexOffset, indices.data(), indexSize);
+    std::memcpy(bytes + meshletOffset, m_cullData.data(), meshletSize);
+    vkUnmapMemory(m_device, stagingMemory);
+
+    CreateBuffer(positionSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_positionBuffer, m_positionMemory);
+    CreateBuffer(indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_indexBuffer, m_indexMemory);
+    //Uploaded here and read by the cull, written once so sharing costs nothing
+    CreateBuffer(meshletSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_meshletBuffer, m_meshletMemory, true);
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    if (vkAllocateCommandBuffers(m_device, &allocInfo, &cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate meshlet upload command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &beginInfo);
+
+    VkBufferCopy copy = {};
+    copy.srcOffset = 0;
+    copy.size = positionSize;
+    vkCmdCopyBuffer(cmd, staging, m_positionBuffer, 1, &copy);
+    copy.srcOffset = indexOffset;
+    copy.size = indexSize;
+    vkCmdCopyBuffer(cmd, staging, m_indexBuffer, 1, &copy);
+    copy.srcOffset = meshletOffset;
+    copy.size = meshletSize;
+    vkCmdCopyBuffer(cmd, staging, m_meshletBuffer, 1, &copy);
+
+    //Later submits on the queue are ordered behind this, the barrier covers every one of them
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record meshlet upload!");
+    }
+
+    QueueTimeline::Batch batch;
+    batch.m_commandBuffers = &cmd;
+    batch.m_commandBufferCount = 1;
+    uint64_t value = timeline->Submit(batch);
+
+    m_deletionQueue->DestroyBuffer(staging, value);
+    m_deletionQueue->FreeMemory(stagingMemory, value);
+    VkDevice device = m_device;
+    m_deletionQueue->Defer([device, commandPool, cmd]()
+    {
+        vkFreeCommandBuffers(device, commandPool, 1, &cmd);
+    }, value);
+}
+
+void MeshletGeometry::CreateDrawBuffers(uint32_t slotCount, bool gpuCull)
+{
+    const VkPhysicalDeviceLimits& limits = m_caps->GetLimits();
+
+    m_drawRegionSize = AlignUp(DRAW_COMMAND_OFFSET + m_meshletCount * sizeof(VkDrawIndexedIndirectCommand),
+        std::max<VkDeviceSize>(limits.minStorageBufferOffsetAlignment, 16));
+
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    if (gpuCull)
+    {
+        usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    }
+    CreateBuffer(m_drawRegionSize * slotCount, usage, gpuCull ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        m_drawBuffer, m_drawMemory);
+
+    if (gpuCull)
+    {
+        m_constantRegionSize = AlignUp(sizeof(MeshletCullConstants), std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 16));
+        CreateBuffer(m_constantRegionSize * slotCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            m_constantBuffer, m_constantMemory);
+
+        void* mapped = nullptr;
+        if (vkMapMemory(m_device, m_constantMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map meshlet cull constants!");
+        }
+        m_mappedConstants = static_cast<uint8_t*>(mapped);
+        std::memset(m_mappedConstants, 0, m_constantRegionSize * slotCount);
+        return;
+    }
+
+    void* mapped = nullptr;
+    if (vkMapMemory(m_device, m_drawMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map meshlet draws!");
+    }
+    m_mappedDraws = static_cast<uint8_t*>(mapped);
+
+    //Everything drawn until the first Update
+    for (uint32_t slot = 0; slot < slotCount; slot++)
+    {
+        uint8_t* region = m_mappedDraws + slot * m_drawRegionSize;
+        uint32_t count = static_cast<uint32_t>(m_meshletCount);
+        std::memcpy(region, &count, sizeof(count));
+        for (size_t i = 0; i < m_meshletCount; i++)
+        {
+            VkDrawIndexedIndirectCommand draw = GetDraw(i, 1);
+            std::memcpy(region + DRAW_COMMAND_OFFSET + i * sizeof(draw), &draw, sizeof(draw));
+        }
+    }
+}
+
+void MeshletGeometry::CreateDescriptorSets()
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create meshlet set layout!");
+    }
+
+    //Room for the cull set too, whether or not it's used
+    VkDescriptorPoolSize poolSizes[3] = {};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 2;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[1].descriptorCount = 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    poolSizes[2].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 2;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create meshlet descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate meshlet descriptor set!");
+    }
+
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = m_positionBuffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+void MeshletGeometry::CreateCullPipeline(const std::vector<char>& cullShader)
+{
+    //Meshlets, the slot's constants and the slot's draws
+    VkDescriptorSetLayoutBinding bindings[3] = {};
+    VkDescriptorType types[3] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC };
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = types[i];
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_cullSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create meshlet cull set layout!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_cullSetLayout;
+
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_cullSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate meshlet cull descriptor set!");
+    }
+
+    //The dynamic bindings cover one slot, their offsets pick which
+    VkDescriptorBufferInfo bufferInfos[3] = {};
+    bufferInfos[0] = { m_meshletBuffer, 0, VK_WHOLE_SIZE };
+    bufferInfos[1] = { m_constantBuffer, 0, sizeof(MeshletCullConstants) };
+    bufferInfos[2] = { m_drawBuffer, 0, m_drawRegionSize };
+
+    VkWriteDescriptorSet writes[3] = {};
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_cullSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = types[i];
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_device, 3, writes, 0, nullptr);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_cullSetLayout;
+
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_cullPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create meshlet cull pipeline layout!");
+    }
+
+    VkShaderModuleCreateInfo moduleInfo = {};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = cullShader.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(cullShader.data());
+
+    VkShaderModule module = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &module) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create meshlet cull shader module!");
+    }
+
+    //COMPACT, constant 0 of the shader
+    VkBool32 compact = m_drawIndirectCount ? VK_TRUE : VK_FALSE;
+    VkSpecializationMapEntry entry = { 0, 0, sizeof(VkBool32) };
+    VkSpecializationInfo specialization = {};
+    specialization.mapEntryCount = 1;
+    specialization.pMapEntries = &entry;
+    specialization.dataSize = sizeof(compact);
+    specialization.pData = &compact;
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specialization;
+    pipelineInfo.layout = m_cullPipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_cullPipeline);
+    //The pipeline doesn't need the module once it's built
+    vkDestroyShaderModule(m_device, module, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+        m_cullPipeline = VK_NULL_HANDLE;
+        throw std::runtime_error("failed to create meshlet cull pipeline!");
+    }
+}
+
+void MeshletGeometry::Cull(uint32_t slot, const MeshletFrustum& frustum, const glm::vec3& cameraPosition)
+{
+    uint8_t* region = m_mappedDraws + slot * m_drawRegionSize;
+    uint8_t* draws = region + DRAW_COMMAND_OFFSET;
+
+    uint32_t visible = 0;
+    for (size_t i = 0; i < m_meshletCount; i++)
+    {
+        bool isVisible = IsMeshletVisible(m_bounds[i], frustum, cameraPosition);
+
+        //Compacted with a count to go by, otherwise every meshlet keeps its place
+        if (m_drawIndirectCount)
+        {
+            if (isVisible)
+            {
+                VkDrawIndexedIndirectCommand draw = GetDraw(i, 1);
+                std::memcpy(draws + visible * sizeof(draw), &draw, sizeof(draw));
+            }
+        }
+        else
+        {
+            VkDrawIndexedIndirectCommand draw = GetDraw(i, isVisible ? 1 : 0);
+            std::memcpy(draws + i * sizeof(draw), &draw, sizeof(draw));
+        }
+
+        visible += isVisible ? 1 : 0;
+    }
+
+    std::memcpy(region, &visible, sizeof(visible));
+    m_visibleMeshlets = visible;
+}
+
+VkDrawIndexedIndirectCommand MeshletGeometry::GetDraw(size_t meshlet, uint32_t instanceCount) const
+{
+    VkDrawIndexedIndirectCommand draw = {};
+    draw.indexCount = m_cullData[meshlet].m_indexCount;
+    draw.instanceCount = instanceCount;
+    draw.firstIndex = m_cullData[meshlet].m_firstIndex;
+    draw.vertexOffset = 0;
+    draw.firstInstance = 0;
+
+    return draw;
+}
@@ -0,0 +1,179 @@
+#ifndef __MESHLET_GEOMETRY_H__
+#define __MESHLET_GEOMETRY_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AsyncCompute.h"
+#include "DeletionQueue.h"
+#include "DeviceCaps.h"
+#include "MemoryBudget.h"
+#include "MeshletBuilder.h"
+#include "QueueTimeline.h"
+
+//Per meshlet data the cull shader reads, std430
+struct MeshletCullData
+{
+    //Bounding sphere center and radius
+    float m_sphere[4];
+    //Cone axis and cutoff, see MeshletBounds
+    float m_cone[4];
+    uint32_t m_indexCount;
+    uint32_t m_firstIndex;
+    uint32_t m_padding[2];
+};
+
+//Per slot constants of the cull shader, std140. Everything in the mesh's own space.
+struct MeshletCullConstants
+{
+    glm::vec4 m_planes[6];
+    glm::vec4 m_cameraPosition;
+    uint32_t m_meshletCount;
+    uint32_t m_padding[3];
+};
+
+//Mesh shading the device exposes. Only reported for now, meshlets are drawn as indexed
+//draws on every device.
+enum class MeshShaderSupport
+{
+    None,
+    NV,
+    EXT
+};
+
+const char* GetMeshShaderSupportName(MeshShaderSupport support);
+
+//A mesh split into meshlets (see MeshletBuilder.h) and culled per meshlet every frame, so
+//only the clusters that can be on screen and facing the camera reach the rasterizer.
+//Vertices are pulled from a storage buffer by gl_VertexIndex, there's no vertex input, which
+//keeps the pipelines the same shape as the rest. The index buffer holds every meshlet's
+//triangles back to back and each meshlet is one indexed draw.
+//Culling writes the frame's draws into the slot's region of the draw buffer: a count, then
+//a VkDrawIndexedIndirectCommand per meshlet. Two ways of filling it:
+//- Compute: one invocation per meshlet tests the frustum planes and the normal cone. With
+//  VK_KHR_draw_indirect_count the survivors are compacted to the front and the count
+//  decides how many draws run, without it culled draws keep their place with no instances.
+//- CPU: the same tests in Update, written straight into the mapped region. Used when there
+//  is no cull shader.
+//The compute path is an AsyncCompute job: the cull is recorded every frame on the compute
+//queue, and the draw queue waits for it before drawing. On a separate queue family the
+//slot's region of the draw buffer changes owner every frame (RecordCull releases it,
+//RecordAcquire takes it back). The meshlet buffer is shared by both families instead.
+//The draws are recorded once into the slot's command buffer and never change.
+//Slots follow the swapchain images. A slot's region may only be written (Update, RecordCull)
+//once the GPU is done with the slot's last frame.
+class MeshletGeometry
+{
+public:
+    //Builds the meshlets and uploads everything on the timeline's queue. cullShader is
+    //SPIR-V of Shaders/MeshletCull.comp, empty culls on the CPU. drawIndirectCount says
+    //VK_KHR_draw_indirect_count is enabled and loaded, multiDrawIndirect the feature.
+    //The cull runs on a queue of cullFamily, the draws on one of the timeline's drawFamily.
+    void Init(VkDevice device, const DeviceCaps* caps, VkCommandPool commandPool, QueueTimeline* timeline, DeletionQueue* deletionQueue,
+        MemoryBudget* budget, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, uint32_t slotCount,
+        const std::vector<char>& cullShader, bool drawIndirectCount, bool multiDrawIndirect, uint32_t cullFamily, uint32_t drawFamily);
+    //The device has to be idle
+    void Destroy();
+    bool IsLoaded() const { return m_device != VK_NULL_HANDLE; }
+
+    static MeshShaderSupport GetMeshShaderSupport(const DeviceCaps& caps);
+
+    //Culls against viewProjection * model from cameraPosition (world space). The cone test
+    //is only exact for models without non-uniform scale.
+    void Update(uint32_t slot, const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition);
+
+    //On the cull queue, in a submit the draw queue waits on at VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT.
+    //Nothing on the CPU path.
+    void RecordCull(VkCommandBuffer cmd, uint32_t slot) const;
+    //On the draw queue, outside any render pass and ahead of the passes that draw. Only
+    //records anything when the cull runs on another queue family.
+    void RecordAcquire(VkCommandBuffer cmd, uint32_t slot) const;
+    //Inside a render pass, with a pipeline built for GetSetLayout bound
+    void RecordDraw(VkCommandBuffer cmd, uint32_t slot) const;
+
+    //Positions, vertex stage
+    VkDescriptorSetLayout GetSetLayout() const { return m_setLayout; }
+    VkDescriptorSet GetDescriptorSet() const { return m_descriptorSet; }
+
+    uint32_t GetMeshletCount() const { return static_cast<uint32_t>(m_meshletCount); }
+    uint32_t GetTriangleCount() const { return m_indexCount / 3; }
+    bool IsGpuCulled() const { return m_cullPipeline != VK_NULL_HANDLE; }
+
+    void PrintReport(std::ostream& out) const;
+
+private:
+    //Host visible memory is also coherent. shared buffers are concurrent over the cull and
+    //draw families when those differ.
+    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory,
+        bool shared = false);
+    void Upload(const MeshletData& data, const std::vector<glm::vec3>& positions, VkCommandPool commandPool, QueueTimeline* timeline);
+    //Device local when the compute path fills them, mapped for the CPU path otherwise
+    void CreateDrawBuffers(uint32_t slotCount, bool gpuCull);
+    void CreateDescriptorSets();
+    void CreateCullPipeline(const std::vector<char>& cullShader);
+    //CPU path, the frustum and cone test per meshlet
+    void Cull(uint32_t slot, const MeshletFrustum& frustum, const glm::vec3& cameraPosition);
+    VkDrawIndexedIndirectCommand GetDraw(size_t meshlet, uint32_t instanceCount) const;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    const DeviceCaps* m_caps = nullptr;
+    DeletionQueue* m_deletionQueue = nullptr;
+    MemoryBudget* m_budget = nullptr;
+    bool m_drawIndirectCount = false;
+    bool m_multiDrawIndirect = false;
+    uint32_t m_cullFamily = 0;
+    uint32_t m_drawFamily = 0;
+    //The draw buffer from the cull to the draws
+    QueueOwnershipTransfer m_drawTransfer;
+
+    //Bounds for the CPU path, index ranges for its draws
+    std::vector<MeshletBounds> m_bounds;
+    std::vector<MeshletCullData> m_cullData;
+    size_t m_meshletCount = 0;
+    uint32_t m_indexCount = 0;
+    uint32_t m_vertexCount = 0;
+    //Summed over the meshlets, vertices on a meshlet border count once per meshlet
+    size_t m_meshletVertexCount = 0;
+    MeshShaderSupport m_meshShaderSupport = MeshShaderSupport::None;
+
+    VkBuffer m_positionBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_positionMemory = VK_NULL_HANDLE;
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_indexMemory = VK_NULL_HANDLE;
+    VkBuffer m_meshletBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_meshletMemory = VK_NULL_HANDLE;
+    //What's been reported to m_budget
+    VkDeviceSize m_trackedBytes = 0;
+
+    //A region per slot: the draw count, then the draws from offset DRAW_COMMAND_OFFSET
+    VkBuffer m_drawBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_drawMemory = VK_NULL_HANDLE;
+    //Null on the compute path, the draws never leave the device there
+    uint8_t* m_mappedDraws = nullptr;
+    VkDeviceSize m_drawRegionSize = 0;
+    //A MeshletCullConstants per slot
+    VkBuffer m_constantBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_constantMemory = VK_NULL_HANDLE;
+    uint8_t* m_mappedConstants = nullptr;
+    VkDeviceSize m_constantRegionSize = 0;
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_cullSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+    //Constants and draws are bound with dynamic offsets, one set covers every slot
+    VkDescriptorSet m_cullSet = VK_NULL_HANDLE;
+    VkPipelineLayout m_cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_cullPipeline = VK_NULL_HANDLE;
+
+    //CPU path, from the last Update
+    uint32_t m_visibleMeshlets = 0;
+};
+
+#endif // !__MESHLET_GEOMETRY_H__
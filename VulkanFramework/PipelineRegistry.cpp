@@ -0,0 +1,68 @@
+#include "PipelineRegistry.h"
+
+PipelineKey PipelineRegistry::GetPipelineKey(const PipelineKey& key) const
+{
+    if (!m_extendedDynamicState)
+    {
+        return key;
+    }
+
+    PipelineKey pipelineKey = key;
+    pipelineKey.m_cullMode = VK_CULL_MODE_NONE;
+    pipelineKey.m_depthTest = true;
+
+    //Dynamic topology can only switch within the class the pipeline was built with
+    switch (key.m_topology)
+    {
+    case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+        pipelineKey.m_topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        break;
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+        pipelineKey.m_topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        break;
+    case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+        pipelineKey.m_topology = VK_PRIMITIVE_TOPOLOGY_PATCH_LIST;
+        break;
+    default:
+        pipelineKey.m_topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        break;
+    }
+
+    return pipelineKey;
+}
+
+VkPipeline PipelineRegistry::GetOrCreate(const PipelineKey& key, const CreateFunc& create)
+{
+    PipelineKey pipelineKey = GetPipelineKey(key);
+
+    auto it = m_pipelines.find(pipelineKey);
+    if (it != m_pipelines.end())
+    {
+        return it->second;
+    }
+
+    VkPipeline pipeline = create(pipelineKey);
+    m_pipelines.emplace(pipelineKey, pipeline);
+
+    return pipeline;
+}
+
+VkPipeline PipelineRegistry::Find(const PipelineKey& key) const
+{
+    auto it = m_pipelines.find(GetPipelineKey(key));
+
+    return it != m_pipelines.end() ? it->second : VK_NULL_HANDLE;
+}
+
+void PipelineRegistry::Destroy(VkDevice device)
+{
+    for (auto& entry : m_pipelines)
+    {
+        vkDestroyPipeline(device, entry.second, nullptr);
+    }
+
+    m_pipelines.clear();
+}
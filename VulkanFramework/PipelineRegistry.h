@@ -0,0 +1,89 @@
+#ifndef __PIPELINE_REGISTRY_H__
+#define __PIPELINE_REGISTRY_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <functional>
+#include <unordered_map>
+
+#include "ShaderPermutation.h"
+#include "Util.h"
+
+//Which pass a pipeline is built for, decides render pass, stages and depth state
+enum class PipelinePass : uint32_t
+{
+    //Depth test and write, reversed-Z GREATER
+    Forward = 0,
+    //Vertex stage only, lays down depth for the opaque geometry
+    DepthPrePass = 1,
+    //Shades after a depth pre-pass, EQUAL test and no depth write
+    ForwardDepthEqual = 2
+};
+
+struct PipelineKey
+{
+    ShaderPermutationKey m_permutation;
+    PipelinePass m_pass = PipelinePass::Forward;
+
+    //Fixed function state. Only part of the pipeline when the device can't set it
+    //with VK_EXT_extended_dynamic_state, otherwise it's recorded with the draw.
+    VkCullModeFlags m_cullMode = VK_CULL_MODE_BACK_BIT;
+    VkPrimitiveTopology m_topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    bool m_depthTest = true;
+    //Pulls MeshletGeometry's vertices instead of drawing the built-in triangle
+    bool m_meshlets = false;
+
+    bool operator==(const PipelineKey& other) const
+    {
+        return m_permutation == other.m_permutation &&
+            m_pass == other.m_pass &&
+            m_cullMode == other.m_cullMode &&
+            m_topology == other.m_topology &&
+            m_depthTest == other.m_depthTest &&
+            m_meshlets == other.m_meshlets;
+    }
+};
+
+struct PipelineKeyHash
+{
+    size_t operator()(const PipelineKey& key) const
+    {
+        size_t hash = std::hash<uint64_t>()((static_cast<uint64_t>(key.m_pass) << 32) | key.m_permutation.Pack());
+        Util::HashCombine(hash, key.m_cullMode);
+        Util::HashCombine(hash, static_cast<uint32_t>(key.m_topology));
+        Util::HashCombine(hash, key.m_depthTest);
+        Util::HashCombine(hash, key.m_meshlets);
+
+        return hash;
+    }
+};
+
+//Holds every graphics pipeline, keyed on the shader permutation and pass it was built for.
+//Pipelines are created lazily the first time a permutation is requested.
+class PipelineRegistry
+{
+public:
+    using CreateFunc = std::function<VkPipeline(const PipelineKey&)>;
+
+    //With extended dynamic state, keys that only differ in dynamic state share a pipeline
+    void SetExtendedDynamicState(bool enabled) { m_extendedDynamicState = enabled; }
+    bool HasExtendedDynamicState() const { return m_extendedDynamicState; }
+    //Drops whatever the pipeline doesn't bake in, this is the key pipelines are stored under
+    PipelineKey GetPipelineKey(const PipelineKey& key) const;
+
+    //Returns the pipeline for the key, building it with create if it doesn't exist yet
+    VkPipeline GetOrCreate(const PipelineKey& key, const CreateFunc& create);
+    //Returns VK_NULL_HANDLE if the permutation was never built
+    VkPipeline Find(const PipelineKey& key) const;
+
+    size_t GetPipelineCount() const { return m_pipelines.size(); }
+
+    void Destroy(VkDevice device);
+
+private:
+    bool m_extendedDynamicState = false;
+    std::unordered_map<PipelineKey, VkPipeline, PipelineKeyHash> m_pipelines;
+};
+
+#endif // !__PIPELINE_REGISTRY_H__
@@ -0,0 +1,199 @@
+#include "PresentPolicy.h"
+
+#include <algorithm>
+
+namespace
+{
+    bool HasPresentMode(const std::vector<VkPresentModeKHR>& presentModes, VkPresentModeKHR presentMode)
+    {
+        return std::find(presentModes.begin(), presentModes.end(), presentMode) != presentModes.end();
+    }
+}
+
+bool ParsePresentPolicy(const std::string& name, PresentPolicy& policy)
+{
+    const PresentPolicy policies[] = { PresentPolicy::VSync, PresentPolicy::LowLatency, PresentPolicy::Adaptive, PresentPolicy::Uncapped };
+    for (PresentPolicy candidate : policies)
+    {
+        if (name == GetPresentPolicyName(candidate))
+        {
+            policy = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char* GetPresentPolicyName(PresentPolicy policy)
+{
+    switch (policy)
+    {
+    case PresentPolicy::VSync: return "vsync";
+    case PresentPolicy::LowLatency: return "low-latency";
+    case PresentPolicy::Adaptive: return "adaptive";
+    case PresentPolicy::Uncapped: return "uncapped";
+    default: return "unknown";
+    }
+}
+
+const char* GetPresentModeName(VkPresentModeKHR presentMode)
+{
+    switch (presentMode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+    default: return "other";
+    }
+}
+
+PresentConfig ChoosePresentConfig(PresentPolicy policy, const VkSurfaceCapabilitiesKHR& capabilities, const std::vector<VkPresentModeKHR>& presentModes)
+{
+    PresentConfig config;
+
+    //One image more than the minimum lets the CPU record the next frame while one is shown
+    //and one queued, which is what the old fixed minImageCount + 1 did
+    uint32_t queuedImageCount = capabilities.minImageCount + 1;
+
+    switch (policy)
+    {
+    case PresentPolicy::VSync:
+        config.m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        config.m_imageCount = queuedImageCount;
+        break;
+    case PresentPolicy::LowLatency:
+        if (HasPresentMode(presentModes, VK_PRESENT_MODE_MAILBOX_KHR))
+        {
+            //Mailbox needs one image on screen, one being rendered and one to replace,
+            //anything past three only adds memory
+            config.m_presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            config.m_imageCount = std::max(capabilities.minImageCount, 3u);
+        }
+        else
+        {
+            //Rendering blocks on acquire instead of queueing frames up
+            config.m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+            config.m_imageCount = capabilities.minImageCount;
+            config.m_fallback = true;
+        }
+        break;
+    case PresentPolicy::Adaptive:
+        config.m_presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        config.m_imageCount = queuedImageCount;
+        break;
+    case PresentPolicy::Uncapped:
+        config.m_presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        config.m_imageCount = queuedImageCount;
+        break;
+    }
+
+    if (!HasPresentMode(presentModes, config.m_presentMode))
+    {
+        //Mailbox is the next best thing to immediate for a benchmark, it never waits either
+        if (policy == PresentPolicy::Uncapped && HasPresentMode(presentModes, VK_PRESENT_MODE_MAILBOX_KHR))
+        {
+            config.m_presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        }
+        else
+        {
+            config.m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        }
+        config.m_fallback = true;
+    }
+
+    //0 is a special number, means no limit
+    config.m_imageCount = std::max(config.m_imageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0)
+    {
+        config.m_imageCount = std::min(config.m_imageCount, capabilities.maxImageCount);
+    }
+
+    return config;
+}
+
+void PresentStats::OnPresent()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (m_hasPresented)
+    {
+        if (m_intervals.empty())
+        {
+            m_intervals.resize(WINDOW_SIZE);
+        }
+
+        m_intervals[m_next] = std::chrono::duration<double, std::milli>(now - m_lastPresent).count();
+        m_next = (m_next + 1) % WINDOW_SIZE;
+        if (m_count < WINDOW_SIZE)
+        {
+            m_count++;
+        }
+    }
+
+    m_lastPresent = now;
+    m_hasPresented = true;
+}
+
+void PresentStats::Reset()
+{
+    m_hasPresented = false;
+    m_next = 0;
+    m_count = 0;
+}
+
+double PresentStats::GetAverageMs() const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+
+    double total = 0.0;
+    for (uint32_t i = 0; i < m_count; i++)
+    {
+        total += m_intervals[i];
+    }
+
+    return total / m_count;
+}
+
+double PresentStats::GetMinMs() const
+{
+    return m_count == 0 ? 0.0 : *std::min_element(m_intervals.begin(), m_intervals.begin() + m_count);
+}
+
+double PresentStats::GetMaxMs() const
+{
+    return m_count == 0 ? 0.0 : *std::max_element(m_intervals.begin(), m_intervals.begin() + m_count);
+}
+
+double PresentStats::GetPercentileMs(double percentile) const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+
+    //The window is small, a sorted copy is cheaper than keeping anything sorted per frame
+    std::vector<double> sorted(m_intervals.begin(), m_intervals.begin() + m_count);
+    size_t index = static_cast<size_t>(std::clamp(percentile, 0.0, 1.0) * (m_count - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+
+    return sorted[index];
+}
+
+void PresentStats::PrintReport(std::ostream& out) const
+{
+    if (m_count == 0)
+    {
+        out << "present: no intervals yet" << std::endl;
+        return;
+    }
+
+    double average = GetAverageMs();
+    out << "present: " << m_count << " intervals, avg " << average << "ms (" << 1000.0 / average << " Hz)"
+        << ", min " << GetMinMs() << "ms, p50 " << GetPercentileMs(0.5) << "ms, p99 " << GetPercentileMs(0.99)
+        << "ms, max " << GetMaxMs() << "ms" << std::endl;
+}
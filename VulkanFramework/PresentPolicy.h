@@ -0,0 +1,75 @@
+#ifndef __PRESENT_POLICY_H__
+#define __PRESENT_POLICY_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//What the swapchain optimizes for. Each one maps to a present mode and an image count,
+//falling back to FIFO (the only mode every device has) when its mode is missing.
+enum class PresentPolicy : uint32_t
+{
+    //FIFO, one image more than the minimum so the CPU can work ahead. No tearing, most latency.
+    VSync,
+    //MAILBOX with the fewest images that still let a newer frame replace a queued one.
+    //Without MAILBOX, FIFO with the minimum image count so at most one frame is queued.
+    LowLatency,
+    //FIFO_RELAXED, tears instead of waiting a whole refresh when a frame is late
+    Adaptive,
+    //IMMEDIATE, no waiting on the display at all, for benchmarking
+    Uncapped
+};
+
+struct PresentConfig
+{
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t m_imageCount = 0;
+    //The policy's own mode wasn't available
+    bool m_fallback = false;
+};
+
+//Returns false for an unknown name, accepts what GetPresentPolicyName returns
+bool ParsePresentPolicy(const std::string& name, PresentPolicy& policy);
+const char* GetPresentPolicyName(PresentPolicy policy);
+const char* GetPresentModeName(VkPresentModeKHR presentMode);
+
+//Present mode and swapchain minImageCount for policy, within what the surface allows
+PresentConfig ChoosePresentConfig(PresentPolicy policy, const VkSurfaceCapabilitiesKHR& capabilities, const std::vector<VkPresentModeKHR>& presentModes);
+
+//Time between consecutive presents over the last few hundred frames. The spread shows
+//pacing (FIFO should sit on the refresh interval), the average what the policy lets through.
+class PresentStats
+{
+public:
+    static const uint32_t WINDOW_SIZE = 512;
+
+    //Call right after vkQueuePresentKHR
+    void OnPresent();
+    void Reset();
+
+    //Intervals currently in the window
+    uint32_t GetCount() const { return m_count; }
+    double GetAverageMs() const;
+    double GetMinMs() const;
+    double GetMaxMs() const;
+    //percentile in [0, 1]
+    double GetPercentileMs(double percentile) const;
+
+    void PrintReport(std::ostream& out) const;
+
+private:
+    std::chrono::steady_clock::time_point m_lastPresent;
+    bool m_hasPresented = false;
+
+    //Ring of the last WINDOW_SIZE intervals
+    std::vector<double> m_intervals;
+    uint32_t m_next = 0;
+    uint32_t m_count = 0;
+};
+
+#endif // !__PRESENT_POLICY_H__
@@ -0,0 +1,339 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+Profiler* Profiler::m_singletonInst = nullptr;
+bool Profiler::m_enabled = false;
+
+//Hard cap so a forgotten capture can't eat all the memory
+static const size_t MAX_CAPTURED_EVENTS = 1 << 20;
+
+void RollingStats::Add(double value)
+{
+    m_samples[m_next] = value;
+    m_next = (m_next + 1) % WINDOW;
+    m_count = std::min(m_count + 1, WINDOW);
+}
+
+double RollingStats::GetMin() const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+
+    return *std::min_element(m_samples.begin(), m_samples.begin() + m_count);
+}
+
+double RollingStats::GetAverage() const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+
+    double sum = 0.0;
+    for (uint32_t i = 0; i < m_count; i++)
+    {
+        sum += m_samples[i];
+    }
+
+    return sum / m_count;
+}
+
+double RollingStats::GetPercentile(double p) const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+
+    //Only runs when reporting, a copy is fine
+    std::vector<double> sorted(m_samples.begin(), m_samples.begin() + m_count);
+    size_t index = std::min(static_cast<size_t>(p * m_count), sorted.size() - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+
+    return sorted[index];
+}
+
+Profiler* Profiler::GetInstance()
+{
+    if (m_singletonInst == nullptr)
+    {
+        m_singletonInst = new Profiler();
+    }
+
+    return m_singletonInst;
+}
+
+Profiler::Profiler()
+{
+    m_calibrationTicks = Now();
+    m_calibrationNs = SteadyNanoseconds();
+}
+
+void Profiler::Calibrate()
+{
+#ifdef PROFILER_HAS_TSC
+    //Needs a few milliseconds between the samples before the ratio means anything
+    int64_t ticks = Now();
+    int64_t ns = SteadyNanoseconds();
+    if (ns - m_calibrationNs > 1000000 && ticks > m_calibrationTicks)
+    {
+        m_nsPerTick = static_cast<double>(ns - m_calibrationNs) / (ticks - m_calibrationTicks);
+    }
+#endif
+}
+
+void Profiler::CleanupInstance()
+{
+    if (m_singletonInst != nullptr)
+    {
+        delete m_singletonInst;
+        m_singletonInst = nullptr;
+    }
+}
+
+void Profiler::EndFrame()
+{
+    Calibrate();
+
+    for (uint32_t i = 0; i < m_cpuEventCount; i++)
+    {
+        const CpuEvent& event = m_cpuEvents[i];
+        int64_t start = ToNanoseconds(event.m_start);
+        int64_t end = ToNanoseconds(event.m_end);
+        m_cpuStats[event.m_name].Add((end - start) / 1000000.0);
+
+        if (m_capturing)
+        {
+            AddCaptured(event.m_name, false, start, end);
+        }
+    }
+
+    m_cpuEventCount = 0;
+    m_frameIndex++;
+}
+
+void Profiler::InitGpu(VkDevice device, const DeviceCaps& caps, uint32_t queueFamily, uint32_t slotCount)
+{
+    //Zero valid bits means the queue can't write timestamps at all
+    uint32_t validBits = caps.GetQueueFamilies()[queueFamily].timestampValidBits;
+    if (validBits == 0)
+    {
+        return;
+    }
+
+    m_device = device;
+    m_timestampPeriod = caps.GetLimits().timestampPeriod;
+    m_timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+    m_gpuSlots.resize(slotCount);
+    for (GpuSlot& slot : m_gpuSlots)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo = {};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = MAX_GPU_SCOPES * 2;
+
+        if (vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &slot.m_queryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+}
+
+void Profiler::DestroyGpu()
+{
+    for (GpuSlot& slot : m_gpuSlots)
+    {
+        vkDestroyQueryPool(m_device, slot.m_queryPool, nullptr);
+    }
+
+    m_gpuSlots.clear();
+}
+
+void Profiler::BeginGpuFrame(VkCommandBuffer cmd, uint32_t slot)
+{
+    if (!HasGpuTimestamps())
+    {
+        return;
+    }
+
+    GpuSlot& gpuSlot = m_gpuSlots[slot];
+    gpuSlot.m_scopes.clear();
+    gpuSlot.m_openScopes.clear();
+
+    vkCmdResetQueryPool(cmd, gpuSlot.m_queryPool, 0, MAX_GPU_SCOPES * 2);
+}
+
+void Profiler::BeginGpuScope(VkCommandBuffer cmd, uint32_t slot, const std::string& name)
+{
+    if (!HasGpuTimestamps() || m_gpuSlots[slot].m_scopes.size() >= MAX_GPU_SCOPES)
+    {
+        return;
+    }
+
+    GpuSlot& gpuSlot = m_gpuSlots[slot];
+    uint32_t scope = static_cast<uint32_t>(gpuSlot.m_scopes.size());
+    gpuSlot.m_scopes.push_back(name);
+    gpuSlot.m_openScopes.push_back(scope);
+
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gpuSlot.m_queryPool, scope * 2);
+}
+
+void Profiler::EndGpuScope(VkCommandBuffer cmd, uint32_t slot)
+{
+    if (!HasGpuTimestamps() || m_gpuSlots[slot].m_openScopes.empty())
+    {
+        return;
+    }
+
+    GpuSlot& gpuSlot = m_gpuSlots[slot];
+    uint32_t scope = gpuSlot.m_openScopes.back();
+    gpuSlot.m_openScopes.pop_back();
+
+    //Bottom of pipe, so the timestamp lands once everything before it has finished
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gpuSlot.m_queryPool, scope * 2 + 1);
+}
+
+void Profiler::OnSubmit(uint32_t slot)
+{
+    if (!HasGpuTimestamps())
+    {
+        return;
+    }
+
+    m_gpuSlots[slot].m_submitted = true;
+    m_gpuSlots[slot].m_submitTime = ToNanoseconds(Now());
+}
+
+void Profiler::CollectGpu(uint32_t slot)
+{
+    if (!HasGpuTimestamps() || !m_gpuSlots[slot].m_submitted || m_gpuSlots[slot].m_scopes.empty())
+    {
+        return;
+    }
+
+    GpuSlot& gpuSlot = m_gpuSlots[slot];
+    uint32_t queryCount = static_cast<uint32_t>(gpuSlot.m_scopes.size()) * 2;
+
+    //No WAIT flag, if the results aren't all there yet this frame is just skipped
+    std::array<uint64_t, MAX_GPU_SCOPES * 2> ticks;
+    if (vkGetQueryPoolResults(m_device, gpuSlot.m_queryPool, 0, queryCount, sizeof(uint64_t) * queryCount,
+        ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    gpuSlot.m_submitted = false;
+
+    //Ticks to nanoseconds, masked in case the counter wraps
+    uint64_t first = ticks[0] & m_timestampMask;
+    for (uint32_t i = 0; i < gpuSlot.m_scopes.size(); i++)
+    {
+        uint64_t begin = ticks[i * 2] & m_timestampMask;
+        uint64_t end = ticks[i * 2 + 1] & m_timestampMask;
+        double duration = ((end - begin) & m_timestampMask) * m_timestampPeriod;
+
+        m_gpuStats[gpuSlot.m_scopes[i]].Add(duration / 1000000.0);
+
+        //The GPU clock isn't the CPU clock, line the frame up with its submit
+        if (m_capturing)
+        {
+            int64_t start = gpuSlot.m_submitTime + static_cast<int64_t>(((begin - first) & m_timestampMask) * m_timestampPeriod);
+            AddCaptured(gpuSlot.m_scopes[i], true, start, start + static_cast<int64_t>(duration));
+        }
+    }
+}
+
+void Profiler::PrintReport(std::ostream& out) const
+{
+    auto printTable = [&out](const char* title, const std::unordered_map<std::string, RollingStats>& stats)
+    {
+        //Sorted so consecutive reports line up
+        std::map<std::string, const RollingStats*> sorted;
+        for (const auto& entry : stats)
+        {
+            sorted[entry.first] = &entry.second;
+        }
+
+        out << title << " (ms)        min       avg       p99" << std::endl;
+        for (const auto& entry : sorted)
+        {
+            out << "  " << std::left << std::setw(20) << entry.first << std::right << std::fixed << std::setprecision(3)
+                << std::setw(10) << entry.second->GetMin()
+                << std::setw(10) << entry.second->GetAverage()
+                << std::setw(10) << entry.second->GetPercentile(0.99) << std::endl;
+        }
+    };
+
+    printTable("cpu", m_cpuStats);
+    if (HasGpuTimestamps())
+    {
+        printTable("gpu", m_gpuStats);
+    }
+}
+
+void Profiler::StartCapture()
+{
+    m_captured.clear();
+    m_capturing = true;
+}
+
+void Profiler::AddCaptured(const std::string& name, bool gpu, int64_t start, int64_t end)
+{
+    if (m_captured.size() < MAX_CAPTURED_EVENTS)
+    {
+        m_captured.push_back({ name, gpu, start, end });
+    }
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+    m_capturing = false;
+
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    int64_t origin = m_captured.empty() ? 0 : m_captured.front().m_start;
+    for (const auto& event : m_captured)
+    {
+        origin = std::min(origin, event.m_start);
+    }
+
+    //Complete events, CPU and GPU on their own tracks. Timestamps are in microseconds.
+    file << "{\"traceEvents\":[" << std::endl;
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}}," << std::endl;
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    file << std::fixed << std::setprecision(3);
+    for (const auto& event : m_captured)
+    {
+        std::string name;
+        for (char c : event.m_name)
+        {
+            if (c == '"' || c == '\\')
+            {
+                name += '\\';
+            }
+            name += c;
+        }
+
+        file << "," << std::endl << "{\"name\":\"" << name << "\",\"cat\":\"" << (event.m_gpu ? "gpu" : "cpu")
+            << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << (event.m_gpu ? 1 : 0)
+            << ",\"ts\":" << (event.m_start - origin) / 1000.0
+            << ",\"dur\":" << (event.m_end - event.m_start) / 1000.0 << "}";
+    }
+    file << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+    m_captured.clear();
+
+    return true;
+}
@@ -0,0 +1,204 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DeviceCaps.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_HAS_TSC 1
+#endif
+
+//Last WINDOW samples of one scope, in milliseconds
+class RollingStats
+{
+public:
+    static const uint32_t WINDOW = 256;
+
+    void Add(double value);
+
+    uint32_t GetCount() const { return m_count; }
+    double GetMin() const;
+    double GetAverage() const;
+    //p in [0, 1], e.g. 0.99
+    double GetPercentile(double p) const;
+
+private:
+    std::array<double, WINDOW> m_samples = {};
+    uint32_t m_next = 0;
+    uint32_t m_count = 0;
+};
+
+//CPU scopes and GPU timestamps per render graph pass.
+//CPU scopes go into a preallocated array, no locks or allocations, so they can stay
+//in release builds. They're meant for the render thread, other threads should use the tracer.
+//GPU timestamps are written into one query pool per recorded command buffer and read
+//without waiting, once that command buffer's previous submission is known to be done.
+class Profiler
+{
+public:
+    static const uint32_t MAX_CPU_EVENTS_PER_FRAME = 1024;
+    static const uint32_t MAX_GPU_SCOPES = 32;
+
+    //Get singleton profiler instance
+    static Profiler* GetInstance();
+    static void CleanupInstance();
+
+    //Scopes cost a single branch while disabled
+    static void SetEnabled(bool enabled) { m_enabled = enabled; }
+    static bool IsEnabled() { return m_enabled; }
+
+    //Raw clock ticks, the TSC where there is one since it's a fraction of the cost of
+    //steady_clock. Only ever compared or converted with ToNanoseconds.
+    static int64_t Now()
+    {
+#ifdef PROFILER_HAS_TSC
+        return static_cast<int64_t>(__rdtsc());
+#else
+        return SteadyNanoseconds();
+#endif
+    }
+
+    static int64_t SteadyNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //The tick rate isn't known up front, it's worked out from how far both clocks have moved
+    void Calibrate();
+    //Ticks from Now() to steady_clock nanoseconds
+    int64_t ToNanoseconds(int64_t ticks) const
+    {
+        return m_calibrationNs + static_cast<int64_t>((ticks - m_calibrationTicks) * m_nsPerTick);
+    }
+
+    void RecordCpu(const char* name, int64_t start, int64_t end)
+    {
+        if (m_cpuEventCount < MAX_CPU_EVENTS_PER_FRAME)
+        {
+            m_cpuEvents[m_cpuEventCount++] = { name, start, end };
+        }
+    }
+
+    //Folds this frame's CPU scopes into the stats, call once per frame
+    void EndFrame();
+    uint64_t GetFrameIndex() const { return m_frameIndex; }
+
+    //GPU side, slotCount is the number of command buffers that get recorded
+    void InitGpu(VkDevice device, const DeviceCaps& caps, uint32_t queueFamily, uint32_t slotCount);
+    void DestroyGpu();
+    bool HasGpuTimestamps() const { return !m_gpuSlots.empty(); }
+
+    //Has to be recorded outside a render pass before any scope
+    void BeginGpuFrame(VkCommandBuffer cmd, uint32_t slot);
+    void BeginGpuScope(VkCommandBuffer cmd, uint32_t slot, const std::string& name);
+    void EndGpuScope(VkCommandBuffer cmd, uint32_t slot);
+    //Call right after the command buffer for slot is submitted
+    void OnSubmit(uint32_t slot);
+    //Picks up the slot's last results if they're there, never waits
+    void CollectGpu(uint32_t slot);
+
+    //min/avg/p99 of every CPU and GPU scope
+    void PrintReport(std::ostream& out) const;
+
+    //Keeps every event from now on for a Chrome trace (chrome://tracing, Perfetto)
+    void StartCapture();
+    bool IsCapturing() const { return m_capturing; }
+    //Stops capturing and writes what was captured
+    bool WriteChromeTrace(const std::string& path);
+
+private:
+    struct CpuEvent
+    {
+        const char* m_name;
+        int64_t m_start;
+        int64_t m_end;
+    };
+
+    struct CapturedEvent
+    {
+        std::string m_name;
+        bool m_gpu;
+        int64_t m_start;
+        int64_t m_end;
+    };
+
+    struct GpuSlot
+    {
+        VkQueryPool m_queryPool = VK_NULL_HANDLE;
+        //Scope names in query order, scope i owns queries 2i and 2i+1
+        std::vector<std::string> m_scopes;
+        std::vector<uint32_t> m_openScopes;
+        bool m_submitted = false;
+        //CPU time of the submit in nanoseconds, anchors the GPU events in a capture
+        int64_t m_submitTime = 0;
+    };
+
+    Profiler();
+    Profiler(Profiler&) = delete;
+
+    void AddCaptured(const std::string& name, bool gpu, int64_t start, int64_t end);
+
+    static Profiler* m_singletonInst;
+    static bool m_enabled;
+
+    std::array<CpuEvent, MAX_CPU_EVENTS_PER_FRAME> m_cpuEvents;
+    uint32_t m_cpuEventCount = 0;
+    uint64_t m_frameIndex = 0;
+
+    int64_t m_calibrationTicks = 0;
+    int64_t m_calibrationNs = 0;
+    double m_nsPerTick = 1.0;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    double m_timestampPeriod = 1.0;
+    uint64_t m_timestampMask = UINT64_MAX;
+    std::vector<GpuSlot> m_gpuSlots;
+
+    std::unordered_map<std::string, RollingStats> m_cpuStats;
+    std::unordered_map<std::string, RollingStats> m_gpuStats;
+
+    bool m_capturing = false;
+    std::vector<CapturedEvent> m_captured;
+};
+
+//Times the enclosing block on the CPU
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) : m_name(name), m_start(Profiler::IsEnabled() ? Profiler::Now() : 0) { }
+
+    ~ProfileScope()
+    {
+        if (m_start != 0)
+        {
+            Profiler::GetInstance()->RecordCpu(m_name, m_start, Profiler::Now());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+//name has to outlive the frame, string literals are what it's meant for
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif // !__PROFILER_H__
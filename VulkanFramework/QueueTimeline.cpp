@@ -0,0 +1,237 @@
+#include "QueueTimeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "VulkanImport.h"
+
+void QueueTimeline::Batch::Wait(VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value)
+{
+    if (m_waitCount == MAX_WAITS)
+    {
+        throw std::runtime_error("too many semaphore waits in one submit!");
+    }
+
+    m_waitSemaphores[m_waitCount] = semaphore;
+    m_waitValues[m_waitCount] = value;
+    m_waitStages[m_waitCount] = stage;
+    m_waitCount++;
+}
+
+void QueueTimeline::Batch::Signal(VkSemaphore semaphore)
+{
+    if (m_signalCount == MAX_SIGNALS)
+    {
+        throw std::runtime_error("too many semaphore signals in one submit!");
+    }
+
+    m_signalSemaphores[m_signalCount++] = semaphore;
+}
+
+void QueueTimeline::Init(VkDevice device, VkQueue queue, bool native)
+{
+    m_device = device;
+    m_queue = queue;
+    m_lastSubmitted = 0;
+    m_completed = 0;
+
+#ifdef VK_KHR_timeline_semaphore
+    m_native = native;
+    if (m_native)
+    {
+        VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timeline semaphore!");
+        }
+    }
+#else
+    m_native = false;
+#endif //VK_KHR_timeline_semaphore
+}
+
+void QueueTimeline::Destroy()
+{
+    if (m_semaphore != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(m_device, m_semaphore, nullptr);
+        m_semaphore = VK_NULL_HANDLE;
+    }
+
+    for (const PendingFence& pending : m_pendingFences)
+    {
+        vkDestroyFence(m_device, pending.m_fence, nullptr);
+    }
+    m_pendingFences.clear();
+
+    for (VkFence fence : m_freeFences)
+    {
+        vkDestroyFence(m_device, fence, nullptr);
+    }
+    m_freeFences.clear();
+}
+
+VkFence QueueTimeline::GetFence()
+{
+    RetireFences();
+
+    if (!m_freeFences.empty())
+    {
+        VkFence fence = m_freeFences.back();
+        m_freeFences.pop_back();
+        return fence;
+    }
+
+    //Only grows to the number of submits in flight
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    if (vkCreateFence(m_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create timeline fence!");
+    }
+
+    return fence;
+}
+
+uint64_t QueueTimeline::Submit(const Batch& batch)
+{
+    uint64_t value = m_lastSubmitted + 1;
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = batch.m_waitCount;
+    submitInfo.pWaitSemaphores = batch.m_waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = batch.m_waitStages.data();
+    submitInfo.commandBufferCount = batch.m_commandBufferCount;
+    submitInfo.pCommandBuffers = batch.m_commandBuffers;
+
+    std::array<VkSemaphore, MAX_SIGNALS + 1> signalSemaphores = {};
+    std::copy(batch.m_signalSemaphores.begin(), batch.m_signalSemaphores.begin() + batch.m_signalCount, signalSemaphores.begin());
+    uint32_t signalCount = batch.m_signalCount;
+
+    VkFence fence = VK_NULL_HANDLE;
+
+#ifdef VK_KHR_timeline_semaphore
+    //Values line up with the semaphore arrays, binary semaphores ignore theirs
+    std::array<uint64_t, MAX_SIGNALS + 1> signalValues = {};
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+    if (m_native)
+    {
+        signalSemaphores[signalCount] = m_semaphore;
+        signalValues[signalCount] = value;
+        signalCount++;
+
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timelineInfo.waitSemaphoreValueCount = batch.m_waitCount;
+        timelineInfo.pWaitSemaphoreValues = batch.m_waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = signalCount;
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+        submitInfo.pNext = &timelineInfo;
+    }
+#endif //VK_KHR_timeline_semaphore
+
+    if (!m_native)
+    {
+        fence = GetFence();
+    }
+
+    submitInfo.signalSemaphoreCount = signalCount;
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    if (vkQueueSubmit(m_queue, 1, &submitInfo, fence) != VK_SUCCESS)
+    {
+        if (fence != VK_NULL_HANDLE)
+        {
+            m_freeFences.push_back(fence);
+        }
+        throw std::runtime_error("failed to submit to queue!");
+    }
+
+    if (fence != VK_NULL_HANDLE)
+    {
+        m_pendingFences.push_back({ value, fence });
+    }
+
+    m_lastSubmitted = value;
+
+    return value;
+}
+
+void QueueTimeline::RetireFences()
+{
+    while (!m_pendingFences.empty() && vkGetFenceStatus(m_device, m_pendingFences.front().m_fence) == VK_SUCCESS)
+    {
+        PendingFence pending = m_pendingFences.front();
+        m_pendingFences.pop_front();
+
+        vkResetFences(m_device, 1, &pending.m_fence);
+        m_freeFences.push_back(pending.m_fence);
+        m_completed = pending.m_value;
+    }
+}
+
+uint64_t QueueTimeline::GetCompletedValue()
+{
+#ifdef VK_KHR_timeline_semaphore
+    if (m_native)
+    {
+        uint64_t value = 0;
+        if (VulkanImport::GetSemaphoreCounterValueKHR(m_device, m_semaphore, &value) == VK_SUCCESS)
+        {
+            m_completed = value;
+        }
+        return m_completed;
+    }
+#endif //VK_KHR_timeline_semaphore
+
+    RetireFences();
+
+    return m_completed;
+}
+
+void QueueTimeline::Wait(uint64_t value)
+{
+    if (value <= m_completed)
+    {
+        return;
+    }
+    if (value > m_lastSubmitted)
+    {
+        throw std::runtime_error("waiting on a timeline value that was never submitted!");
+    }
+
+#ifdef VK_KHR_timeline_semaphore
+    if (m_native)
+    {
+        VkSemaphoreWaitInfoKHR waitInfo = {};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_semaphore;
+        waitInfo.pValues = &value;
+
+        if (VulkanImport::WaitSemaphoresKHR(m_device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to wait on timeline semaphore!");
+        }
+        m_completed = value;
+        return;
+    }
+#endif //VK_KHR_timeline_semaphore
+
+    //Fences aren't guaranteed to signal in submission order, so every one up to value is waited on
+    while (!m_pendingFences.empty() && m_pendingFences.front().m_value <= value)
+    {
+        vkWaitForFences(m_device, 1, &m_pendingFences.front().m_fence, VK_TRUE, UINT64_MAX);
+        RetireFences();
+    }
+}
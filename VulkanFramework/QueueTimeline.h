@@ -0,0 +1,98 @@
+#ifndef __QUEUE_TIMELINE_H__
+#define __QUEUE_TIMELINE_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+//Something a submit can wait on: a timeline semaphore reaching m_value, or a binary
+//semaphore when m_value is 0
+struct SyncPoint
+{
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    uint64_t m_value = 0;
+};
+
+//One monotonically increasing counter per queue, every submit through it signals the next
+//value. Anything retired by a submit (a frame's resources, a readback slot, something
+//waiting to be destroyed) just remembers that value and checks it against GetCompletedValue,
+//no fence per use.
+//With VK_KHR_timeline_semaphore the counter is a timeline semaphore, which other queues
+//can wait on too. Without it each submit gets a pooled fence and the completed value
+//comes from polling them in order; the CPU side works the same, cross-queue waits
+//have to fall back to binary semaphores.
+class QueueTimeline
+{
+public:
+    static const uint32_t MAX_WAITS = 4;
+    static const uint32_t MAX_SIGNALS = 4;
+
+    //What one submit waits on, runs and signals on top of the timeline value
+    struct Batch
+    {
+        //value 0 is a binary semaphore
+        void Wait(VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value = 0);
+        void Wait(const SyncPoint& point, VkPipelineStageFlags stage) { Wait(point.m_semaphore, stage, point.m_value); }
+        //Binary semaphores only, e.g. for present
+        void Signal(VkSemaphore semaphore);
+
+        const VkCommandBuffer* m_commandBuffers = nullptr;
+        uint32_t m_commandBufferCount = 0;
+
+        std::array<VkSemaphore, MAX_WAITS> m_waitSemaphores = {};
+        std::array<uint64_t, MAX_WAITS> m_waitValues = {};
+        std::array<VkPipelineStageFlags, MAX_WAITS> m_waitStages = {};
+        uint32_t m_waitCount = 0;
+        std::array<VkSemaphore, MAX_SIGNALS> m_signalSemaphores = {};
+        uint32_t m_signalCount = 0;
+    };
+
+    //native picks the timeline semaphore, the extension has to be enabled and loaded
+    void Init(VkDevice device, VkQueue queue, bool native);
+    void Destroy();
+
+    bool IsNative() const { return m_native; }
+    VkQueue GetQueue() const { return m_queue; }
+
+    //Submits the batch and returns the value it signals when it's done
+    uint64_t Submit(const Batch& batch);
+
+    //Where other queues wait for value, native only
+    SyncPoint GetSyncPoint(uint64_t value) const { return { m_semaphore, value }; }
+
+    uint64_t GetLastSubmitted() const { return m_lastSubmitted; }
+    //Highest value the GPU is done with, never blocks
+    uint64_t GetCompletedValue();
+    bool IsComplete(uint64_t value) { return value <= m_completed || value <= GetCompletedValue(); }
+    //Blocks until value is done, anything not submitted yet is an error
+    void Wait(uint64_t value);
+
+private:
+    struct PendingFence
+    {
+        uint64_t m_value;
+        VkFence m_fence;
+    };
+
+    VkFence GetFence();
+    //Fallback only, retires every fence up to the first unfinished one
+    void RetireFences();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    bool m_native = false;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+
+    uint64_t m_lastSubmitted = 0;
+    uint64_t m_completed = 0;
+
+    //Fallback, in submission order
+    std::deque<PendingFence> m_pendingFences;
+    std::vector<VkFence> m_freeFences;
+};
+
+#endif // !__QUEUE_TIMELINE_H__
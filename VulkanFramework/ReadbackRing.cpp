@@ -0,0 +1,179 @@
+#include "ReadbackRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Util.h"
+
+void ReadbackRing::Init(VkDevice device, const VkPhysicalDeviceMemoryProperties& memProperties, uint32_t slotCount, VkDeviceSize slotSize, QueueTimeline* timeline)
+{
+    m_device = device;
+    m_timeline = timeline;
+    m_slotSize = slotSize;
+    m_slots.resize(slotCount);
+    m_oldest = 0;
+
+    for (Slot& slot : m_slots)
+    {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = slotSize;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &slot.m_buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create readback buffer!");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(m_device, slot.m_buffer, &requirements);
+
+        //The CPU reads every byte, so cached memory is worth a lot more than coherent memory here
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        try
+        {
+            allocInfo.memoryTypeIndex = Util::FindMemoryType(memProperties, requirements.memoryTypeBits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        }
+        catch (const std::runtime_error&)
+        {
+            allocInfo.memoryTypeIndex = Util::FindMemoryType(memProperties, requirements.memoryTypeBits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+        m_coherent = (memProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &slot.m_memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate readback memory!");
+        }
+
+        vkBindBufferMemory(m_device, slot.m_buffer, slot.m_memory, 0);
+
+        //Stays mapped for the lifetime of the ring
+        if (vkMapMemory(m_device, slot.m_memory, 0, VK_WHOLE_SIZE, 0, &slot.m_mapped) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map readback memory!");
+        }
+    }
+}
+
+void ReadbackRing::Destroy()
+{
+    for (Slot& slot : m_slots)
+    {
+        vkUnmapMemory(m_device, slot.m_memory);
+        vkDestroyBuffer(m_device, slot.m_buffer, nullptr);
+        vkFreeMemory(m_device, slot.m_memory, nullptr);
+    }
+
+    m_slots.clear();
+}
+
+void ReadbackRing::RecordCopy(VkCommandBuffer cmd, uint32_t slot, VkImage image, VkImageAspectFlags aspect, VkExtent2D extent) const
+{
+    //Tightly packed, row length and height of 0 mean the image extent
+    VkBufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = aspect;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { extent.width, extent.height, 1 };
+
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_slots[slot].m_buffer, 1, &region);
+
+    RecordHostBarrier(cmd, slot);
+}
+
+void ReadbackRing::RecordCopy(VkCommandBuffer cmd, uint32_t slot, VkBuffer buffer, VkDeviceSize size) const
+{
+    VkBufferCopy region = {};
+    region.srcOffset = 0;
+    region.dstOffset = 0;
+    region.size = std::min(size, m_slotSize);
+
+    vkCmdCopyBuffer(cmd, buffer, m_slots[slot].m_buffer, 1, &region);
+
+    RecordHostBarrier(cmd, slot);
+}
+
+void ReadbackRing::RecordHostBarrier(VkCommandBuffer cmd, uint32_t slot) const
+{
+    //The submit finishing alone doesn't make device writes visible to the host
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = m_slots[slot].m_buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void ReadbackRing::Deliver(Slot& slot, const ReadbackFunc& onReady)
+{
+    if (!m_coherent)
+    {
+        VkMappedMemoryRange range = {};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = slot.m_memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+    }
+
+    slot.m_pending = false;
+    if (onReady)
+    {
+        onReady(slot.m_frame, slot.m_mapped, m_slotSize);
+    }
+}
+
+void ReadbackRing::Acquire(uint32_t slot, const ReadbackFunc& onReady)
+{
+    //Everything submitted before this slot finishes first anyway, hand it over in order
+    while (m_slots[slot].m_pending)
+    {
+        Slot& oldest = m_slots[m_oldest];
+        m_timeline->Wait(oldest.m_value);
+        Deliver(oldest, onReady);
+        m_oldest = (m_oldest + 1) % GetSlotCount();
+    }
+}
+
+void ReadbackRing::Submitted(uint32_t slot, uint64_t frame, uint64_t value)
+{
+    m_slots[slot].m_pending = true;
+    m_slots[slot].m_frame = frame;
+    m_slots[slot].m_value = value;
+}
+
+void ReadbackRing::Poll(const ReadbackFunc& onReady)
+{
+    //Pending slots are always a run starting at the oldest one
+    while (m_slots[m_oldest].m_pending && m_timeline->IsComplete(m_slots[m_oldest].m_value))
+    {
+        Deliver(m_slots[m_oldest], onReady);
+        m_oldest = (m_oldest + 1) % GetSlotCount();
+    }
+}
+
+void ReadbackRing::Flush(const ReadbackFunc& onReady)
+{
+    while (!m_slots.empty() && m_slots[m_oldest].m_pending)
+    {
+        m_timeline->Wait(m_slots[m_oldest].m_value);
+        Deliver(m_slots[m_oldest], onReady);
+        m_oldest = (m_oldest + 1) % GetSlotCount();
+    }
+}
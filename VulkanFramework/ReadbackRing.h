@@ -0,0 +1,67 @@
+#ifndef __READBACK_RING_H__
+#define __READBACK_RING_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "QueueTimeline.h"
+
+//Ring of persistently mapped, host visible buffers that rendered images get copied into.
+//Every slot remembers the timeline value of its submit, so a slot's contents are picked up when
+//the ring comes back around to it (or when polled) instead of stalling the queue right after the submit.
+//Slots have to be used round robin, that's what keeps results in submission order.
+class ReadbackRing
+{
+public:
+    //frame is the value the slot was submitted with, data is only valid during the call
+    using ReadbackFunc = std::function<void(uint64_t frame, const void* data, VkDeviceSize size)>;
+
+    //timeline is the one the copies are submitted on
+    void Init(VkDevice device, const VkPhysicalDeviceMemoryProperties& memProperties, uint32_t slotCount, VkDeviceSize slotSize, QueueTimeline* timeline);
+    void Destroy();
+
+    //Records copying image (already in TRANSFER_SRC_OPTIMAL) into the slot, made visible to the host
+    void RecordCopy(VkCommandBuffer cmd, uint32_t slot, VkImage image, VkImageAspectFlags aspect, VkExtent2D extent) const;
+    //Same for the first size bytes of a buffer, its writes have to be visible to transfers already
+    void RecordCopy(VkCommandBuffer cmd, uint32_t slot, VkBuffer buffer, VkDeviceSize size) const;
+
+    //Waits for the slot's last submission and hands its contents to onReady
+    void Acquire(uint32_t slot, const ReadbackFunc& onReady);
+    //Marks the slot as in flight until the timeline reaches value
+    void Submitted(uint32_t slot, uint64_t frame, uint64_t value);
+
+    //Hands over every slot that has already finished, never blocks
+    void Poll(const ReadbackFunc& onReady);
+    //Waits for and hands over everything still in flight
+    void Flush(const ReadbackFunc& onReady);
+
+    uint32_t GetSlotCount() const { return static_cast<uint32_t>(m_slots.size()); }
+
+private:
+    struct Slot
+    {
+        VkBuffer m_buffer = VK_NULL_HANDLE;
+        VkDeviceMemory m_memory = VK_NULL_HANDLE;
+        void* m_mapped = nullptr;
+        uint64_t m_value = 0;
+        bool m_pending = false;
+        uint64_t m_frame = 0;
+    };
+
+    void RecordHostBarrier(VkCommandBuffer cmd, uint32_t slot) const;
+    void Deliver(Slot& slot, const ReadbackFunc& onReady);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    QueueTimeline* m_timeline = nullptr;
+    VkDeviceSize m_slotSize = 0;
+    bool m_coherent = true;
+    std::vector<Slot> m_slots;
+    //Oldest slot still pending, if any
+    uint32_t m_oldest = 0;
+};
+
+#endif // !__READBACK_RING_H__
@@ -0,0 +1,901 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+
+#include "Util.h"
+
+namespace
+{
+    //Layout, pipeline stages and access a usage implies
+    struct UsageState
+    {
+        VkImageLayout m_layout;
+        VkPipelineStageFlags m_stage;
+        VkAccessFlags m_access;
+        VkImageUsageFlags m_imageUsage;
+    };
+
+    const VkAccessFlags WRITE_ACCESS_MASK =
+        VK_ACCESS_SHADER_WRITE_BIT |
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_TRANSFER_WRITE_BIT |
+        VK_ACCESS_HOST_WRITE_BIT |
+        VK_ACCESS_MEMORY_WRITE_BIT;
+
+    UsageState GetUsageState(RenderResourceUsage usage, bool write)
+    {
+        switch (usage)
+        {
+        case RenderResourceUsage::ColorAttachment:
+            return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | (write ? static_cast<VkAccessFlags>(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) : 0u),
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+        case RenderResourceUsage::DepthAttachment:
+            return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? static_cast<VkAccessFlags>(VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT) : 0u),
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+        case RenderResourceUsage::DepthRead:
+            return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+        case RenderResourceUsage::ShaderRead:
+            return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_USAGE_SAMPLED_BIT };
+        case RenderResourceUsage::TransferSrc:
+            return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT,
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+        case RenderResourceUsage::TransferDst:
+            return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+        }
+
+        throw std::runtime_error("Unknown render resource usage!");
+    }
+}
+
+void RenderGraph::Reset()
+{
+    m_passes.clear();
+    m_resources.clear();
+}
+
+RenderResourceHandle RenderGraph::CreateTransient(const RenderResourceDesc& desc)
+{
+    ResourceNode node;
+    node.m_desc = desc;
+    m_resources.push_back(node);
+
+    return static_cast<RenderResourceHandle>(m_resources.size() - 1);
+}
+
+RenderResourceHandle RenderGraph::Import(const RenderResourceDesc& desc, VkImage image, VkImageView view)
+{
+    ResourceNode node;
+    node.m_desc = desc;
+    node.m_imported = true;
+    node.m_image = image;
+    node.m_view = view;
+    m_resources.push_back(node);
+
+    return static_cast<RenderResourceHandle>(m_resources.size() - 1);
+}
+
+void RenderGraph::MarkOutput(RenderResourceHandle resource)
+{
+    m_resources.at(resource).m_output = true;
+}
+
+void RenderGraph::MarkSideEffect(uint32_t pass)
+{
+    m_passes.at(pass).m_sideEffect = true;
+}
+
+uint32_t RenderGraph::AddPass(const std::string& name, ExecuteFunc execute)
+{
+    PassNode node;
+    node.m_name = name;
+    node.m_execute = std::move(execute);
+    m_passes.push_back(std::move(node));
+
+    return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void RenderGraph::Read(uint32_t pass, RenderResourceHandle resource, RenderResourceUsage usage)
+{
+    m_passes.at(pass).m_accesses.push_back({ resource, usage, false });
+}
+
+void RenderGraph::Write(uint32_t pass, RenderResourceHandle resource, RenderResourceUsage usage)
+{
+    if (usage == RenderResourceUsage::DepthRead || usage == RenderResourceUsage::ShaderRead || usage == RenderResourceUsage::TransferSrc)
+    {
+        throw std::runtime_error("Render graph write declared with a read-only usage!");
+    }
+
+    m_passes.at(pass).m_accesses.push_back({ resource, usage, true });
+}
+
+bool RenderGraph::Compile()
+{
+    //Same structure as last time, the barriers and ordering still hold. The hash only rules
+    //graphs out, a match is checked against what was compiled before it's trusted.
+    size_t hash = HashStructure();
+    if (m_hasCompiled && hash == m_compiledHash && IsCompiledStructure())
+    {
+        return false;
+    }
+
+    m_compiled = CompiledRenderGraph();
+    m_compiled.m_passCulled.assign(m_passes.size(), false);
+    m_compiled.m_firstUse.assign(m_resources.size(), UINT32_MAX);
+    m_compiled.m_lastUse.assign(m_resources.size(), UINT32_MAX);
+    m_compiled.m_imageUsage.assign(m_resources.size(), 0);
+    m_compiled.m_aliasSlot.assign(m_resources.size(), UINT32_MAX);
+
+    CullPasses();
+
+    std::vector<uint32_t> order;
+    SortPasses(order);
+
+    //Lifetimes are positions in the sorted order, aliasing needs them before barriers
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        for (const auto& access : m_passes[order[i]].m_accesses)
+        {
+            uint32_t& first = m_compiled.m_firstUse[access.m_resource];
+            first = std::min(first, i);
+            m_compiled.m_lastUse[access.m_resource] = i;
+            m_compiled.m_imageUsage[access.m_resource] |= GetUsageState(access.m_usage, access.m_write).m_imageUsage;
+        }
+    }
+
+    AssignAliasSlots();
+    BuildBarriers(order);
+
+    m_compiledHash = hash;
+    m_hasCompiled = true;
+    m_compileCount++;
+
+    //Only the structure, the callbacks would keep whatever they capture alive
+    m_compiledResources = m_resources;
+    m_compiledPasses.clear();
+    for (const auto& pass : m_passes)
+    {
+        m_compiledPasses.push_back({ pass.m_name, nullptr, pass.m_accesses, pass.m_sideEffect });
+    }
+
+    return true;
+}
+
+size_t RenderGraph::HashStructure() const
+{
+    size_t hash = 0;
+
+    for (const auto& resource : m_resources)
+    {
+        const RenderResourceDesc& desc = resource.m_desc;
+        Util::HashCombine(hash, static_cast<uint32_t>(desc.m_format));
+        Util::HashCombine(hash, desc.m_extent.width);
+        Util::HashCombine(hash, desc.m_extent.height);
+        Util::HashCombine(hash, static_cast<uint32_t>(desc.m_samples));
+        Util::HashCombine(hash, desc.m_aspect);
+        Util::HashCombine(hash, desc.m_transientAttachment);
+        Util::HashCombine(hash, static_cast<uint32_t>(desc.m_initialLayout));
+        Util::HashCombine(hash, desc.m_initialStage);
+        Util::HashCombine(hash, static_cast<uint32_t>(desc.m_finalLayout));
+        Util::HashCombine(hash, resource.m_imported);
+        Util::HashCombine(hash, resource.m_output);
+    }
+
+    for (const auto& pass : m_passes)
+    {
+        Util::HashCombine(hash, pass.m_name);
+        Util::HashCombine(hash, pass.m_sideEffect);
+        for (const auto& access : pass.m_accesses)
+        {
+            Util::HashCombine(hash, access.m_resource);
+            Util::HashCombine(hash, static_cast<uint32_t>(access.m_usage));
+            Util::HashCombine(hash, access.m_write);
+        }
+    }
+
+    return hash;
+}
+
+bool RenderGraph::IsCompiledStructure() const
+{
+    //Exactly what HashStructure covers
+    if (m_resources.size() != m_compiledResources.size() || m_passes.size() != m_compiledPasses.size())
+    {
+        return false;
+    }
+
+    for (size_t r = 0; r < m_resources.size(); r++)
+    {
+        const ResourceNode& resource = m_resources[r];
+        const ResourceNode& compiled = m_compiledResources[r];
+        const RenderResourceDesc& desc = resource.m_desc;
+        const RenderResourceDesc& compiledDesc = compiled.m_desc;
+
+        if (desc.m_format != compiledDesc.m_format ||
+            desc.m_extent.width != compiledDesc.m_extent.width ||
+            desc.m_extent.height != compiledDesc.m_extent.height ||
+            desc.m_samples != compiledDesc.m_samples ||
+            desc.m_aspect != compiledDesc.m_aspect ||
+            desc.m_transientAttachment != compiledDesc.m_transientAttachment ||
+            desc.m_initialLayout != compiledDesc.m_initialLayout ||
+            desc.m_initialStage != compiledDesc.m_initialStage ||
+            desc.m_finalLayout != compiledDesc.m_finalLayout ||
+            resource.m_imported != compiled.m_imported ||
+            resource.m_output != compiled.m_output)
+        {
+            return false;
+        }
+    }
+
+    for (size_t p = 0; p < m_passes.size(); p++)
+    {
+        const PassNode& pass = m_passes[p];
+        const PassNode& compiled = m_compiledPasses[p];
+        if (pass.m_name != compiled.m_name || pass.m_sideEffect != compiled.m_sideEffect || pass.m_accesses.size() != compiled.m_accesses.size())
+        {
+            return false;
+        }
+
+        for (size_t a = 0; a < pass.m_accesses.size(); a++)
+        {
+            const Access& access = pass.m_accesses[a];
+            const Access& compiledAccess = compiled.m_accesses[a];
+            if (access.m_resource != compiledAccess.m_resource || access.m_usage != compiledAccess.m_usage || access.m_write != compiledAccess.m_write)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void RenderGraph::CullPasses()
+{
+    std::vector<bool> resourceNeeded(m_resources.size(), false);
+    std::vector<bool> passNeeded(m_passes.size(), false);
+
+    for (size_t i = 0; i < m_resources.size(); i++)
+    {
+        resourceNeeded[i] = m_resources[i].m_output;
+    }
+
+    //Side effect passes are roots as well, along with everything they touch
+    for (size_t p = 0; p < m_passes.size(); p++)
+    {
+        if (m_passes[p].m_sideEffect)
+        {
+            passNeeded[p] = true;
+            for (const auto& access : m_passes[p].m_accesses)
+            {
+                resourceNeeded[access.m_resource] = true;
+            }
+        }
+    }
+
+    //Walk back from the outputs, a pass is needed if it writes something that's needed
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        for (size_t p = 0; p < m_passes.size(); p++)
+        {
+            if (passNeeded[p])
+            {
+                continue;
+            }
+
+            for (const auto& access : m_passes[p].m_accesses)
+            {
+                if (access.m_write && resourceNeeded[access.m_resource])
+                {
+                    passNeeded[p] = true;
+                    break;
+                }
+            }
+
+            if (passNeeded[p])
+            {
+                changed = true;
+                for (const auto& access : m_passes[p].m_accesses)
+                {
+                    resourceNeeded[access.m_resource] = true;
+                }
+            }
+        }
+    }
+
+    for (size_t p = 0; p < m_passes.size(); p++)
+    {
+        m_compiled.m_passCulled[p] = !passNeeded[p];
+    }
+}
+
+void RenderGraph::SortPasses(std::vector<uint32_t>& order) const
+{
+    //Writers of a resource run in declaration order, anything that only reads
+    //it waits for the last writer. Consumers can be declared before producers.
+    std::vector<std::vector<uint32_t>> edges(m_passes.size());
+    std::vector<uint32_t> inDegree(m_passes.size(), 0);
+
+    for (RenderResourceHandle r = 0; r < m_resources.size(); r++)
+    {
+        std::vector<uint32_t> writers;
+        std::vector<uint32_t> readers;
+
+        for (uint32_t p = 0; p < m_passes.size(); p++)
+        {
+            if (m_compiled.m_passCulled[p])
+            {
+                continue;
+            }
+
+            bool reads = false;
+            bool writes = false;
+            for (const auto& access : m_passes[p].m_accesses)
+            {
+                if (access.m_resource == r)
+                {
+                    writes |= access.m_write;
+                    reads |= !access.m_write;
+                }
+            }
+
+            if (writes)
+            {
+                writers.push_back(p);
+            }
+            else if (reads)
+            {
+                readers.push_back(p);
+            }
+        }
+
+        for (size_t i = 1; i < writers.size(); i++)
+        {
+            edges[writers[i - 1]].push_back(writers[i]);
+            inDegree[writers[i]]++;
+        }
+
+        if (!writers.empty())
+        {
+            for (uint32_t reader : readers)
+            {
+                edges[writers.back()].push_back(reader);
+                inDegree[reader]++;
+            }
+        }
+    }
+
+    //Kahn's algorithm, ties broken by declaration order so the result is deterministic
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+    size_t aliveCount = 0;
+    for (uint32_t p = 0; p < m_passes.size(); p++)
+    {
+        if (!m_compiled.m_passCulled[p])
+        {
+            aliveCount++;
+            if (inDegree[p] == 0)
+            {
+                ready.push(p);
+            }
+        }
+    }
+
+    while (!ready.empty())
+    {
+        uint32_t pass = ready.top();
+        ready.pop();
+        order.push_back(pass);
+
+        for (uint32_t next : edges[pass])
+        {
+            if (--inDegree[next] == 0)
+            {
+                ready.push(next);
+            }
+        }
+    }
+
+    if (order.size() != aliveCount)
+    {
+        throw std::runtime_error("Render graph has a dependency cycle!");
+    }
+}
+
+void RenderGraph::AssignAliasSlots()
+{
+    std::vector<RenderResourceHandle> transients;
+    for (RenderResourceHandle r = 0; r < m_resources.size(); r++)
+    {
+        if (!m_resources[r].m_imported && m_compiled.m_firstUse[r] != UINT32_MAX)
+        {
+            transients.push_back(r);
+        }
+    }
+
+    std::sort(transients.begin(), transients.end(), [this](RenderResourceHandle a, RenderResourceHandle b)
+    {
+        return m_compiled.m_firstUse[a] < m_compiled.m_firstUse[b];
+    });
+
+    //First fit: reuse the first slot whose occupant is already dead.
+    //Lazily allocated memory only ever aliases with other lazily allocated memory.
+    std::vector<uint32_t> slotEnd;
+    std::vector<bool> slotLazy;
+    for (RenderResourceHandle r : transients)
+    {
+        bool lazy = m_resources[r].m_desc.m_transientAttachment;
+        uint32_t slot = UINT32_MAX;
+        for (uint32_t s = 0; s < slotEnd.size(); s++)
+        {
+            if (slotEnd[s] < m_compiled.m_firstUse[r] && slotLazy[s] == lazy)
+            {
+                slot = s;
+                break;
+            }
+        }
+
+        if (slot == UINT32_MAX)
+        {
+            slot = static_cast<uint32_t>(slotEnd.size());
+            slotEnd.push_back(0);
+            slotLazy.push_back(lazy);
+        }
+
+        slotEnd[slot] = m_compiled.m_lastUse[r];
+        m_compiled.m_aliasSlot[r] = slot;
+    }
+
+    m_compiled.m_aliasSlotCount = static_cast<uint32_t>(slotEnd.size());
+}
+
+void RenderGraph::BuildBarriers(const std::vector<uint32_t>& order)
+{
+    struct ResourceState
+    {
+        VkImageLayout m_layout;
+        VkPipelineStageFlags m_stage;
+        VkAccessFlags m_access;
+    };
+
+    //Transients aren't per frame, every frame (and every command buffer recorded from the
+    //graph) uses the same images. Their first use in a frame has to wait for the last use
+    //of that memory in the frame before, so the passes are walked twice: the first walk
+    //only finds the state each alias slot is left in, the second starts from it.
+    std::vector<ResourceState> states(m_resources.size());
+    //Last state of whoever occupied an alias slot, the next occupant has to wait on it
+    std::vector<ResourceState> slotStates(m_compiled.m_aliasSlotCount, { VK_IMAGE_LAYOUT_UNDEFINED, 0, 0 });
+
+    for (uint32_t walk = 0; walk < 2; walk++)
+    {
+        bool record = walk == 1;
+
+        for (size_t r = 0; r < m_resources.size(); r++)
+        {
+            if (m_resources[r].m_imported)
+            {
+                states[r] = { m_resources[r].m_desc.m_initialLayout, m_resources[r].m_desc.m_initialStage, 0 };
+            }
+            else
+            {
+                states[r] = { VK_IMAGE_LAYOUT_UNDEFINED, 0, 0 };
+            }
+        }
+
+        for (uint32_t position = 0; position < order.size(); position++)
+        {
+            CompiledRenderGraph::Pass compiledPass;
+            compiledPass.m_passIndex = order[position];
+
+            //Merge every access the pass makes to the same resource
+            std::vector<std::pair<RenderResourceHandle, UsageState>> merged;
+            for (const auto& access : m_passes[order[position]].m_accesses)
+            {
+                UsageState usage = GetUsageState(access.m_usage, access.m_write);
+
+                auto it = std::find_if(merged.begin(), merged.end(), [&access](const std::pair<RenderResourceHandle, UsageState>& entry)
+                {
+                    return entry.first == access.m_resource;
+                });
+
+                if (it == merged.end())
+                {
+                    merged.push_back({ access.m_resource, usage });
+                }
+                else if (it->second.m_layout != usage.m_layout)
+                {
+                    throw std::runtime_error("Render pass " + m_passes[order[position]].m_name + " uses a resource in two layouts!");
+                }
+                else
+                {
+                    it->second.m_stage |= usage.m_stage;
+                    it->second.m_access |= usage.m_access;
+                }
+            }
+
+            for (const auto& entry : merged)
+            {
+                RenderResourceHandle resource = entry.first;
+                const UsageState& usage = entry.second;
+                ResourceState& state = states[resource];
+                uint32_t slot = m_compiled.m_aliasSlot[resource];
+
+                //First touch of an aliased transient has to wait for the previous occupant of the memory,
+                //on the second walk that includes the last occupant of the previous frame
+                if (slot != UINT32_MAX && m_compiled.m_firstUse[resource] == position)
+                {
+                    state.m_stage = slotStates[slot].m_stage;
+                    state.m_access = slotStates[slot].m_access;
+                }
+
+                bool layoutChange = state.m_layout != usage.m_layout;
+                bool afterWrite = (state.m_access & WRITE_ACCESS_MASK) != 0;
+                bool writeAfterRead = (usage.m_access & WRITE_ACCESS_MASK) != 0 && state.m_stage != 0;
+
+                if (layoutChange || afterWrite || writeAfterRead)
+                {
+                    RenderGraphBarrier barrier;
+                    barrier.m_resource = resource;
+                    barrier.m_oldLayout = state.m_layout;
+                    barrier.m_newLayout = usage.m_layout;
+                    barrier.m_srcStage = state.m_stage != 0 ? state.m_stage : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+                    //Only writes need to be made available, reads just need the execution dependency
+                    barrier.m_srcAccess = state.m_access & WRITE_ACCESS_MASK;
+                    barrier.m_dstStage = usage.m_stage;
+                    barrier.m_dstAccess = usage.m_access;
+                    compiledPass.m_barriers.push_back(barrier);
+
+                    state = { usage.m_layout, usage.m_stage, usage.m_access };
+                }
+                else
+                {
+                    //Read after read in the same layout, just widen the scope
+                    state.m_stage |= usage.m_stage;
+                    state.m_access |= usage.m_access;
+                }
+
+                if (slot != UINT32_MAX)
+                {
+                    slotStates[slot] = state;
+                }
+            }
+
+            if (record)
+            {
+                m_compiled.m_passes.push_back(std::move(compiledPass));
+            }
+        }
+    }
+
+    //Leave imported images the way the outside world expects them
+    for (RenderResourceHandle r = 0; r < m_resources.size(); r++)
+    {
+        const RenderResourceDesc& desc = m_resources[r].m_desc;
+        if (!m_resources[r].m_imported || desc.m_finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || desc.m_finalLayout == states[r].m_layout)
+        {
+            continue;
+        }
+
+        RenderGraphBarrier barrier;
+        barrier.m_resource = r;
+        barrier.m_oldLayout = states[r].m_layout;
+        barrier.m_newLayout = desc.m_finalLayout;
+        barrier.m_srcStage = states[r].m_stage != 0 ? states[r].m_stage : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        barrier.m_srcAccess = states[r].m_access & WRITE_ACCESS_MASK;
+        barrier.m_dstStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        barrier.m_dstAccess = 0;
+        m_compiled.m_finalBarriers.push_back(barrier);
+    }
+}
+
+uint32_t RenderGraph::FindTransientMemoryType(const VkPhysicalDeviceMemoryProperties& memProperties, uint32_t typeBits, bool lazy)
+{
+    //Tilers can keep lazily allocated attachments on chip and never back them with real memory
+    if (lazy)
+    {
+        const VkMemoryPropertyFlags lazyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        {
+            if ((typeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & lazyFlags) == lazyFlags)
+            {
+                return i;
+            }
+        }
+    }
+
+    return Util::FindMemoryType(memProperties, typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void RenderGraph::AllocateTransients(VkDevice device, const VkPhysicalDeviceMemoryProperties& memProperties, DeletionQueue* deletionQueue)
+{
+    if (!m_hasCompiled)
+    {
+        throw std::runtime_error("Render graph has to be compiled before allocating transients!");
+    }
+
+    //Still backed by the images we made for this structure
+    if (m_allocatedCompile == m_compileCount && !m_transientImages.empty())
+    {
+        return;
+    }
+
+    ReleaseTransients(device, deletionQueue);
+    m_transientImages.resize(m_resources.size());
+
+    std::vector<std::vector<RenderResourceHandle>> slots(m_compiled.m_aliasSlotCount);
+    std::vector<VkMemoryRequirements> requirements(m_resources.size());
+
+    for (RenderResourceHandle r = 0; r < m_resources.size(); r++)
+    {
+        if (m_compiled.m_aliasSlot[r] == UINT32_MAX)
+        {
+            continue;
+        }
+
+        const RenderResourceDesc& desc = m_resources[r].m_desc;
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = desc.m_format;
+        imageInfo.extent = { desc.m_extent.width, desc.m_extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = desc.m_samples;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = m_compiled.m_imageUsage[r];
+        if (desc.m_transientAttachment)
+        {
+            imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &m_transientImages[r].m_image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create transient image " + desc.m_name + "!");
+        }
+
+        vkGetImageMemoryRequirements(device, m_transientImages[r].m_image, &requirements[r]);
+        slots[m_compiled.m_aliasSlot[r]].push_back(r);
+    }
+
+    for (const auto& slot : slots)
+    {
+        //Every image in the slot has to be happy with the same memory type
+        VkDeviceSize size = 0;
+        VkDeviceSize alignment = 1;
+        uint32_t typeBits = UINT32_MAX;
+        bool lazy = !slot.empty() && m_resources[slot[0]].m_desc.m_transientAttachment;
+        for (RenderResourceHandle r : slot)
+        {
+            size = std::max(size, requirements[r].size);
+            alignment = std::max(alignment, requirements[r].alignment);
+            typeBits &= requirements[r].memoryTypeBits;
+        }
+
+        //No common type, so the images in this slot get memory of their own
+        bool shared = typeBits != 0;
+        std::vector<std::vector<RenderResourceHandle>> groups;
+        if (shared)
+        {
+            groups.push_back(slot);
+        }
+        else
+        {
+            for (RenderResourceHandle r : slot)
+            {
+                groups.push_back({ r });
+            }
+        }
+
+        for (const auto& group : groups)
+        {
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = shared ? (size + alignment - 1) / alignment * alignment : requirements[group[0]].size;
+            allocInfo.memoryTypeIndex = FindTransientMemoryType(memProperties,
+                shared ? typeBits : requirements[group[0]].memoryTypeBits, lazy);
+
+            VkDeviceMemory memory;
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate transient image memory!");
+            }
+            m_slotMemory.push_back(memory);
+            m_transientBytes += allocInfo.allocationSize;
+
+            for (RenderResourceHandle r : group)
+            {
+                vkBindImageMemory(device, m_transientImages[r].m_image, memory, 0);
+            }
+        }
+    }
+
+    for (RenderResourceHandle r = 0; r < m_resources.size(); r++)
+    {
+        if (m_transientImages[r].m_image == VK_NULL_HANDLE)
+        {
+            continue;
+        }
+
+        const RenderResourceDesc& desc = m_resources[r].m_desc;
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_transientImages[r].m_image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = desc.m_format;
+        viewInfo.subresourceRange.aspectMask = desc.m_aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &m_transientImages[r].m_view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create transient image view " + desc.m_name + "!");
+        }
+    }
+
+    m_allocatedCompile = m_compileCount;
+}
+
+void RenderGraph::ReleaseTransients(VkDevice device, DeletionQueue* deletionQueue)
+{
+    if (deletionQueue != nullptr)
+    {
+        for (auto& transient : m_transientImages)
+        {
+            deletionQueue->DestroyImageView(transient.m_view);
+            deletionQueue->DestroyImage(transient.m_image);
+        }
+
+        for (auto memory : m_slotMemory)
+        {
+            deletionQueue->FreeMemory(memory);
+        }
+    }
+    else
+    {
+        for (auto& transient : m_transientImages)
+        {
+            if (transient.m_view != VK_NULL_HANDLE)
+            {
+                vkDestroyImageView(device, transient.m_view, nullptr);
+            }
+
+            if (transient.m_image != VK_NULL_HANDLE)
+            {
+                vkDestroyImage(device, transient.m_image, nullptr);
+            }
+        }
+
+        for (auto memory : m_slotMemory)
+        {
+            vkFreeMemory(device, memory, nullptr);
+        }
+    }
+
+    m_transientImages.clear();
+    m_slotMemory.clear();
+    m_transientBytes = 0;
+    m_allocatedCompile = 0;
+}
+
+void RenderGraph::BindImage(RenderResourceHandle resource, VkImage image, VkImageView view)
+{
+    ResourceNode& node = m_resources.at(resource);
+    if (!node.m_imported)
+    {
+        throw std::runtime_error("Only imported render graph resources can be rebound!");
+    }
+
+    node.m_image = image;
+    node.m_view = view;
+}
+
+VkImage RenderGraph::GetImage(RenderResourceHandle resource) const
+{
+    if (m_resources.at(resource).m_imported)
+    {
+        return m_resources[resource].m_image;
+    }
+
+    return resource < m_transientImages.size() ? m_transientImages[resource].m_image : VK_NULL_HANDLE;
+}
+
+VkImageView RenderGraph::GetImageView(RenderResourceHandle resource) const
+{
+    if (m_resources.at(resource).m_imported)
+    {
+        return m_resources[resource].m_view;
+    }
+
+    return resource < m_transientImages.size() ? m_transientImages[resource].m_view : VK_NULL_HANDLE;
+}
+
+void RenderGraph::Execute(VkCommandBuffer cmd, const PassHook& beforePass, const PassHook& afterPass)
+{
+    auto recordBarriers = [this, cmd](const std::vector<RenderGraphBarrier>& barriers)
+    {
+        if (barriers.empty())
+        {
+            return;
+        }
+
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        VkPipelineStageFlags srcStage = 0;
+        VkPipelineStageFlags dstStage = 0;
+
+        for (const auto& barrier : barriers)
+        {
+            VkImageMemoryBarrier imageBarrier = {};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = barrier.m_srcAccess;
+            imageBarrier.dstAccessMask = barrier.m_dstAccess;
+            imageBarrier.oldLayout = barrier.m_oldLayout;
+            imageBarrier.newLayout = barrier.m_newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = GetImage(barrier.m_resource);
+            imageBarrier.subresourceRange.aspectMask = m_resources[barrier.m_resource].m_desc.m_aspect;
+            imageBarrier.subresourceRange.baseMipLevel = 0;
+            imageBarrier.subresourceRange.levelCount = 1;
+            imageBarrier.subresourceRange.baseArrayLayer = 0;
+            imageBarrier.subresourceRange.layerCount = 1;
+            imageBarriers.push_back(imageBarrier);
+
+            srcStage |= barrier.m_srcStage;
+            dstStage |= barrier.m_dstStage;
+        }
+
+        vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    };
+
+    for (const auto& pass : m_compiled.m_passes)
+    {
+        const PassNode& node = m_passes[pass.m_passIndex];
+
+        //Barriers count towards the pass that needed them
+        if (beforePass)
+        {
+            beforePass(cmd, node.m_name);
+        }
+
+        recordBarriers(pass.m_barriers);
+
+        if (node.m_execute)
+        {
+            node.m_execute(cmd);
+        }
+
+        if (afterPass)
+        {
+            afterPass(cmd, node.m_name);
+        }
+    }
+
+    recordBarriers(m_compiled.m_finalBarriers);
+}
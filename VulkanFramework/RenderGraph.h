@@ -0,0 +1,187 @@
+#ifndef __RENDER_GRAPH_H__
+#define __RENDER_GRAPH_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "DeletionQueue.h"
+
+using RenderResourceHandle = uint32_t;
+const RenderResourceHandle INVALID_RENDER_RESOURCE = UINT32_MAX;
+
+//How a pass touches a resource, decides the layout, stages and access masks
+enum class RenderResourceUsage
+{
+    ColorAttachment,
+    DepthAttachment,
+    DepthRead,
+    ShaderRead,
+    TransferSrc,
+    TransferDst
+};
+
+struct RenderResourceDesc
+{
+    std::string m_name;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    VkExtent2D m_extent = { 0, 0 };
+    VkSampleCountFlagBits m_samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImageAspectFlags m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    //Contents never leave the render pass (MSAA targets resolved on tile etc).
+    //Gets TRANSIENT usage and lazily allocated memory where the device has it.
+    bool m_transientAttachment = false;
+
+    //Only used for imported resources (swapchain images etc).
+    //The state the image is in when the graph starts, and the layout it has to be left in.
+    VkImageLayout m_initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags m_initialStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkImageLayout m_finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+struct RenderGraphBarrier
+{
+    RenderResourceHandle m_resource = INVALID_RENDER_RESOURCE;
+    VkImageLayout m_oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout m_newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags m_srcStage = 0;
+    VkPipelineStageFlags m_dstStage = 0;
+    VkAccessFlags m_srcAccess = 0;
+    VkAccessFlags m_dstAccess = 0;
+};
+
+//Result of compiling the graph, only depends on the declared structure
+struct CompiledRenderGraph
+{
+    struct Pass
+    {
+        uint32_t m_passIndex = 0;
+        //Barriers that have to be recorded before the pass runs
+        std::vector<RenderGraphBarrier> m_barriers;
+    };
+
+    //Surviving passes in execution order
+    std::vector<Pass> m_passes;
+    //Transitions imported resources into their final layout
+    std::vector<RenderGraphBarrier> m_finalBarriers;
+    std::vector<bool> m_passCulled;
+
+    //Per resource, first and last position in m_passes (UINT32_MAX if unused)
+    std::vector<uint32_t> m_firstUse;
+    std::vector<uint32_t> m_lastUse;
+    //Per resource image usage flags gathered from every access
+    std::vector<VkImageUsageFlags> m_imageUsage;
+    //Transients sharing a slot have disjoint lifetimes and can share memory
+    std::vector<uint32_t> m_aliasSlot;
+    uint32_t m_aliasSlotCount = 0;
+};
+
+//Frame graph: passes declare what they read and write, compiling orders them,
+//culls anything that doesn't contribute to an output and works out the barriers.
+//Compile only touches CPU data so it can be exercised without a device.
+class RenderGraph
+{
+public:
+    using ExecuteFunc = std::function<void(VkCommandBuffer)>;
+    //Wrapped around every pass that runs, e.g. for timestamps or debug labels
+    using PassHook = std::function<void(VkCommandBuffer, const std::string&)>;
+
+    //Clears the declared passes and resources. Compiled data and transient
+    //memory are kept so re-declaring the same graph next frame is free.
+    void Reset();
+
+    RenderResourceHandle CreateTransient(const RenderResourceDesc& desc);
+    RenderResourceHandle Import(const RenderResourceDesc& desc, VkImage image = VK_NULL_HANDLE, VkImageView view = VK_NULL_HANDLE);
+    //Anything that leads to an output survives culling
+    void MarkOutput(RenderResourceHandle resource);
+
+    uint32_t AddPass(const std::string& name, ExecuteFunc execute);
+    void Read(uint32_t pass, RenderResourceHandle resource, RenderResourceUsage usage);
+    void Write(uint32_t pass, RenderResourceHandle resource, RenderResourceUsage usage);
+    //The pass does something outside the graph (readback, queries) and is never culled
+    void MarkSideEffect(uint32_t pass);
+
+    //Returns true if the graph had to be recompiled, false if the cached result was reused
+    bool Compile();
+    const CompiledRenderGraph& GetCompiled() const { return m_compiled; }
+
+    //Creates images for the transients and binds aliased ones to shared memory
+    //With deletionQueue the images being replaced are only destroyed once frames in flight are done with them
+    void AllocateTransients(VkDevice device, const VkPhysicalDeviceMemoryProperties& memProperties, DeletionQueue* deletionQueue = nullptr);
+    void ReleaseTransients(VkDevice device, DeletionQueue* deletionQueue = nullptr);
+    //Memory allocated for the transients, aliased slots counted once
+    VkDeviceSize GetTransientBytes() const { return m_transientBytes; }
+
+    //Swaps the image behind an imported resource, e.g. the acquired swapchain image
+    void BindImage(RenderResourceHandle resource, VkImage image, VkImageView view = VK_NULL_HANDLE);
+    VkImage GetImage(RenderResourceHandle resource) const;
+    VkImageView GetImageView(RenderResourceHandle resource) const;
+
+    //Records barriers and passes into cmd
+    void Execute(VkCommandBuffer cmd, const PassHook& beforePass = nullptr, const PassHook& afterPass = nullptr);
+
+private:
+    struct Access
+    {
+        RenderResourceHandle m_resource;
+        RenderResourceUsage m_usage;
+        bool m_write;
+    };
+
+    struct PassNode
+    {
+        std::string m_name;
+        ExecuteFunc m_execute;
+        std::vector<Access> m_accesses;
+        bool m_sideEffect = false;
+    };
+
+    struct ResourceNode
+    {
+        RenderResourceDesc m_desc;
+        bool m_imported = false;
+        bool m_output = false;
+        VkImage m_image = VK_NULL_HANDLE;
+        VkImageView m_view = VK_NULL_HANDLE;
+    };
+
+    //Physical backing of a transient, survives Reset()
+    struct TransientImage
+    {
+        VkImage m_image = VK_NULL_HANDLE;
+        VkImageView m_view = VK_NULL_HANDLE;
+    };
+
+    size_t HashStructure() const;
+    //Whether the declared graph is the one m_compiled was built from
+    bool IsCompiledStructure() const;
+    void CullPasses();
+    void SortPasses(std::vector<uint32_t>& order) const;
+    void BuildBarriers(const std::vector<uint32_t>& order);
+    void AssignAliasSlots();
+    static uint32_t FindTransientMemoryType(const VkPhysicalDeviceMemoryProperties& memProperties, uint32_t typeBits, bool lazy);
+
+    std::vector<PassNode> m_passes;
+    std::vector<ResourceNode> m_resources;
+
+    CompiledRenderGraph m_compiled;
+    size_t m_compiledHash = 0;
+    bool m_hasCompiled = false;
+    //Compiles that built something new, the first is 1
+    uint64_t m_compileCount = 0;
+    //Declared passes (without their callbacks) and resources m_compiled was built from
+    std::vector<PassNode> m_compiledPasses;
+    std::vector<ResourceNode> m_compiledResources;
+
+    std::vector<TransientImage> m_transientImages;
+    std::vector<VkDeviceMemory> m_slotMemory;
+    //m_compileCount the transients were allocated for, 0 if they weren't
+    uint64_t m_allocatedCompile = 0;
+    VkDeviceSize m_transientBytes = 0;
+};
+
+#endif // !__RENDER_GRAPH_H__
@@ -0,0 +1,327 @@
+#include "RenderPassCache.h"
+
+#include <stdexcept>
+
+#include "Util.h"
+
+bool RenderPassAttachment::operator==(const RenderPassAttachment& other) const
+{
+    return m_format == other.m_format &&
+        m_samples == other.m_samples &&
+        m_loadOp == other.m_loadOp &&
+        m_storeOp == other.m_storeOp &&
+        m_stencilLoadOp == other.m_stencilLoadOp &&
+        m_stencilStoreOp == other.m_stencilStoreOp &&
+        m_initialLayout == other.m_initialLayout &&
+        m_finalLayout == other.m_finalLayout;
+}
+
+uint32_t RenderPassKey::AddAttachment(const RenderPassAttachment& attachment)
+{
+    if (m_attachmentCount >= MAX_RENDER_PASS_ATTACHMENTS)
+    {
+        throw std::runtime_error("Too many render pass attachments!");
+    }
+
+    m_attachments[m_attachmentCount] = attachment;
+
+    return m_attachmentCount++;
+}
+
+bool RenderPassKey::operator==(const RenderPassKey& other) const
+{
+    if (m_attachmentCount != other.m_attachmentCount ||
+        m_colorAttachmentCount != other.m_colorAttachmentCount ||
+        m_depthAttachment != other.m_depthAttachment ||
+        m_depthReadOnly != other.m_depthReadOnly ||
+        m_resolveAttachmentCount != other.m_resolveAttachmentCount)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_attachmentCount; i++)
+    {
+        if (!(m_attachments[i] == other.m_attachments[i]))
+        {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < m_colorAttachmentCount; i++)
+    {
+        if (m_colorAttachments[i] != other.m_colorAttachments[i])
+        {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < m_resolveAttachmentCount; i++)
+    {
+        if (m_resolveAttachments[i] != other.m_resolveAttachments[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t RenderPassKeyHash::operator()(const RenderPassKey& key) const
+{
+    size_t hash = 0;
+
+    for (uint32_t i = 0; i < key.m_attachmentCount; i++)
+    {
+        const RenderPassAttachment& attachment = key.m_attachments[i];
+        Util::HashCombine(hash, static_cast<uint32_t>(attachment.m_format));
+        Util::HashCombine(hash, static_cast<uint32_t>(attachment.m_samples));
+        Util::HashCombine(hash, static_cast<uint32_t>(attachment.m_loadOp));
+        Util::HashCombine(hash, static_cast<uint32_t>(attachment.m_storeOp));
+        Util::HashCombine(hash, static_cast<uint32_t>(attachment.m_stencilLoadOp));
+        Util::HashCombine(hash, static_cast<uint32_t>(attachment.m_stencilStoreOp));
+        Util::HashCombine(hash, static_cast<uint32_t>(attachment.m_initialLayout));
+        Util::HashCombine(hash, static_cast<uint32_t>(attachment.m_finalLayout));
+    }
+
+    for (uint32_t i = 0; i < key.m_colorAttachmentCount; i++)
+    {
+        Util::HashCombine(hash, key.m_colorAttachments[i]);
+    }
+    Util::HashCombine(hash, key.m_depthAttachment);
+    Util::HashCombine(hash, key.m_depthReadOnly);
+    for (uint32_t i = 0; i < key.m_resolveAttachmentCount; i++)
+    {
+        Util::HashCombine(hash, key.m_resolveAttachments[i]);
+    }
+
+    return hash;
+}
+
+bool FramebufferKey::operator==(const FramebufferKey& other) const
+{
+    if (m_renderPass != other.m_renderPass ||
+        m_attachmentCount != other.m_attachmentCount ||
+        m_width != other.m_width ||
+        m_height != other.m_height ||
+        m_layers != other.m_layers)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_attachmentCount; i++)
+    {
+        if (m_attachments[i] != other.m_attachments[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t FramebufferKeyHash::operator()(const FramebufferKey& key) const
+{
+    size_t hash = 0;
+
+    Util::HashCombine(hash, reinterpret_cast<uintptr_t>(key.m_renderPass));
+    for (uint32_t i = 0; i < key.m_attachmentCount; i++)
+    {
+        Util::HashCombine(hash, reinterpret_cast<uintptr_t>(key.m_attachments[i]));
+    }
+    Util::HashCombine(hash, key.m_width);
+    Util::HashCombine(hash, key.m_height);
+    Util::HashCombine(hash, key.m_layers);
+
+    return hash;
+}
+
+VkRenderPass RenderPassCache::GetRenderPass(const RenderPassKey& key)
+{
+    auto it = m_renderPasses.find(key);
+    if (it != m_renderPasses.end())
+    {
+        return it->second;
+    }
+
+    VkRenderPass renderPass = CreateRenderPass(key);
+    m_renderPasses.emplace(key, renderPass);
+
+    return renderPass;
+}
+
+VkRenderPass RenderPassCache::CreateRenderPass(const RenderPassKey& key)
+{
+    std::array<VkAttachmentDescription, MAX_RENDER_PASS_ATTACHMENTS> attachments = {};
+    for (uint32_t i = 0; i < key.m_attachmentCount; i++)
+    {
+        const RenderPassAttachment& attachment = key.m_attachments[i];
+        attachments[i].format = attachment.m_format;
+        attachments[i].samples = attachment.m_samples;
+        attachments[i].loadOp = attachment.m_loadOp;
+        attachments[i].storeOp = attachment.m_storeOp;
+        attachments[i].stencilLoadOp = attachment.m_stencilLoadOp;
+        attachments[i].stencilStoreOp = attachment.m_stencilStoreOp;
+        attachments[i].initialLayout = attachment.m_initialLayout;
+        attachments[i].finalLayout = attachment.m_finalLayout;
+    }
+
+    //Outcolor(s) in shader
+    std::array<VkAttachmentReference, MAX_RENDER_PASS_ATTACHMENTS> colorRefs = {};
+    for (uint32_t i = 0; i < key.m_colorAttachmentCount; i++)
+    {
+        colorRefs[i].attachment = key.m_colorAttachments[i];
+        colorRefs[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+
+    //Resolve happens as part of the subpass, on tile for tiled GPUs, instead of a separate blit
+    std::array<VkAttachmentReference, MAX_RENDER_PASS_ATTACHMENTS> resolveRefs = {};
+    for (uint32_t i = 0; i < key.m_resolveAttachmentCount; i++)
+    {
+        resolveRefs[i].attachment = key.m_resolveAttachments[i];
+        resolveRefs[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+
+    if (key.m_resolveAttachmentCount != 0 && key.m_resolveAttachmentCount != key.m_colorAttachmentCount)
+    {
+        throw std::runtime_error("Render pass needs one resolve attachment per color attachment!");
+    }
+
+    VkAttachmentReference depthRef = {};
+    depthRef.attachment = key.m_depthAttachment;
+    depthRef.layout = key.m_depthReadOnly ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = key.m_colorAttachmentCount;
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pResolveAttachments = key.m_resolveAttachmentCount != 0 ? resolveRefs.data() : nullptr;
+    subpass.pDepthStencilAttachment = key.m_depthAttachment != VK_ATTACHMENT_UNUSED ? &depthRef : nullptr;
+
+    //No external dependency, the render graph records the barriers around the pass
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = key.m_attachmentCount;
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 0;
+    renderPassInfo.pDependencies = nullptr;
+
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create render pass!");
+    }
+
+    return renderPass;
+}
+
+void RenderPassCache::Destroy()
+{
+    for (auto& entry : m_renderPasses)
+    {
+        vkDestroyRenderPass(m_device, entry.second, nullptr);
+    }
+
+    m_renderPasses.clear();
+}
+
+void FramebufferCache::Init(VkDevice device, size_t capacity, uint32_t framesInFlight)
+{
+    m_device = device;
+    m_capacity = capacity;
+    m_framesInFlight = framesInFlight;
+}
+
+VkFramebuffer FramebufferCache::GetFramebuffer(const FramebufferKey& key)
+{
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end())
+    {
+        //Move to the front, it's the most recently used now
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        it->second->m_lastUsedFrame = m_frame;
+
+        return it->second->m_framebuffer;
+    }
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = key.m_renderPass;
+    framebufferInfo.attachmentCount = key.m_attachmentCount;
+    framebufferInfo.pAttachments = key.m_attachments.data();
+    framebufferInfo.width = key.m_width;
+    framebufferInfo.height = key.m_height;
+    framebufferInfo.layers = key.m_layers;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create framebuffer!");
+    }
+
+    m_entries.push_front({ key, framebuffer, m_frame });
+    m_lookup.emplace(key, m_entries.begin());
+
+    EvictUnused();
+
+    return framebuffer;
+}
+
+void FramebufferCache::EvictUnused()
+{
+    //Walk from the least recently used end, stop at the first one that might still be in flight
+    while (m_lookup.size() > m_capacity)
+    {
+        const Entry& oldest = m_entries.back();
+        if (oldest.m_lastUsedFrame + m_framesInFlight > m_frame)
+        {
+            break;
+        }
+
+        vkDestroyFramebuffer(m_device, oldest.m_framebuffer, nullptr);
+        m_lookup.erase(oldest.m_key);
+        m_entries.pop_back();
+    }
+}
+
+void FramebufferCache::OnImageViewDestroyed(VkImageView view, DeletionQueue* deletionQueue)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        bool usesView = false;
+        for (uint32_t i = 0; i < it->m_key.m_attachmentCount; i++)
+        {
+            usesView |= it->m_key.m_attachments[i] == view;
+        }
+
+        if (usesView)
+        {
+            if (deletionQueue != nullptr)
+            {
+                deletionQueue->DestroyFramebuffer(it->m_framebuffer);
+            }
+            else
+            {
+                vkDestroyFramebuffer(m_device, it->m_framebuffer, nullptr);
+            }
+            m_lookup.erase(it->m_key);
+            it = m_entries.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+void FramebufferCache::Destroy()
+{
+    for (auto& entry : m_entries)
+    {
+        vkDestroyFramebuffer(m_device, entry.m_framebuffer, nullptr);
+    }
+
+    m_entries.clear();
+    m_lookup.clear();
+}
@@ -0,0 +1,133 @@
+#ifndef __RENDER_PASS_CACHE_H__
+#define __RENDER_PASS_CACHE_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "DeletionQueue.h"
+
+const uint32_t MAX_RENDER_PASS_ATTACHMENTS = 8;
+
+struct RenderPassAttachment
+{
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits m_samples = VK_SAMPLE_COUNT_1_BIT;
+    VkAttachmentLoadOp m_loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    VkAttachmentStoreOp m_storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    VkAttachmentLoadOp m_stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    VkAttachmentStoreOp m_stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    VkImageLayout m_initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout m_finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    bool operator==(const RenderPassAttachment& other) const;
+};
+
+//Everything that makes two single subpass render passes different.
+//Fixed size so building and hashing a key never allocates.
+struct RenderPassKey
+{
+    std::array<RenderPassAttachment, MAX_RENDER_PASS_ATTACHMENTS> m_attachments = {};
+    uint32_t m_attachmentCount = 0;
+
+    //Indices into m_attachments used by the subpass
+    std::array<uint32_t, MAX_RENDER_PASS_ATTACHMENTS> m_colorAttachments = {};
+    uint32_t m_colorAttachmentCount = 0;
+    uint32_t m_depthAttachment = VK_ATTACHMENT_UNUSED;
+    //Depth is tested but not written, e.g. after a depth pre-pass
+    bool m_depthReadOnly = false;
+    //Single sample targets the color attachments resolve into at the end of the subpass,
+    //either none or one per color attachment
+    std::array<uint32_t, MAX_RENDER_PASS_ATTACHMENTS> m_resolveAttachments = {};
+    uint32_t m_resolveAttachmentCount = 0;
+
+    //Adds an attachment and returns its index
+    uint32_t AddAttachment(const RenderPassAttachment& attachment);
+
+    bool operator==(const RenderPassKey& other) const;
+};
+
+struct RenderPassKeyHash
+{
+    size_t operator()(const RenderPassKey& key) const;
+};
+
+struct FramebufferKey
+{
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    std::array<VkImageView, MAX_RENDER_PASS_ATTACHMENTS> m_attachments = {};
+    uint32_t m_attachmentCount = 0;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_layers = 1;
+
+    bool operator==(const FramebufferKey& other) const;
+};
+
+struct FramebufferKeyHash
+{
+    size_t operator()(const FramebufferKey& key) const;
+};
+
+//Creates each distinct render pass once, lookups are a single hash probe
+class RenderPassCache
+{
+public:
+    void Init(VkDevice device) { m_device = device; }
+
+    VkRenderPass GetRenderPass(const RenderPassKey& key);
+    size_t GetRenderPassCount() const { return m_renderPasses.size(); }
+
+    void Destroy();
+
+private:
+    VkRenderPass CreateRenderPass(const RenderPassKey& key);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::unordered_map<RenderPassKey, VkRenderPass, RenderPassKeyHash> m_renderPasses;
+};
+
+//Framebuffers keyed by the views they wrap. Least recently used ones are dropped
+//once the cache is full, but only if no frame in flight can still reference them.
+class FramebufferCache
+{
+public:
+    void Init(VkDevice device, size_t capacity, uint32_t framesInFlight);
+
+    VkFramebuffer GetFramebuffer(const FramebufferKey& key);
+    size_t GetFramebufferCount() const { return m_lookup.size(); }
+
+    //Call once per frame so eviction knows what might still be in flight
+    void NextFrame() { m_frame++; }
+    //Drops every framebuffer that wraps view, has to happen before the view goes away.
+    //With deletionQueue they are destroyed once the frames in flight are done with them,
+    //queue the view itself after this.
+    void OnImageViewDestroyed(VkImageView view, DeletionQueue* deletionQueue = nullptr);
+
+    void Destroy();
+
+private:
+    struct Entry
+    {
+        FramebufferKey m_key;
+        VkFramebuffer m_framebuffer;
+        uint64_t m_lastUsedFrame;
+    };
+
+    void EvictUnused();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    size_t m_capacity = 0;
+    uint32_t m_framesInFlight = 0;
+    uint64_t m_frame = 0;
+
+    //Front is most recently used
+    std::list<Entry> m_entries;
+    std::unordered_map<FramebufferKey, std::list<Entry>::iterator, FramebufferKeyHash> m_lookup;
+};
+
+#endif // !__RENDER_PASS_CACHE_H__
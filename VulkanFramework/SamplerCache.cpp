@@ -0,0 +1,166 @@
+#include "SamplerCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Util.h"
+
+namespace
+{
+    uint32_t FloatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+}
+
+size_t SamplerInfoHash::operator()(const VkSamplerCreateInfo& info) const
+{
+    size_t hash = 0;
+
+    Util::HashCombine(hash, static_cast<uint32_t>(info.flags));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.magFilter));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.minFilter));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.mipmapMode));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.addressModeU));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.addressModeV));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.addressModeW));
+    Util::HashCombine(hash, FloatBits(info.mipLodBias));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.anisotropyEnable));
+    Util::HashCombine(hash, FloatBits(info.maxAnisotropy));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.compareEnable));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.compareOp));
+    Util::HashCombine(hash, FloatBits(info.minLod));
+    Util::HashCombine(hash, FloatBits(info.maxLod));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.borderColor));
+    Util::HashCombine(hash, static_cast<uint32_t>(info.unnormalizedCoordinates));
+
+    return hash;
+}
+
+bool SamplerInfoEqual::operator()(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b) const
+{
+    return a.flags == b.flags &&
+        a.magFilter == b.magFilter &&
+        a.minFilter == b.minFilter &&
+        a.mipmapMode == b.mipmapMode &&
+        a.addressModeU == b.addressModeU &&
+        a.addressModeV == b.addressModeV &&
+        a.addressModeW == b.addressModeW &&
+        FloatBits(a.mipLodBias) == FloatBits(b.mipLodBias) &&
+        a.anisotropyEnable == b.anisotropyEnable &&
+        FloatBits(a.maxAnisotropy) == FloatBits(b.maxAnisotropy) &&
+        a.compareEnable == b.compareEnable &&
+        a.compareOp == b.compareOp &&
+        FloatBits(a.minLod) == FloatBits(b.minLod) &&
+        FloatBits(a.maxLod) == FloatBits(b.maxLod) &&
+        a.borderColor == b.borderColor &&
+        a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+void SamplerCache::Init(VkDevice device, const VkPhysicalDeviceLimits& limits, DeletionQueue* deletionQueue)
+{
+    m_device = device;
+    m_deletionQueue = deletionQueue;
+    m_maxSamplers = limits.maxSamplerAllocationCount;
+    m_acquireCount = 0;
+    m_createdCount = 0;
+    m_peakCount = 0;
+}
+
+void SamplerCache::Destroy()
+{
+    for (auto& entry : m_entries)
+    {
+        vkDestroySampler(m_device, entry.second.m_sampler, nullptr);
+    }
+
+    m_entries.clear();
+    m_lookup.clear();
+}
+
+VkSampler SamplerCache::Acquire(const VkSamplerCreateInfo& info)
+{
+    if (info.pNext != nullptr)
+    {
+        throw std::runtime_error("sampler cache can't key on extension structs!");
+    }
+
+    m_acquireCount++;
+
+    auto it = m_entries.find(info);
+    if (it != m_entries.end())
+    {
+        it->second.m_references++;
+        return it->second.m_sampler;
+    }
+
+    if (m_entries.size() >= m_maxSamplers)
+    {
+        throw std::runtime_error("too many distinct samplers for the device!");
+    }
+
+    Entry entry;
+    if (vkCreateSampler(m_device, &info, nullptr, &entry.m_sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create sampler!");
+    }
+    entry.m_references = 1;
+
+    //The stored key never points anywhere
+    VkSamplerCreateInfo key = info;
+    key.pNext = nullptr;
+    it = m_entries.emplace(key, entry).first;
+    m_lookup[entry.m_sampler] = it;
+
+    m_createdCount++;
+    m_peakCount = std::max(m_peakCount, m_entries.size());
+
+    return entry.m_sampler;
+}
+
+void SamplerCache::Release(VkSampler sampler)
+{
+    auto lookup = m_lookup.find(sampler);
+    if (lookup == m_lookup.end())
+    {
+        throw std::runtime_error("released a sampler the cache doesn't own!");
+    }
+
+    Entry& entry = lookup->second->second;
+    if (--entry.m_references != 0)
+    {
+        return;
+    }
+
+    //Frames in flight may still sample with it
+    m_deletionQueue->DestroySampler(sampler);
+    m_entries.erase(lookup->second);
+    m_lookup.erase(lookup);
+}
+
+VkDescriptorSetLayoutBinding SamplerCache::GetImmutableBinding(uint32_t binding, VkShaderStageFlags stages, VkSampler sampler) const
+{
+    auto lookup = m_lookup.find(sampler);
+    if (lookup == m_lookup.end())
+    {
+        throw std::runtime_error("immutable sampler isn't from the cache!");
+    }
+
+    VkDescriptorSetLayoutBinding layoutBinding = {};
+    layoutBinding.binding = binding;
+    layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    layoutBinding.descriptorCount = 1;
+    layoutBinding.stageFlags = stages;
+    layoutBinding.pImmutableSamplers = &lookup->second->second.m_sampler;
+
+    return layoutBinding;
+}
+
+void SamplerCache::PrintReport(std::ostream& out) const
+{
+    out << "samplers: " << m_entries.size() << " live (peak " << m_peakCount << ", device limit " << m_maxSamplers << "), "
+        << m_createdCount << " created for " << m_acquireCount << " acquires" << std::endl;
+}
@@ -0,0 +1,75 @@
+#ifndef __SAMPLER_CACHE_H__
+#define __SAMPLER_CACHE_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+#include "DeletionQueue.h"
+
+//Every VkSamplerCreateInfo field but sType and pNext, floats compared bit for bit
+struct SamplerInfoHash
+{
+    size_t operator()(const VkSamplerCreateInfo& info) const;
+};
+
+struct SamplerInfoEqual
+{
+    bool operator()(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b) const;
+};
+
+//One VkSampler per distinct sampler state, shared by everyone who asks for it. Materials
+//differ in their images far more than in how they sample them, so the sampler count stays
+//at the handful of states in use instead of growing with the material count, well under
+//maxSamplerAllocationCount (4000 on some drivers).
+//Acquire and Release are reference counted, the last Release hands the sampler to the
+//deletion queue. Main thread only.
+class SamplerCache
+{
+public:
+    void Init(VkDevice device, const VkPhysicalDeviceLimits& limits, DeletionQueue* deletionQueue);
+    //Destroys every sampler, acquired or not. The device has to be idle.
+    void Destroy();
+
+    //pNext has to be null, extension structs aren't part of the key
+    VkSampler Acquire(const VkSamplerCreateInfo& info);
+    void Release(VkSampler sampler);
+
+    //Combined image sampler binding with the sampler baked into the set layout, so shaders
+    //sample through it without it ever being written to a set. pImmutableSamplers points into
+    //the cache: the sampler has to stay acquired until the layout is created, and the layout
+    //has to be destroyed before the sampler is released for good.
+    VkDescriptorSetLayoutBinding GetImmutableBinding(uint32_t binding, VkShaderStageFlags stages, VkSampler sampler) const;
+
+    size_t GetSamplerCount() const { return m_entries.size(); }
+    uint64_t GetAcquireCount() const { return m_acquireCount; }
+    uint64_t GetCreatedCount() const { return m_createdCount; }
+
+    void PrintReport(std::ostream& out) const;
+
+private:
+    struct Entry
+    {
+        VkSampler m_sampler = VK_NULL_HANDLE;
+        uint32_t m_references = 0;
+    };
+
+    using EntryMap = std::unordered_map<VkSamplerCreateInfo, Entry, SamplerInfoHash, SamplerInfoEqual>;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    DeletionQueue* m_deletionQueue = nullptr;
+    uint32_t m_maxSamplers = 0;
+
+    //Node based, so Entry addresses (and m_sampler for pImmutableSamplers) are stable
+    EntryMap m_entries;
+    std::unordered_map<VkSampler, EntryMap::iterator> m_lookup;
+
+    uint64_t m_acquireCount = 0;
+    uint64_t m_createdCount = 0;
+    size_t m_peakCount = 0;
+};
+
+#endif // !__SAMPLER_CACHE_H__
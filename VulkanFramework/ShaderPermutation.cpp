@@ -0,0 +1,53 @@
+#include "ShaderPermutation.h"
+
+const char* GetLightingModelName(LightingModel model)
+{
+    switch (model)
+    {
+    case LightingModel::Unlit: return "unlit";
+    case LightingModel::Lambert: return "lambert";
+    case LightingModel::BlinnPhong: return "blinn-phong";
+    }
+
+    return "unknown";
+}
+
+bool ParseLightingModel(const std::string& name, LightingModel& model)
+{
+    const LightingModel models[] = { LightingModel::Unlit, LightingModel::Lambert, LightingModel::BlinnPhong };
+    for (LightingModel candidate : models)
+    {
+        if (name == GetLightingModelName(candidate))
+        {
+            model = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t ShaderPermutationKey::Pack() const
+{
+    //The lighting model is the whole key, the low byte is plenty for it
+    return static_cast<uint32_t>(m_lightingModel) & 0xFF;
+}
+
+SpecializationData::SpecializationData(const ShaderPermutationKey& key)
+{
+    m_values[SHADER_CONSTANT_LIGHTING_MODEL] = static_cast<uint32_t>(key.m_lightingModel);
+
+    //One entry per constant, ids line up with the indices into m_values
+    for (uint32_t i = 0; i < SHADER_CONSTANT_COUNT; i++)
+    {
+        m_entries[i].constantID = i;
+        m_entries[i].offset = i * sizeof(uint32_t);
+        m_entries[i].size = sizeof(uint32_t);
+    }
+
+    //Entries for constants a stage doesn't declare are ignored, so both stages can share this
+    m_info.mapEntryCount = static_cast<uint32_t>(m_entries.size());
+    m_info.pMapEntries = m_entries.data();
+    m_info.dataSize = sizeof(m_values);
+    m_info.pData = m_values.data();
+}
@@ -0,0 +1,73 @@
+#ifndef __SHADER_PERMUTATION_H__
+#define __SHADER_PERMUTATION_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+//Lighting models the fragment shader can be specialized for
+enum class LightingModel : uint32_t
+{
+    Unlit = 0,
+    Lambert = 1,
+    BlinnPhong = 2
+};
+
+const char* GetLightingModelName(LightingModel model);
+//Names as printed by GetLightingModelName, false if unknown
+bool ParseLightingModel(const std::string& name, LightingModel& model);
+
+//Must match the constant_id values declared in the shaders
+enum ShaderConstantId : uint32_t
+{
+    SHADER_CONSTANT_LIGHTING_MODEL = 0,
+
+    SHADER_CONSTANT_COUNT
+};
+
+//Describes one shader permutation. Every feature is a specialization constant
+//so a single SPIR-V module covers them all and the driver folds the dead branches.
+struct ShaderPermutationKey
+{
+    LightingModel m_lightingModel = LightingModel::Unlit;
+
+    //Packs the key into a single value, used for hashing and comparison
+    uint32_t Pack() const;
+
+    bool operator==(const ShaderPermutationKey& other) const
+    {
+        return Pack() == other.Pack();
+    }
+};
+
+struct ShaderPermutationKeyHash
+{
+    size_t operator()(const ShaderPermutationKey& key) const
+    {
+        return std::hash<uint32_t>()(key.Pack());
+    }
+};
+
+//Owns the constant values and map entries that VkSpecializationInfo points into,
+//so it has to stay alive until the pipeline is created.
+class SpecializationData
+{
+public:
+    explicit SpecializationData(const ShaderPermutationKey& key);
+    SpecializationData(const SpecializationData&) = delete;
+    SpecializationData& operator=(const SpecializationData&) = delete;
+
+    const VkSpecializationInfo* GetInfo() const { return &m_info; }
+
+private:
+    //Every constant is 32 bits wide (int or VkBool32 on the shader side)
+    std::array<uint32_t, SHADER_CONSTANT_COUNT> m_values = {};
+    std::array<VkSpecializationMapEntry, SHADER_CONSTANT_COUNT> m_entries = {};
+    VkSpecializationInfo m_info = {};
+};
+
+#endif // !__SHADER_PERMUTATION_H__
@@ -1,3 +1,5 @@
 C:/VulkanSDK/1.2.131.1/Bin/glslc.exe Shader.vert -o vert.spv
 C:/VulkanSDK/1.2.131.1/Bin/glslc.exe Shader.frag -o frag.spv
+C:/VulkanSDK/1.2.131.1/Bin/glslc.exe Meshlet.vert -o meshlet_vert.spv
+C:/VulkanSDK/1.2.131.1/Bin/glslc.exe MeshletCull.comp -o meshlet_cull.spv
 pause
\ No newline at end of file
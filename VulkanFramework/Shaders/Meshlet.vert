@@ -0,0 +1,46 @@
+#version 450
+
+//Meshlet geometry (see MeshletGeometry.h), vertices pulled by index instead of from vertex input
+
+//Uniform ring, bound with dynamic offsets (see UniformRing.h and FrameUniforms in VulkanBackend.h)
+layout(set = 0, binding = 0) uniform FrameUniforms
+{
+    mat4 viewProjection;
+    vec4 cameraPosition;
+} frame;
+
+layout(set = 0, binding = 1) uniform ObjectUniforms
+{
+    mat4 model;
+} object;
+
+//w is always 1
+layout(set = 1, binding = 0) readonly buffer Positions
+{
+    vec4 positions[];
+};
+
+layout(push_constant) uniform DrawConstants
+{
+    vec4 tint;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+//World space, for the lighting models in Shader.frag
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec3 fragViewDir;
+
+//The depth pre-pass and the EQUAL tested forward pass have to produce bit identical depth
+invariant gl_Position;
+
+void main()
+{
+    vec4 position = positions[gl_VertexIndex];
+
+    gl_Position = frame.viewProjection * object.model * position;
+    //No normals in the stream, the direction from the mesh's origin stands in for spheres
+    vec3 normal = normalize(position.xyz);
+    fragColor = (normal * 0.5 + 0.5) * draw.tint.rgb;
+    fragNormal = (object.model * vec4(normal, 0.0)).xyz;
+    fragViewDir = frame.cameraPosition.xyz - (object.model * position).xyz;
+}
@@ -1,10 +1,38 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+//Permutation switch, value comes from VkSpecializationInfo (see ShaderPermutation.h)
+layout(constant_id = 0) const int LIGHTING_MODEL = 0;
+
+const int LIGHTING_UNLIT = 0;
+const int LIGHTING_LAMBERT = 1;
+const int LIGHTING_BLINN_PHONG = 2;
+
 layout(location = 0) out vec4 outColor;
 layout(location = 0) in vec3 fragColor;
+//World space, not normalized after interpolation
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec3 fragViewDir;
 
 void main() 
 {
-    outColor = vec4(0.5, 1.0, 0.5, 1.0);
-}
\ No newline at end of file
+    vec3 baseColor = fragColor;
+    vec3 color = baseColor;
+
+    //One directional light, fixed in world space. lightDir points towards it.
+    vec3 normal = normalize(fragNormal);
+    vec3 lightDir = normalize(vec3(0.3, 0.5, 1.0));
+
+    if (LIGHTING_MODEL == LIGHTING_LAMBERT)
+    {
+        color = baseColor * max(dot(normal, lightDir), 0.0);
+    }
+    else if (LIGHTING_MODEL == LIGHTING_BLINN_PHONG)
+    {
+        vec3 halfDir = normalize(lightDir + normalize(fragViewDir));
+        float specular = pow(max(dot(normal, halfDir), 0.0), 32.0);
+        color = baseColor * max(dot(normal, lightDir), 0.0) + vec3(specular);
+    }
+
+    outColor = vec4(color, 1.0);
+}
@@ -1,5 +1,22 @@
 #version 450
 
+//Uniform ring, bound with dynamic offsets (see UniformRing.h and FrameUniforms in VulkanBackend.h)
+layout(set = 0, binding = 0) uniform FrameUniforms
+{
+    mat4 viewProjection;
+    vec4 cameraPosition;
+} frame;
+
+layout(set = 0, binding = 1) uniform ObjectUniforms
+{
+    mat4 model;
+} object;
+
+layout(push_constant) uniform DrawConstants
+{
+    vec4 tint;
+} draw;
+
 vec2 positions[3] = vec2[](
     vec2(0.0, -0.5),
     vec2(0.5, 0.5),
@@ -13,9 +30,22 @@ vec3 colors[3] = vec3[](
 );
 
 layout(location = 0) out vec3 fragColor;
+//World space, for the lighting models in Shader.frag
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec3 fragViewDir;
+
+//The depth pre-pass and the EQUAL tested forward pass have to produce bit identical depth
+invariant gl_Position;
 
 void main() 
 {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+    vec2 position = positions[gl_VertexIndex];
+
+    gl_Position = frame.viewProjection * object.model * vec4(position, 0.0, 1.0);
+    fragColor = colors[gl_VertexIndex] * draw.tint.rgb;
+
+    //The triangle lies in z = 0 and winds counter-clockwise around +z. Normals go through the
+    //model matrix as directions, fine as long as it has no non-uniform scale.
+    fragNormal = (object.model * vec4(0.0, 0.0, 1.0, 0.0)).xyz;
+    fragViewDir = frame.cameraPosition.xyz - (object.model * vec4(position, 0.0, 1.0)).xyz;
+}
@@ -0,0 +1,78 @@
+//Sampling and feedback for VirtualTexture (see VirtualTexture.h), #include it into fragment
+//shaders. Needs GL_GOOGLE_include_directive, glslc has it on by default.
+//The set is bound at VIRTUAL_TEXTURE_SET, 1 unless the shader defines it first.
+
+#ifndef VIRTUAL_TEXTURE_SET
+#define VIRTUAL_TEXTURE_SET 1
+#endif
+
+//Per page: slot x, slot y, mip of the finest resident page covering it
+layout(set = VIRTUAL_TEXTURE_SET, binding = 0) uniform usampler2D virtualPageTable;
+//Software: single level atlas of pages. Sparse: the whole texture.
+layout(set = VIRTUAL_TEXTURE_SET, binding = 1) uniform sampler2D virtualCache;
+
+//Page each block of pixels wants, packed like VirtualPage::Pack
+layout(set = VIRTUAL_TEXTURE_SET, binding = 2) writeonly buffer VirtualFeedback
+{
+    uint requests[];
+} virtualFeedback;
+
+//VirtualTextureConstants
+layout(set = VIRTUAL_TEXTURE_SET, binding = 3) uniform VirtualTextureConstants
+{
+    vec4 virtualSize;
+    vec4 page;
+    vec4 cache;
+    vec4 feedback;
+} virtualTexture;
+
+//Mip the hardware would pick for uv, in levels of the full texture
+float VirtualTextureLod(vec2 uv)
+{
+    vec2 texels = uv * virtualTexture.virtualSize.xy;
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    return max(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0);
+}
+
+//Writes the page uv needs into the feedback buffer. One pixel of each block writes, the
+//block's position in the buffer. Call it from every fragment that samples the texture.
+void WriteVirtualTextureFeedback(vec2 uv)
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    int scale = int(virtualTexture.cache.w);
+    if (pixel.x % scale != 0 || pixel.y % scale != 0)
+    {
+        return;
+    }
+
+    int mip = clamp(int(VirtualTextureLod(uv)), 0, int(virtualTexture.page.z) - 1);
+    ivec2 pageCount = max(ivec2(virtualTexture.virtualSize.xy / virtualTexture.page.xy) >> mip, ivec2(1));
+    ivec2 page = clamp(ivec2(floor(uv * vec2(pageCount))), ivec2(0), pageCount - 1);
+
+    ivec2 cell = pixel / scale;
+    uint index = uint(cell.y) * uint(virtualTexture.feedback.x) + uint(cell.x);
+    virtualFeedback.requests[index] = (uint(mip) << 28) | (uint(page.x) << 14) | uint(page.y);
+}
+
+vec4 SampleVirtualTexture(vec2 uv)
+{
+    float lod = VirtualTextureLod(uv);
+    int levels = int(virtualTexture.page.z);
+    int mip = clamp(int(lod), 0, levels - 1);
+    ivec2 pageCount = max(ivec2(virtualTexture.virtualSize.xy / virtualTexture.page.xy) >> mip, ivec2(1));
+    ivec2 page = clamp(ivec2(floor(uv * vec2(pageCount))), ivec2(0), pageCount - 1);
+    uvec4 entry = texelFetch(virtualPageTable, page, mip);
+
+    //Sparse: never sample below what's resident, the hardware does the rest
+    if (virtualTexture.page.w != 0.0)
+    {
+        return textureLod(virtualCache, uv, max(lod, float(entry.b)));
+    }
+
+    //Software: position within the resident page, which may be a coarser one, then into its slot
+    vec2 levelTexels = uv * virtualTexture.virtualSize.xy / exp2(float(entry.b));
+    vec2 inPage = levelTexels - floor(levelTexels / virtualTexture.page.xy) * virtualTexture.page.xy;
+    vec2 cacheTexels = vec2(entry.rg) * virtualTexture.page.xy + inPage;
+    return textureLod(virtualCache, cacheTexels / virtualTexture.cache.xy, 0.0);
+}
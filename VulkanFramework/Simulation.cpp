@@ -0,0 +1,103 @@
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Profiler.h"
+
+SimulationState SimulationState::Interpolate(const SimulationState& from, const SimulationState& to, float alpha)
+{
+    SimulationState state = alpha < 1.0f ? from : to;
+    state.m_time = from.m_time + (to.m_time - from.m_time) * alpha;
+    state.m_cameraPosition = glm::mix(from.m_cameraPosition, to.m_cameraPosition, alpha);
+    state.m_cameraTarget = glm::mix(from.m_cameraTarget, to.m_cameraTarget, alpha);
+
+    return state;
+}
+
+void Simulation::Init(double tickRate, StepFunc step, const SimulationState& initial)
+{
+    m_step = std::move(step);
+    m_stepTime = 1.0 / tickRate;
+    m_accumulator = 0.0;
+    m_droppedTime = 0.0;
+
+    m_pairs[0] = { initial, initial };
+    m_pairs[1] = { initial, initial };
+    m_front = 0;
+    m_working = initial;
+}
+
+void Simulation::Shutdown()
+{
+    JobSystem::GetInstance()->Wait(m_job);
+    m_job = JobHandle();
+}
+
+void Simulation::BeginFrame(double frameTime)
+{
+    PROFILE_SCOPE("SimulationBeginFrame");
+
+    //Normally long done, it had a whole frame of recording and presenting to run in
+    {
+        PROFILE_SCOPE("WaitForSimulation");
+        JobSystem::GetInstance()->Wait(m_job);
+    }
+    m_job = JobHandle();
+
+    if (m_backPending)
+    {
+        m_front ^= 1;
+        m_backPending = false;
+    }
+    m_renderAlpha = m_pendingAlpha;
+
+    //Spiral of death guard, a long hitch (debugger, window drag) isn't worth catching up on
+    if (frameTime > MAX_FRAME_TIME)
+    {
+        m_droppedTime += frameTime - MAX_FRAME_TIME;
+        frameTime = MAX_FRAME_TIME;
+    }
+    m_accumulator += frameTime;
+
+    uint32_t steps = static_cast<uint32_t>(m_accumulator / m_stepTime);
+    if (steps > MAX_STEPS_PER_FRAME)
+    {
+        //Keeps less than a step so the blend factor stays in range
+        double excess = m_accumulator - MAX_STEPS_PER_FRAME * m_stepTime;
+        double kept = std::fmod(excess, m_stepTime);
+        m_droppedTime += excess - kept;
+        m_accumulator = MAX_STEPS_PER_FRAME * m_stepTime + kept;
+        steps = MAX_STEPS_PER_FRAME;
+    }
+    m_accumulator -= steps * m_stepTime;
+    m_stepsLastFrame = steps;
+
+    m_pendingAlpha = static_cast<float>(std::clamp(m_accumulator / m_stepTime, 0.0, 1.0));
+
+    if (steps == 0)
+    {
+        return;
+    }
+
+    //The job owns the back pair and m_working until the next BeginFrame waits on it
+    StatePair* back = &m_pairs[m_front ^ 1];
+    m_backPending = true;
+    m_job = JobSystem::GetInstance()->Submit("SimulationSteps", [this, back, steps]()
+    {
+        for (uint32_t i = 0; i < steps; i++)
+        {
+            //Only the last two survive, they're what the blend needs
+            if (i + 1 == steps)
+            {
+                back->m_previous = m_working;
+            }
+
+            m_step(m_working, m_stepTime);
+            m_working.m_tick++;
+            m_working.m_time = m_working.m_tick * m_stepTime;
+        }
+
+        back->m_current = m_working;
+    });
+}
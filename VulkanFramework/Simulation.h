@@ -0,0 +1,92 @@
+#ifndef __SIMULATION_H__
+#define __SIMULATION_H__
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+
+//Everything one simulation step produces. Rendering only ever sees a blend of two of these.
+struct SimulationState
+{
+    uint64_t m_tick = 0;
+    //Simulated seconds, m_tick times the step length
+    double m_time = 0.0;
+    glm::vec3 m_cameraPosition = glm::vec3(0.0f, 0.0f, 2.0f);
+    glm::vec3 m_cameraTarget = glm::vec3(0.0f);
+
+    //alpha 0 is from, 1 is to
+    static SimulationState Interpolate(const SimulationState& from, const SimulationState& to, float alpha);
+};
+
+//Fixed timestep simulation decoupled from the render rate. Every rendered frame adds its
+//length to an accumulator and runs as many whole steps as fit, on the job system. Rendering
+//draws a blend of the last two states at the leftover fraction of a step, so motion is
+//smooth at any frame rate and the simulation is deterministic at any frame rate.
+//
+//The states are double buffered: the job writes the back pair while rendering reads the
+//front pair, and they only swap in BeginFrame once the job is done, so neither side locks.
+//The price is latency, a frame renders what the previous frame's steps produced, blended one
+//step behind.
+//
+//A frame longer than MAX_FRAME_TIME, or needing more than MAX_STEPS_PER_FRAME steps, has
+//the excess dropped (the simulation slows down) rather than trying to catch up, which would
+//only make the next frame longer still.
+class Simulation
+{
+public:
+    using StepFunc = std::function<void(SimulationState& state, double stepTime)>;
+
+    static const uint32_t MAX_STEPS_PER_FRAME = 8;
+    static constexpr double MAX_FRAME_TIME = 0.25;
+
+    //step runs on a worker, it may only touch the state it's given
+    void Init(double tickRate, StepFunc step, const SimulationState& initial = SimulationState());
+    //Waits for the last job
+    void Shutdown();
+
+    //Once per rendered frame on the main thread, frameTime in seconds. Publishes what the
+    //previous frame's job produced and kicks off this frame's steps.
+    void BeginFrame(double frameTime);
+
+    //Read-only until the next BeginFrame, safe to use while the job runs
+    SimulationState GetRenderState() const { return SimulationState::Interpolate(GetFront().m_previous, GetFront().m_current, m_renderAlpha); }
+    float GetRenderAlpha() const { return m_renderAlpha; }
+
+    double GetStepTime() const { return m_stepTime; }
+    uint32_t GetStepsLastFrame() const { return m_stepsLastFrame; }
+    //Seconds the spiral-of-death guard has thrown away
+    double GetDroppedTime() const { return m_droppedTime; }
+
+private:
+    struct StatePair
+    {
+        SimulationState m_previous;
+        SimulationState m_current;
+    };
+
+    const StatePair& GetFront() const { return m_pairs[m_front]; }
+
+    StepFunc m_step;
+    double m_stepTime = 1.0 / 120.0;
+    double m_accumulator = 0.0;
+    double m_droppedTime = 0.0;
+    uint32_t m_stepsLastFrame = 0;
+
+    std::array<StatePair, 2> m_pairs;
+    uint32_t m_front = 0;
+    //Only the job touches this while it runs, it always matches the newest published state
+    SimulationState m_working;
+
+    JobHandle m_job;
+    //The back pair holds new states once m_job finishes
+    bool m_backPending = false;
+    //Blend factor for the back pair, and the one being rendered
+    float m_pendingAlpha = 0.0f;
+    float m_renderAlpha = 0.0f;
+};
+
+#endif // !__SIMULATION_H__
@@ -0,0 +1,108 @@
+#include "StagingRing.h"
+
+#include <stdexcept>
+
+#include "Util.h"
+
+namespace
+{
+    VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    //Region bases stay aligned for anything Allocate is asked for
+    const VkDeviceSize REGION_ALIGNMENT = 256;
+}
+
+void StagingRing::Init(VkDevice device, const VkPhysicalDeviceMemoryProperties& memProperties, uint32_t regionCount, VkDeviceSize regionSize)
+{
+    m_device = device;
+    m_regionCount = regionCount;
+    m_regionSize = AlignUp(regionSize, REGION_ALIGNMENT);
+    m_regionBase = 0;
+    m_offset = 0;
+    m_totalBytes = 0;
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_regionSize * m_regionCount;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create staging ring buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, m_buffer, &requirements);
+
+    //Coherent, so nothing has to be flushed before the copies are submitted
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = Util::FindMemoryType(memProperties, requirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate staging ring memory!");
+    }
+
+    vkBindBufferMemory(m_device, m_buffer, m_memory, 0);
+
+    //Stays mapped for the lifetime of the ring
+    void* mapped = nullptr;
+    if (vkMapMemory(m_device, m_memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map staging ring memory!");
+    }
+    m_mapped = static_cast<std::byte*>(mapped);
+}
+
+void StagingRing::Destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    vkUnmapMemory(m_device, m_memory);
+    vkDestroyBuffer(m_device, m_buffer, nullptr);
+    vkFreeMemory(m_device, m_memory, nullptr);
+
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+    m_mapped = nullptr;
+    m_device = VK_NULL_HANDLE;
+}
+
+void StagingRing::BeginFrame(uint32_t region)
+{
+    if (region >= m_regionCount)
+    {
+        throw std::runtime_error("staging ring region out of range!");
+    }
+
+    m_regionBase = region * m_regionSize;
+    m_offset = 0;
+}
+
+StagingRing::Allocation StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    Allocation allocation;
+
+    VkDeviceSize offset = AlignUp(m_offset, alignment);
+    if (offset + size > m_regionSize)
+    {
+        return allocation;
+    }
+
+    allocation.m_data = m_mapped + m_regionBase + offset;
+    allocation.m_offset = m_regionBase + offset;
+    m_offset = offset + size;
+    m_totalBytes += size;
+
+    return allocation;
+}
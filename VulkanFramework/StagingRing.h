@@ -0,0 +1,53 @@
+#ifndef __STAGING_RING_H__
+#define __STAGING_RING_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+#include <cstdint>
+
+//One persistently mapped transfer source buffer split into a region per frame that can be in
+//flight, for streaming uploads that happen every frame. Same idea as UniformRing: allocations
+//bump through the current region and come back as a mapped pointer plus the buffer offset to
+//copy from. Running out of space isn't an error here, the caller just uploads the rest next frame.
+//A region may only be written once the GPU is done with the frame that last used it.
+class StagingRing
+{
+public:
+    struct Allocation
+    {
+        //Null if the region is full
+        void* m_data = nullptr;
+        VkDeviceSize m_offset = 0;
+    };
+
+    void Init(VkDevice device, const VkPhysicalDeviceMemoryProperties& memProperties, uint32_t regionCount, VkDeviceSize regionSize);
+    void Destroy();
+
+    //Rewinds region and makes it the one allocations come from
+    void BeginFrame(uint32_t region);
+
+    //alignment has to be a power of two, copies into compressed images want 16
+    Allocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    VkBuffer GetBuffer() const { return m_buffer; }
+    VkDeviceSize GetFrameBytes() const { return m_offset; }
+    VkDeviceSize GetRegionSize() const { return m_regionSize; }
+    //Bytes handed out over the ring's life
+    uint64_t GetTotalBytes() const { return m_totalBytes; }
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    std::byte* m_mapped = nullptr;
+
+    uint32_t m_regionCount = 0;
+    VkDeviceSize m_regionSize = 0;
+    VkDeviceSize m_regionBase = 0;
+    VkDeviceSize m_offset = 0;
+    uint64_t m_totalBytes = 0;
+};
+
+#endif // !__STAGING_RING_H__
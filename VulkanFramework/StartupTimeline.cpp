@@ -0,0 +1,100 @@
+#include "StartupTimeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+void StartupTimeline::Begin()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_stages.clear();
+    m_origin = Now();
+    m_mainThread = std::this_thread::get_id();
+    m_lastMainStage = NO_STAGE;
+}
+
+int64_t StartupTimeline::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+StartupTimeline::StageId StartupTimeline::Record(const std::string& name, int64_t start, int64_t end, const std::vector<StageId>& deps)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stage stage;
+    stage.m_name = name;
+    stage.m_start = start - m_origin;
+    stage.m_end = end - m_origin;
+    stage.m_mainThread = std::this_thread::get_id() == m_mainThread;
+    for (StageId dep : deps)
+    {
+        if (dep != NO_STAGE)
+        {
+            stage.m_deps.push_back(dep);
+        }
+    }
+
+    m_stages.push_back(stage);
+
+    return static_cast<StageId>(m_stages.size() - 1);
+}
+
+void StartupTimeline::PrintReport(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_stages.empty())
+    {
+        return;
+    }
+
+    //The critical path ends at whatever finished last, and each step back is the
+    //dependency that finished last, since that's the one the stage actually waited for
+    std::vector<bool> critical(m_stages.size(), false);
+    StageId current = 0;
+    for (StageId i = 1; i < m_stages.size(); i++)
+    {
+        if (m_stages[i].m_end > m_stages[current].m_end)
+        {
+            current = i;
+        }
+    }
+
+    int64_t total = m_stages[current].m_end;
+    while (current != NO_STAGE)
+    {
+        critical[current] = true;
+
+        StageId next = NO_STAGE;
+        for (StageId dep : m_stages[current].m_deps)
+        {
+            if (next == NO_STAGE || m_stages[dep].m_end > m_stages[next].m_end)
+            {
+                next = dep;
+            }
+        }
+        current = next;
+    }
+
+    //Stages come in the order they finished, sorting by start reads like a timeline
+    std::vector<StageId> order(m_stages.size());
+    for (StageId i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](StageId a, StageId b) { return m_stages[a].m_start < m_stages[b].m_start; });
+
+    out << "startup (ms)                 start  duration" << std::endl;
+    for (StageId i : order)
+    {
+        const Stage& stage = m_stages[i];
+        out << (critical[i] ? " * " : "   ") << std::left << std::setw(24) << stage.m_name << std::right
+            << std::fixed << std::setprecision(2)
+            << std::setw(9) << stage.m_start / 1000000.0
+            << std::setw(10) << (stage.m_end - stage.m_start) / 1000000.0
+            << (stage.m_mainThread ? "" : "  (worker)") << std::endl;
+    }
+    out << "total " << std::fixed << std::setprecision(2) << total / 1000000.0 << " ms, * marks the critical path" << std::endl;
+}
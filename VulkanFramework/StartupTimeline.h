@@ -0,0 +1,70 @@
+#ifndef __STARTUP_TIMELINE_H__
+#define __STARTUP_TIMELINE_H__
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Times every startup stage and what it waited on, so the critical path to the first frame
+//can be worked out afterwards. Stages can be recorded from any thread.
+class StartupTimeline
+{
+public:
+    using StageId = uint32_t;
+    static const StageId NO_STAGE = UINT32_MAX;
+
+    //Everything is reported relative to this
+    void Begin();
+
+    //Runs a stage on the main chain, it depends on the previous main chain stage plus extraDeps
+    template<typename Func>
+    StageId RunStage(const std::string& name, Func&& func, const std::vector<StageId>& extraDeps = {})
+    {
+        std::vector<StageId> deps = extraDeps;
+        deps.push_back(m_lastMainStage);
+
+        m_lastMainStage = RunTask(name, deps, func);
+
+        return m_lastMainStage;
+    }
+
+    //Runs a stage off the main chain (usually on another thread), it only depends on deps
+    template<typename Func>
+    StageId RunTask(const std::string& name, const std::vector<StageId>& deps, Func&& func)
+    {
+        int64_t start = Now();
+        func();
+        int64_t end = Now();
+
+        return Record(name, start, end, deps);
+    }
+
+    StageId GetLastMainStage() const { return m_lastMainStage; }
+
+    //Every stage, with the ones on the critical path marked
+    void PrintReport(std::ostream& out) const;
+
+private:
+    struct Stage
+    {
+        std::string m_name;
+        int64_t m_start;
+        int64_t m_end;
+        std::vector<StageId> m_deps;
+        bool m_mainThread;
+    };
+
+    static int64_t Now();
+    StageId Record(const std::string& name, int64_t start, int64_t end, const std::vector<StageId>& deps);
+
+    mutable std::mutex m_mutex;
+    std::vector<Stage> m_stages;
+    int64_t m_origin = 0;
+    std::thread::id m_mainThread;
+    StageId m_lastMainStage = NO_STAGE;
+};
+
+#endif // !__STARTUP_TIMELINE_H__
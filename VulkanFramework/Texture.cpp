@@ -0,0 +1,468 @@
+#include "Texture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "TextureFile.h"
+#include "Tracer.h"
+#include "Util.h"
+
+namespace
+{
+    //Copy offsets have to be multiples of the texel block size, 16 covers every format
+    const VkDeviceSize STAGING_ALIGNMENT = 16;
+}
+
+bool IsTextureFormatSupported(const DeviceCaps& caps, VkFormat format)
+{
+    //Compressed formats are reported by the table too, as long as the feature bit is on
+    return caps.SupportsFormat(format, VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT);
+}
+
+void TextureLoader::Init(VkDevice device, const DeviceCaps* caps, VkCommandPool commandPool, QueueTimeline* timeline, DeletionQueue* deletionQueue,
+    MemoryBudget* budget)
+{
+    m_device = device;
+    m_caps = caps;
+    m_commandPool = commandPool;
+    m_timeline = timeline;
+    m_deletionQueue = deletionQueue;
+    m_budget = budget;
+    m_uploadedBytes = 0;
+}
+
+Texture TextureLoader::Load(const std::string& path, uint32_t skipLevels)
+{
+    TextureFile file;
+    file.Open(path);
+
+    return Load(file, skipLevels);
+}
+
+Texture TextureLoader::Load(TextureFile& file, uint32_t skipLevels)
+{
+    TRACE_SCOPE("LoadTexture");
+
+    uint32_t firstLevel = std::min(skipLevels, file.GetLevelCount() - 1);
+
+    Texture texture;
+    texture.m_format = file.GetFormat();
+    texture.m_firstLevel = firstLevel;
+    texture.m_extent = { file.GetLevelWidth(firstLevel), file.GetLevelHeight(firstLevel) };
+    texture.m_mipLevels = file.GetLevelCount() - firstLevel;
+
+    TextureCodec codec = TextureCodec::RGBA8;
+    bool srgb = false;
+    if (!IsTextureFormatSupported(*m_caps, texture.m_format))
+    {
+        if (!GetFormatCodec(texture.m_format, codec, srgb) || !CanDecode(codec) ||
+            !IsTextureFormatSupported(*m_caps, GetCodecFormat(TextureCodec::RGBA8, srgb)))
+        {
+            throw std::runtime_error("texture format isn't supported by the device!");
+        }
+
+        texture.m_format = GetCodecFormat(TextureCodec::RGBA8, srgb);
+        texture.m_decoded = true;
+    }
+
+    VkBuffer staging = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    std::vector<VkDeviceSize> offsets;
+    VkDeviceSize stagingSize = StageLevels(file, texture, texture.m_mipLevels, codec, staging, stagingMemory, offsets);
+
+    CreateImage(texture);
+
+    VkCommandBuffer cmd = BeginUpload();
+    RecordUpload(cmd, staging, texture, offsets.data());
+    texture.m_uploadValue = SubmitUpload(cmd, staging, stagingMemory);
+
+    m_uploadedBytes += stagingSize;
+
+    return texture;
+}
+
+void TextureLoader::Restream(Texture& texture, TextureFile& file, uint32_t firstLevel)
+{
+    TRACE_SCOPE("RestreamTexture");
+
+    firstLevel = std::min(firstLevel, file.GetLevelCount() - 1);
+    if (firstLevel == texture.m_firstLevel)
+    {
+        return;
+    }
+
+    Texture streamed;
+    streamed.m_format = texture.m_format;
+    streamed.m_decoded = texture.m_decoded;
+    streamed.m_firstLevel = firstLevel;
+    streamed.m_extent = { file.GetLevelWidth(firstLevel), file.GetLevelHeight(firstLevel) };
+    streamed.m_mipLevels = file.GetLevelCount() - firstLevel;
+
+    //Only levels finer than the old image's come from the file, the rest are copied over
+    uint32_t readLevels = texture.m_firstLevel > firstLevel ? texture.m_firstLevel - firstLevel : 0;
+
+    TextureCodec codec = TextureCodec::RGBA8;
+    bool srgb = false;
+    if (streamed.m_decoded)
+    {
+        GetFormatCodec(file.GetFormat(), codec, srgb);
+    }
+
+    VkBuffer staging = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    std::vector<VkDeviceSize> offsets;
+    VkDeviceSize stagingSize = 0;
+    if (readLevels != 0)
+    {
+        stagingSize = StageLevels(file, streamed, readLevels, codec, staging, stagingMemory, offsets);
+    }
+
+    CreateImage(streamed);
+
+    VkCommandBuffer cmd = BeginUpload();
+    RecordRestream(cmd, staging, texture, streamed, readLevels, offsets.data());
+    streamed.m_uploadValue = SubmitUpload(cmd, staging, stagingMemory);
+
+    //Frames submitted before the copy are the last that can sample the old image
+    m_deletionQueue->DestroyImageView(texture.m_view, streamed.m_uploadValue);
+    m_deletionQueue->DestroyImage(texture.m_image, streamed.m_uploadValue);
+    m_deletionQueue->FreeMemory(texture.m_memory, streamed.m_uploadValue);
+    if (m_budget != nullptr)
+    {
+        m_budget->Release(MemoryCategory::Texture, texture.m_memorySize);
+    }
+
+    m_uploadedBytes += stagingSize;
+
+    texture = streamed;
+}
+
+void TextureLoader::Destroy(Texture& texture)
+{
+    if (texture.m_image == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    m_deletionQueue->DestroyImageView(texture.m_view);
+    m_deletionQueue->DestroyImage(texture.m_image);
+    m_deletionQueue->FreeMemory(texture.m_memory);
+    if (m_budget != nullptr)
+    {
+        m_budget->Release(MemoryCategory::Texture, texture.m_memorySize);
+    }
+
+    texture = Texture();
+}
+
+VkDeviceSize TextureLoader::StageLevels(TextureFile& file, const Texture& texture, uint32_t levelCount, TextureCodec codec,
+    VkBuffer& staging, VkDeviceMemory& stagingMemory, std::vector<VkDeviceSize>& offsets)
+{
+    //Where each level goes in the staging buffer
+    offsets.resize(levelCount);
+    VkDeviceSize stagingSize = 0;
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        uint32_t level = texture.m_firstLevel + i;
+        stagingSize = (stagingSize + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+        offsets[i] = stagingSize;
+        stagingSize += texture.m_decoded ? GetCodecImageSize(TextureCodec::RGBA8, file.GetLevelWidth(level), file.GetLevelHeight(level)) : file.GetLevelSize(level);
+    }
+
+    CreateBuffer(stagingSize, staging, stagingMemory);
+
+    void* mapped = nullptr;
+    if (vkMapMemory(m_device, stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map texture staging memory!");
+    }
+
+    {
+        TRACE_SCOPE("ReadTextureLevels");
+
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            uint32_t level = texture.m_firstLevel + i;
+            uint8_t* dst = static_cast<uint8_t*>(mapped) + offsets[i];
+
+            if (!texture.m_decoded)
+            {
+                file.ReadLevel(level, dst);
+                continue;
+            }
+
+            std::vector<uint8_t> encoded(file.GetLevelSize(level));
+            file.ReadLevel(level, encoded.data());
+            std::vector<uint8_t> rgba = DecompressImage(codec, encoded.data(), file.GetLevelWidth(level), file.GetLevelHeight(level));
+            std::memcpy(dst, rgba.data(), rgba.size());
+        }
+    }
+
+    //Host coherent, the submit makes the writes visible
+    vkUnmapMemory(m_device, stagingMemory);
+
+    return stagingSize;
+}
+
+VkCommandBuffer TextureLoader::BeginUpload()
+{
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    if (vkAllocateCommandBuffers(m_device, &allocInfo, &cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate texture upload command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &beginInfo);
+
+    return cmd;
+}
+
+uint64_t TextureLoader::SubmitUpload(VkCommandBuffer cmd, VkBuffer staging, VkDeviceMemory stagingMemory)
+{
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record texture upload!");
+    }
+
+    QueueTimeline::Batch batch;
+    batch.m_commandBuffers = &cmd;
+    batch.m_commandBufferCount = 1;
+    uint64_t value = m_timeline->Submit(batch);
+
+    //Everything but the image itself is done with once the copy is
+    if (staging != VK_NULL_HANDLE)
+    {
+        m_deletionQueue->DestroyBuffer(staging, value);
+        m_deletionQueue->FreeMemory(stagingMemory, value);
+    }
+    VkDevice device = m_device;
+    VkCommandPool pool = m_commandPool;
+    m_deletionQueue->Defer([device, pool, cmd]()
+    {
+        vkFreeCommandBuffers(device, pool, 1, &cmd);
+    }, value);
+
+    return value;
+}
+
+void TextureLoader::CreateBuffer(VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture staging buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = Util::FindMemoryType(m_caps->GetMemoryProperties(), requirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate texture staging memory!");
+    }
+
+    vkBindBufferMemory(m_device, buffer, memory, 0);
+}
+
+void TextureLoader::CreateImage(Texture& texture)
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = texture.m_format;
+    imageInfo.extent = { texture.m_extent.width, texture.m_extent.height, 1 };
+    imageInfo.mipLevels = texture.m_mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    //Transfer source so Restream can copy the levels it keeps
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &texture.m_image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture image!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, texture.m_image, &requirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = Util::FindMemoryType(m_caps->GetMemoryProperties(), requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &texture.m_memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate texture memory!");
+    }
+
+    vkBindImageMemory(m_device, texture.m_image, texture.m_memory, 0);
+    texture.m_memorySize = requirements.size;
+    if (m_budget != nullptr)
+    {
+        m_budget->Track(MemoryCategory::Texture, requirements.size);
+    }
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture.m_image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = texture.m_format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = texture.m_mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &texture.m_view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture image view!");
+    }
+}
+
+void TextureLoader::RecordUpload(VkCommandBuffer cmd, VkBuffer staging, const Texture& texture, const VkDeviceSize* offsets)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture.m_image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = texture.m_mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    //Fresh image, nothing to wait for
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    //One region per level, row length 0 means tightly packed (whole blocks for compressed formats)
+    std::vector<VkBufferImageCopy> regions(texture.m_mipLevels);
+    for (uint32_t level = 0; level < texture.m_mipLevels; level++)
+    {
+        VkBufferImageCopy& region = regions[level];
+        region.bufferOffset = offsets[level];
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = { std::max(1u, texture.m_extent.width >> level), std::max(1u, texture.m_extent.height >> level), 1 };
+    }
+    vkCmdCopyBufferToImage(cmd, staging, texture.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    //Submission order on the queue covers later frames, the barrier covers the caches
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void TextureLoader::RecordRestream(VkCommandBuffer cmd, VkBuffer staging, const Texture& from, const Texture& to, uint32_t readLevels, const VkDeviceSize* offsets)
+{
+    VkImageMemoryBarrier barriers[2] = {};
+    for (VkImageMemoryBarrier& barrier : barriers)
+    {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+    }
+
+    //Earlier frames may still be sampling the old image
+    barriers[0].image = from.m_image;
+    barriers[0].subresourceRange.levelCount = from.m_mipLevels;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    barriers[1].image = to.m_image;
+    barriers[1].subresourceRange.levelCount = to.m_mipLevels;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 2, barriers);
+
+    //Levels both images have, whole subresources so compressed formats need no block rounding
+    std::vector<VkImageCopy> copies;
+    for (uint32_t level = std::max(from.m_firstLevel, to.m_firstLevel); level < to.m_firstLevel + to.m_mipLevels; level++)
+    {
+        uint32_t dstLevel = level - to.m_firstLevel;
+
+        VkImageCopy copy = {};
+        copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - from.m_firstLevel, 0, 1 };
+        copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, dstLevel, 0, 1 };
+        copy.extent = { std::max(1u, to.m_extent.width >> dstLevel), std::max(1u, to.m_extent.height >> dstLevel), 1 };
+        copies.push_back(copy);
+    }
+    vkCmdCopyImage(cmd, from.m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, to.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(copies.size()), copies.data());
+
+    //The finer levels the old image didn't have
+    std::vector<VkBufferImageCopy> regions(readLevels);
+    for (uint32_t level = 0; level < readLevels; level++)
+    {
+        VkBufferImageCopy& region = regions[level];
+        region.bufferOffset = offsets[level];
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = { std::max(1u, to.m_extent.width >> level), std::max(1u, to.m_extent.height >> level), 1 };
+    }
+    if (!regions.empty())
+    {
+        vkCmdCopyBufferToImage(cmd, staging, to.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    //Both end up sampleable, frames recorded before the caller switches over still use the old one
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 2, barriers);
+}
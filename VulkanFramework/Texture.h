@@ -0,0 +1,87 @@
+#ifndef __TEXTURE_H__
+#define __TEXTURE_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DeviceCaps.h"
+#include "DeletionQueue.h"
+#include "MemoryBudget.h"
+#include "QueueTimeline.h"
+#include "TextureFile.h"
+
+//A sampled 2D image with its whole mip chain, in SHADER_READ_ONLY_OPTIMAL once uploaded
+struct Texture
+{
+    VkImage m_image = VK_NULL_HANDLE;
+    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    VkImageView m_view = VK_NULL_HANDLE;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    VkExtent2D m_extent = {};
+    uint32_t m_mipLevels = 0;
+    //File level the image's level 0 is, non zero when the largest levels were left out
+    uint32_t m_firstLevel = 0;
+    //Size of m_memory, what the MemoryBudget was told
+    VkDeviceSize m_memorySize = 0;
+    //Graphics timeline value of the upload. Later submits on the graphics queue can sample it.
+    uint64_t m_uploadValue = 0;
+    //The file's format wasn't supported, it was decoded to RGBA8
+    bool m_decoded = false;
+};
+
+//Sampled with linear filtering in optimal tiling, straight from the format table
+bool IsTextureFormatSupported(const DeviceCaps& caps, VkFormat format);
+
+//Creates textures from TextureFiles. Each load reads the levels it keeps straight into a
+//staging buffer, copies them on the graphics queue and transitions the image for sampling.
+//The staging buffer and command buffer go to the deletion queue, so nothing waits on the GPU.
+//Formats the device can't sample are decoded to RGBA8 when TextureCompression has a decoder;
+//that costs four to eight times the memory, which is why compressed formats are worth having.
+//Restream changes which levels are resident after the fact, see TextureStreamer.
+//Main thread only, it records into the backend's command pool.
+class TextureLoader
+{
+public:
+    //Image memory is tracked as MemoryCategory::Texture when there's a budget
+    void Init(VkDevice device, const DeviceCaps* caps, VkCommandPool commandPool, QueueTimeline* timeline, DeletionQueue* deletionQueue,
+        MemoryBudget* budget = nullptr);
+
+    //skipLevels drops that many of the largest levels (always leaving one), their bytes are never read
+    Texture Load(const std::string& path, uint32_t skipLevels = 0);
+    Texture Load(TextureFile& file, uint32_t skipLevels = 0);
+    //Replaces the texture's image with one starting at file level firstLevel. Levels both have
+    //are copied on the GPU, only finer ones are read from file (the one it was loaded from).
+    //The old image stays valid for frames already submitted, later ones have to use the new view.
+    void Restream(Texture& texture, TextureFile& file, uint32_t firstLevel);
+    //Released once the frames that might sample it are done
+    void Destroy(Texture& texture);
+
+    //Staging bytes uploaded over the loader's life
+    uint64_t GetUploadedBytes() const { return m_uploadedBytes; }
+
+private:
+    void CreateBuffer(VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory);
+    void CreateImage(Texture& texture);
+    void RecordUpload(VkCommandBuffer cmd, VkBuffer staging, const Texture& texture, const VkDeviceSize* offsets);
+    void RecordRestream(VkCommandBuffer cmd, VkBuffer staging, const Texture& from, const Texture& to, uint32_t readLevels, const VkDeviceSize* offsets);
+    //Reads the texture's first levelCount levels into a new staging buffer, returns its size
+    VkDeviceSize StageLevels(TextureFile& file, const Texture& texture, uint32_t levelCount, TextureCodec codec,
+        VkBuffer& staging, VkDeviceMemory& stagingMemory, std::vector<VkDeviceSize>& offsets);
+    VkCommandBuffer BeginUpload();
+    //Submits on the timeline and queues the staging buffer and command buffer for deletion
+    uint64_t SubmitUpload(VkCommandBuffer cmd, VkBuffer staging, VkDeviceMemory stagingMemory);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    const DeviceCaps* m_caps = nullptr;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    QueueTimeline* m_timeline = nullptr;
+    DeletionQueue* m_deletionQueue = nullptr;
+    MemoryBudget* m_budget = nullptr;
+    uint64_t m_uploadedBytes = 0;
+};
+
+#endif // !__TEXTURE_H__
@@ -0,0 +1,839 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+namespace
+{
+    const uint32_t BLOCK_TEXELS = 16;
+    //Least squares passes over the endpoints after the first fit
+    const uint32_t REFINE_PASSES = 2;
+    //BC7 4 bit index weights, out of 64
+    const uint32_t BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    //Direction points spread out along the most, zero when they're all the same.
+    //Power iteration on the covariance, starting from the widest channel.
+    template<typename Vec, typename Mat>
+    Vec PrincipalAxis(const Vec* points, uint32_t count, const Vec& mean)
+    {
+        Mat covariance(0.0f);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Vec delta = points[i] - mean;
+            covariance += glm::outerProduct(delta, delta);
+        }
+
+        Vec axis(0.0f);
+        int widest = 0;
+        for (int c = 1; c < static_cast<int>(Vec::length()); c++)
+        {
+            if (covariance[c][c] > covariance[widest][widest])
+            {
+                widest = c;
+            }
+        }
+        axis[widest] = 1.0f;
+
+        for (int i = 0; i < 8; i++)
+        {
+            axis = covariance * axis;
+            float length = glm::length(axis);
+            if (length < 1e-6f)
+            {
+                return Vec(0.0f);
+            }
+            axis /= length;
+        }
+
+        return axis;
+    }
+
+    //Ends of the points' extent along axis, pulled in a little since the extremes are rarely worth exact hits
+    template<typename Vec, typename Mat>
+    void FitEndpoints(const Vec* points, uint32_t count, float insetFraction, Vec& end0, Vec& end1)
+    {
+        Vec mean(0.0f);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mean += points[i];
+        }
+        mean /= static_cast<float>(count);
+
+        Vec axis = PrincipalAxis<Vec, Mat>(points, count, mean);
+        float minProjection = 0.0f;
+        float maxProjection = 0.0f;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float projection = glm::dot(points[i] - mean, axis);
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+
+        float inset = (maxProjection - minProjection) * insetFraction;
+        end0 = glm::clamp(mean + axis * (maxProjection - inset), Vec(0.0f), Vec(255.0f));
+        end1 = glm::clamp(mean + axis * (minProjection + inset), Vec(0.0f), Vec(255.0f));
+    }
+
+    //Endpoints minimizing the squared error for fixed weights, weights[i] is texel i's share of end0.
+    //False if the weights don't pin the endpoints down (all the same).
+    template<typename Vec>
+    bool SolveEndpoints(const Vec* points, const float* weights, uint32_t count, Vec& end0, Vec& end1)
+    {
+        float aa = 0.0f;
+        float bb = 0.0f;
+        float ab = 0.0f;
+        Vec ax(0.0f);
+        Vec bx(0.0f);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float a = weights[i];
+            float b = 1.0f - a;
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+            ax += points[i] * a;
+            bx += points[i] * b;
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)
+        {
+            return false;
+        }
+
+        end0 = glm::clamp((ax * bb - bx * ab) / determinant, Vec(0.0f), Vec(255.0f));
+        end1 = glm::clamp((bx * aa - ax * ab) / determinant, Vec(0.0f), Vec(255.0f));
+        return true;
+    }
+
+    template<typename Vec>
+    float DistanceSquared(const Vec& a, const Vec& b)
+    {
+        Vec delta = a - b;
+        return glm::dot(delta, delta);
+    }
+
+    uint16_t Read16(const uint8_t* data)
+    {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    void Write16(uint8_t* data, uint16_t value)
+    {
+        data[0] = static_cast<uint8_t>(value);
+        data[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    //BC1
+
+    uint16_t To565(const glm::vec3& color)
+    {
+        int r = std::clamp(static_cast<int>(color.r * 31.0f / 255.0f + 0.5f), 0, 31);
+        int g = std::clamp(static_cast<int>(color.g * 63.0f / 255.0f + 0.5f), 0, 63);
+        int b = std::clamp(static_cast<int>(color.b * 31.0f / 255.0f + 0.5f), 0, 31);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    glm::ivec3 From565(uint16_t color)
+    {
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+        return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+    }
+
+    //Four colors, or three and transparent black. What the decoder produces, so the encoder measures against it.
+    void BuildBC1Palette(uint16_t c0, uint16_t c1, bool fourColor, glm::ivec3* palette)
+    {
+        palette[0] = From565(c0);
+        palette[1] = From565(c1);
+        if (fourColor)
+        {
+            palette[2] = (palette[0] * 2 + palette[1]) / 3;
+            palette[3] = (palette[0] + palette[1] * 2) / 3;
+        }
+        else
+        {
+            palette[2] = (palette[0] + palette[1]) / 2;
+            palette[3] = glm::ivec3(0);
+        }
+    }
+
+    struct BC1Fit
+    {
+        uint16_t m_c0 = 0;
+        uint16_t m_c1 = 0;
+        uint8_t m_indices[BLOCK_TEXELS] = {};
+        float m_error = 0.0f;
+    };
+
+    //Quantizes the endpoints, orders them for the mode wanted and picks every texel's index
+    BC1Fit FitBC1(const glm::vec3* colors, const bool* transparent, const glm::vec3& end0, const glm::vec3& end1, bool fourColor)
+    {
+        BC1Fit fit;
+        fit.m_c0 = To565(end0);
+        fit.m_c1 = To565(end1);
+
+        //The order of the endpoints is the mode, equal endpoints can only be 3 color
+        if (fourColor ? fit.m_c0 < fit.m_c1 : fit.m_c0 > fit.m_c1)
+        {
+            std::swap(fit.m_c0, fit.m_c1);
+        }
+        bool fourColorMode = fit.m_c0 > fit.m_c1;
+
+        glm::ivec3 palette[4];
+        BuildBC1Palette(fit.m_c0, fit.m_c1, fourColorMode, palette);
+        uint32_t colorCount = fourColorMode ? 4 : 3;
+
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+        {
+            if (transparent[i])
+            {
+                fit.m_indices[i] = 3;
+                continue;
+            }
+
+            float bestError = FLT_MAX;
+            for (uint32_t p = 0; p < colorCount; p++)
+            {
+                float error = DistanceSquared(colors[i], glm::vec3(palette[p]));
+                if (error < bestError)
+                {
+                    bestError = error;
+                    fit.m_indices[i] = static_cast<uint8_t>(p);
+                }
+            }
+            fit.m_error += bestError;
+        }
+
+        return fit;
+    }
+
+    //BC4
+
+    void BuildBC4Palette(uint8_t a0, uint8_t a1, uint8_t* palette)
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1)
+        {
+            for (int i = 1; i < 7; i++)
+            {
+                palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1 + 3) / 7);
+            }
+        }
+        else
+        {
+            for (int i = 1; i < 5; i++)
+            {
+                palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1 + 2) / 5);
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    //Picks indices for a0/a1 and writes the block, returns the squared error
+    uint32_t FitBC4(const uint8_t* values, size_t stride, uint8_t a0, uint8_t a1, uint8_t* out)
+    {
+        uint8_t palette[8];
+        BuildBC4Palette(a0, a1, palette);
+
+        uint64_t indices = 0;
+        uint32_t totalError = 0;
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+        {
+            int value = values[i * stride];
+            uint32_t bestError = UINT32_MAX;
+            uint64_t bestIndex = 0;
+            for (uint32_t p = 0; p < 8; p++)
+            {
+                uint32_t error = (value - palette[p]) * (value - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            indices |= bestIndex << (i * 3);
+            totalError += bestError;
+        }
+
+        out[0] = a0;
+        out[1] = a1;
+        for (int i = 0; i < 6; i++)
+        {
+            out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+        }
+
+        return totalError;
+    }
+
+    //BC7
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(uint8_t* out) : m_out(out) { std::memset(m_out, 0, 16); }
+
+        void Write(uint32_t value, uint32_t bits)
+        {
+            for (uint32_t i = 0; i < bits; i++, m_position++)
+            {
+                m_out[m_position >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (m_position & 7));
+            }
+        }
+
+    private:
+        uint8_t* m_out;
+        uint32_t m_position = 0;
+    };
+
+    class BitReader
+    {
+    public:
+        explicit BitReader(const uint8_t* data) : m_data(data) { }
+
+        uint32_t Read(uint32_t bits)
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < bits; i++, m_position++)
+            {
+                value |= ((m_data[m_position >> 3] >> (m_position & 7)) & 1u) << i;
+            }
+            return value;
+        }
+
+    private:
+        const uint8_t* m_data;
+        uint32_t m_position = 0;
+    };
+
+    //7 bit endpoint plus the shared low bit, as the decoder expands it
+    glm::ivec4 ExpandBC7Endpoint(const glm::ivec4& quantized, uint32_t pBit)
+    {
+        return (quantized << 1) | glm::ivec4(pBit);
+    }
+
+    //Best 7 bit endpoint and p-bit for an 8 bit color, the p-bit is shared by all four channels
+    void QuantizeBC7Endpoint(const glm::vec4& color, glm::ivec4& quantized, uint32_t& pBit)
+    {
+        float bestError = FLT_MAX;
+        for (uint32_t p = 0; p < 2; p++)
+        {
+            glm::ivec4 candidate = glm::clamp(glm::ivec4(glm::floor((color - static_cast<float>(p)) * 0.5f + 0.5f)), glm::ivec4(0), glm::ivec4(127));
+            float error = DistanceSquared(glm::vec4(ExpandBC7Endpoint(candidate, p)), color);
+            if (error < bestError)
+            {
+                bestError = error;
+                quantized = candidate;
+                pBit = p;
+            }
+        }
+    }
+
+    struct BC7Fit
+    {
+        glm::ivec4 m_endpoints[2];
+        uint32_t m_pBits[2] = {};
+        uint8_t m_indices[BLOCK_TEXELS] = {};
+        float m_error = 0.0f;
+    };
+
+    BC7Fit FitBC7(const glm::vec4* texels, const glm::vec4& end0, const glm::vec4& end1)
+    {
+        BC7Fit fit;
+        QuantizeBC7Endpoint(end0, fit.m_endpoints[0], fit.m_pBits[0]);
+        QuantizeBC7Endpoint(end1, fit.m_endpoints[1], fit.m_pBits[1]);
+
+        glm::ivec4 e0 = ExpandBC7Endpoint(fit.m_endpoints[0], fit.m_pBits[0]);
+        glm::ivec4 e1 = ExpandBC7Endpoint(fit.m_endpoints[1], fit.m_pBits[1]);
+        glm::vec4 palette[16];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            palette[i] = glm::vec4((e0 * static_cast<int>(64 - BC7_WEIGHTS[i]) + e1 * static_cast<int>(BC7_WEIGHTS[i]) + 32) >> 6);
+        }
+
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+        {
+            float bestError = FLT_MAX;
+            for (uint32_t p = 0; p < 16; p++)
+            {
+                float error = DistanceSquared(texels[i], palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    fit.m_indices[i] = static_cast<uint8_t>(p);
+                }
+            }
+            fit.m_error += bestError;
+        }
+
+        return fit;
+    }
+
+    //Texels of the block at (blockX, blockY), edges repeat the last row and column
+    void GatherBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t* texels)
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+                std::memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+            }
+        }
+    }
+}
+
+const char* GetTextureCodecName(TextureCodec codec)
+{
+    switch (codec)
+    {
+    case TextureCodec::RGBA8: return "rgba8";
+    case TextureCodec::BC1: return "bc1";
+    case TextureCodec::BC3: return "bc3";
+    case TextureCodec::BC4: return "bc4";
+    case TextureCodec::BC5: return "bc5";
+    case TextureCodec::BC7: return "bc7";
+    case TextureCodec::ASTC4x4: return "astc4x4";
+    }
+
+    return "unknown";
+}
+
+bool ParseTextureCodec(const std::string& name, TextureCodec& codec)
+{
+    const TextureCodec codecs[] = { TextureCodec::RGBA8, TextureCodec::BC1, TextureCodec::BC3, TextureCodec::BC4, TextureCodec::BC5, TextureCodec::BC7, TextureCodec::ASTC4x4 };
+    for (TextureCodec candidate : codecs)
+    {
+        if (name == GetTextureCodecName(candidate))
+        {
+            codec = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool IsBlockCompressed(TextureCodec codec)
+{
+    return codec != TextureCodec::RGBA8;
+}
+
+uint32_t GetCodecBlockBytes(TextureCodec codec)
+{
+    switch (codec)
+    {
+    case TextureCodec::BC1:
+    case TextureCodec::BC4:
+        return 8;
+    case TextureCodec::BC3:
+    case TextureCodec::BC5:
+    case TextureCodec::BC7:
+    case TextureCodec::ASTC4x4:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+size_t GetCodecImageSize(TextureCodec codec, uint32_t width, uint32_t height)
+{
+    if (!IsBlockCompressed(codec))
+    {
+        return static_cast<size_t>(width) * height * 4;
+    }
+
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetCodecBlockBytes(codec);
+}
+
+bool CanEncode(TextureCodec codec)
+{
+    return codec != TextureCodec::ASTC4x4;
+}
+
+bool CanDecode(TextureCodec codec)
+{
+    return codec != TextureCodec::ASTC4x4;
+}
+
+std::vector<uint8_t> CompressImage(TextureCodec codec, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    if (!CanEncode(codec))
+    {
+        throw std::runtime_error("no encoder for this texture codec!");
+    }
+
+    if (!IsBlockCompressed(codec))
+    {
+        return std::vector<uint8_t>(rgba, rgba + static_cast<size_t>(width) * height * 4);
+    }
+
+    std::vector<uint8_t> data(GetCodecImageSize(codec, width, height));
+    uint32_t blockBytes = GetCodecBlockBytes(codec);
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+
+    uint8_t texels[BLOCK_TEXELS * 4];
+    for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            GatherBlock(rgba, width, height, blockX, blockY, texels);
+            uint8_t* out = data.data() + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes;
+
+            switch (codec)
+            {
+            case TextureCodec::BC1: EncodeBC1Block(texels, out); break;
+            case TextureCodec::BC3: EncodeBC3Block(texels, out); break;
+            case TextureCodec::BC4: EncodeBC4Block(texels, 4, out); break;
+            case TextureCodec::BC5: EncodeBC5Block(texels, out); break;
+            case TextureCodec::BC7: EncodeBC7Block(texels, out); break;
+            default: break;
+            }
+        }
+    }
+
+    return data;
+}
+
+std::vector<uint8_t> DecompressImage(TextureCodec codec, const uint8_t* data, uint32_t width, uint32_t height)
+{
+    if (!CanDecode(codec))
+    {
+        throw std::runtime_error("no decoder for this texture codec!");
+    }
+
+    if (!IsBlockCompressed(codec))
+    {
+        return std::vector<uint8_t>(data, data + static_cast<size_t>(width) * height * 4);
+    }
+
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    uint32_t blockBytes = GetCodecBlockBytes(codec);
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+
+    uint8_t texels[BLOCK_TEXELS * 4];
+    for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            const uint8_t* block = data + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes;
+
+            //Single and dual channel codecs leave the rest to the defaults
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+            {
+                texels[i * 4 + 0] = 0;
+                texels[i * 4 + 1] = 0;
+                texels[i * 4 + 2] = 0;
+                texels[i * 4 + 3] = 255;
+            }
+
+            switch (codec)
+            {
+            case TextureCodec::BC1: DecodeBC1Block(block, texels); break;
+            case TextureCodec::BC3: DecodeBC3Block(block, texels); break;
+            case TextureCodec::BC4: DecodeBC4Block(block, texels, 4); break;
+            case TextureCodec::BC5: DecodeBC5Block(block, texels); break;
+            case TextureCodec::BC7: DecodeBC7Block(block, texels); break;
+            default: break;
+            }
+
+            //Edge blocks only have some of their texels in the image
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+            {
+                uint32_t rowTexels = std::min(4u, width - blockX * 4);
+                std::memcpy(rgba.data() + ((static_cast<size_t>(blockY) * 4 + y) * width + blockX * 4) * 4, texels + y * 16, rowTexels * 4);
+            }
+        }
+    }
+
+    return rgba;
+}
+
+void EncodeBC1Block(const uint8_t* texels, uint8_t* out, bool allowAlpha)
+{
+    glm::vec3 colors[BLOCK_TEXELS];
+    bool transparent[BLOCK_TEXELS];
+    glm::vec3 opaque[BLOCK_TEXELS];
+    uint32_t opaqueCount = 0;
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        colors[i] = glm::vec3(texels[i * 4 + 0], texels[i * 4 + 1], texels[i * 4 + 2]);
+        transparent[i] = allowAlpha && texels[i * 4 + 3] < 128;
+        if (!transparent[i])
+        {
+            opaque[opaqueCount++] = colors[i];
+        }
+    }
+
+    //Nothing but transparent texels, equal endpoints select the 3 color mode
+    if (opaqueCount == 0)
+    {
+        Write16(out, 0);
+        Write16(out + 2, 0);
+        std::memset(out + 4, 0xFF, 4);
+        return;
+    }
+
+    //The 3 color mode is the only one with a transparent index
+    bool fourColor = opaqueCount == BLOCK_TEXELS;
+
+    glm::vec3 end0;
+    glm::vec3 end1;
+    FitEndpoints<glm::vec3, glm::mat3>(opaque, opaqueCount, 1.0f / 16.0f, end0, end1);
+    BC1Fit best = FitBC1(colors, transparent, end0, end1, fourColor);
+
+    //Fixing the indices and solving for the endpoints usually finds a bit more
+    for (uint32_t pass = 0; pass < REFINE_PASSES && best.m_error > 0.0f; pass++)
+    {
+        bool fourColorMode = best.m_c0 > best.m_c1;
+        const float fourColorWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        const float threeColorWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+
+        float weights[BLOCK_TEXELS];
+        uint32_t weightCount = 0;
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+        {
+            if (!transparent[i])
+            {
+                weights[weightCount++] = (fourColorMode ? fourColorWeights : threeColorWeights)[best.m_indices[i]];
+            }
+        }
+
+        if (!SolveEndpoints(opaque, weights, opaqueCount, end0, end1))
+        {
+            break;
+        }
+
+        BC1Fit refined = FitBC1(colors, transparent, end0, end1, fourColor);
+        if (refined.m_error >= best.m_error)
+        {
+            break;
+        }
+        best = refined;
+    }
+
+    uint32_t indices = 0;
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        indices |= static_cast<uint32_t>(best.m_indices[i]) << (i * 2);
+    }
+
+    Write16(out, best.m_c0);
+    Write16(out + 2, best.m_c1);
+    Write16(out + 4, static_cast<uint16_t>(indices));
+    Write16(out + 6, static_cast<uint16_t>(indices >> 16));
+}
+
+void EncodeBC4Block(const uint8_t* values, size_t stride, uint8_t* out)
+{
+    uint8_t low = 255;
+    uint8_t high = 0;
+    //Range without the two values the 6 value mode has for free
+    uint8_t innerLow = 255;
+    uint8_t innerHigh = 0;
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        uint8_t value = values[i * stride];
+        low = std::min(low, value);
+        high = std::max(high, value);
+        if (value != 0 && value != 255)
+        {
+            innerLow = std::min(innerLow, value);
+            innerHigh = std::max(innerHigh, value);
+        }
+    }
+
+    //8 interpolated values between the extremes
+    uint32_t error = FitBC4(values, stride, high, low, out);
+
+    //6 values over the rest, plus exact 0 and 255. Wins for masks and anything clipped.
+    if (error != 0 && (low == 0 || high == 255))
+    {
+        if (innerLow > innerHigh)
+        {
+            innerLow = innerHigh = 0;
+        }
+
+        uint8_t candidate[8];
+        if (FitBC4(values, stride, innerLow, innerHigh, candidate) < error)
+        {
+            std::memcpy(out, candidate, 8);
+        }
+    }
+}
+
+void EncodeBC3Block(const uint8_t* texels, uint8_t* out)
+{
+    EncodeBC4Block(texels + 3, 4, out);
+    EncodeBC1Block(texels, out + 8, false);
+}
+
+void EncodeBC5Block(const uint8_t* texels, uint8_t* out)
+{
+    EncodeBC4Block(texels + 0, 4, out);
+    EncodeBC4Block(texels + 1, 4, out + 8);
+}
+
+void EncodeBC7Block(const uint8_t* texels, uint8_t* out)
+{
+    //Mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4 bit indices.
+    //Fits smooth blocks with alpha well, which covers most of what textures are.
+    glm::vec4 colors[BLOCK_TEXELS];
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        colors[i] = glm::vec4(texels[i * 4 + 0], texels[i * 4 + 1], texels[i * 4 + 2], texels[i * 4 + 3]);
+    }
+
+    glm::vec4 end0;
+    glm::vec4 end1;
+    FitEndpoints<glm::vec4, glm::mat4>(colors, BLOCK_TEXELS, 1.0f / 32.0f, end0, end1);
+    BC7Fit best = FitBC7(colors, end0, end1);
+
+    for (uint32_t pass = 0; pass < REFINE_PASSES && best.m_error > 0.0f; pass++)
+    {
+        float weights[BLOCK_TEXELS];
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+        {
+            weights[i] = 1.0f - BC7_WEIGHTS[best.m_indices[i]] / 64.0f;
+        }
+
+        if (!SolveEndpoints(colors, weights, BLOCK_TEXELS, end0, end1))
+        {
+            break;
+        }
+
+        BC7Fit refined = FitBC7(colors, end0, end1);
+        if (refined.m_error >= best.m_error)
+        {
+            break;
+        }
+        best = refined;
+    }
+
+    //The first texel's index has its top bit implied 0, swapping the endpoints gets it there
+    if (best.m_indices[0] & 8)
+    {
+        std::swap(best.m_endpoints[0], best.m_endpoints[1]);
+        std::swap(best.m_pBits[0], best.m_pBits[1]);
+        for (uint8_t& index : best.m_indices)
+        {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    BitWriter writer(out);
+    writer.Write(1 << 6, 7);
+    for (int channel = 0; channel < 4; channel++)
+    {
+        writer.Write(best.m_endpoints[0][channel], 7);
+        writer.Write(best.m_endpoints[1][channel], 7);
+    }
+    writer.Write(best.m_pBits[0], 1);
+    writer.Write(best.m_pBits[1], 1);
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        writer.Write(best.m_indices[i], i == 0 ? 3 : 4);
+    }
+}
+
+void DecodeBC1Block(const uint8_t* block, uint8_t* texels, bool forceFourColor)
+{
+    uint16_t c0 = Read16(block);
+    uint16_t c1 = Read16(block + 2);
+    uint32_t indices = Read16(block + 4) | (static_cast<uint32_t>(Read16(block + 6)) << 16);
+
+    bool fourColor = forceFourColor || c0 > c1;
+    glm::ivec3 palette[4];
+    BuildBC1Palette(c0, c1, fourColor, palette);
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        uint32_t index = (indices >> (i * 2)) & 3;
+        texels[i * 4 + 0] = static_cast<uint8_t>(palette[index].r);
+        texels[i * 4 + 1] = static_cast<uint8_t>(palette[index].g);
+        texels[i * 4 + 2] = static_cast<uint8_t>(palette[index].b);
+        if (!forceFourColor)
+        {
+            texels[i * 4 + 3] = !fourColor && index == 3 ? 0 : 255;
+        }
+    }
+}
+
+void DecodeBC4Block(const uint8_t* block, uint8_t* values, size_t stride)
+{
+    uint8_t palette[8];
+    BuildBC4Palette(block[0], block[1], palette);
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+    }
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        values[i * stride] = palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+void DecodeBC3Block(const uint8_t* block, uint8_t* texels)
+{
+    DecodeBC1Block(block + 8, texels, true);
+    DecodeBC4Block(block, texels + 3, 4);
+}
+
+void DecodeBC5Block(const uint8_t* block, uint8_t* texels)
+{
+    DecodeBC4Block(block, texels + 0, 4);
+    DecodeBC4Block(block + 8, texels + 1, 4);
+}
+
+void DecodeBC7Block(const uint8_t* block, uint8_t* texels)
+{
+    BitReader reader(block);
+
+    //The mode is the number of zero bits before the first one
+    uint32_t mode = 0;
+    while (mode < 8 && reader.Read(1) == 0)
+    {
+        mode++;
+    }
+    if (mode != 6)
+    {
+        throw std::runtime_error("BC7 block uses a mode the CPU decoder doesn't handle!");
+    }
+
+    glm::ivec4 endpoints[2];
+    for (int channel = 0; channel < 4; channel++)
+    {
+        endpoints[0][channel] = reader.Read(7);
+        endpoints[1][channel] = reader.Read(7);
+    }
+    uint32_t p0 = reader.Read(1);
+    uint32_t p1 = reader.Read(1);
+    glm::ivec4 e0 = ExpandBC7Endpoint(endpoints[0], p0);
+    glm::ivec4 e1 = ExpandBC7Endpoint(endpoints[1], p1);
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        int weight = static_cast<int>(BC7_WEIGHTS[reader.Read(i == 0 ? 3 : 4)]);
+        glm::ivec4 color = (e0 * (64 - weight) + e1 * weight + 32) >> 6;
+        for (int channel = 0; channel < 4; channel++)
+        {
+            texels[i * 4 + channel] = static_cast<uint8_t>(color[channel]);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef __TEXTURE_COMPRESSION_H__
+#define __TEXTURE_COMPRESSION_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//How texel data is stored. Everything but RGBA8 is 4x4 blocks.
+enum class TextureCodec : uint8_t
+{
+    RGBA8,
+    //RGB plus 1 bit alpha, 8 bytes a block
+    BC1,
+    //BC1 color with a BC4 alpha block, 16 bytes
+    BC3,
+    //One channel, 8 bytes
+    BC4,
+    //Two independent BC4 channels, 16 bytes. Normal maps.
+    BC5,
+    //RGBA, 16 bytes. Only mode 6 is encoded (and decoded).
+    BC7,
+    //Loads from files made by other tools, there is no encoder here
+    ASTC4x4
+};
+
+const char* GetTextureCodecName(TextureCodec codec);
+//Lowercase names as printed by GetTextureCodecName, false if unknown
+bool ParseTextureCodec(const std::string& name, TextureCodec& codec);
+
+bool IsBlockCompressed(TextureCodec codec);
+//Bytes per 4x4 block, or per texel for RGBA8
+uint32_t GetCodecBlockBytes(TextureCodec codec);
+//Whole image, partial blocks at the edges included
+size_t GetCodecImageSize(TextureCodec codec, uint32_t width, uint32_t height);
+
+bool CanEncode(TextureCodec codec);
+bool CanDecode(TextureCodec codec);
+
+//rgba is width * height tightly packed RGBA8 texels. Edge blocks repeat the last row and column.
+std::vector<uint8_t> CompressImage(TextureCodec codec, const uint8_t* rgba, uint32_t width, uint32_t height);
+//Back to RGBA8, for devices without the format. BC4 decodes to R, BC5 to RG, the rest of
+//the channel is 0 with alpha 255.
+std::vector<uint8_t> DecompressImage(TextureCodec codec, const uint8_t* data, uint32_t width, uint32_t height);
+
+//Single blocks. texels are 16 RGBA8 texels in row order.
+//allowAlpha lets BC1 use its 3 color mode for texels with alpha below 128, BC3's color block can't
+void EncodeBC1Block(const uint8_t* texels, uint8_t* out, bool allowAlpha = true);
+//values are 16 bytes stride apart
+void EncodeBC4Block(const uint8_t* values, size_t stride, uint8_t* out);
+void EncodeBC3Block(const uint8_t* texels, uint8_t* out);
+void EncodeBC5Block(const uint8_t* texels, uint8_t* out);
+void EncodeBC7Block(const uint8_t* texels, uint8_t* out);
+
+//forceFourColor is how BC3 reads its color block, whatever the endpoint order
+void DecodeBC1Block(const uint8_t* block, uint8_t* texels, bool forceFourColor = false);
+//Writes 16 values stride bytes apart
+void DecodeBC4Block(const uint8_t* block, uint8_t* values, size_t stride);
+void DecodeBC3Block(const uint8_t* block, uint8_t* texels);
+void DecodeBC5Block(const uint8_t* block, uint8_t* texels);
+//Throws for anything but mode 6
+void DecodeBC7Block(const uint8_t* block, uint8_t* texels);
+
+#endif // !__TEXTURE_COMPRESSION_H__
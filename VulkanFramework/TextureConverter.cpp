@@ -0,0 +1,232 @@
+#include "TextureConverter.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include "JobSystem.h"
+#include "TextureFile.h"
+#include "Tracer.h"
+
+namespace
+{
+    //Rows per encoding job, a multiple of the block height so strips are whole blocks
+    const uint32_t STRIP_ROWS = 64;
+
+    float SrgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSrgb(float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    //Skips whitespace and # comments between PPM header fields
+    uint32_t ReadHeaderValue(std::istream& file)
+    {
+        file >> std::ws;
+        while (file.peek() == '#')
+        {
+            std::string comment;
+            std::getline(file, comment);
+            file >> std::ws;
+        }
+
+        uint32_t value = 0;
+        file >> value;
+        return value;
+    }
+}
+
+ImageData LoadImageFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open image file!");
+    }
+
+    std::string magic;
+    file >> magic;
+
+    ImageData image;
+    uint32_t channels = 0;
+    uint32_t maxValue = 0;
+
+    if (magic == "P6")
+    {
+        image.m_width = ReadHeaderValue(file);
+        image.m_height = ReadHeaderValue(file);
+        maxValue = ReadHeaderValue(file);
+        channels = 3;
+    }
+    else if (magic == "P7")
+    {
+        //Tagged header lines up to ENDHDR, TUPLTYPE follows from DEPTH for the types read here
+        std::string tag;
+        while (file >> tag && tag != "ENDHDR")
+        {
+            if (tag == "WIDTH") file >> image.m_width;
+            else if (tag == "HEIGHT") file >> image.m_height;
+            else if (tag == "DEPTH") file >> channels;
+            else if (tag == "MAXVAL") file >> maxValue;
+            else
+            {
+                std::string rest;
+                std::getline(file, rest);
+            }
+        }
+    }
+    else
+    {
+        throw std::runtime_error("image file isn't a binary PPM or PAM!");
+    }
+
+    if (image.m_width == 0 || image.m_height == 0 || maxValue != 255 || channels < 1 || channels > 4)
+    {
+        throw std::runtime_error("unsupported image file header!");
+    }
+
+    //Exactly one whitespace character separates the header from the pixels
+    file.get();
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(image.m_width) * image.m_height * channels);
+    file.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+    if (!file)
+    {
+        throw std::runtime_error("image file is truncated!");
+    }
+
+    //Gray, gray + alpha, RGB or RGBA
+    image.m_rgba.resize(static_cast<size_t>(image.m_width) * image.m_height * 4);
+    for (size_t i = 0; i < static_cast<size_t>(image.m_width) * image.m_height; i++)
+    {
+        const uint8_t* src = pixels.data() + i * channels;
+        uint8_t* dst = image.m_rgba.data() + i * 4;
+        bool color = channels >= 3;
+        dst[0] = src[0];
+        dst[1] = color ? src[1] : src[0];
+        dst[2] = color ? src[2] : src[0];
+        dst[3] = channels == 2 || channels == 4 ? src[channels - 1] : 255;
+    }
+
+    return image;
+}
+
+std::vector<ImageData> GenerateMipChain(const ImageData& image, bool srgb)
+{
+    std::array<float, 256> toLinear;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        toLinear[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+    }
+
+    std::vector<ImageData> levels;
+    levels.push_back(image);
+
+    while (levels.back().m_width > 1 || levels.back().m_height > 1)
+    {
+        const ImageData& source = levels.back();
+        ImageData level;
+        level.m_width = std::max(1u, source.m_width / 2);
+        level.m_height = std::max(1u, source.m_height / 2);
+        level.m_rgba.resize(static_cast<size_t>(level.m_width) * level.m_height * 4);
+
+        for (uint32_t y = 0; y < level.m_height; y++)
+        {
+            for (uint32_t x = 0; x < level.m_width; x++)
+            {
+                //Clamped, for a side that's already 1
+                uint32_t x0 = std::min(x * 2, source.m_width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, source.m_width - 1);
+                uint32_t y0 = std::min(y * 2, source.m_height - 1);
+                uint32_t y1 = std::min(y * 2 + 1, source.m_height - 1);
+                const uint8_t* texels[4] =
+                {
+                    source.m_rgba.data() + (static_cast<size_t>(y0) * source.m_width + x0) * 4,
+                    source.m_rgba.data() + (static_cast<size_t>(y0) * source.m_width + x1) * 4,
+                    source.m_rgba.data() + (static_cast<size_t>(y1) * source.m_width + x0) * 4,
+                    source.m_rgba.data() + (static_cast<size_t>(y1) * source.m_width + x1) * 4
+                };
+
+                uint8_t* dst = level.m_rgba.data() + (static_cast<size_t>(y) * level.m_width + x) * 4;
+                for (uint32_t channel = 0; channel < 3; channel++)
+                {
+                    float sum = 0.0f;
+                    for (const uint8_t* texel : texels)
+                    {
+                        sum += toLinear[texel[channel]];
+                    }
+                    float value = srgb ? LinearToSrgb(sum * 0.25f) : sum * 0.25f;
+                    dst[channel] = static_cast<uint8_t>(std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f));
+                }
+
+                uint32_t alpha = 0;
+                for (const uint8_t* texel : texels)
+                {
+                    alpha += texel[3];
+                }
+                dst[3] = static_cast<uint8_t>((alpha + 2) / 4);
+            }
+        }
+
+        levels.push_back(std::move(level));
+    }
+
+    return levels;
+}
+
+void ConvertTexture(const std::string& input, const std::string& output, const TextureConvertOptions& options, std::ostream& out)
+{
+    TRACE_SCOPE("ConvertTexture");
+
+    if (!CanEncode(options.m_codec))
+    {
+        throw std::runtime_error("the converter has no encoder for this codec!");
+    }
+
+    ImageData image = LoadImageFile(input);
+    std::vector<ImageData> mips = options.m_generateMips ? GenerateMipChain(image, options.m_srgb) : std::vector<ImageData>{ image };
+
+    //Strips are whole block rows, so encoding them separately gives the same bytes as one go
+    std::vector<std::vector<uint8_t>> levels(mips.size());
+    std::vector<JobHandle> jobs;
+    JobSystem* jobSystem = JobSystem::GetInstance();
+    for (size_t i = 0; i < mips.size(); i++)
+    {
+        const ImageData& mip = mips[i];
+        levels[i].resize(GetCodecImageSize(options.m_codec, mip.m_width, mip.m_height));
+
+        for (uint32_t y = 0; y < mip.m_height; y += STRIP_ROWS)
+        {
+            jobs.push_back(jobSystem->Submit("EncodeTextureStrip", [&options, &mip, &level = levels[i], y]()
+            {
+                uint32_t rows = std::min(STRIP_ROWS, mip.m_height - y);
+                std::vector<uint8_t> strip = CompressImage(options.m_codec, mip.m_rgba.data() + static_cast<size_t>(y) * mip.m_width * 4, mip.m_width, rows);
+                std::copy(strip.begin(), strip.end(), level.begin() + GetCodecImageSize(options.m_codec, mip.m_width, y));
+            }));
+        }
+    }
+    for (const JobHandle& job : jobs)
+    {
+        jobSystem->Wait(job);
+    }
+
+    TextureFile::Write(output, GetCodecFormat(options.m_codec, options.m_srgb), image.m_width, image.m_height, levels);
+
+    size_t encodedSize = 0;
+    size_t rgbaSize = 0;
+    for (size_t i = 0; i < mips.size(); i++)
+    {
+        encodedSize += levels[i].size();
+        rgbaSize += mips[i].m_rgba.size();
+    }
+
+    out << "texture: " << input << " -> " << output << ", " << GetTextureCodecName(options.m_codec) << (options.m_srgb ? " srgb" : "")
+        << ", " << image.m_width << "x" << image.m_height << ", " << levels.size() << " levels, " << encodedSize / 1024 << " KiB ("
+        << static_cast<double>(rgbaSize) / encodedSize << "x smaller than RGBA8)" << std::endl;
+}
@@ -0,0 +1,39 @@
+#ifndef __TEXTURE_CONVERTER_H__
+#define __TEXTURE_CONVERTER_H__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "TextureCompression.h"
+
+//Tightly packed RGBA8
+struct ImageData
+{
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    std::vector<uint8_t> m_rgba;
+};
+
+//Binary PPM (P6) or PAM (P7) with 8 bit channels, what Game::WriteImage and most image tools
+//can write. Anything without alpha comes in with alpha 255.
+ImageData LoadImageFile(const std::string& path);
+
+//Every level down to 1x1, level 0 is a copy of image. 2x2 box filter; odd sizes drop their
+//last row or column. Color is averaged in linear space when srgb is set, alpha never is.
+std::vector<ImageData> GenerateMipChain(const ImageData& image, bool srgb);
+
+struct TextureConvertOptions
+{
+    TextureCodec m_codec = TextureCodec::BC7;
+    //Color data, stored in an _SRGB format and filtered in linear space. Off for normal maps and masks.
+    bool m_srgb = false;
+    bool m_generateMips = true;
+};
+
+//Offline conversion of an image into a TextureFile, every level encoded ahead of time so
+//loading is a copy. Strips of each level encode in parallel on the job system.
+void ConvertTexture(const std::string& input, const std::string& output, const TextureConvertOptions& options, std::ostream& out);
+
+#endif // !__TEXTURE_CONVERTER_H__
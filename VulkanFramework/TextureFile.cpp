@@ -0,0 +1,245 @@
+#include "TextureFile.h"
+
+#include <stdexcept>
+
+namespace
+{
+    const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    //Level data offsets are kept to this, enough for every block and texel size
+    const uint64_t LEVEL_ALIGNMENT = 16;
+
+    //Field for field the KTX2 header and index, all little endian like the platforms this runs on
+    struct Ktx2Header
+    {
+        uint8_t m_identifier[12];
+        uint32_t m_vkFormat;
+        uint32_t m_typeSize;
+        uint32_t m_pixelWidth;
+        uint32_t m_pixelHeight;
+        uint32_t m_pixelDepth;
+        uint32_t m_layerCount;
+        uint32_t m_faceCount;
+        uint32_t m_levelCount;
+        uint32_t m_supercompressionScheme;
+        uint32_t m_dfdByteOffset;
+        uint32_t m_dfdByteLength;
+        uint32_t m_kvdByteOffset;
+        uint32_t m_kvdByteLength;
+        uint64_t m_sgdByteOffset;
+        uint64_t m_sgdByteLength;
+    };
+    static_assert(sizeof(Ktx2Header) == 80, "KTX2 header has to match the file layout");
+
+    struct Ktx2Level
+    {
+        uint64_t m_byteOffset;
+        uint64_t m_byteLength;
+        uint64_t m_uncompressedByteLength;
+    };
+    static_assert(sizeof(Ktx2Level) == 24, "KTX2 level index has to match the file layout");
+
+    struct FormatEntry
+    {
+        TextureCodec m_codec;
+        VkFormat m_unorm;
+        VkFormat m_srgb;
+    };
+
+    const FormatEntry FORMATS[] =
+    {
+        { TextureCodec::RGBA8, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_SRGB },
+        { TextureCodec::BC1, VK_FORMAT_BC1_RGBA_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK },
+        { TextureCodec::BC3, VK_FORMAT_BC3_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK },
+        { TextureCodec::BC4, VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_BC4_UNORM_BLOCK },
+        { TextureCodec::BC5, VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC5_UNORM_BLOCK },
+        { TextureCodec::BC7, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK },
+        { TextureCodec::ASTC4x4, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK }
+    };
+}
+
+void TextureFile::Write(const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels)
+{
+    Ktx2Header header = {};
+    std::copy(std::begin(KTX2_IDENTIFIER), std::end(KTX2_IDENTIFIER), header.m_identifier);
+    header.m_vkFormat = static_cast<uint32_t>(format);
+    //1 for block compressed formats, and for the 8 bit ones there are
+    header.m_typeSize = 1;
+    header.m_pixelWidth = width;
+    header.m_pixelHeight = height;
+    header.m_faceCount = 1;
+    header.m_levelCount = static_cast<uint32_t>(levels.size());
+
+    //Smallest level first, so a reader streaming from the tail up has its first usable mip soonest
+    std::vector<Ktx2Level> index(levels.size());
+    uint64_t offset = sizeof(Ktx2Header) + sizeof(Ktx2Level) * levels.size();
+    for (size_t level = levels.size(); level-- > 0;)
+    {
+        offset = (offset + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+        index[level].m_byteOffset = offset;
+        index[level].m_byteLength = levels[level].size();
+        index[level].m_uncompressedByteLength = levels[level].size();
+        offset += levels[level].size();
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open texture file for writing!");
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), sizeof(Ktx2Level) * index.size());
+
+    for (size_t level = levels.size(); level-- > 0;)
+    {
+        //Padding up to the level's offset
+        uint64_t position = static_cast<uint64_t>(file.tellp());
+        const char padding[LEVEL_ALIGNMENT] = {};
+        file.write(padding, index[level].m_byteOffset - position);
+        file.write(reinterpret_cast<const char*>(levels[level].data()), levels[level].size());
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("failed to write texture file!");
+    }
+}
+
+void TextureFile::Open(const std::string& path)
+{
+    Close();
+    m_file.clear();
+    m_file.open(path, std::ios::binary);
+    if (!m_file.is_open())
+    {
+        throw std::runtime_error("failed to open texture file!");
+    }
+
+    Ktx2Header header = {};
+    m_file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!m_file || !std::equal(std::begin(KTX2_IDENTIFIER), std::end(KTX2_IDENTIFIER), header.m_identifier))
+    {
+        throw std::runtime_error("not a KTX2 texture file!");
+    }
+
+    //2D, one layer, one face and stored plainly is all the loader handles
+    if (header.m_pixelDepth > 1 || header.m_layerCount > 1 || header.m_faceCount != 1 ||
+        header.m_supercompressionScheme != 0 || header.m_pixelWidth == 0 || header.m_pixelHeight == 0)
+    {
+        throw std::runtime_error("unsupported texture file layout!");
+    }
+
+    //Level sizes are checked against the format, which needs to know it
+    TextureCodec codec = TextureCodec::RGBA8;
+    bool srgb = false;
+    if (!GetFormatCodec(static_cast<VkFormat>(header.m_vkFormat), codec, srgb))
+    {
+        throw std::runtime_error("unsupported texture file format!");
+    }
+
+    m_format = static_cast<VkFormat>(header.m_vkFormat);
+    m_width = header.m_pixelWidth;
+    m_height = header.m_pixelHeight;
+
+    //0 levels asks the loader to generate them, there's just the one in the file then
+    uint32_t maxLevels = 1;
+    while ((std::max(m_width, m_height) >> maxLevels) != 0)
+    {
+        maxLevels++;
+    }
+    if (header.m_levelCount > maxLevels)
+    {
+        throw std::runtime_error("texture file has more levels than its size allows!");
+    }
+
+    std::vector<Ktx2Level> index(std::max(header.m_levelCount, 1u));
+    m_file.read(reinterpret_cast<char*>(index.data()), sizeof(Ktx2Level) * index.size());
+    if (!m_file)
+    {
+        throw std::runtime_error("texture file level index is truncated!");
+    }
+
+    m_file.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(m_file.tellg());
+
+    //Uploads copy whole levels by their extent, a level of any other size would read past its data
+    m_levels.resize(index.size());
+    for (size_t level = 0; level < index.size(); level++)
+    {
+        m_levels[level].m_offset = index[level].m_byteOffset;
+        m_levels[level].m_size = index[level].m_byteLength;
+
+        uint32_t level32 = static_cast<uint32_t>(level);
+        if (m_levels[level].m_size != GetCodecImageSize(codec, GetLevelWidth(level32), GetLevelHeight(level32)))
+        {
+            throw std::runtime_error("texture file level size doesn't match its extent!");
+        }
+        if (m_levels[level].m_offset > fileSize || m_levels[level].m_size > fileSize - m_levels[level].m_offset)
+        {
+            throw std::runtime_error("texture file level runs past the end of the file!");
+        }
+    }
+}
+
+void TextureFile::Close()
+{
+    m_file.close();
+    m_levels.clear();
+}
+
+void TextureFile::ReadLevel(uint32_t level, void* dst)
+{
+    const Level& entry = m_levels.at(level);
+    m_file.seekg(static_cast<std::streamoff>(entry.m_offset));
+    m_file.read(static_cast<char*>(dst), static_cast<std::streamsize>(entry.m_size));
+
+    if (!m_file)
+    {
+        throw std::runtime_error("failed to read texture level!");
+    }
+}
+
+void TextureFile::ReadLevelRange(uint32_t level, uint64_t offset, uint64_t size, void* dst)
+{
+    const Level& entry = m_levels.at(level);
+    if (offset + size > entry.m_size)
+    {
+        throw std::runtime_error("texture level range out of bounds!");
+    }
+
+    m_file.seekg(static_cast<std::streamoff>(entry.m_offset + offset));
+    m_file.read(static_cast<char*>(dst), static_cast<std::streamsize>(size));
+
+    if (!m_file)
+    {
+        throw std::runtime_error("failed to read texture level!");
+    }
+}
+
+VkFormat GetCodecFormat(TextureCodec codec, bool srgb)
+{
+    for (const FormatEntry& entry : FORMATS)
+    {
+        if (entry.m_codec == codec)
+        {
+            return srgb ? entry.m_srgb : entry.m_unorm;
+        }
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool GetFormatCodec(VkFormat format, TextureCodec& codec, bool& srgb)
+{
+    for (const FormatEntry& entry : FORMATS)
+    {
+        if (entry.m_unorm == format || entry.m_srgb == format)
+        {
+            codec = entry.m_codec;
+            srgb = entry.m_srgb == format && entry.m_srgb != entry.m_unorm;
+            return true;
+        }
+    }
+
+    return false;
+}
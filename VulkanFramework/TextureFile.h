@@ -0,0 +1,65 @@
+#ifndef __TEXTURE_FILE_H__
+#define __TEXTURE_FILE_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "TextureCompression.h"
+
+//2D texture container with the KTX2 layout: identifier, header, level index, then the mip
+//levels stored smallest first. Opening reads the header and index only, every level is read
+//on demand straight to where it's going (a mapped staging buffer), so loading a texture at
+//reduced resolution never touches the bytes of the levels it skips.
+//Written files have no data format descriptor, which KTX2 requires, so other tools may not
+//take them. Reading only needs the level index, plain (not supercompressed) KTX2 files from
+//other tools load fine as long as TextureCompression knows the format.
+class TextureFile
+{
+public:
+    //levels[0] is the full size image, each one tightly packed in format
+    static void Write(const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels);
+
+    //Throws if the file isn't a single 2D texture this can load, or its level index doesn't
+    //match its size and format
+    void Open(const std::string& path);
+    void Close();
+
+    VkFormat GetFormat() const { return m_format; }
+    uint32_t GetWidth() const { return m_width; }
+    uint32_t GetHeight() const { return m_height; }
+    uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_levels.size()); }
+    uint32_t GetLevelWidth(uint32_t level) const { return std::max(1u, m_width >> level); }
+    uint32_t GetLevelHeight(uint32_t level) const { return std::max(1u, m_height >> level); }
+    uint64_t GetLevelSize(uint32_t level) const { return m_levels[level].m_size; }
+
+    //Level's bytes into dst, which has to hold GetLevelSize(level)
+    void ReadLevel(uint32_t level, void* dst);
+    //size bytes starting offset bytes into the level, for reading parts of levels (pages, rows of blocks)
+    void ReadLevelRange(uint32_t level, uint64_t offset, uint64_t size, void* dst);
+
+private:
+    struct Level
+    {
+        uint64_t m_offset = 0;
+        uint64_t m_size = 0;
+    };
+
+    std::ifstream m_file;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    std::vector<Level> m_levels;
+};
+
+//VkFormat for a codec, _SRGB where the codec has one
+VkFormat GetCodecFormat(TextureCodec codec, bool srgb);
+//The other way around, false for formats TextureCompression doesn't know
+bool GetFormatCodec(VkFormat format, TextureCodec& codec, bool& srgb);
+
+#endif // !__TEXTURE_FILE_H__
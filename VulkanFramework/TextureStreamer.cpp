@@ -0,0 +1,297 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "Profiler.h"
+#include "Tracer.h"
+
+void TextureStreamer::Init(TextureLoader* loader, MemoryBudget* budget, const TextureStreamerSettings& settings)
+{
+    m_loader = loader;
+    m_budget = budget;
+    m_settings = settings;
+    m_settleFrames = 0;
+}
+
+void TextureStreamer::Destroy()
+{
+    for (StreamedTextureHandle handle = 0; handle < m_entries.size(); handle++)
+    {
+        if (m_entries[handle].m_used)
+        {
+            Remove(handle);
+        }
+    }
+
+    m_entries.clear();
+    m_freeHandles.clear();
+}
+
+StreamedTextureHandle TextureStreamer::Add(const std::string& path)
+{
+    TRACE_SCOPE("AddStreamedTexture");
+
+    Entry entry;
+    entry.m_file.Open(path);
+
+    //Coarsest levels only, everything bigger waits until something needs it
+    uint32_t levelCount = entry.m_file.GetLevelCount();
+    while (entry.m_initialLevel + 1 < levelCount &&
+        std::max(entry.m_file.GetLevelWidth(entry.m_initialLevel), entry.m_file.GetLevelHeight(entry.m_initialLevel)) > m_settings.m_initialSize)
+    {
+        entry.m_initialLevel++;
+    }
+    entry.m_wantedLevel = entry.m_initialLevel;
+    entry.m_texture = m_loader->Load(entry.m_file, entry.m_initialLevel);
+    entry.m_used = true;
+
+    StreamedTextureHandle handle;
+    if (!m_freeHandles.empty())
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+        m_entries[handle] = std::move(entry);
+    }
+    else
+    {
+        handle = static_cast<StreamedTextureHandle>(m_entries.size());
+        m_entries.push_back(std::move(entry));
+    }
+
+    return handle;
+}
+
+void TextureStreamer::Remove(StreamedTextureHandle handle)
+{
+    Entry& entry = m_entries.at(handle);
+    if (!entry.m_used)
+    {
+        throw std::runtime_error("streamed texture removed twice!");
+    }
+
+    m_loader->Destroy(entry.m_texture);
+    entry.m_file.Close();
+    entry.m_used = false;
+    m_freeHandles.push_back(handle);
+}
+
+void TextureStreamer::SetScreenSize(StreamedTextureHandle handle, float pixels)
+{
+    m_entries.at(handle).m_screenSize = pixels;
+}
+
+bool TextureStreamer::Update(std::pmr::memory_resource* scratch)
+{
+    PROFILE_SCOPE("TextureStreaming");
+
+    for (Entry& entry : m_entries)
+    {
+        if (entry.m_used)
+        {
+            entry.m_wantedLevel = GetWantedLevel(entry);
+        }
+    }
+
+    if (m_settleFrames != 0)
+    {
+        m_settleFrames--;
+        return false;
+    }
+
+    if (m_budget->IsOverBudget())
+    {
+        m_pressureUpdates++;
+        return DropLevels(scratch);
+    }
+
+    return StreamLevels(scratch);
+}
+
+void TextureStreamer::PrintReport(std::ostream& out) const
+{
+    uint32_t textures = 0;
+    uint32_t starved = 0;
+    VkDeviceSize residentBytes = 0;
+    for (const Entry& entry : m_entries)
+    {
+        if (!entry.m_used)
+        {
+            continue;
+        }
+
+        textures++;
+        residentBytes += entry.m_texture.m_memorySize;
+        if (entry.m_texture.m_firstLevel > entry.m_wantedLevel)
+        {
+            starved++;
+        }
+    }
+
+    out << "texture streaming: " << textures << " textures, " << static_cast<double>(residentBytes) / (1024.0 * 1024.0) << " MB resident, "
+        << starved << " below the level they want" << std::endl;
+    out << "texture streaming: " << m_streamedLevels << " levels streamed in (" << static_cast<double>(m_streamedBytes) / (1024.0 * 1024.0)
+        << " MB read), " << m_droppedLevels << " dropped over " << m_pressureUpdates << " updates over budget" << std::endl;
+}
+
+VkDeviceSize TextureStreamer::GetLevelBytes(const Entry& entry, uint32_t level) const
+{
+    if (entry.m_texture.m_decoded)
+    {
+        return GetCodecImageSize(TextureCodec::RGBA8, entry.m_file.GetLevelWidth(level), entry.m_file.GetLevelHeight(level));
+    }
+    return entry.m_file.GetLevelSize(level);
+}
+
+uint32_t TextureStreamer::GetWantedLevel(const Entry& entry) const
+{
+    if (entry.m_screenSize <= 0.0f)
+    {
+        return entry.m_initialLevel;
+    }
+
+    //The coarsest level that still has a texel for every pixel it covers
+    float size = static_cast<float>(std::max(entry.m_file.GetWidth(), entry.m_file.GetHeight()));
+    float level = std::floor(std::log2(std::max(size / entry.m_screenSize, 1.0f)));
+    return std::min(static_cast<uint32_t>(level), entry.m_initialLevel);
+}
+
+uint32_t TextureStreamer::PickDrop(const std::pmr::vector<uint32_t>& targets) const
+{
+    uint32_t best = UINT32_MAX;
+    bool bestUnneeded = false;
+    VkDeviceSize bestBytes = 0;
+
+    for (uint32_t i = 0; i < m_entries.size(); i++)
+    {
+        const Entry& entry = m_entries[i];
+        if (!entry.m_used || targets[i] >= entry.m_initialLevel)
+        {
+            continue;
+        }
+
+        //Detail finer than the screen shows costs nothing to lose, after that the biggest level goes
+        bool unneeded = targets[i] < entry.m_wantedLevel;
+        VkDeviceSize bytes = GetLevelBytes(entry, targets[i]);
+        if (best == UINT32_MAX || (unneeded && !bestUnneeded) || (unneeded == bestUnneeded && bytes > bestBytes))
+        {
+            best = i;
+            bestUnneeded = unneeded;
+            bestBytes = bytes;
+        }
+    }
+
+    return best;
+}
+
+bool TextureStreamer::DropLevels(std::pmr::memory_resource* scratch)
+{
+    TRACE_SCOPE("DropTextureLevels");
+
+    VkDeviceSize usage = m_budget->GetDeviceUsage();
+    VkDeviceSize budget = m_budget->GetBudget();
+    VkDeviceSize excess = usage > budget ? usage - budget : 0;
+
+    //Decides every texture's level first, so each one is restreamed once however many levels it loses
+    std::pmr::vector<uint32_t> targets(m_entries.size(), scratch);
+    for (uint32_t i = 0; i < m_entries.size(); i++)
+    {
+        targets[i] = m_entries[i].m_texture.m_firstLevel;
+    }
+
+    while (excess != 0)
+    {
+        uint32_t victim = PickDrop(targets);
+        if (victim == UINT32_MAX)
+        {
+            break;
+        }
+
+        excess -= std::min(excess, GetLevelBytes(m_entries[victim], targets[victim]));
+        targets[victim]++;
+    }
+
+    bool changed = false;
+    for (uint32_t i = 0; i < m_entries.size(); i++)
+    {
+        Entry& entry = m_entries[i];
+        if (!entry.m_used || targets[i] == entry.m_texture.m_firstLevel)
+        {
+            continue;
+        }
+
+        m_droppedLevels += targets[i] - entry.m_texture.m_firstLevel;
+        m_loader->Restream(entry.m_texture, entry.m_file, targets[i]);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        m_settleFrames = m_settings.m_settleFrames;
+    }
+    return changed;
+}
+
+bool TextureStreamer::StreamLevels(std::pmr::memory_resource* scratch)
+{
+    VkDeviceSize headroom = m_budget->GetHeadroom();
+    VkDeviceSize uploadBytes = 0;
+    std::pmr::vector<bool> streamed(m_entries.size(), false, scratch);
+    bool changed = false;
+
+    //One level per texture per Update, furthest behind first
+    while (true)
+    {
+        uint32_t best = UINT32_MAX;
+        for (uint32_t i = 0; i < m_entries.size(); i++)
+        {
+            const Entry& entry = m_entries[i];
+            if (!entry.m_used || streamed[i] || entry.m_texture.m_firstLevel <= entry.m_wantedLevel)
+            {
+                continue;
+            }
+
+            if (best == UINT32_MAX)
+            {
+                best = i;
+                continue;
+            }
+
+            const Entry& other = m_entries[best];
+            uint32_t deficit = entry.m_texture.m_firstLevel - entry.m_wantedLevel;
+            uint32_t otherDeficit = other.m_texture.m_firstLevel - other.m_wantedLevel;
+            if (deficit > otherDeficit || (deficit == otherDeficit && entry.m_screenSize > other.m_screenSize))
+            {
+                best = i;
+            }
+        }
+
+        if (best == UINT32_MAX)
+        {
+            break;
+        }
+
+        Entry& entry = m_entries[best];
+        uint32_t level = entry.m_texture.m_firstLevel - 1;
+        VkDeviceSize bytes = GetLevelBytes(entry, level);
+
+        //The old image lives until the frames sampling it are done, so both have to fit for a while
+        VkDeviceSize needed = entry.m_texture.m_memorySize + bytes;
+        if (needed > headroom || (uploadBytes != 0 && uploadBytes + bytes > m_settings.m_uploadBytesPerFrame))
+        {
+            break;
+        }
+
+        m_loader->Restream(entry.m_texture, entry.m_file, level);
+        headroom -= needed;
+        uploadBytes += bytes;
+        streamed[best] = true;
+        changed = true;
+
+        m_streamedLevels++;
+        m_streamedBytes += bytes;
+    }
+
+    return changed;
+}
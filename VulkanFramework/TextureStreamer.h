@@ -0,0 +1,95 @@
+#ifndef __TEXTURE_STREAMER_H__
+#define __TEXTURE_STREAMER_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MemoryBudget.h"
+#include "Texture.h"
+#include "TextureFile.h"
+
+struct TextureStreamerSettings
+{
+    //Textures start out with only the levels up to this size (longest side) resident
+    uint32_t m_initialSize = 64;
+    //File bytes read per Update, one level always goes through even if it's bigger
+    VkDeviceSize m_uploadBytesPerFrame = 16 * 1024 * 1024;
+    //Updates that don't drop anything after levels were dropped. Freed memory sits in the
+    //deletion queue for a few frames before the driver's usage goes down.
+    uint32_t m_settleFrames = 4;
+};
+
+using StreamedTextureHandle = uint32_t;
+
+//Per texture mip residency. Textures are loaded with only their coarsest levels and each
+//Update moves them one level at a time toward what their size on screen needs, reading just
+//the new level from the file (TextureLoader::Restream). When the MemoryBudget says memory is
+//over, levels are dropped again: first ones finer than the screen needs, then the finest
+//level of the biggest textures, never below the initial levels.
+//Restreaming replaces a texture's image and view, Get returns the current ones.
+//Main thread only, same as TextureLoader.
+class TextureStreamer
+{
+public:
+    void Init(TextureLoader* loader, MemoryBudget* budget, const TextureStreamerSettings& settings = TextureStreamerSettings());
+    //Releases every texture still added
+    void Destroy();
+
+    //Loads the coarsest levels now, keeps the file open for the rest
+    StreamedTextureHandle Add(const std::string& path);
+    void Remove(StreamedTextureHandle handle);
+
+    //Longest side the texture covers on screen in pixels, 0 if it isn't visible. Stays until set again.
+    void SetScreenSize(StreamedTextureHandle handle, float pixels);
+
+    //Streams levels in or drops them, true if any texture's image was replaced. Bookkeeping
+    //for the update is allocated from scratch.
+    bool Update(std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+    const Texture& Get(StreamedTextureHandle handle) const { return m_entries[handle].m_texture; }
+    //File level the texture wants resident as of the last Update
+    uint32_t GetWantedLevel(StreamedTextureHandle handle) const { return m_entries[handle].m_wantedLevel; }
+
+    void PrintReport(std::ostream& out) const;
+
+private:
+    struct Entry
+    {
+        TextureFile m_file;
+        Texture m_texture;
+        //Coarsest level the texture starts with and never drops below
+        uint32_t m_initialLevel = 0;
+        uint32_t m_wantedLevel = 0;
+        float m_screenSize = 0.0f;
+        bool m_used = false;
+    };
+
+    //Device bytes one level of the texture takes
+    VkDeviceSize GetLevelBytes(const Entry& entry, uint32_t level) const;
+    uint32_t GetWantedLevel(const Entry& entry) const;
+    //Index of the entry that loses least by dropping a level below target, UINT32_MAX if none can
+    uint32_t PickDrop(const std::pmr::vector<uint32_t>& targets) const;
+    bool DropLevels(std::pmr::memory_resource* scratch);
+    bool StreamLevels(std::pmr::memory_resource* scratch);
+
+    TextureLoader* m_loader = nullptr;
+    MemoryBudget* m_budget = nullptr;
+    TextureStreamerSettings m_settings;
+
+    std::vector<Entry> m_entries;
+    std::vector<StreamedTextureHandle> m_freeHandles;
+    uint32_t m_settleFrames = 0;
+
+    uint64_t m_streamedLevels = 0;
+    uint64_t m_droppedLevels = 0;
+    uint64_t m_streamedBytes = 0;
+    uint64_t m_pressureUpdates = 0;
+};
+
+#endif // !__TEXTURE_STREAMER_H__
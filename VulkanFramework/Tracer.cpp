@@ -0,0 +1,280 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+std::atomic<bool> Tracer::m_enabled = { false };
+std::mutex Tracer::m_threadsMutex;
+std::vector<std::unique_ptr<Tracer::ThreadBuffer>> Tracer::m_threads;
+
+namespace
+{
+    //Just enough protobuf to write Perfetto's TracePacket/TrackEvent messages by hand
+    void PutVarint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    void PutUint(std::string& out, uint32_t field, uint64_t value)
+    {
+        PutVarint(out, (static_cast<uint64_t>(field) << 3) | 0);
+        PutVarint(out, value);
+    }
+
+    void PutBytes(std::string& out, uint32_t field, const std::string& bytes)
+    {
+        PutVarint(out, (static_cast<uint64_t>(field) << 3) | 2);
+        PutVarint(out, bytes.size());
+        out += bytes;
+    }
+
+    //Field numbers from perfetto/trace/trace_packet.proto and track_event/*.proto
+    const uint32_t TRACE_PACKET = 1;
+    const uint32_t PACKET_TIMESTAMP = 8;
+    const uint32_t PACKET_SEQUENCE_ID = 10;
+    const uint32_t PACKET_TRACK_EVENT = 11;
+    const uint32_t PACKET_SEQUENCE_FLAGS = 13;
+    const uint32_t PACKET_TRACK_DESCRIPTOR = 60;
+    const uint32_t TRACK_EVENT_TYPE = 9;
+    const uint32_t TRACK_EVENT_TRACK_UUID = 11;
+    const uint32_t TRACK_EVENT_NAME = 23;
+    const uint32_t TRACK_DESCRIPTOR_UUID = 1;
+    const uint32_t TRACK_DESCRIPTOR_THREAD = 4;
+    const uint32_t THREAD_PID = 1;
+    const uint32_t THREAD_TID = 2;
+    const uint32_t THREAD_NAME = 5;
+    const uint64_t TYPE_SLICE_BEGIN = 1;
+    const uint64_t TYPE_SLICE_END = 2;
+    const uint64_t TYPE_INSTANT = 3;
+    const uint64_t SEQ_INCREMENTAL_STATE_CLEARED = 1;
+
+    const uint32_t TRACE_PID = 1;
+    const uint32_t SEQUENCE_ID = 1;
+
+    std::string EscapeJson(const char* text)
+    {
+        std::string escaped;
+        for (const char* c = text; *c != '\0'; c++)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                escaped += '\\';
+            }
+            escaped += *c;
+        }
+
+        return escaped;
+    }
+}
+
+void Tracer::SetThreadName(const std::string& name)
+{
+    ThreadBuffer* buffer = GetThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    buffer->m_name = name;
+}
+
+Tracer::ThreadBuffer* Tracer::RegisterThread()
+{
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+
+    m_threads.push_back(std::make_unique<ThreadBuffer>());
+    ThreadBuffer* buffer = m_threads.back().get();
+    buffer->m_threadId = static_cast<uint32_t>(m_threads.size());
+    buffer->m_name = "Thread " + std::to_string(buffer->m_threadId);
+
+    return buffer;
+}
+
+std::vector<Tracer::ThreadEvents> Tracer::CollectEvents()
+{
+    std::vector<ThreadEvents> threads;
+
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    for (const auto& buffer : m_threads)
+    {
+        uint64_t head = buffer->m_head.load(std::memory_order_acquire);
+        uint64_t first = std::max(buffer->m_flushed, head > RING_CAPACITY ? head - RING_CAPACITY : 0);
+
+        std::vector<Event> events;
+        events.reserve(static_cast<size_t>(head - first));
+        for (uint64_t i = first; i < head; i++)
+        {
+            events.push_back(buffer->m_events[i % RING_CAPACITY]);
+        }
+
+        //The owner kept writing during the copy. Whatever it could have reached since,
+        //including the slot it might be halfway through, is unreliable.
+        uint64_t headAfter = buffer->m_head.load(std::memory_order_acquire);
+        uint64_t firstValid = headAfter >= RING_CAPACITY ? headAfter - RING_CAPACITY + 1 : 0;
+        if (firstValid > first)
+        {
+            size_t dropped = static_cast<size_t>(std::min<uint64_t>(firstValid - first, events.size()));
+            events.erase(events.begin(), events.begin() + dropped);
+        }
+
+        buffer->m_flushed = head;
+        threads.push_back({ buffer.get(), std::move(events) });
+    }
+
+    return threads;
+}
+
+bool Tracer::Flush(const std::string& path)
+{
+    std::vector<ThreadEvents> threads = CollectEvents();
+
+    //Outer scopes first, so the writers can nest them with a stack
+    for (auto& thread : threads)
+    {
+        std::sort(thread.m_events.begin(), thread.m_events.end(), [](const Event& a, const Event& b)
+        {
+            return a.m_start != b.m_start ? a.m_start < b.m_start : a.m_end > b.m_end;
+        });
+    }
+
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+    return json ? WriteJson(path, threads) : WritePerfetto(path, threads);
+}
+
+bool Tracer::WriteJson(const std::string& path, const std::vector<ThreadEvents>& threads)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    Profiler* clock = Profiler::GetInstance();
+    clock->Calibrate();
+
+    //Microseconds, complete events for scopes and thread scoped instants
+    file << "{\"traceEvents\":[" << std::endl;
+    file << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const auto& thread : threads)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << TRACE_PID
+            << ",\"tid\":" << thread.m_buffer->m_threadId
+            << ",\"args\":{\"name\":\"" << EscapeJson(thread.m_buffer->m_name.c_str()) << "\"}}";
+        first = false;
+
+        for (const Event& event : thread.m_events)
+        {
+            file << ",\n{\"name\":\"" << EscapeJson(event.m_name) << "\",\"pid\":" << TRACE_PID
+                << ",\"tid\":" << thread.m_buffer->m_threadId
+                << ",\"ts\":" << clock->ToNanoseconds(event.m_start) / 1000.0;
+
+            if (event.m_type == EventType::Instant)
+            {
+                file << ",\"ph\":\"i\",\"s\":\"t\"}";
+            }
+            else
+            {
+                file << ",\"ph\":\"X\",\"dur\":" << (clock->ToNanoseconds(event.m_end) - clock->ToNanoseconds(event.m_start)) / 1000.0 << "}";
+            }
+        }
+    }
+    file << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+    return true;
+}
+
+bool Tracer::WritePerfetto(const std::string& path, const std::vector<ThreadEvents>& threads)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    Profiler* clock = Profiler::GetInstance();
+    clock->Calibrate();
+
+    bool firstPacket = true;
+    auto writePacket = [&file, &firstPacket](std::string& packet)
+    {
+        PutUint(packet, PACKET_SEQUENCE_ID, SEQUENCE_ID);
+        if (firstPacket)
+        {
+            PutUint(packet, PACKET_SEQUENCE_FLAGS, SEQ_INCREMENTAL_STATE_CLEARED);
+            firstPacket = false;
+        }
+
+        //A trace is just a stream of "repeated TracePacket packet = 1"
+        std::string framed;
+        PutBytes(framed, TRACE_PACKET, packet);
+        file.write(framed.data(), framed.size());
+    };
+
+    auto writeTrackEvent = [&writePacket](uint64_t uuid, int64_t timestamp, uint64_t type, const char* name)
+    {
+        std::string trackEvent;
+        PutUint(trackEvent, TRACK_EVENT_TYPE, type);
+        PutUint(trackEvent, TRACK_EVENT_TRACK_UUID, uuid);
+        if (name != nullptr)
+        {
+            PutBytes(trackEvent, TRACK_EVENT_NAME, name);
+        }
+
+        std::string packet;
+        PutUint(packet, PACKET_TIMESTAMP, static_cast<uint64_t>(timestamp));
+        PutBytes(packet, PACKET_TRACK_EVENT, trackEvent);
+        writePacket(packet);
+    };
+
+    for (const auto& thread : threads)
+    {
+        uint64_t uuid = thread.m_buffer->m_threadId;
+
+        std::string threadDescriptor;
+        PutUint(threadDescriptor, THREAD_PID, TRACE_PID);
+        PutUint(threadDescriptor, THREAD_TID, thread.m_buffer->m_threadId);
+        PutBytes(threadDescriptor, THREAD_NAME, thread.m_buffer->m_name);
+
+        std::string trackDescriptor;
+        PutUint(trackDescriptor, TRACK_DESCRIPTOR_UUID, uuid);
+        PutBytes(trackDescriptor, TRACK_DESCRIPTOR_THREAD, threadDescriptor);
+
+        std::string packet;
+        PutBytes(packet, PACKET_TRACK_DESCRIPTOR, trackDescriptor);
+        writePacket(packet);
+
+        //Begin/end pairs have to nest, close every open scope that ends before the next one starts
+        std::vector<int64_t> openEnds;
+        for (const Event& event : thread.m_events)
+        {
+            while (!openEnds.empty() && openEnds.back() <= event.m_start)
+            {
+                writeTrackEvent(uuid, clock->ToNanoseconds(openEnds.back()), TYPE_SLICE_END, nullptr);
+                openEnds.pop_back();
+            }
+
+            if (event.m_type == EventType::Instant)
+            {
+                writeTrackEvent(uuid, clock->ToNanoseconds(event.m_start), TYPE_INSTANT, event.m_name);
+            }
+            else
+            {
+                writeTrackEvent(uuid, clock->ToNanoseconds(event.m_start), TYPE_SLICE_BEGIN, event.m_name);
+                openEnds.push_back(event.m_end);
+            }
+        }
+
+        while (!openEnds.empty())
+        {
+            writeTrackEvent(uuid, clock->ToNanoseconds(openEnds.back()), TYPE_SLICE_END, nullptr);
+            openEnds.pop_back();
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,122 @@
+#ifndef __TRACER_H__
+#define __TRACER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Profiler.h"
+
+//Trace events from any thread (init, asset loading, jobs...), for chrome://tracing or Perfetto.
+//Every thread writes into its own ring buffer, so recording never takes a lock. Once a
+//ring is full the oldest events are overwritten. Flush can run while threads keep tracing,
+//anything that might have been overwritten mid copy is dropped.
+//Define SHIPPING_BUILD to compile every TRACE_ macro out.
+class Tracer
+{
+public:
+    //Events kept per thread
+    static const uint32_t RING_CAPACITY = 1 << 14;
+
+    enum class EventType : uint32_t
+    {
+        Scope,
+        Instant
+    };
+
+    struct Event
+    {
+        const char* m_name;
+        int64_t m_start;
+        int64_t m_end;
+        EventType m_type;
+    };
+
+    static void SetEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool IsEnabled() { return m_enabled.load(std::memory_order_relaxed); }
+
+    //Shows up as the track name, call from the thread being named
+    static void SetThreadName(const std::string& name);
+
+    static void Record(const char* name, int64_t start, int64_t end, EventType type)
+    {
+        ThreadBuffer* buffer = GetThreadBuffer();
+        uint64_t head = buffer->m_head.load(std::memory_order_relaxed);
+        buffer->m_events[head % RING_CAPACITY] = { name, start, end, type };
+        //Publishes the event to Flush
+        buffer->m_head.store(head + 1, std::memory_order_release);
+    }
+
+    //Writes everything recorded so far, .json gives Chrome trace JSON and anything
+    //else a Perfetto protobuf trace. Events are consumed, the next flush starts after them.
+    static bool Flush(const std::string& path);
+
+private:
+    struct ThreadBuffer
+    {
+        std::vector<Event> m_events = std::vector<Event>(RING_CAPACITY);
+        std::atomic<uint64_t> m_head = { 0 };
+        //Everything before this has already been flushed
+        uint64_t m_flushed = 0;
+        uint32_t m_threadId = 0;
+        std::string m_name;
+    };
+
+    struct ThreadEvents
+    {
+        const ThreadBuffer* m_buffer;
+        std::vector<Event> m_events;
+    };
+
+    static ThreadBuffer* GetThreadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = RegisterThread();
+        return buffer;
+    }
+    static ThreadBuffer* RegisterThread();
+
+    static std::vector<ThreadEvents> CollectEvents();
+    static bool WriteJson(const std::string& path, const std::vector<ThreadEvents>& threads);
+    static bool WritePerfetto(const std::string& path, const std::vector<ThreadEvents>& threads);
+
+    static std::atomic<bool> m_enabled;
+    //Only touched when a thread records its first event and on flush
+    static std::mutex m_threadsMutex;
+    static std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+};
+
+//Records the enclosing block as one event
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name) : m_name(name), m_start(Tracer::IsEnabled() ? Profiler::Now() : 0) { }
+
+    ~TraceScope()
+    {
+        if (m_start != 0)
+        {
+            Tracer::Record(m_name, m_start, Profiler::Now(), Tracer::EventType::Scope);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_start;
+};
+
+#ifdef SHIPPING_BUILD
+#define TRACE_SCOPE(name)
+#define TRACE_INSTANT(name)
+#else
+//name has to stay alive until the flush, string literals are what it's meant for
+#define TRACE_SCOPE(name) TraceScope PROFILE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_INSTANT(name) \
+    do { if (Tracer::IsEnabled()) { int64_t traceNow = Profiler::Now(); Tracer::Record(name, traceNow, traceNow, Tracer::EventType::Instant); } } while (0)
+#endif //SHIPPING_BUILD
+
+#endif // !__TRACER_H__
@@ -0,0 +1,238 @@
+#include "UniformRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Util.h"
+
+namespace
+{
+    //Both are powers of two
+    VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+void UniformRing::Init(VkDevice device, const VkPhysicalDeviceMemoryProperties& memProperties, const VkPhysicalDeviceLimits& limits,
+    uint32_t regionCount, VkDeviceSize regionSize, const std::vector<UniformBinding>& bindings)
+{
+    m_device = device;
+    m_alignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+    m_regionCount = regionCount;
+    //Every region starts aligned for both dynamic offsets and flushes
+    m_regionSize = AlignUp(regionSize, std::max(m_alignment, m_nonCoherentAtomSize));
+    m_regionBase = 0;
+    m_offset = 0;
+    m_peakFrameBytes = 0;
+
+    for (const UniformBinding& binding : bindings)
+    {
+        if (binding.m_range > limits.maxUniformBufferRange || binding.m_range > m_regionSize)
+        {
+            throw std::runtime_error("uniform binding range is too large!");
+        }
+    }
+
+    CreateBuffer(memProperties, m_regionSize * m_regionCount);
+    CreateDescriptorSet(bindings);
+}
+
+void UniformRing::CreateBuffer(const VkPhysicalDeviceMemoryProperties& memProperties, VkDeviceSize size)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create uniform ring buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, m_buffer, &requirements);
+
+    //The CPU only ever writes, sequentially, so write combined memory is ideal. Device local
+    //and host visible (integrated GPUs, resizable BAR) saves the GPU reading over the bus.
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    const VkMemoryPropertyFlags candidates[] =
+    {
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+    };
+    bool found = false;
+    for (VkMemoryPropertyFlags flags : candidates)
+    {
+        try
+        {
+            allocInfo.memoryTypeIndex = Util::FindMemoryType(memProperties, requirements.memoryTypeBits, flags);
+            found = true;
+            break;
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+    }
+    if (!found)
+    {
+        throw std::runtime_error("failed to find memory for the uniform ring!");
+    }
+    m_coherent = (memProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate uniform ring memory!");
+    }
+
+    vkBindBufferMemory(m_device, m_buffer, m_memory, 0);
+
+    //Stays mapped for the lifetime of the ring
+    void* mapped = nullptr;
+    if (vkMapMemory(m_device, m_memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map uniform ring memory!");
+    }
+    m_mapped = static_cast<std::byte*>(mapped);
+}
+
+void UniformRing::CreateDescriptorSet(const std::vector<UniformBinding>& bindings)
+{
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings(bindings.size());
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        layoutBindings[i].binding = static_cast<uint32_t>(i);
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = bindings[i].m_stages;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    layoutInfo.pBindings = layoutBindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create uniform ring set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize = {};
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = std::max<uint32_t>(static_cast<uint32_t>(bindings.size()), 1);
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create uniform ring descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate uniform ring descriptor set!");
+    }
+
+    //Every binding points at the start of the buffer, the dynamic offset does the rest
+    std::vector<VkDescriptorBufferInfo> bufferInfos(bindings.size());
+    std::vector<VkWriteDescriptorSet> writes(bindings.size());
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        bufferInfos[i].buffer = m_buffer;
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = bindings[i].m_range;
+
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_descriptorSet;
+        writes[i].dstBinding = static_cast<uint32_t>(i);
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void UniformRing::Destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    //Freeing the pool frees the set with it
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    vkUnmapMemory(m_device, m_memory);
+    vkDestroyBuffer(m_device, m_buffer, nullptr);
+    vkFreeMemory(m_device, m_memory, nullptr);
+
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_setLayout = VK_NULL_HANDLE;
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+    m_mapped = nullptr;
+    m_device = VK_NULL_HANDLE;
+}
+
+void UniformRing::BeginFrame(uint32_t region)
+{
+    if (region >= m_regionCount)
+    {
+        throw std::runtime_error("uniform ring region out of range!");
+    }
+
+    m_regionBase = region * m_regionSize;
+    m_offset = 0;
+}
+
+void UniformRing::EndFrame()
+{
+    m_peakFrameBytes = std::max(m_peakFrameBytes, m_offset);
+
+    if (m_coherent || m_offset == 0)
+    {
+        return;
+    }
+
+    //Region bases are atom aligned, so rounding the size up keeps the range inside the region
+    VkMappedMemoryRange range = {};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = m_memory;
+    range.offset = m_regionBase;
+    range.size = AlignUp(m_offset, m_nonCoherentAtomSize);
+    vkFlushMappedMemoryRanges(m_device, 1, &range);
+}
+
+UniformRing::Allocation UniformRing::Allocate(VkDeviceSize size)
+{
+    if (m_offset + size > m_regionSize)
+    {
+        throw std::runtime_error("uniform ring region is full!");
+    }
+
+    Allocation allocation;
+    allocation.m_data = m_mapped + m_regionBase + m_offset;
+    allocation.m_offset = static_cast<uint32_t>(m_regionBase + m_offset);
+
+    //The next allocation has to start on a legal dynamic offset
+    m_offset = AlignUp(m_offset + size, m_alignment);
+
+    return allocation;
+}
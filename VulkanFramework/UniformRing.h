@@ -0,0 +1,87 @@
+#ifndef __UNIFORM_RING_H__
+#define __UNIFORM_RING_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//A dynamic uniform buffer binding, the descriptor covers m_range bytes wherever its offset points
+struct UniformBinding
+{
+    VkDeviceSize m_range = 0;
+    VkShaderStageFlags m_stages = VK_SHADER_STAGE_ALL_GRAPHICS;
+};
+
+//One persistently mapped uniform buffer split into a region per frame that can be in flight.
+//Allocations bump through the current region in minUniformBufferOffsetAlignment steps and come
+//back as a mapped pointer plus the dynamic offset to bind with, so writing per object data is a
+//memcpy and nothing else. The descriptor set is written once at Init and never updated, draws
+//only change the dynamic offsets they bind it with.
+//A region may only be written once the GPU is done with the frame that last used it.
+class UniformRing
+{
+public:
+    struct Allocation
+    {
+        void* m_data = nullptr;
+        uint32_t m_offset = 0;
+    };
+
+    //Binding i of the set layout is bindings[i], every one a UNIFORM_BUFFER_DYNAMIC
+    void Init(VkDevice device, const VkPhysicalDeviceMemoryProperties& memProperties, const VkPhysicalDeviceLimits& limits,
+        uint32_t regionCount, VkDeviceSize regionSize, const std::vector<UniformBinding>& bindings);
+    void Destroy();
+
+    //Rewinds region and makes it the one allocations come from
+    void BeginFrame(uint32_t region);
+    //Makes the frame's writes visible to the device, nothing to do on coherent memory
+    void EndFrame();
+
+    //size bytes in the current region, throws if the region is full
+    Allocation Allocate(VkDeviceSize size);
+    //Copies value in and returns its dynamic offset
+    template<typename T>
+    uint32_t Write(const T& value)
+    {
+        Allocation allocation = Allocate(sizeof(T));
+        std::memcpy(allocation.m_data, &value, sizeof(T));
+        return allocation.m_offset;
+    }
+
+    VkDescriptorSetLayout GetSetLayout() const { return m_setLayout; }
+    VkDescriptorSet GetDescriptorSet() const { return m_descriptorSet; }
+
+    //Bytes allocated in the current region, padding included
+    VkDeviceSize GetFrameBytes() const { return m_offset; }
+    VkDeviceSize GetPeakFrameBytes() const { return m_peakFrameBytes; }
+    VkDeviceSize GetRegionSize() const { return m_regionSize; }
+
+private:
+    void CreateBuffer(const VkPhysicalDeviceMemoryProperties& memProperties, VkDeviceSize size);
+    void CreateDescriptorSet(const std::vector<UniformBinding>& bindings);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    std::byte* m_mapped = nullptr;
+    bool m_coherent = true;
+    VkDeviceSize m_alignment = 1;
+    VkDeviceSize m_nonCoherentAtomSize = 1;
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+    uint32_t m_regionCount = 0;
+    VkDeviceSize m_regionSize = 0;
+    //Start of the current region in the buffer, and how far into it allocations have got
+    VkDeviceSize m_regionBase = 0;
+    VkDeviceSize m_offset = 0;
+    VkDeviceSize m_peakFrameBytes = 0;
+};
+
+#endif // !__UNIFORM_RING_H__
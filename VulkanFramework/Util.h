@@ -1,7 +1,12 @@
 #pragma once
 
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
 #include <vector>
 #include <fstream>
+#include <functional>
+#include <stdexcept>
 
 namespace Util
 {
@@ -24,4 +29,25 @@ namespace Util
 
         return buffer;
     }
-}
\ No newline at end of file
+
+    //Mixes the hash of value into seed, same mixing as boost::hash_combine
+    template<typename T>
+    static void HashCombine(size_t& seed, const T& value)
+    {
+        seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    //Finds a memory type allowed by typeFilter that has all of the requested properties
+    static uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties& memProperties, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    {
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        {
+            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+}
@@ -0,0 +1,1099 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Profiler.h"
+#include "Texture.h"
+#include "Tracer.h"
+#include "Util.h"
+
+namespace
+{
+    bool IsPowerOfTwo(uint32_t value)
+    {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+
+    //Atlas slots are addressed with a byte per axis
+    const uint32_t MAX_CACHE_PAGES_PER_ROW = 255;
+}
+
+bool VirtualTexture::CanUseSparse(const DeviceCaps& caps, uint32_t queueFamily)
+{
+    const std::vector<VkQueueFamilyProperties>& families = caps.GetQueueFamilies();
+    return caps.GetFeatures().sparseBinding && caps.GetFeatures().sparseResidencyImage2D &&
+        queueFamily < families.size() && (families[queueFamily].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT);
+}
+
+void VirtualTexture::Init(VkDevice device, const DeviceCaps* caps, VkQueue queue, uint32_t queueFamily, QueueTimeline* timeline, SamplerCache* samplers,
+    const std::string& path, uint32_t slotCount, VkExtent2D renderExtent, const VirtualTextureSettings& settings)
+{
+    TRACE_SCOPE("InitVirtualTexture");
+
+    m_device = device;
+    m_caps = caps;
+    m_queue = queue;
+    m_queueFamily = queueFamily;
+    m_timeline = timeline;
+    m_samplers = samplers;
+    m_settings = settings;
+    m_firstUpload = true;
+    m_uploadedPages = 0;
+    m_deferredPages = 0;
+    m_peakRequests = 0;
+
+    if (!m_caps->GetFeatures().fragmentStoresAndAtomics)
+    {
+        throw std::runtime_error("virtual texture feedback needs fragment stores!");
+    }
+
+    m_file.Open(path);
+    m_format = m_file.GetFormat();
+    if (!IsPowerOfTwo(m_file.GetWidth()) || !IsPowerOfTwo(m_file.GetHeight()))
+    {
+        throw std::runtime_error("virtual textures have to be power of two sized!");
+    }
+
+    bool srgb = false;
+    if (!GetFormatCodec(m_format, m_codec, srgb))
+    {
+        throw std::runtime_error("virtual texture format isn't supported!");
+    }
+
+    m_decode = false;
+    if (!IsTextureFormatSupported(*m_caps, m_format))
+    {
+        if (!CanDecode(m_codec) || !IsTextureFormatSupported(*m_caps, GetCodecFormat(TextureCodec::RGBA8, srgb)))
+        {
+            throw std::runtime_error("virtual texture format isn't supported by the device!");
+        }
+
+        m_format = GetCodecFormat(TextureCodec::RGBA8, srgb);
+        m_decode = true;
+    }
+
+    //Decoding happens per page on the CPU, which only the software path's copies can take
+    ChooseLayout(m_settings.m_allowSparse && !m_decode);
+    CreateImages();
+    if (m_sparse)
+    {
+        CreateSparseMemory();
+    }
+
+    //Every page a frame in flight samples is ordered before the copies that replace it on the
+    //software path. Sparse binds aren't ordered against submits, BindSparse waits for those instead.
+    m_cache.Init(m_sparse ? m_settings.m_cachePages : std::min(m_settings.m_cachePages, m_cachePagesPerRow * m_cachePagesPerRow), 0);
+    InitPageTable();
+
+    CreateFeedback(slotCount, renderExtent);
+    CreateDescriptorSet();
+    CreateCommandBuffers(slotCount);
+
+    //A frame's worth of pages plus the whole page table, and the first frame's mip tail on top
+    VkDeviceSize pageBytes = m_decode ? VkDeviceSize(m_pageWidth) * m_pageHeight * 4 :
+        GetCodecImageSize(m_codec, m_pageWidth, m_pageHeight);
+    VkDeviceSize regionSize = (pageBytes + 16) * (m_settings.m_uploadsPerFrame + 1);
+    for (uint32_t level = 0; level < m_table.GetLevelCount(); level++)
+    {
+        regionSize += m_table.GetLevel(level).size() * sizeof(uint32_t) + 16;
+    }
+    if (m_sparse)
+    {
+        for (uint32_t level = m_mipTailFirstLevel; level < m_file.GetLevelCount(); level++)
+        {
+            regionSize += m_file.GetLevelSize(level) + 16;
+        }
+    }
+    m_staging.Init(m_device, m_caps->GetMemoryProperties(), slotCount, regionSize);
+}
+
+void VirtualTexture::ChooseLayout(bool allowSparse)
+{
+    m_sparse = false;
+
+    if (allowSparse && CanUseSparse(*m_caps, m_queueFamily))
+    {
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        uint32_t count = 0;
+        vkGetPhysicalDeviceSparseImageFormatProperties(m_caps->GetPhysicalDevice(), m_format, VK_IMAGE_TYPE_2D,
+            VK_SAMPLE_COUNT_1_BIT, usage, VK_IMAGE_TILING_OPTIMAL, &count, nullptr);
+        std::vector<VkSparseImageFormatProperties> properties(count);
+        vkGetPhysicalDeviceSparseImageFormatProperties(m_caps->GetPhysicalDevice(), m_format, VK_IMAGE_TYPE_2D,
+            VK_SAMPLE_COUNT_1_BIT, usage, VK_IMAGE_TILING_OPTIMAL, &count, properties.data());
+
+        //Pages are the tiles, whatever size the device makes them
+        for (const VkSparseImageFormatProperties& property : properties)
+        {
+            if ((property.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) && !(property.flags & VK_SPARSE_IMAGE_FORMAT_NONSTANDARD_BLOCK_SIZE_BIT))
+            {
+                m_pageWidth = property.imageGranularity.width;
+                m_pageHeight = property.imageGranularity.height;
+                m_sparse = true;
+                break;
+            }
+        }
+    }
+
+    if (!m_sparse)
+    {
+        if (!IsPowerOfTwo(m_settings.m_pageSize) || m_settings.m_pageSize < 4)
+        {
+            throw std::runtime_error("virtual texture page size has to be a power of two of at least 4!");
+        }
+
+        m_pageWidth = m_settings.m_pageSize;
+        m_pageHeight = m_settings.m_pageSize;
+    }
+}
+
+void VirtualTexture::CreateImages()
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = m_format;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (m_sparse)
+    {
+        //The whole texture, no memory behind it until pages are bound
+        imageInfo.flags = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+        imageInfo.extent = { m_file.GetWidth(), m_file.GetHeight(), 1 };
+        imageInfo.mipLevels = m_file.GetLevelCount();
+
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &m_image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create sparse virtual texture image!");
+        }
+
+        uint32_t count = 0;
+        vkGetImageSparseMemoryRequirements(m_device, m_image, &count, nullptr);
+        std::vector<VkSparseImageMemoryRequirements> requirements(count);
+        vkGetImageSparseMemoryRequirements(m_device, m_image, &count, requirements.data());
+
+        m_pageLevels = 0;
+        for (const VkSparseImageMemoryRequirements& requirement : requirements)
+        {
+            if (requirement.formatProperties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT)
+            {
+                m_mipTailFirstLevel = std::min(requirement.imageMipTailFirstLod, m_file.GetLevelCount());
+                m_mipTailSize = requirement.imageMipTailSize;
+                m_mipTailOffset = requirement.imageMipTailOffset;
+                m_pageLevels = m_mipTailFirstLevel;
+            }
+        }
+
+        //Everything in the mip tail, nothing to page. Small enough for the atlas anyway.
+        if (m_pageLevels == 0)
+        {
+            vkDestroyImage(m_device, m_image, nullptr);
+            m_image = VK_NULL_HANDLE;
+            m_sparse = false;
+            m_pageWidth = m_settings.m_pageSize;
+            m_pageHeight = m_settings.m_pageSize;
+        }
+    }
+
+    if (!m_sparse)
+    {
+        //Down to the first level that fits in a single page, that one is pinned as the root
+        m_pageLevels = 0;
+        for (uint32_t level = 0; level < m_file.GetLevelCount() && m_pageLevels == 0; level++)
+        {
+            if (m_file.GetLevelWidth(level) <= m_pageWidth && m_file.GetLevelHeight(level) <= m_pageHeight)
+            {
+                m_pageLevels = level + 1;
+            }
+        }
+        if (m_pageLevels == 0)
+        {
+            throw std::runtime_error("virtual texture needs mips down to a single page!");
+        }
+
+        uint32_t maxPagesPerRow = std::min(m_caps->GetLimits().maxImageDimension2D / m_pageWidth, MAX_CACHE_PAGES_PER_ROW);
+        m_cachePagesPerRow = 1;
+        while (m_cachePagesPerRow * m_cachePagesPerRow < m_settings.m_cachePages && m_cachePagesPerRow < maxPagesPerRow)
+        {
+            m_cachePagesPerRow++;
+        }
+
+        imageInfo.flags = 0;
+        imageInfo.extent = { m_cachePagesPerRow * m_pageWidth, m_cachePagesPerRow * m_pageHeight, 1 };
+        imageInfo.mipLevels = 1;
+
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &m_image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create virtual texture cache image!");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(m_device, m_image, &requirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = Util::FindMemoryType(m_caps->GetMemoryProperties(), requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_imageMemory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate virtual texture cache memory!");
+        }
+
+        vkBindImageMemory(m_device, m_image, m_imageMemory, 0);
+    }
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = m_format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = m_sparse ? m_file.GetLevelCount() : 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_imageView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create virtual texture image view!");
+    }
+
+    //A texel per page of the full size level, and a level per paged mip
+    VkImageCreateInfo tableInfo = {};
+    tableInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    tableInfo.imageType = VK_IMAGE_TYPE_2D;
+    tableInfo.format = VK_FORMAT_R8G8B8A8_UINT;
+    tableInfo.extent = { std::max(1u, m_file.GetWidth() / m_pageWidth), std::max(1u, m_file.GetHeight() / m_pageHeight), 1 };
+    tableInfo.mipLevels = m_pageLevels;
+    tableInfo.arrayLayers = 1;
+    tableInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    tableInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    tableInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    tableInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    tableInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(m_device, &tableInfo, nullptr, &m_pageTable) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create virtual texture page table!");
+    }
+
+    VkMemoryRequirements tableRequirements;
+    vkGetImageMemoryRequirements(m_device, m_pageTable, &tableRequirements);
+
+    VkMemoryAllocateInfo tableAllocInfo = {};
+    tableAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    tableAllocInfo.allocationSize = tableRequirements.size;
+    tableAllocInfo.memoryTypeIndex = Util::FindMemoryType(m_caps->GetMemoryProperties(), tableRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(m_device, &tableAllocInfo, nullptr, &m_pageTableMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate virtual texture page table memory!");
+    }
+
+    vkBindImageMemory(m_device, m_pageTable, m_pageTableMemory, 0);
+
+    viewInfo.image = m_pageTable;
+    viewInfo.format = VK_FORMAT_R8G8B8A8_UINT;
+    viewInfo.subresourceRange.levelCount = m_pageLevels;
+
+    if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_pageTableView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create virtual texture page table view!");
+    }
+}
+
+void VirtualTexture::CreateSparseMemory()
+{
+    //Sparse blocks are bound at multiples of the alignment, which is the tile size
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, m_image, &requirements);
+    m_tileSize = requirements.alignment;
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = m_tileSize * m_settings.m_cachePages;
+    allocInfo.memoryTypeIndex = Util::FindMemoryType(m_caps->GetMemoryProperties(), requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_imageMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate virtual texture page pool!");
+    }
+
+    //The mip tail is always resident, bound with the first frame's pages
+    if (m_mipTailSize != 0)
+    {
+        allocInfo.allocationSize = (m_mipTailSize + m_tileSize - 1) / m_tileSize * m_tileSize;
+
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_mipTailMemory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate virtual texture mip tail!");
+        }
+    }
+}
+
+void VirtualTexture::CreateFeedback(uint32_t slotCount, VkExtent2D renderExtent)
+{
+    uint32_t scale = std::max(1u, m_settings.m_feedbackScale);
+    uint32_t feedbackWidth = (renderExtent.width + scale - 1) / scale;
+    uint32_t feedbackHeight = (renderExtent.height + scale - 1) / scale;
+    m_feedbackSize = VkDeviceSize(feedbackWidth) * feedbackHeight * sizeof(uint32_t);
+
+    //Written by fragment shaders, cleared and copied out by transfers
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_feedbackSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &m_feedbackBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create virtual texture feedback buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, m_feedbackBuffer, &requirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = Util::FindMemoryType(m_caps->GetMemoryProperties(), requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_feedbackMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate virtual texture feedback memory!");
+    }
+
+    vkBindBufferMemory(m_device, m_feedbackBuffer, m_feedbackMemory, 0);
+
+    //One buffer on the GPU, copied out per slot so the CPU reads it frames later without stalling
+    m_feedbackReadback.Init(m_device, m_caps->GetMemoryProperties(), slotCount, m_feedbackSize, m_timeline);
+
+    float width = static_cast<float>(m_file.GetWidth());
+    float height = static_cast<float>(m_file.GetHeight());
+    m_constants.m_virtualSize[0] = width;
+    m_constants.m_virtualSize[1] = height;
+    m_constants.m_virtualSize[2] = 1.0f / width;
+    m_constants.m_virtualSize[3] = 1.0f / height;
+    m_constants.m_page[0] = static_cast<float>(m_pageWidth);
+    m_constants.m_page[1] = static_cast<float>(m_pageHeight);
+    m_constants.m_page[2] = static_cast<float>(m_pageLevels);
+    m_constants.m_page[3] = m_sparse ? 1.0f : 0.0f;
+    m_constants.m_cache[0] = static_cast<float>(m_cachePagesPerRow * m_pageWidth);
+    m_constants.m_cache[1] = static_cast<float>(m_cachePagesPerRow * m_pageHeight);
+    m_constants.m_cache[2] = static_cast<float>(m_cachePagesPerRow);
+    m_constants.m_cache[3] = static_cast<float>(scale);
+    m_constants.m_feedback[0] = static_cast<float>(feedbackWidth);
+    m_constants.m_feedback[1] = static_cast<float>(feedbackHeight);
+
+    //Written once, so plain host visible memory is fine
+    bufferInfo.size = sizeof(VirtualTextureConstants);
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &m_constantBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create virtual texture constant buffer!");
+    }
+
+    vkGetBufferMemoryRequirements(m_device, m_constantBuffer, &requirements);
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = Util::FindMemoryType(m_caps->GetMemoryProperties(), requirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_constantMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate virtual texture constant memory!");
+    }
+
+    vkBindBufferMemory(m_device, m_constantBuffer, m_constantMemory, 0);
+
+    void* mapped = nullptr;
+    if (vkMapMemory(m_device, m_constantMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map virtual texture constant memory!");
+    }
+    std::memcpy(mapped, &m_constants, sizeof(m_constants));
+    vkUnmapMemory(m_device, m_constantMemory);
+}
+
+void VirtualTexture::CreateDescriptorSet()
+{
+    //Page table entries are integers, only ever fetched
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = static_cast<float>(m_pageLevels);
+    m_pageTableSampler = m_samplers->Acquire(samplerInfo);
+
+    //The atlas has one level and shaders pick the LOD themselves, the sparse image has them all
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = m_sparse ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.maxLod = m_sparse ? static_cast<float>(m_file.GetLevelCount()) : 0.0f;
+    m_imageSampler = m_samplers->Acquire(samplerInfo);
+
+    //Neither sampler ever changes, so they're part of the layout
+    VkDescriptorSetLayoutBinding bindings[4] = {};
+    const VkDescriptorType types[4] =
+    {
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+    };
+    bindings[0] = m_samplers->GetImmutableBinding(0, VK_SHADER_STAGE_FRAGMENT_BIT, m_pageTableSampler);
+    bindings[1] = m_samplers->GetImmutableBinding(1, VK_SHADER_STAGE_FRAGMENT_BIT, m_imageSampler);
+    for (uint32_t i = 2; i < 4; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = types[i];
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create virtual texture set layout!");
+    }
+
+    VkDescriptorPoolSize poolSizes[3] = {};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 2;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[2].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create virtual texture descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_setLayout;
+
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate virtual texture descriptor set!");
+    }
+
+    //Nothing in the set ever changes, residency only changes what the images contain.
+    //The samplers are immutable, only the views are written.
+    VkDescriptorImageInfo imageInfos[2] = {};
+    imageInfos[0].imageView = m_pageTableView;
+    imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfos[1].imageView = m_imageView;
+    imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkDescriptorBufferInfo bufferInfos[2] = {};
+    bufferInfos[0].buffer = m_feedbackBuffer;
+    bufferInfos[0].range = VK_WHOLE_SIZE;
+    bufferInfos[1].buffer = m_constantBuffer;
+    bufferInfos[1].range = sizeof(VirtualTextureConstants);
+
+    VkWriteDescriptorSet writes[4] = {};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = types[i];
+    }
+    writes[0].pImageInfo = &imageInfos[0];
+    writes[1].pImageInfo = &imageInfos[1];
+    writes[2].pBufferInfo = &bufferInfos[0];
+    writes[3].pBufferInfo = &bufferInfos[1];
+
+    vkUpdateDescriptorSets(m_device, 4, writes, 0, nullptr);
+}
+
+void VirtualTexture::CreateCommandBuffers(uint32_t slotCount)
+{
+    //Rerecorded every frame the slot comes around
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = m_queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create virtual texture command pool!");
+    }
+
+    m_commandBuffers.resize(slotCount);
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = slotCount;
+
+    if (vkAllocateCommandBuffers(m_device, &allocInfo, m_commandBuffers.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate virtual texture command buffers!");
+    }
+
+    if (!m_sparse)
+    {
+        return;
+    }
+
+    m_bindSemaphores.resize(slotCount);
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (VkSemaphore& semaphore : m_bindSemaphores)
+    {
+        if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create virtual texture bind semaphore!");
+        }
+    }
+}
+
+void VirtualTexture::InitPageTable()
+{
+    //Until anything is loaded every entry points at the fallback: the pinned root page, or
+    //the mip tail which the LOD clamp then never goes below
+    uint32_t fallback = PageTable::PackEntry(0, 0, m_pageLevels);
+    if (!m_sparse)
+    {
+        uint32_t root = VirtualPage::Pack(m_pageLevels - 1, 0, 0);
+        uint32_t evicted = VirtualPage::INVALID;
+        uint32_t slot = m_cache.Insert(root, 0, evicted);
+        m_cache.Pin(root);
+        fallback = GetSlotEntry(slot, m_pageLevels - 1);
+    }
+
+    m_table.Init(m_pageLevels, m_file.GetWidth() / m_pageWidth, m_file.GetHeight() / m_pageHeight, fallback);
+}
+
+VkOffset2D VirtualTexture::GetPageOffset(uint32_t page) const
+{
+    return { static_cast<int32_t>(VirtualPage::GetX(page) * m_pageWidth), static_cast<int32_t>(VirtualPage::GetY(page) * m_pageHeight) };
+}
+
+VkExtent2D VirtualTexture::GetPageExtent(uint32_t page) const
+{
+    //Only levels smaller than a page have a partial one
+    uint32_t mip = VirtualPage::GetMip(page);
+    VkOffset2D offset = GetPageOffset(page);
+    return { std::min(m_pageWidth, m_file.GetLevelWidth(mip) - offset.x), std::min(m_pageHeight, m_file.GetLevelHeight(mip) - offset.y) };
+}
+
+VkOffset2D VirtualTexture::GetSlotOffset(uint32_t slot) const
+{
+    return { static_cast<int32_t>(slot % m_cachePagesPerRow * m_pageWidth), static_cast<int32_t>(slot / m_cachePagesPerRow * m_pageHeight) };
+}
+
+uint32_t VirtualTexture::GetSlotEntry(uint32_t slot, uint32_t mip) const
+{
+    //Sparse pages sit at their own place in the image, the entry only says they're there
+    return m_sparse ? PageTable::PackEntry(0, 0, mip) : PageTable::PackEntry(slot % m_cachePagesPerRow, slot / m_cachePagesPerRow, mip);
+}
+
+bool VirtualTexture::StagePage(uint32_t page, VkOffset2D dstOffset, uint32_t dstLevel, std::pmr::vector<VkBufferImageCopy>& copies)
+{
+    uint32_t mip = VirtualPage::GetMip(page);
+    VkOffset2D offset = GetPageOffset(page);
+    VkExtent2D extent = GetPageExtent(page);
+
+    //Rows of blocks, the page's slice of each is contiguous in the file
+    uint32_t blockSize = IsBlockCompressed(m_codec) ? 4 : 1;
+    uint32_t blockBytes = GetCodecBlockBytes(m_codec);
+    uint32_t levelBlocksWide = (m_file.GetLevelWidth(mip) + blockSize - 1) / blockSize;
+    uint32_t blocksWide = (extent.width + blockSize - 1) / blockSize;
+    uint32_t blocksHigh = (extent.height + blockSize - 1) / blockSize;
+    size_t encodedSize = size_t(blocksWide) * blocksHigh * blockBytes;
+
+    StagingRing::Allocation allocation = m_staging.Allocate(m_decode ? size_t(extent.width) * extent.height * 4 : encodedSize);
+    if (allocation.m_data == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t* encoded = static_cast<uint8_t*>(allocation.m_data);
+    if (m_decode)
+    {
+        m_decodeScratch.resize(encodedSize);
+        encoded = m_decodeScratch.data();
+    }
+
+    size_t rowBytes = size_t(blocksWide) * blockBytes;
+    for (uint32_t row = 0; row < blocksHigh; row++)
+    {
+        uint64_t blockRow = offset.y / blockSize + row;
+        m_file.ReadLevelRange(mip, (blockRow * levelBlocksWide + offset.x / blockSize) * blockBytes, rowBytes, encoded + row * rowBytes);
+    }
+
+    if (m_decode)
+    {
+        std::vector<uint8_t> rgba = DecompressImage(m_codec, encoded, extent.width, extent.height);
+        std::memcpy(allocation.m_data, rgba.data(), rgba.size());
+        blockSize = 1;
+    }
+
+    //Atlas copies land in the middle of the image, where they have to cover whole blocks
+    VkBufferImageCopy copy = {};
+    copy.bufferOffset = allocation.m_offset;
+    copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy.imageSubresource.mipLevel = dstLevel;
+    copy.imageSubresource.baseArrayLayer = 0;
+    copy.imageSubresource.layerCount = 1;
+    copy.imageOffset = { dstOffset.x, dstOffset.y, 0 };
+    copy.imageExtent = { extent.width, extent.height, 1 };
+    if (!m_sparse)
+    {
+        copy.imageExtent.width = (extent.width + blockSize - 1) / blockSize * blockSize;
+        copy.imageExtent.height = (extent.height + blockSize - 1) / blockSize * blockSize;
+    }
+    copies.push_back(copy);
+
+    return true;
+}
+
+bool VirtualTexture::StageMipTail(std::pmr::vector<VkBufferImageCopy>& copies)
+{
+    for (uint32_t level = m_mipTailFirstLevel; level < m_file.GetLevelCount(); level++)
+    {
+        StagingRing::Allocation allocation = m_staging.Allocate(m_file.GetLevelSize(level));
+        if (allocation.m_data == nullptr)
+        {
+            return false;
+        }
+
+        m_file.ReadLevel(level, allocation.m_data);
+
+        VkBufferImageCopy copy = {};
+        copy.bufferOffset = allocation.m_offset;
+        copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.imageSubresource.mipLevel = level;
+        copy.imageSubresource.baseArrayLayer = 0;
+        copy.imageSubresource.layerCount = 1;
+        copy.imageExtent = { m_file.GetLevelWidth(level), m_file.GetLevelHeight(level), 1 };
+        copies.push_back(copy);
+    }
+
+    return true;
+}
+
+void VirtualTexture::StagePageTable(std::pmr::vector<VkBufferImageCopy>& copies)
+{
+    for (uint32_t level = 0; level < m_pageLevels; level++)
+    {
+        const PageTable::DirtyRect& dirty = m_table.GetDirty(level);
+        if (dirty.IsEmpty())
+        {
+            continue;
+        }
+
+        uint32_t width = dirty.m_x1 - dirty.m_x0;
+        uint32_t height = dirty.m_y1 - dirty.m_y0;
+        StagingRing::Allocation allocation = m_staging.Allocate(size_t(width) * height * sizeof(uint32_t));
+        if (allocation.m_data == nullptr)
+        {
+            return;
+        }
+
+        const std::vector<uint32_t>& entries = m_table.GetLevel(level);
+        uint32_t* dst = static_cast<uint32_t*>(allocation.m_data);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            std::memcpy(dst + size_t(y) * width, &entries[size_t(dirty.m_y0 + y) * m_table.GetWidth(level) + dirty.m_x0], width * sizeof(uint32_t));
+        }
+
+        VkBufferImageCopy copy = {};
+        copy.bufferOffset = allocation.m_offset;
+        copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.imageSubresource.mipLevel = level;
+        copy.imageSubresource.baseArrayLayer = 0;
+        copy.imageSubresource.layerCount = 1;
+        copy.imageOffset = { static_cast<int32_t>(dirty.m_x0), static_cast<int32_t>(dirty.m_y0), 0 };
+        copy.imageExtent = { width, height, 1 };
+        copies.push_back(copy);
+
+        m_table.ClearDirty(level);
+    }
+}
+
+void VirtualTexture::BindSparse(const std::pmr::vector<VkSparseImageMemoryBind>& binds, bool waitForFrames, VkSemaphore signal)
+{
+    VkBindSparseInfo bindInfo = {};
+    bindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    bindInfo.signalSemaphoreCount = 1;
+    bindInfo.pSignalSemaphores = &signal;
+
+    VkSparseImageMemoryBindInfo imageBinds = {};
+    if (!binds.empty())
+    {
+        imageBinds.image = m_image;
+        imageBinds.bindCount = static_cast<uint32_t>(binds.size());
+        imageBinds.pBinds = binds.data();
+        bindInfo.imageBindCount = 1;
+        bindInfo.pImageBinds = &imageBinds;
+    }
+
+    VkSparseMemoryBind mipTailBind = {};
+    VkSparseImageOpaqueMemoryBindInfo opaqueBinds = {};
+    if (m_firstUpload && m_mipTailMemory != VK_NULL_HANDLE)
+    {
+        mipTailBind.resourceOffset = m_mipTailOffset;
+        mipTailBind.size = m_mipTailSize;
+        mipTailBind.memory = m_mipTailMemory;
+        mipTailBind.memoryOffset = 0;
+        opaqueBinds.image = m_image;
+        opaqueBinds.bindCount = 1;
+        opaqueBinds.pBinds = &mipTailBind;
+        bindInfo.imageOpaqueBindCount = 1;
+        bindInfo.pImageOpaqueBinds = &opaqueBinds;
+    }
+
+    //Binds aren't ordered against earlier submits, and an evicted page may still be sampled
+    //by frames in flight. Those have to finish first, on the GPU if the timeline can be waited on.
+    SyncPoint wait = m_timeline->GetSyncPoint(m_timeline->GetLastSubmitted());
+#ifdef VK_KHR_timeline_semaphore
+    uint64_t signalValue = 0;
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+#endif //VK_KHR_timeline_semaphore
+    if (waitForFrames && !m_timeline->IsComplete(wait.m_value))
+    {
+#ifdef VK_KHR_timeline_semaphore
+        if (m_timeline->IsNative())
+        {
+            timelineInfo.waitSemaphoreValueCount = 1;
+            timelineInfo.pWaitSemaphoreValues = &wait.m_value;
+            timelineInfo.signalSemaphoreValueCount = 1;
+            timelineInfo.pSignalSemaphoreValues = &signalValue;
+            bindInfo.waitSemaphoreCount = 1;
+            bindInfo.pWaitSemaphores = &wait.m_semaphore;
+            bindInfo.pNext = &timelineInfo;
+        }
+        else
+#endif //VK_KHR_timeline_semaphore
+        {
+            PROFILE_SCOPE("WaitForSparseUnbind");
+            m_timeline->Wait(wait.m_value);
+        }
+    }
+
+    if (vkQueueBindSparse(m_queue, 1, &bindInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to bind virtual texture pages!");
+    }
+}
+
+void VirtualTexture::RecordUploads(VkCommandBuffer cmd, const std::pmr::vector<VkBufferImageCopy>& pageCopies, const std::pmr::vector<VkBufferImageCopy>& tableCopies)
+{
+    struct Target
+    {
+        VkImage m_image;
+        uint32_t m_levels;
+        const std::pmr::vector<VkBufferImageCopy>* m_copies;
+    };
+    const Target targets[2] =
+    {
+        { m_image, m_sparse ? m_file.GetLevelCount() : 1, &pageCopies },
+        { m_pageTable, m_pageLevels, &tableCopies }
+    };
+
+    for (const Target& target : targets)
+    {
+        if (target.m_copies->empty())
+        {
+            continue;
+        }
+
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = target.m_image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = target.m_levels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        //Earlier frames sampling the old contents come before the copies overwrite them
+        barrier.oldLayout = m_firstUpload ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        vkCmdCopyBufferToImage(cmd, m_staging.GetBuffer(), target.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(target.m_copies->size()), target.m_copies->data());
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+VirtualTexture::Update VirtualTexture::BeginFrame(uint32_t slot, uint64_t frame, std::pmr::memory_resource* scratch)
+{
+    PROFILE_SCOPE("VirtualTextureUpdate");
+
+    //The slot's frame is done, so its feedback is there without waiting. The root is pinned
+    //and never requested, the sparse mip tail isn't paged at all.
+    uint32_t requestLevels = m_sparse ? m_pageLevels : m_pageLevels - 1;
+    m_feedbackReadback.Acquire(slot, [this, requestLevels](uint64_t, const void* data, VkDeviceSize size)
+    {
+        m_prioritizer.AddFeedback(static_cast<const uint32_t*>(data), static_cast<size_t>(size / sizeof(uint32_t)), requestLevels);
+    });
+
+    std::pmr::vector<uint32_t> pages = m_prioritizer.Prioritize(m_cache, frame, m_settings.m_uploadsPerFrame, scratch);
+    m_peakRequests = std::max(m_peakRequests, m_prioritizer.GetLastRequestCount());
+
+    m_staging.BeginFrame(slot);
+    std::pmr::vector<VkBufferImageCopy> pageCopies(scratch);
+    std::pmr::vector<VkBufferImageCopy> tableCopies(scratch);
+    std::pmr::vector<VkSparseImageMemoryBind> binds(scratch);
+    bool evicting = false;
+
+    //The region is sized for a full frame of pages, the whole page table and the mip tail
+    bool staged = true;
+    if (m_firstUpload)
+    {
+        if (m_sparse)
+        {
+            staged = StageMipTail(pageCopies);
+        }
+        else
+        {
+            uint32_t root = VirtualPage::Pack(m_pageLevels - 1, 0, 0);
+            uint32_t rootSlot = m_cache.Find(root);
+            staged = StagePage(root, GetSlotOffset(rootSlot), 0, pageCopies);
+        }
+    }
+
+    for (size_t i = 0; i < pages.size() && staged; i++)
+    {
+        uint32_t page = pages[i];
+        uint32_t evicted = VirtualPage::INVALID;
+        uint32_t cacheSlot = m_cache.Insert(page, frame, evicted);
+        if (cacheSlot == PageCache::INVALID_SLOT)
+        {
+            //Every resident page is still in use, try again once some aren't
+            m_deferredPages += pages.size() - i;
+            break;
+        }
+
+        VkSparseImageMemoryBind bind = {};
+        bind.subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        bind.subresource.arrayLayer = 0;
+
+        if (evicted != VirtualPage::INVALID)
+        {
+            m_table.Unmap(evicted);
+            evicting = true;
+
+            if (m_sparse)
+            {
+                VkOffset2D offset = GetPageOffset(evicted);
+                VkExtent2D extent = GetPageExtent(evicted);
+                bind.subresource.mipLevel = VirtualPage::GetMip(evicted);
+                bind.offset = { offset.x, offset.y, 0 };
+                bind.extent = { extent.width, extent.height, 1 };
+                bind.memory = VK_NULL_HANDLE;
+                binds.push_back(bind);
+            }
+        }
+
+        if (m_sparse)
+        {
+            VkOffset2D offset = GetPageOffset(page);
+            VkExtent2D extent = GetPageExtent(page);
+            bind.subresource.mipLevel = VirtualPage::GetMip(page);
+            bind.offset = { offset.x, offset.y, 0 };
+            bind.extent = { extent.width, extent.height, 1 };
+            bind.memory = m_imageMemory;
+            bind.memoryOffset = cacheSlot * m_tileSize;
+            binds.push_back(bind);
+
+            staged = StagePage(page, offset, VirtualPage::GetMip(page), pageCopies);
+        }
+        else
+        {
+            staged = StagePage(page, GetSlotOffset(cacheSlot), 0, pageCopies);
+        }
+
+        m_table.Map(page, GetSlotEntry(cacheSlot, VirtualPage::GetMip(page)));
+        m_uploadedPages++;
+    }
+
+    StagePageTable(tableCopies);
+
+    //A page in the table without its texels (or a table lagging behind an evicted slot) would
+    //sample garbage, the region is sized so this never happens
+    if (!staged || m_table.IsDirty())
+    {
+        throw std::runtime_error("virtual texture staging region is full!");
+    }
+
+    Update update;
+    if (pageCopies.empty() && tableCopies.empty())
+    {
+        return update;
+    }
+
+    if (m_sparse && (!binds.empty() || m_firstUpload))
+    {
+        BindSparse(binds, evicting, m_bindSemaphores[slot]);
+        update.m_waitSemaphore = m_bindSemaphores[slot];
+    }
+
+    VkCommandBuffer cmd = m_commandBuffers[slot];
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &beginInfo);
+    RecordUploads(cmd, pageCopies, tableCopies);
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record virtual texture uploads!");
+    }
+
+    m_firstUpload = false;
+    update.m_commandBuffer = cmd;
+
+    return update;
+}
+
+void VirtualTexture::RecordFeedbackClear(VkCommandBuffer cmd) const
+{
+    //The last frame's copy out has to be done reading before the buffer is cleared
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = m_feedbackBuffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    //Every entry nothing writes to reads as VirtualPage::INVALID
+    vkCmdFillBuffer(cmd, m_feedbackBuffer, 0, VK_WHOLE_SIZE, VirtualPage::INVALID);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void VirtualTexture::RecordFeedbackCopy(VkCommandBuffer cmd, uint32_t slot) const
+{
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = m_feedbackBuffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    m_feedbackReadback.RecordCopy(cmd, slot, m_feedbackBuffer, m_feedbackSize);
+}
+
+void VirtualTexture::Destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    m_feedbackReadback.Destroy();
+    m_staging.Destroy();
+
+    //Freeing the pools frees the sets and command buffers with them
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    for (VkSemaphore semaphore : m_bindSemaphores)
+    {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+    //After the layout that has them baked in
+    m_samplers->Release(m_pageTableSampler);
+    m_samplers->Release(m_imageSampler);
+
+    vkDestroyBuffer(m_device, m_constantBuffer, nullptr);
+    vkFreeMemory(m_device, m_constantMemory, nullptr);
+    vkDestroyBuffer(m_device, m_feedbackBuffer, nullptr);
+    vkFreeMemory(m_device, m_feedbackMemory, nullptr);
+
+    vkDestroyImageView(m_device, m_pageTableView, nullptr);
+    vkDestroyImage(m_device, m_pageTable, nullptr);
+    vkFreeMemory(m_device, m_pageTableMemory, nullptr);
+    vkDestroyImageView(m_device, m_imageView, nullptr);
+    vkDestroyImage(m_device, m_image, nullptr);
+    vkFreeMemory(m_device, m_imageMemory, nullptr);
+    vkFreeMemory(m_device, m_mipTailMemory, nullptr);
+
+    m_commandPool = VK_NULL_HANDLE;
+    m_commandBuffers.clear();
+    m_bindSemaphores.clear();
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_setLayout = VK_NULL_HANDLE;
+    m_pageTableSampler = VK_NULL_HANDLE;
+    m_imageSampler = VK_NULL_HANDLE;
+    m_constantBuffer = VK_NULL_HANDLE;
+    m_constantMemory = VK_NULL_HANDLE;
+    m_feedbackBuffer = VK_NULL_HANDLE;
+    m_feedbackMemory = VK_NULL_HANDLE;
+    m_pageTableView = VK_NULL_HANDLE;
+    m_pageTable = VK_NULL_HANDLE;
+    m_pageTableMemory = VK_NULL_HANDLE;
+    m_imageView = VK_NULL_HANDLE;
+    m_image = VK_NULL_HANDLE;
+    m_imageMemory = VK_NULL_HANDLE;
+    m_mipTailMemory = VK_NULL_HANDLE;
+    m_table.Clear();
+    m_file.Close();
+    m_device = VK_NULL_HANDLE;
+}
+
+void VirtualTexture::PrintReport(std::ostream& out) const
+{
+    out << "virtual texture: " << m_file.GetWidth() << "x" << m_file.GetHeight() << " " << GetTextureCodecName(m_codec)
+        << (m_decode ? " (decoded)" : "") << ", " << (m_sparse ? "sparse" : "software") << ", " << m_pageWidth << "x" << m_pageHeight
+        << " pages over " << m_pageLevels << " levels" << std::endl;
+    out << "virtual texture: " << m_cache.GetResidentCount() << "/" << m_cache.GetSlotCount() << " pages resident, "
+        << m_uploadedPages << " uploaded, " << m_cache.GetEvictionCount() << " evicted, " << m_deferredPages << " deferred, "
+        << m_peakRequests << " pages requested by the busiest frame" << std::endl;
+}
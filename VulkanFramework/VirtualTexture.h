@@ -0,0 +1,208 @@
+#ifndef __VIRTUAL_TEXTURE_H__
+#define __VIRTUAL_TEXTURE_H__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "DeviceCaps.h"
+#include "QueueTimeline.h"
+#include "ReadbackRing.h"
+#include "SamplerCache.h"
+#include "StagingRing.h"
+#include "TextureFile.h"
+#include "VirtualTexturePages.h"
+
+struct VirtualTextureSettings
+{
+    //Page side in texels on the software path, sparse images use the device's tile size
+    uint32_t m_pageSize = 128;
+    //Physical pages kept resident
+    uint32_t m_cachePages = 256;
+    //Pages read and uploaded per frame at most, the rest wait for later frames
+    uint32_t m_uploadsPerFrame = 8;
+    //Feedback has one entry per m_feedbackScale x m_feedbackScale pixels
+    uint32_t m_feedbackScale = 8;
+    //Sparse residency when the device has it, the software path otherwise
+    bool m_allowSparse = true;
+};
+
+//Constants Shaders/VirtualTexture.glsl reads, binding 3 of the set. std140, so vec4s only.
+struct VirtualTextureConstants
+{
+    //Width, height and their reciprocals, in texels of the full size level
+    float m_virtualSize[4];
+    //Page width and height, page table levels, 1 for sparse
+    float m_page[4];
+    //Width and height of the physical cache image, pages per row of it, feedback scale
+    float m_cache[4];
+    //Width and height of the feedback buffer
+    float m_feedback[4];
+};
+
+//A texture far bigger than memory, only the pages something actually samples are resident.
+//Shaders write the page they want per block of pixels into a feedback buffer, which comes
+//back through a ReadbackRing slot once its frame is done. PagePrioritizer picks what to load,
+//PageCache decides where it goes and what gets evicted, and the pages are read straight from
+//the TextureFile into a StagingRing region and copied on the graphics queue ahead of the frame.
+//A page table image with a level per mip says, for every page, the finest resident page
+//covering it; that's how shaders fall back to coarser data while finer pages stream in.
+//Two ways of holding the pages:
+//- Sparse: with sparseResidencyImage2D the texture is one sparse image and pages are its
+//  tiles, bound to slots of a memory pool with vkQueueBindSparse. The page table only
+//  clamps the sampled LOD to what's resident, filtering and mips are the hardware's.
+//- Software: pages are copied into slots of a single level atlas and the page table holds
+//  each page's slot. The coarsest mip that fits in one page is pinned as the fallback.
+//  Pages have no borders, so bilinear filtering bleeds into the neighbouring slot at page edges.
+//Main thread only. Slots are the swapchain images, the command buffers record the feedback
+//clear and copy per image like everything else.
+class VirtualTexture
+{
+public:
+    //What a frame's submit has to run before its own command buffer
+    struct Update
+    {
+        //Null when there was nothing to upload
+        VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+        //Binary semaphore from the sparse binds, waited for at the transfer stage
+        VkSemaphore m_waitSemaphore = VK_NULL_HANDLE;
+    };
+
+    //queue has to be the timeline's, and support sparse binding for the sparse path to be used.
+    //Throws if the file can't be paged (no mips down to a single page) or the format can't be sampled.
+    //Both samplers come from samplers and are immutable in the set layout
+    void Init(VkDevice device, const DeviceCaps* caps, VkQueue queue, uint32_t queueFamily, QueueTimeline* timeline, SamplerCache* samplers,
+        const std::string& path, uint32_t slotCount, VkExtent2D renderExtent, const VirtualTextureSettings& settings = VirtualTextureSettings());
+    //The device has to be idle
+    void Destroy();
+    bool IsLoaded() const { return m_device != VK_NULL_HANDLE; }
+
+    //Sparse binding and sparseResidencyImage2D, what CreateLogicalDevice has to enable for the sparse path
+    static bool CanUseSparse(const DeviceCaps& caps, uint32_t queueFamily);
+
+    //Takes in the slot's feedback, picks pages and records their uploads. The slot's last
+    //submission has to be done, frame has to increase with every call. The frame's page
+    //list, copies and binds are allocated from scratch (see FrameArena).
+    Update BeginFrame(uint32_t slot, uint64_t frame, std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+    //The slot's frame went out with this timeline value
+    void Submitted(uint32_t slot, uint64_t frame, uint64_t value) { m_feedbackReadback.Submitted(slot, frame, value); }
+
+    //Recorded into the slot's frame command buffer, outside any render pass, before and after
+    //everything that samples the texture
+    void RecordFeedbackClear(VkCommandBuffer cmd) const;
+    void RecordFeedbackCopy(VkCommandBuffer cmd, uint32_t slot) const;
+
+    //Page table, cache image, feedback buffer and constants, fragment stage
+    VkDescriptorSetLayout GetSetLayout() const { return m_setLayout; }
+    VkDescriptorSet GetDescriptorSet() const { return m_descriptorSet; }
+
+    bool IsSparse() const { return m_sparse; }
+    uint32_t GetWidth() const { return m_file.GetWidth(); }
+    uint32_t GetHeight() const { return m_file.GetHeight(); }
+    uint32_t GetResidentPages() const { return m_cache.GetResidentCount(); }
+    uint64_t GetUploadedPages() const { return m_uploadedPages; }
+
+    void PrintReport(std::ostream& out) const;
+
+private:
+    void ChooseLayout(bool allowSparse);
+    void CreateImages();
+    void CreateSparseMemory();
+    void CreateFeedback(uint32_t slotCount, VkExtent2D renderExtent);
+    void CreateDescriptorSet();
+    void CreateCommandBuffers(uint32_t slotCount);
+    void InitPageTable();
+
+    //Texel rectangle of a page within its level
+    VkOffset2D GetPageOffset(uint32_t page) const;
+    VkExtent2D GetPageExtent(uint32_t page) const;
+    //Where a cache slot is in the software atlas
+    VkOffset2D GetSlotOffset(uint32_t slot) const;
+    //Page table entry pointing at a cache slot
+    uint32_t GetSlotEntry(uint32_t slot, uint32_t mip) const;
+    //Reads the page into staging and records where it goes, false if the staging region is full
+    bool StagePage(uint32_t page, VkOffset2D dstOffset, uint32_t dstLevel, std::pmr::vector<VkBufferImageCopy>& copies);
+    //Mip tail levels of a sparse image, false if the staging region is full
+    bool StageMipTail(std::pmr::vector<VkBufferImageCopy>& copies);
+
+    //Stages dirty page table rectangles, they stay dirty if the staging region is full
+    void StagePageTable(std::pmr::vector<VkBufferImageCopy>& copies);
+
+    void BindSparse(const std::pmr::vector<VkSparseImageMemoryBind>& binds, bool waitForFrames, VkSemaphore signal);
+    void RecordUploads(VkCommandBuffer cmd, const std::pmr::vector<VkBufferImageCopy>& pageCopies, const std::pmr::vector<VkBufferImageCopy>& tableCopies);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    const DeviceCaps* m_caps = nullptr;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    uint32_t m_queueFamily = 0;
+    QueueTimeline* m_timeline = nullptr;
+    SamplerCache* m_samplers = nullptr;
+    VirtualTextureSettings m_settings;
+
+    TextureFile m_file;
+    TextureCodec m_codec = TextureCodec::RGBA8;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    //Pages are decoded to RGBA8 on the CPU, the device can't sample the file's format
+    bool m_decode = false;
+    std::vector<uint8_t> m_decodeScratch;
+    bool m_sparse = false;
+    uint32_t m_pageWidth = 0;
+    uint32_t m_pageHeight = 0;
+    //Levels with pages in the page table. Software: down to and including the root level
+    //that fits in one page. Sparse: everything before the mip tail.
+    uint32_t m_pageLevels = 0;
+
+    PageCache m_cache;
+    PagePrioritizer m_prioritizer;
+
+    //Software atlas, or the whole sparse image
+    VkImage m_image = VK_NULL_HANDLE;
+    VkDeviceMemory m_imageMemory = VK_NULL_HANDLE;
+    VkImageView m_imageView = VK_NULL_HANDLE;
+    uint32_t m_cachePagesPerRow = 0;
+    //Sparse only: one tile sized block per cache slot, and the mip tail
+    VkDeviceSize m_tileSize = 0;
+    uint32_t m_mipTailFirstLevel = 0;
+    VkDeviceSize m_mipTailSize = 0;
+    VkDeviceSize m_mipTailOffset = 0;
+    VkDeviceMemory m_mipTailMemory = VK_NULL_HANDLE;
+    std::vector<VkSemaphore> m_bindSemaphores;
+
+    VkImage m_pageTable = VK_NULL_HANDLE;
+    VkDeviceMemory m_pageTableMemory = VK_NULL_HANDLE;
+    VkImageView m_pageTableView = VK_NULL_HANDLE;
+    //CPU copy of every level
+    PageTable m_table;
+    //The images are still UNDEFINED and the root or mip tail isn't uploaded yet
+    bool m_firstUpload = true;
+
+    VkBuffer m_feedbackBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_feedbackMemory = VK_NULL_HANDLE;
+    VkDeviceSize m_feedbackSize = 0;
+    ReadbackRing m_feedbackReadback;
+    VkBuffer m_constantBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_constantMemory = VK_NULL_HANDLE;
+    VirtualTextureConstants m_constants = {};
+
+    VkSampler m_pageTableSampler = VK_NULL_HANDLE;
+    VkSampler m_imageSampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+    StagingRing m_staging;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> m_commandBuffers;
+
+    uint64_t m_uploadedPages = 0;
+    uint64_t m_deferredPages = 0;
+    uint32_t m_peakRequests = 0;
+};
+
+#endif // !__VIRTUAL_TEXTURE_H__
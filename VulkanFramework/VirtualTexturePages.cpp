@@ -0,0 +1,263 @@
+#include "VirtualTexturePages.h"
+
+#include <algorithm>
+
+void PageCache::Init(uint32_t slotCount, uint32_t protectFrames)
+{
+    m_slots = std::vector<Slot>(slotCount);
+    m_lru.clear();
+    m_pageSlots.clear();
+    m_protectFrames = protectFrames;
+    m_evictions = 0;
+
+    //Handed out lowest slot first
+    m_freeSlots.resize(slotCount);
+    for (uint32_t i = 0; i < slotCount; i++)
+    {
+        m_freeSlots[i] = slotCount - 1 - i;
+    }
+}
+
+uint32_t PageCache::Find(uint32_t page) const
+{
+    auto found = m_pageSlots.find(page);
+    return found != m_pageSlots.end() ? found->second : INVALID_SLOT;
+}
+
+void PageCache::Touch(uint32_t page, uint64_t frame)
+{
+    uint32_t slotIndex = Find(page);
+    if (slotIndex == INVALID_SLOT)
+    {
+        return;
+    }
+
+    Slot& slot = m_slots[slotIndex];
+    slot.m_lastUsed = std::max(slot.m_lastUsed, frame);
+    if (!slot.m_pinned)
+    {
+        m_lru.splice(m_lru.end(), m_lru, slot.m_lruPosition);
+    }
+}
+
+uint32_t PageCache::Insert(uint32_t page, uint64_t frame, uint32_t& evicted)
+{
+    evicted = VirtualPage::INVALID;
+
+    uint32_t slotIndex = Find(page);
+    if (slotIndex != INVALID_SLOT)
+    {
+        Touch(page, frame);
+        return slotIndex;
+    }
+
+    if (!m_freeSlots.empty())
+    {
+        slotIndex = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        //The front is the oldest, if even that one is still in use everything is
+        if (m_lru.empty() || m_slots[m_lru.front()].m_lastUsed + m_protectFrames >= frame)
+        {
+            return INVALID_SLOT;
+        }
+
+        slotIndex = m_lru.front();
+        m_lru.pop_front();
+        evicted = m_slots[slotIndex].m_page;
+        m_pageSlots.erase(evicted);
+        m_evictions++;
+    }
+
+    Slot& slot = m_slots[slotIndex];
+    slot.m_page = page;
+    slot.m_lastUsed = frame;
+    slot.m_pinned = false;
+    slot.m_lruPosition = m_lru.insert(m_lru.end(), slotIndex);
+    m_pageSlots[page] = slotIndex;
+
+    return slotIndex;
+}
+
+void PageCache::Pin(uint32_t page)
+{
+    uint32_t slotIndex = Find(page);
+    if (slotIndex == INVALID_SLOT || m_slots[slotIndex].m_pinned)
+    {
+        return;
+    }
+
+    m_slots[slotIndex].m_pinned = true;
+    m_lru.erase(m_slots[slotIndex].m_lruPosition);
+}
+
+void PageTable::Init(uint32_t levelCount, uint32_t widthPages, uint32_t heightPages, uint32_t fallback)
+{
+    m_widthPages = widthPages;
+    m_heightPages = heightPages;
+    m_levels.resize(levelCount);
+    m_dirty.assign(levelCount, DirtyRect());
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        m_levels[level].assign(size_t(GetWidth(level)) * GetHeight(level), fallback);
+        m_dirty[level] = { 0, 0, GetWidth(level), GetHeight(level) };
+    }
+}
+
+void PageTable::Clear()
+{
+    m_levels.clear();
+    m_dirty.clear();
+}
+
+template <typename Edit>
+void PageTable::EditPage(uint32_t page, Edit edit)
+{
+    uint32_t mip = VirtualPage::GetMip(page);
+    for (uint32_t level = 0; level <= mip; level++)
+    {
+        uint32_t shift = mip - level;
+        uint32_t width = GetWidth(level);
+        uint32_t x0 = VirtualPage::GetX(page) << shift;
+        uint32_t y0 = VirtualPage::GetY(page) << shift;
+        uint32_t x1 = std::min((VirtualPage::GetX(page) + 1) << shift, width);
+        uint32_t y1 = std::min((VirtualPage::GetY(page) + 1) << shift, GetHeight(level));
+
+        std::vector<uint32_t>& entries = m_levels[level];
+        for (uint32_t y = y0; y < y1; y++)
+        {
+            for (uint32_t x = x0; x < x1; x++)
+            {
+                edit(entries[size_t(y) * width + x]);
+            }
+        }
+
+        DirtyRect& dirty = m_dirty[level];
+        dirty.m_x0 = std::min(dirty.m_x0, x0);
+        dirty.m_y0 = std::min(dirty.m_y0, y0);
+        dirty.m_x1 = std::max(dirty.m_x1, x1);
+        dirty.m_y1 = std::max(dirty.m_y1, y1);
+    }
+}
+
+void PageTable::Map(uint32_t page, uint32_t entry)
+{
+    uint32_t mip = VirtualPage::GetMip(page);
+    EditPage(page, [mip, entry](uint32_t& current)
+    {
+        if (GetEntryMip(current) >= mip)
+        {
+            current = entry;
+        }
+    });
+}
+
+void PageTable::Unmap(uint32_t page)
+{
+    uint32_t mip = VirtualPage::GetMip(page);
+    uint32_t fallback = PackEntry(0, 0, GetLevelCount());
+    if (mip + 1 < GetLevelCount())
+    {
+        uint32_t parent = VirtualPage::GetParent(page);
+        fallback = GetEntry(mip + 1, VirtualPage::GetX(parent), VirtualPage::GetY(parent));
+    }
+
+    //Inside the page's area, anything at its mip is the page itself
+    EditPage(page, [mip, fallback](uint32_t& current)
+    {
+        if (GetEntryMip(current) == mip)
+        {
+            current = fallback;
+        }
+    });
+}
+
+bool PageTable::IsDirty() const
+{
+    return std::any_of(m_dirty.begin(), m_dirty.end(), [](const DirtyRect& dirty) { return !dirty.IsEmpty(); });
+}
+
+void PagePrioritizer::AddFeedback(const uint32_t* pages, size_t count, uint32_t mipCount)
+{
+    m_mipCount = mipCount;
+
+    //Neighbouring texels mostly ask for the same page, skipping repeats saves most of the lookups
+    uint32_t previous = VirtualPage::INVALID;
+    uint32_t* previousCount = nullptr;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t page = pages[i];
+        if (page == VirtualPage::INVALID || VirtualPage::GetMip(page) >= mipCount)
+        {
+            continue;
+        }
+
+        if (page != previous)
+        {
+            previous = page;
+            previousCount = &m_requests[page];
+        }
+        (*previousCount)++;
+    }
+}
+
+std::pmr::vector<uint32_t> PagePrioritizer::Prioritize(PageCache& cache, uint64_t frame, uint32_t maxPages, std::pmr::memory_resource* scratch)
+{
+    struct Candidate
+    {
+        uint32_t m_page;
+        uint32_t m_count;
+    };
+
+    m_lastRequestCount = static_cast<uint32_t>(m_requests.size());
+
+    //Parents of requested pages are wanted too, with their children's weight, and resident
+    //ones are touched so the pages a finer request falls back to stay around
+    std::pmr::unordered_map<uint32_t, uint32_t> wanted(scratch);
+    for (const auto& request : m_requests)
+    {
+        for (uint32_t page = request.first; VirtualPage::GetMip(page) < m_mipCount; page = VirtualPage::GetParent(page))
+        {
+            if (cache.IsResident(page))
+            {
+                cache.Touch(page, frame);
+            }
+            else
+            {
+                wanted[page] += request.second;
+            }
+        }
+    }
+    m_requests.clear();
+
+    std::pmr::vector<Candidate> candidates(scratch);
+    candidates.reserve(wanted.size());
+    for (const auto& page : wanted)
+    {
+        candidates.push_back({ page.first, page.second });
+    }
+
+    size_t count = std::min<size_t>(maxPages, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](const Candidate& a, const Candidate& b)
+    {
+        uint32_t mipA = VirtualPage::GetMip(a.m_page);
+        uint32_t mipB = VirtualPage::GetMip(b.m_page);
+        if (mipA != mipB)
+        {
+            return mipA > mipB;
+        }
+        //Page id last, so equal candidates come out the same every run
+        return a.m_count != b.m_count ? a.m_count > b.m_count : a.m_page < b.m_page;
+    });
+
+    std::pmr::vector<uint32_t> pages(count, scratch);
+    for (size_t i = 0; i < count; i++)
+    {
+        pages[i] = candidates[i].m_page;
+    }
+
+    return pages;
+}
@@ -0,0 +1,152 @@
+#ifndef __VIRTUAL_TEXTURE_PAGES_H__
+#define __VIRTUAL_TEXTURE_PAGES_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+//A page of a virtual texture packed into 32 bits: mip in the top 4, then 14 bits each of
+//page x and y within that mip. Shaders write the same packing into the feedback buffer.
+namespace VirtualPage
+{
+    //Cleared feedback entries, nothing was sampled there
+    const uint32_t INVALID = 0xFFFFFFFF;
+    const uint32_t MAX_MIPS = 15;
+    const uint32_t MAX_PAGES_PER_SIDE = 1 << 14;
+
+    inline uint32_t Pack(uint32_t mip, uint32_t x, uint32_t y) { return (mip << 28) | (x << 14) | y; }
+    inline uint32_t GetMip(uint32_t page) { return page >> 28; }
+    inline uint32_t GetX(uint32_t page) { return (page >> 14) & 0x3FFF; }
+    inline uint32_t GetY(uint32_t page) { return page & 0x3FFF; }
+    //Page covering this one in the next coarser mip
+    inline uint32_t GetParent(uint32_t page) { return Pack(GetMip(page) + 1, GetX(page) >> 1, GetY(page) >> 1); }
+}
+
+//Fixed number of physical page slots with least recently used replacement. Pages used by
+//frames that may still be in flight are never evicted, the GPU could be sampling them.
+//Pinned pages (the coarsest mips, the fallback for everything) are never evicted either.
+class PageCache
+{
+public:
+    static const uint32_t INVALID_SLOT = 0xFFFFFFFF;
+
+    //protectFrames is how many frames back a page counts as in use
+    void Init(uint32_t slotCount, uint32_t protectFrames);
+
+    //Slot holding page, or INVALID_SLOT
+    uint32_t Find(uint32_t page) const;
+    bool IsResident(uint32_t page) const { return Find(page) != INVALID_SLOT; }
+    //Marks page used by frame, does nothing if it isn't resident
+    void Touch(uint32_t page, uint64_t frame);
+
+    //A slot for page, free or taken from the least recently used page, which comes back in
+    //evicted (VirtualPage::INVALID if the slot was free). INVALID_SLOT if every page is in use.
+    uint32_t Insert(uint32_t page, uint64_t frame, uint32_t& evicted);
+    void Pin(uint32_t page);
+
+    uint32_t GetSlotCount() const { return static_cast<uint32_t>(m_slots.size()); }
+    uint32_t GetResidentCount() const { return static_cast<uint32_t>(m_pageSlots.size()); }
+    uint64_t GetEvictionCount() const { return m_evictions; }
+
+private:
+    struct Slot
+    {
+        uint32_t m_page = VirtualPage::INVALID;
+        uint64_t m_lastUsed = 0;
+        bool m_pinned = false;
+        std::list<uint32_t>::iterator m_lruPosition;
+    };
+
+    std::vector<Slot> m_slots;
+    //Occupied, unpinned slots, least recently used at the front
+    std::list<uint32_t> m_lru;
+    std::vector<uint32_t> m_freeSlots;
+    std::unordered_map<uint32_t, uint32_t> m_pageSlots;
+    uint32_t m_protectFrames = 0;
+    uint64_t m_evictions = 0;
+};
+
+//CPU copy of a virtual texture's page table, a level per page mip. Entries are RGBA8_UINT
+//texels (slot x, slot y, mip of the page they point at) and every one points at the finest
+//resident page covering it. What changed is kept per level as a rectangle to upload.
+class PageTable
+{
+public:
+    //Rectangle of a level that changed since it was last cleared
+    struct DirtyRect
+    {
+        uint32_t m_x0 = UINT32_MAX;
+        uint32_t m_y0 = UINT32_MAX;
+        uint32_t m_x1 = 0;
+        uint32_t m_y1 = 0;
+
+        bool IsEmpty() const { return m_x0 >= m_x1; }
+    };
+
+    static uint32_t PackEntry(uint32_t slotX, uint32_t slotY, uint32_t mip) { return slotX | (slotY << 8) | (mip << 16); }
+    static uint32_t GetEntryMip(uint32_t entry) { return (entry >> 16) & 0xFF; }
+
+    //widthPages and heightPages are mip 0's. Every entry starts at fallback, every level dirty.
+    void Init(uint32_t levelCount, uint32_t widthPages, uint32_t heightPages, uint32_t fallback);
+    void Clear();
+
+    //Every entry under the page that falls back to something coarser points at entry now,
+    //finer pages that are already resident keep their own entries
+    void Map(uint32_t page, uint32_t entry);
+    //Entries pointing at the page fall back to whatever its parent's entry is, past the last
+    //level to an entry with mip GetLevelCount() (the mip tail)
+    void Unmap(uint32_t page);
+
+    uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_levels.size()); }
+    //Entries per row and column of a level, the same as pages in that mip
+    uint32_t GetWidth(uint32_t level) const { return std::max(1u, m_widthPages >> level); }
+    uint32_t GetHeight(uint32_t level) const { return std::max(1u, m_heightPages >> level); }
+    uint32_t GetEntry(uint32_t level, uint32_t x, uint32_t y) const { return m_levels[level][size_t(y) * GetWidth(level) + x]; }
+    const std::vector<uint32_t>& GetLevel(uint32_t level) const { return m_levels[level]; }
+
+    const DirtyRect& GetDirty(uint32_t level) const { return m_dirty[level]; }
+    void ClearDirty(uint32_t level) { m_dirty[level] = DirtyRect(); }
+    bool IsDirty() const;
+
+private:
+    //Runs edit on every entry the page covers, level by level
+    template <typename Edit>
+    void EditPage(uint32_t page, Edit edit);
+
+    std::vector<std::vector<uint32_t>> m_levels;
+    std::vector<DirtyRect> m_dirty;
+    uint32_t m_widthPages = 0;
+    uint32_t m_heightPages = 0;
+};
+
+//Turns feedback into the pages worth loading next. Coarse pages come first: one of them
+//gives every finer page under it something better than the root to fall back to, and a
+//missing parent is requested along with its child. Pages asked for by more texels win
+//among the same mip.
+class PagePrioritizer
+{
+public:
+    //Feedback of one frame, VirtualPage::INVALID entries are skipped. Pages at or past
+    //mipCount are always resident (mip tail, root) and never requested.
+    void AddFeedback(const uint32_t* pages, size_t count, uint32_t mipCount);
+
+    //Touches every requested page that's resident and returns up to maxPages of the rest,
+    //most important first. Clears the requests. Working sets and the result come from scratch.
+    std::pmr::vector<uint32_t> Prioritize(PageCache& cache, uint64_t frame, uint32_t maxPages,
+        std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+    //Distinct pages asked for by the last Prioritize, resident or not
+    uint32_t GetLastRequestCount() const { return m_lastRequestCount; }
+
+private:
+    //Request count per page
+    std::unordered_map<uint32_t, uint32_t> m_requests;
+    uint32_t m_mipCount = 0;
+    uint32_t m_lastRequestCount = 0;
+};
+
+#endif // !__VIRTUAL_TEXTURE_PAGES_H__
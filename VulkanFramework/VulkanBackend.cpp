@@ -1,5 +1,65 @@
 #include "VulkanBackend.h"
 
+#include <cmath>
+
+namespace
+{
+    //Tessellation of each sphere in the meshlet test grid
+    const uint32_t SPHERE_RINGS = 32;
+    const uint32_t SPHERE_SEGMENTS = 64;
+
+    //n x n spheres in the z = 0 plane, spread wider than the default view so frustum culling has
+    //something to do. Counter-clockwise seen from outside, one sphere after another so
+    //neighbouring triangles stay together in the index buffer.
+    void BuildSphereGrid(uint32_t gridSize, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+    {
+        const float pi = 3.14159265358979f;
+        float spacing = 3.0f / gridSize;
+        float radius = spacing * 0.4f;
+
+        for (uint32_t y = 0; y < gridSize; y++)
+        {
+            for (uint32_t x = 0; x < gridSize; x++)
+            {
+                glm::vec3 center((x + 0.5f) * spacing - 1.5f, (y + 0.5f) * spacing - 1.5f, 0.0f);
+                uint32_t base = static_cast<uint32_t>(positions.size());
+
+                for (uint32_t ring = 0; ring <= SPHERE_RINGS; ring++)
+                {
+                    float theta = pi * ring / SPHERE_RINGS;
+                    for (uint32_t segment = 0; segment <= SPHERE_SEGMENTS; segment++)
+                    {
+                        float phi = 2.0f * pi * segment / SPHERE_SEGMENTS;
+                        glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+                        positions.push_back(center + normal * radius);
+                    }
+                }
+
+                //The rings at the poles collapse to a point, one triangle of each quad there is degenerate
+                for (uint32_t ring = 0; ring < SPHERE_RINGS; ring++)
+                {
+                    for (uint32_t segment = 0; segment < SPHERE_SEGMENTS; segment++)
+                    {
+                        uint32_t a = base + ring * (SPHERE_SEGMENTS + 1) + segment;
+                        uint32_t b = a + 1;
+                        uint32_t c = a + SPHERE_SEGMENTS + 1;
+                        uint32_t d = c + 1;
+
+                        if (ring != 0)
+                        {
+                            indices.insert(indices.end(), { a, b, c });
+                        }
+                        if (ring != SPHERE_RINGS - 1)
+                        {
+                            indices.insert(indices.end(), { b, d, c });
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
 VulkanBackend* VulkanBackend::m_singletonInst = nullptr;
 
 VulkanBackend* VulkanBackend::GetInstance()
@@ -21,77 +81,196 @@ void VulkanBackend::CleanupInstance()
     }
 }
 
-void VulkanBackend::InitVulkan(GLFWwindow* window, const int width, const int height)
+void VulkanBackend::InitVulkan(GLFWwindow* window, const int width, const int height, const RenderSettings& settings)
 {
+    TRACE_SCOPE("InitVulkan");
+
+    m_settings = settings;
+
+    //Reading the SPIR-V needs nothing from Vulkan, so it runs alongside everything up to the device
+    m_shaderCodeTask = std::async(std::launch::async, [this]()
+    {
+        TRACE_SCOPE("LoadShaderFiles");
+
+        ShaderCode code;
+        code.m_stage = m_startupTimeline.RunTask("LoadShaderFiles", {}, [&code]()
+        {
+            code.m_vert = Util::ReadFile("shaders/vert.spv");
+            code.m_frag = Util::ReadFile("shaders/frag.spv");
+        });
+
+        return code;
+    });
+
 	//Creates Vulkan instance!!!
-	CreateInstance();
-	//Prints out supported extensions
-	OutputExtensions(GetSupportedExtensions());
+    m_startupTimeline.RunStage("CreateInstance", [this]() { CreateInstance(); });
+	//Prints out supported extensions, enumerating them isn't free so only when they're wanted
+    if (Log::IsEnabled(LogLevel::Verbose))
+    {
+        m_startupTimeline.RunStage("OutputExtensions", [this]() { OutputExtensions(GetSupportedExtensions()); });
+    }
 	//Sets up the debug messenger
-	SetupDebugMessenger();
-    //Creates surface for vulkan to render to
-    CreateSurface(window);
+    m_startupTimeline.RunStage("SetupDebugMessenger", [this]() { SetupDebugMessenger(); });
+    //Creates surface for vulkan to render to, headless has nothing to present to
+    if (!m_settings.m_headless)
+    {
+        m_startupTimeline.RunStage("CreateSurface", [this, window]() { CreateSurface(window); });
+    }
     //Picks physical GPU to be used
-    PickPhysicalDevice();
+    m_startupTimeline.RunStage("PickPhysicalDevice", [this]() { PickPhysicalDevice(); });
     //Creates the logical device to be used
-    CreateLogicalDevice();
-    //Creates swapchain
-    CreateSwapChain(width, height);
+    StartupTimeline::StageId deviceStage = m_startupTimeline.RunStage("CreateLogicalDevice", [this]() { CreateLogicalDevice(); });
+
+    //Shader modules only need the device, they get built while the swapchain and render pass are set up
+    m_shaderModuleTask = std::async(std::launch::async, [this, deviceStage]()
+    {
+        ShaderCode code = m_shaderCodeTask.get();
+
+        TRACE_SCOPE("CreateShaderModules");
+
+        return m_startupTimeline.RunTask("CreateShaderModules", { code.m_stage, deviceStage }, [this, &code]()
+        {
+            //Modules are kept around so other permutations can be built later without reloading
+            m_vertShaderModule = CreateShaderModule(code.m_vert);
+            m_fragShaderModule = CreateShaderModule(code.m_frag);
+        });
+    });
+
+    //Creates swapchain, or the offscreen images standing in for it
+    if (m_settings.m_headless)
+    {
+        m_startupTimeline.RunStage("CreateOffscreenTargets", [this, width, height]() { CreateOffscreenTargets(width, height); });
+    }
+    else
+    {
+        m_startupTimeline.RunStage("CreateSwapChain", [this, width, height]() { CreateSwapChain(width, height); });
+    }
     //Creates image views
-    CreateImageViews();
+    m_startupTimeline.RunStage("CreateImageViews", [this]() { CreateImageViews(); });
+    //Picks the depth buffer format
+    m_startupTimeline.RunStage("FindDepthFormat", [this]() { FindDepthFormat(); });
+    //Picks the MSAA sample count
+    m_startupTimeline.RunStage("ChooseSampleCount", [this]() { ChooseSampleCount(); });
     //Creates render pass
-    CreateRenderPass();
-    //Creates Graphics pipeline
-    CreateGraphicsPipeline();
+    m_startupTimeline.RunStage("CreateRenderPass", [this]() { CreateRenderPass(); });
+    //Per frame uniform memory and the descriptor set the pipeline layout is built around
+    m_startupTimeline.RunStage("CreateUniformRing", [this]() { CreateUniformRing(); });
+    //Streamed texture, its descriptor set is part of the pipeline layout too
+    if (!m_settings.m_virtualTexturePath.empty())
+    {
+        m_startupTimeline.RunStage("CreateVirtualTexture", [this]() { CreateVirtualTexture(); });
+    }
+    //Creates Graphics pipeline, once the shader modules are in. get() rethrows if loading them failed.
+    StartupTimeline::StageId shaderStage = m_shaderModuleTask.get();
+    m_startupTimeline.RunStage("CreateGraphicsPipeline", [this]() { CreateGraphicsPipeline(); }, { shaderStage });
     //Create framebuffers
-    CreateFramebuffers();
+    m_startupTimeline.RunStage("CreateFramebuffers", [this]() { CreateFramebuffers(); });
     //Create command pool
-    CreateCommandPool();
+    m_startupTimeline.RunStage("CreateCommandPool", [this]() { CreateCommandPool(); });
+    //Compute queue, command buffers and semaphores
+    m_startupTimeline.RunStage("CreateAsyncCompute", [this]() { CreateAsyncCompute(); });
+    //Meshlet test geometry, uploaded through the command pool and culled on the compute queue
+    if (m_settings.m_meshletGridSize != 0)
+    {
+        m_startupTimeline.RunStage("CreateMeshletGeometry", [this]() { CreateMeshletGeometry(); });
+    }
+    //Occlusion queries for the overdraw counter
+    m_startupTimeline.RunStage("CreateOverdrawQueries", [this]() { CreateOverdrawQueries(); });
+    //Timestamp queries for the GPU profiler
+    m_startupTimeline.RunStage("CreateTimestampQueries", [this]() { CreateTimestampQueries(); });
     //Create Command buffers
-    CreateCommandBuffers();
+    m_startupTimeline.RunStage("CreateCommandBuffers", [this]() { CreateCommandBuffers(); });
     //Create sephamores
-    CreateSyncObjects();
+    m_startupTimeline.RunStage("CreateSyncObjects", [this]() { CreateSyncObjects(); });
 }
 
 void VulkanBackend::DrawFrame()
 {
+    PROFILE_SCOPE("DrawFrame");
+
+    //Restreamed textures are submitted ahead of the frame that might sample them. Its
+    //scratch is gone when Update returns, so the previous frame's arena is as good as any.
+    m_memoryBudget.Refresh();
+    m_textureStreamer.Update(m_frameArena.GetResource());
+
+    if (m_settings.m_headless)
+    {
+        DrawFrameHeadless();
+        return;
+    }
+
+    //Blocking isn't CPU work as far as the pacer is concerned
+    m_framePacer.MarkWaitBegin();
+
     //Waits for the previous frame to be finished
-    vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+    {
+        PROFILE_SCOPE("WaitForFrame");
+        m_graphicsTimeline.Wait(m_frameTimelineValues[m_currentFrame]);
+    }
+    //Nothing from this slot's last frame is in use anymore
+    m_frameArena.BeginFrame(static_cast<uint32_t>(m_currentFrame));
     
     uint32_t imageIndex;
-    vkAcquireNextImageKHR(m_device, m_swapChain, UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+    {
+        PROFILE_SCOPE("AcquireImage");
+        vkAcquireNextImageKHR(m_device, m_swapChain, UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
 
     // Check if a previous frame is already using this image 
-    if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(m_device, 1, &m_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+    if (!m_graphicsTimeline.IsComplete(m_imageTimelineValues[imageIndex])) {
+        PROFILE_SCOPE("WaitForImage");
+        m_graphicsTimeline.Wait(m_imageTimelineValues[imageIndex]);
     }
 
-    //Mark image as in use now
-    m_imagesInFlight[imageIndex] = m_inFlightFences[m_currentFrame];
+    m_framePacer.MarkWaitEnd();
+
+    //The image's last frame is done reading its region
+    WriteUniforms(imageIndex);
+    UpdateMeshlets(imageIndex);
+
+    //This command buffer's last run is done, its timestamps can be read without waiting
+    Profiler::GetInstance()->CollectGpu(imageIndex);
+
+    //Same for its occlusion query, which the submit below resets. Value 0 means the image
+    //hasn't been drawn to yet and there's nothing to read.
+    if (m_settings.m_debugOverdraw && m_imageTimelineValues[imageIndex] != 0)
+    {
+        ReadOverdrawQuery(imageIndex);
+    }
 
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    QueueTimeline::Batch batch;
 
     //Wait for for this sephamore to be available within the color output stage
-    VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
-    
-    VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[m_currentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    batch.Wait(m_imageAvailableSemaphores[m_currentFrame], VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
 
-    vkResetFences(m_device, 1, &m_inFlightFences[m_currentFrame]);
+    //Compute results are only waited for by the stages that read them
+    if (m_asyncCompute.HasJobs())
+    {
+        batch.Wait(m_asyncCompute.Submit(static_cast<uint32_t>(m_currentFrame)), m_asyncCompute.GetConsumerStages());
+    }
 
+    //Virtual texture uploads go first, in the same submit
+    VkCommandBuffer commandBuffers[2];
+    batch.m_commandBuffers = commandBuffers;
+    batch.m_commandBufferCount = PrepareVirtualTexture(imageIndex, batch, commandBuffers);
+
+    VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[m_currentFrame] };
+    batch.Signal(signalSemaphores[0]);
 
-    if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrame]) != VK_SUCCESS) 
     {
-        throw std::runtime_error("failed to submit draw command buffer!");
+        PROFILE_SCOPE("Submit");
+        uint64_t value = m_graphicsTimeline.Submit(batch);
+
+        //Both the frame slot and the image are in use until the timeline gets here
+        m_frameTimelineValues[m_currentFrame] = value;
+        m_imageTimelineValues[imageIndex] = value;
+        m_framePacer.MarkSubmitted(value);
+        if (m_virtualTexture.IsLoaded())
+        {
+            m_virtualTexture.Submitted(imageIndex, value, value);
+        }
     }
+    Profiler::GetInstance()->OnSubmit(imageIndex);
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -103,11 +282,102 @@ void VulkanBackend::DrawFrame()
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr; // Optional
 
-    vkQueuePresentKHR(m_presentQueue, &presentInfo);
-    //Basically just waits. Without this the CPU is submitting work faster than GPU keeps track of it.
-    vkQueueWaitIdle(m_presentQueue);
+    {
+        PROFILE_SCOPE("Present");
+        vkQueuePresentKHR(m_presentQueue, &presentInfo);
+        //No vkQueueWaitIdle here, the wait on the frame slot's timeline value already keeps the
+        //CPU at most MAX_FRAMES_IN_FLIGHT ahead. Idling the queue would serialize every frame
+        //and hide what the present mode does to pacing.
+    }
+    m_presentStats.OnPresent();
+
+    //Whatever was retired by frames that have finished since
+    m_deletionQueue.Drain();
+
+    m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    m_framebufferCache.NextFrame();
+}
+
+void VulkanBackend::DrawFrameHeadless()
+{
+    //No acquire, the images are simply used round robin
+    uint32_t imageIndex = static_cast<uint32_t>(m_headlessFrame % m_swapChainImages.size());
+
+    auto onReady = [this](uint64_t frame, const void* data, VkDeviceSize size)
+    {
+        DeliverReadback(frame, data, size);
+    };
+
+    //Only blocks if the GPU is a whole ring behind, and hands over the frame that used this image last
+    {
+        PROFILE_SCOPE("WaitForImage");
+        m_readbackRing.Acquire(imageIndex, onReady);
+    }
+    m_frameArena.BeginFrame(imageIndex);
+    WriteUniforms(imageIndex);
+    UpdateMeshlets(imageIndex);
+    Profiler::GetInstance()->CollectGpu(imageIndex);
+
+    //The last submission of this command buffer is done, so its query is ready
+    if (m_settings.m_debugOverdraw && m_headlessFrame >= m_swapChainImages.size())
+    {
+        ReadOverdrawQuery(imageIndex);
+    }
+
+    QueueTimeline::Batch batch;
+    if (m_asyncCompute.HasJobs())
+    {
+        batch.Wait(m_asyncCompute.Submit(static_cast<uint32_t>(m_currentFrame)), m_asyncCompute.GetConsumerStages());
+    }
+    VkCommandBuffer commandBuffers[2];
+    batch.m_commandBuffers = commandBuffers;
+    batch.m_commandBufferCount = PrepareVirtualTexture(imageIndex, batch, commandBuffers);
+
+    uint64_t value;
+    {
+        PROFILE_SCOPE("Submit");
+        value = m_graphicsTimeline.Submit(batch);
+    }
+    Profiler::GetInstance()->OnSubmit(imageIndex);
+
+    m_readbackRing.Submitted(imageIndex, m_headlessFrame, value);
+    if (m_virtualTexture.IsLoaded())
+    {
+        m_virtualTexture.Submitted(imageIndex, value, value);
+    }
+    m_headlessFrame++;
+
+    //Picks up anything else that's already finished without waiting for it
+    m_readbackRing.Poll(onReady);
+
+    //Whatever was retired by frames that have finished since
+    m_deletionQueue.Drain();
 
     m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    m_framebufferCache.NextFrame();
+}
+
+void VulkanBackend::DeliverReadback(uint64_t frame, const void* data, VkDeviceSize size)
+{
+    //The callback reads a whole tightly packed frame out of the mapped range
+    VkDeviceSize frameSize = static_cast<VkDeviceSize>(m_swapChainExtent.width) * m_swapChainExtent.height * 4;
+    if (size < frameSize)
+    {
+        throw std::runtime_error("readback is smaller than the frame!");
+    }
+
+    if (m_readbackCallback)
+    {
+        m_readbackCallback(frame, static_cast<const uint8_t*>(data), m_swapChainExtent.width, m_swapChainExtent.height, m_swapChainImageFormat);
+    }
+}
+
+VkPipeline VulkanBackend::GetPipeline(const PipelineKey& key)
+{
+    return m_pipelineRegistry.GetOrCreate(key, [this](const PipelineKey& pipelineKey)
+    {
+        return BuildGraphicsPipeline(pipelineKey);
+    });
 }
 
 void VulkanBackend::WaitForIdle()
@@ -117,6 +387,9 @@ void VulkanBackend::WaitForIdle()
 
 void VulkanBackend::CleanupVulkan()
 {
+    //The main loop leaves with frames still in flight, nothing below may go before they're done
+    WaitForIdle();
+
     //Cleans up after debug messenger
     if (m_enableValidationLayers)
     {
@@ -127,24 +400,78 @@ void VulkanBackend::CleanupVulkan()
     {
         vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(m_device, m_inFlightFences[i], nullptr);
     }
 
+    m_textureStreamer.Destroy();
+    //Releases its samplers into the deletion queue
+    m_virtualTexture.Destroy();
+    m_meshletGeometry.Destroy();
+    m_renderGraph.ReleaseTransients(m_device);
+    m_memoryBudget.Release(MemoryCategory::RenderTarget, m_renderTargetBytes);
+    m_renderTargetBytes = 0;
+
+    //Everything still queued can go, the wait above retired every submit
+    m_deletionQueue.Flush();
+
+    //Hands over whatever headless frames are still in flight
+    if (m_readbackRing.GetSlotCount() != 0)
+    {
+        m_readbackRing.Flush([this](uint64_t frame, const void* data, VkDeviceSize size)
+        {
+            DeliverReadback(frame, data, size);
+        });
+        m_readbackRing.Destroy();
+    }
+
+    if (m_overdrawQueryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(m_device, m_overdrawQueryPool, nullptr);
+        m_overdrawQueryPool = VK_NULL_HANDLE;
+    }
+
+    Profiler::GetInstance()->DestroyGpu();
+
+    m_asyncCompute.Destroy();
+    m_graphicsTimeline.Destroy();
+    m_frameArena.Destroy();
+    m_uniformRing.Destroy();
+    //Whatever is still acquired
+    m_samplerCache.Destroy();
+
     if (m_commandPool != VK_NULL_HANDLE)
     {
         vkDestroyCommandPool(m_device, m_commandPool, nullptr);
         m_commandPool = VK_NULL_HANDLE;
     }
 
-    for (auto framebuffer : m_swapChainFramebuffers) 
+    m_framebufferCache.Destroy();
+
+    //Destroys every permutation, including the default graphics pipeline
+    m_pipelineRegistry.Destroy(m_device);
+    m_graphicsPipeline = VK_NULL_HANDLE;
+
+    if (m_fragShaderModule != VK_NULL_HANDLE)
+    {
+        vkDestroyShaderModule(m_device, m_fragShaderModule, nullptr);
+        m_fragShaderModule = VK_NULL_HANDLE;
+    }
+
+    if (m_vertShaderModule != VK_NULL_HANDLE)
+    {
+        vkDestroyShaderModule(m_device, m_vertShaderModule, nullptr);
+        m_vertShaderModule = VK_NULL_HANDLE;
+    }
+
+    if (m_meshletVertShaderModule != VK_NULL_HANDLE)
     {
-        vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+        vkDestroyShaderModule(m_device, m_meshletVertShaderModule, nullptr);
+        m_meshletVertShaderModule = VK_NULL_HANDLE;
     }
 
-    if (m_graphicsPipeline != VK_NULL_HANDLE)
+    if (m_meshletPipelineLayout != VK_NULL_HANDLE)
     {
-        vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
-        m_graphicsPipeline = VK_NULL_HANDLE;
+        vkDestroyPipelineLayout(m_device, m_meshletPipelineLayout, nullptr);
+        m_meshletPipelineLayout = VK_NULL_HANDLE;
     }
 
     if (m_pipelineLayout != VK_NULL_HANDLE)
@@ -153,17 +480,30 @@ void VulkanBackend::CleanupVulkan()
         m_pipelineLayout = VK_NULL_HANDLE;
     }
 
-    if (m_renderPass != VK_NULL_HANDLE)
-    {
-        vkDestroyRenderPass(m_device, m_renderPass, nullptr);
-        m_renderPass = VK_NULL_HANDLE;
-    }
+    //Owns every render pass, including the forward pass
+    m_renderPassCache.Destroy();
+    m_renderPass = VK_NULL_HANDLE;
+    m_depthPrePassRenderPass = VK_NULL_HANDLE;
 
     for (auto imageView : m_swapChainImageViews) 
     {
         vkDestroyImageView(m_device, imageView, nullptr);
     }
 
+    //Headless owns its images, swapchain images belong to the swapchain
+    if (m_settings.m_headless)
+    {
+        for (size_t i = 0; i < m_swapChainImages.size(); i++)
+        {
+            vkDestroyImage(m_device, m_swapChainImages[i], nullptr);
+            vkFreeMemory(m_device, m_offscreenMemory[i], nullptr);
+        }
+        m_swapChainImages.clear();
+        m_offscreenMemory.clear();
+        m_memoryBudget.Release(MemoryCategory::RenderTarget, m_offscreenBytes);
+        m_offscreenBytes = 0;
+    }
+
     if (m_swapChain != VK_NULL_HANDLE)
     {
         vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
@@ -197,6 +537,8 @@ void VulkanBackend::CleanupVulkan()
 
 void VulkanBackend::CreateInstance()
 {
+    TRACE_SCOPE("CreateInstance");
+
     //Check if validation layers requested are available
     if (m_enableValidationLayers && !CheckValidationLayerSupport())
     {
@@ -253,6 +595,8 @@ std::vector<VkExtensionProperties> VulkanBackend::GetSupportedExtensions()
 
 void VulkanBackend::OutputExtensions(std::vector<VkExtensionProperties> extensions)
 {
+    TRACE_SCOPE("OutputExtensions");
+
     std::cout << "available extensions:" << std::endl;
 
     for (const auto& extension : extensions)
@@ -263,22 +607,40 @@ void VulkanBackend::OutputExtensions(std::vector<VkExtensionProperties> extensio
 
 std::vector<const char*> VulkanBackend::GetRequiredExtensions()
 {
-    uint32_t glfwExtensionsCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+    std::vector<const char*> extensions;
+
+    //Surface extensions only matter when there's a window, GLFW isn't even initialized otherwise
+    if (!m_settings.m_headless)
+    {
+        uint32_t glfwExtensionsCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionsCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionsCount);
+    }
 
     if (m_enableValidationLayers)
     {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    //Needed to query the feature structs of optional device extensions on a 1.0 instance
+    for (const auto& extension : GetSupportedExtensions())
+    {
+        if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+        {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            m_physicalDeviceProperties2 = true;
+        }
+    }
+
     return extensions;
 }
 
 void VulkanBackend::SetupDebugMessenger()
 {
+    TRACE_SCOPE("SetupDebugMessenger");
+
     if (!m_enableValidationLayers) return;
 
     //Fill in the details about the messenger itself
@@ -336,23 +698,35 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VulkanBackend::debugCallback(VkDebugUtilsMessageS
     return VK_FALSE;
 }
 
-bool VulkanBackend::IsDeviceSuitable(VkPhysicalDevice device)
+std::string VulkanBackend::GetUnsuitableReason(const DeviceCaps& caps)
 {
-    QueueFamilyIndices indices = FindQueueFamilies(device);
+    if (!FindQueueFamilies(caps).IsComplete())
+    {
+        return m_settings.m_headless ? "no graphics queue" : "no graphics or present queue";
+    }
 
-    bool extensionsSupported = CheckDeviceExtensionSupport(device);
+    if (!CheckDeviceExtensionSupport(caps))
+    {
+        return "missing swapchain extension";
+    }
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
-        SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
-        swapChainAdequate = !swapChainSupport.m_formats.empty() && !swapChainSupport.m_presentModes.empty();
+    //Software ICDs like lavapipe and SwiftShader are fine, all headless needs is a graphics queue
+    if (!m_settings.m_headless)
+    {
+        const SwapChainSupportDetails& swapChainSupport = caps.GetSurfaceSupport();
+        if (swapChainSupport.m_formats.empty() || swapChainSupport.m_presentModes.empty())
+        {
+            return "surface has no formats or present modes";
+        }
     }
 
-    return indices.IsComplete() && extensionsSupported && swapChainAdequate;
+    return "";
 }
 
 void VulkanBackend::PickPhysicalDevice()
 {
+    TRACE_SCOPE("PickPhysicalDevice");
+
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
 
@@ -364,45 +738,60 @@ void VulkanBackend::PickPhysicalDevice()
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
 
-    for (const auto& device : devices)
+    //The snapshots taken here are what the picked device keeps
+    std::vector<DeviceCaps> caps(deviceCount);
+    std::vector<DeviceCandidate> candidates;
+    for (uint32_t i = 0; i < deviceCount; i++)
     {
-        if (IsDeviceSuitable(device))
-        {
-            m_physicalDevice = device;
-            break;
-        }
+        caps[i].Query(devices[i]);
+        caps[i].RefreshSurface(m_surface);
+
+        candidates.push_back(DeviceCandidate::FromCaps(caps[i]));
+        candidates.back().m_unsupportedReason = GetUnsuitableReason(caps[i]);
     }
 
-    if (m_physicalDevice == VK_NULL_HANDLE)
+    //Settings win over the environment
+    std::string deviceOverride = m_settings.m_deviceOverride.empty() ? DeviceSelector::GetEnvironmentOverride() : m_settings.m_deviceOverride;
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), deviceOverride);
+
+    if (Log::IsEnabled(LogLevel::Info))
     {
-        throw std::runtime_error("Failed to find a suitable GPU!");
+        DeviceSelector::PrintSelection(std::cout, candidates, selection);
     }
 
+    if (selection.m_chosen < 0)
+    {
+        throw std::runtime_error("Failed to find a suitable GPU!");
+    }
 
+    m_physicalDevice = devices[selection.m_chosen];
+    m_deviceCaps = std::move(caps[selection.m_chosen]);
+    m_queueFamilyIndices = FindQueueFamilies(m_deviceCaps);
 }
 
-QueueFamilyIndices VulkanBackend::FindQueueFamilies(VkPhysicalDevice device)
+QueueFamilyIndices VulkanBackend::FindQueueFamilies(const DeviceCaps& caps) const
 {
     QueueFamilyIndices indices;
 
-    //Get queue family information
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
-
-
-    
     unsigned int i = 0;
-    for (const auto& queueFamily : queueFamilies)
+    for (const auto& queueFamily : caps.GetQueueFamilies())
     {
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
         {
             indices.m_graphicsFamily = i;
         }
 
+        //Without a surface nothing is presented, the graphics queue stands in for the present queue
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+        if (m_surface != VK_NULL_HANDLE)
+        {
+            presentSupport = caps.CanPresent(i);
+        }
+        else
+        {
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        }
+
         if (presentSupport)
         {
             indices.m_presentFamily = i;
@@ -416,15 +805,32 @@ QueueFamilyIndices VulkanBackend::FindQueueFamilies(VkPhysicalDevice device)
         i++;
     }
 
+    //Compute-only families run beside graphics, one that can also do graphics wouldn't be async
+    const std::vector<VkQueueFamilyProperties>& queueFamilies = caps.GetQueueFamilies();
+    for (uint32_t family = 0; family < queueFamilies.size(); family++)
+    {
+        if ((queueFamilies[family].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[family].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            indices.m_computeFamily = family;
+            break;
+        }
+    }
+
     return indices;
 }
 
 void VulkanBackend::CreateLogicalDevice()
 {
-    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
-    
+    TRACE_SCOPE("CreateLogicalDevice");
+
+    const QueueFamilyIndices& indices = m_queueFamilyIndices;
+
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = { indices.m_graphicsFamily.value(), indices.m_presentFamily.value() };
+    if (indices.m_computeFamily.has_value())
+    {
+        uniqueQueueFamilies.insert(indices.m_computeFamily.value());
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -438,6 +844,28 @@ void VulkanBackend::CreateLogicalDevice()
     }
 
     VkPhysicalDeviceFeatures deviceFeatures = {};
+    //Exact sample counts for the overdraw counter, otherwise it only says zero or not zero
+    m_preciseOcclusion = m_settings.m_debugOverdraw && m_deviceCaps.GetFeatures().occlusionQueryPrecise;
+    deviceFeatures.occlusionQueryPrecise = m_preciseOcclusion ? VK_TRUE : VK_FALSE;
+    //Block compressed textures, TextureLoader decodes on the CPU for whatever is left out
+    deviceFeatures.textureCompressionBC = m_deviceCaps.GetFeatures().textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = m_deviceCaps.GetFeatures().textureCompressionASTC_LDR;
+    //Virtual texture feedback is written from fragment shaders, sparse residency is optional
+    if (!m_settings.m_virtualTexturePath.empty())
+    {
+        deviceFeatures.fragmentStoresAndAtomics = m_deviceCaps.GetFeatures().fragmentStoresAndAtomics;
+        if (m_settings.m_virtualTexture.m_allowSparse && VirtualTexture::CanUseSparse(m_deviceCaps, indices.m_graphicsFamily.value()))
+        {
+            deviceFeatures.sparseBinding = VK_TRUE;
+            deviceFeatures.sparseResidencyImage2D = VK_TRUE;
+        }
+    }
+    //Meshlets are drawn with one indirect call when it's there, one per meshlet otherwise
+    if (m_settings.m_meshletGridSize != 0)
+    {
+        deviceFeatures.multiDrawIndirect = m_deviceCaps.GetFeatures().multiDrawIndirect;
+        m_multiDrawIndirect = deviceFeatures.multiDrawIndirect == VK_TRUE;
+    }
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -446,8 +874,69 @@ void VulkanBackend::CreateLogicalDevice()
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+    std::vector<const char*> deviceExtensions = GetDeviceExtensions();
+
+    //Feature structs of optional extensions get chained in front of each other
+    void* featureChain = nullptr;
+
+#ifdef VK_EXT_extended_dynamic_state
+    //Cull mode, depth test and topology become draw time state instead of pipeline state.
+    //The feature is mandatory when the extension is exposed. Needs
+    //VK_KHR_get_physical_device_properties2 on the instance, like timeline semaphores.
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = {};
+    extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+
+    if (m_physicalDeviceProperties2 && m_deviceCaps.HasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+    {
+        deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+        extendedDynamicStateFeatures.pNext = featureChain;
+        featureChain = &extendedDynamicStateFeatures;
+        m_extendedDynamicState = true;
+    }
+#endif //VK_EXT_extended_dynamic_state
+
+#ifdef VK_KHR_timeline_semaphore
+    //Per queue timelines instead of per frame fences, see QueueTimeline.
+    //Also mandatory when the extension is exposed. It requires
+    //VK_KHR_get_physical_device_properties2 on the instance, QueueTimeline falls back to
+    //fences without it.
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+    if (m_physicalDeviceProperties2 && m_deviceCaps.HasExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+    {
+        deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        timelineSemaphoreFeatures.pNext = featureChain;
+        featureChain = &timelineSemaphoreFeatures;
+        m_timelineSemaphores = true;
+    }
+#endif //VK_KHR_timeline_semaphore
+
+#if defined(VK_EXT_memory_budget) && defined(VK_KHR_get_physical_device_properties2)
+    //Only a query, no features to enable
+    if (m_physicalDeviceProperties2 && m_deviceCaps.HasExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+    {
+        deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        m_memoryBudgetExtension = true;
+    }
+#endif //VK_EXT_memory_budget
+
+#ifdef VK_KHR_draw_indirect_count
+    //Lets culled meshlets be dropped from the draw instead of drawn with no instances.
+    //No features, but the count can only go past 1 with multiDrawIndirect.
+    if (m_multiDrawIndirect && m_deviceCaps.HasExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+    {
+        deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        m_drawIndirectCount = true;
+    }
+#endif //VK_KHR_draw_indirect_count
+
+    createInfo.pNext = featureChain;
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
     if (m_enableValidationLayers)
     {
@@ -466,57 +955,75 @@ void VulkanBackend::CreateLogicalDevice()
     //Gets the graphics queue that was created along with the logical device
     vkGetDeviceQueue(m_device, indices.m_graphicsFamily.value(), 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.m_presentFamily.value(), 0, &m_presentQueue);
-}
-
-bool VulkanBackend::CheckDeviceExtensionSupport(VkPhysicalDevice device)
-{
-    uint32_t extensionCount;
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    m_computeQueue = m_graphicsQueue;
+    if (indices.m_computeFamily.has_value())
+    {
+        vkGetDeviceQueue(m_device, indices.m_computeFamily.value(), 0, &m_computeQueue);
+    }
 
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+#ifdef VK_EXT_extended_dynamic_state
+    if (m_extendedDynamicState)
+    {
+        m_extendedDynamicState = VulkanImport::LoadExtendedDynamicState(m_device);
+    }
+#endif //VK_EXT_extended_dynamic_state
 
-    std::set<std::string> requiredExtensions(m_deviceExtensions.begin(), m_deviceExtensions.end());
+    m_pipelineRegistry.SetExtendedDynamicState(m_extendedDynamicState);
 
-    for (const auto& extension : availableExtensions) {
-        requiredExtensions.erase(extension.extensionName);
+#ifdef VK_KHR_timeline_semaphore
+    if (m_timelineSemaphores)
+    {
+        m_timelineSemaphores = VulkanImport::LoadTimelineSemaphore(m_device);
     }
+#endif //VK_KHR_timeline_semaphore
 
-    return requiredExtensions.empty();
-
+#ifdef VK_KHR_draw_indirect_count
+    if (m_drawIndirectCount)
+    {
+        m_drawIndirectCount = VulkanImport::LoadDrawIndirectCount(m_device);
+    }
+#endif //VK_KHR_draw_indirect_count
+
+    //Every graphics submit signals the next value on this
+    m_graphicsTimeline.Init(m_device, m_graphicsQueue, m_timelineSemaphores);
+    m_deletionQueue.Init(m_device, &m_graphicsTimeline);
+    m_samplerCache.Init(m_device, m_deviceCaps.GetLimits(), &m_deletionQueue);
+    m_memoryBudget.Init(m_instance, &m_deviceCaps, m_memoryBudgetExtension, m_settings.m_memoryBudget);
+    m_framePacer.SetGpuProgress([this]() { return m_graphicsTimeline.GetCompletedValue(); });
 }
 
-void VulkanBackend::CreateSurface(GLFWwindow* window)
+bool VulkanBackend::CheckDeviceExtensionSupport(const DeviceCaps& caps) const
 {
-    if (glfwCreateWindowSurface(m_instance, window, nullptr, &m_surface) != VK_SUCCESS)
+    for (const char* extension : GetDeviceExtensions())
     {
-        throw std::runtime_error("Failed to create window surface!");
+        if (!caps.HasExtension(extension))
+        {
+            return false;
+        }
     }
+
+    return true;
 }
 
-SwapChainSupportDetails VulkanBackend::QuerySwapChainSupport(VkPhysicalDevice device)
+std::vector<const char*> VulkanBackend::GetDeviceExtensions() const
 {
-    SwapChainSupportDetails details;
-
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, m_surface, &details.m_capabilities);
-
-    uint32_t formatCount;
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, nullptr);
-    if (formatCount != 0) 
+    //No swapchain without a surface
+    if (m_settings.m_headless)
     {
-        details.m_formats.resize(formatCount);
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, details.m_formats.data());
+        return {};
     }
 
-    uint32_t presentModeCount;
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, nullptr);
-    if (presentModeCount != 0) 
+    return m_deviceExtensions;
+}
+
+void VulkanBackend::CreateSurface(GLFWwindow* window)
+{
+    TRACE_SCOPE("CreateSurface");
+
+    if (glfwCreateWindowSurface(m_instance, window, nullptr, &m_surface) != VK_SUCCESS)
     {
-        details.m_presentModes.resize(presentModeCount);
-        vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, details.m_presentModes.data());
+        throw std::runtime_error("Failed to create window surface!");
     }
-
-    return details;
 }
 
 VkSurfaceFormatKHR VulkanBackend::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
@@ -534,22 +1041,6 @@ VkSurfaceFormatKHR VulkanBackend::ChooseSwapSurfaceFormat(const std::vector<VkSu
     return availableFormats[0];
 }
 
-VkPresentModeKHR VulkanBackend::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
-{
-    //Checks if triple buffering is available to this device
-    for (const auto& availablePresentMode : availablePresentModes) 
-    {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) 
-        {
-            return availablePresentMode;
-        }
-    }
-
-
-    //If it's not we return the only guaranteed mode
-    return VK_PRESENT_MODE_FIFO_KHR;
-}
-
 VkExtent2D VulkanBackend::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, const int width, const int height)
 {
     //Resolution of the surface
@@ -569,19 +1060,25 @@ VkExtent2D VulkanBackend::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capab
 
 void VulkanBackend::CreateSwapChain(const int width, const int height)
 {
-    SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(m_physicalDevice);
+    TRACE_SCOPE("CreateSwapChain");
+
+    //The surface may have changed since the device was picked, the rest of the snapshot can't
+    m_deviceCaps.RefreshSurface(m_surface);
+    const SwapChainSupportDetails& swapChainSupport = m_deviceCaps.GetSurfaceSupport();
 
     //Sets up surface format, present format and the 
     VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.m_formats);
-    VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.m_presentModes);
     VkExtent2D extent = ChooseSwapExtent(swapChainSupport.m_capabilities, width, height);
 
-    //Choose minimum + 1 just in case
-    uint32_t imageCount = swapChainSupport.m_capabilities.minImageCount + 1;
+    //Present mode and image count both come from the policy, see PresentPolicy
+    PresentConfig presentConfig = ChoosePresentConfig(m_settings.m_presentPolicy, swapChainSupport.m_capabilities, swapChainSupport.m_presentModes);
+    VkPresentModeKHR presentMode = presentConfig.m_presentMode;
+    uint32_t imageCount = presentConfig.m_imageCount;
 
-    //0 is a special number, means no limit, we DO NOT want that.
-    if (swapChainSupport.m_capabilities.maxImageCount > 0 && imageCount > swapChainSupport.m_capabilities.maxImageCount) {
-        imageCount = swapChainSupport.m_capabilities.maxImageCount;
+    if (Log::IsEnabled(LogLevel::Info))
+    {
+        std::cout << "present policy " << GetPresentPolicyName(m_settings.m_presentPolicy) << ": " << GetPresentModeName(presentMode)
+            << ", " << imageCount << " images" << (presentConfig.m_fallback ? " (fallback)" : "") << std::endl;
     }
 
     VkSwapchainCreateInfoKHR createInfo = {};
@@ -594,7 +1091,7 @@ void VulkanBackend::CreateSwapChain(const int width, const int height)
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
+    const QueueFamilyIndices& indices = m_queueFamilyIndices;
     uint32_t queueFamilyIndices[] = { indices.m_graphicsFamily.value(), indices.m_presentFamily.value() };
 
     //Basically just checks if the capability for presenting and rendering are on the same device.
@@ -628,10 +1125,78 @@ void VulkanBackend::CreateSwapChain(const int width, const int height)
 
     m_swapChainImageFormat = surfaceFormat.format;
     m_swapChainExtent = extent;
+    m_presentMode = presentMode;
+    m_presentStats.Reset();
+
+    //Only FIFO modes wait for vblank, the pacer aims for it there
+    m_framePacer.SetEnabled(m_settings.m_framePacing);
+    m_framePacer.SetRefreshLimited(presentMode == VK_PRESENT_MODE_FIFO_KHR || presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR);
+}
+
+void VulkanBackend::CreateOffscreenTargets(const int width, const int height)
+{
+    TRACE_SCOPE("CreateOffscreenTargets");
+
+    //Plain RGBA is what image writers want, every device can render to one of these
+    m_swapChainImageFormat = FindSupportedFormat(
+        { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM },
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+    m_swapChainExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+    const VkPhysicalDeviceMemoryProperties& memProperties = m_deviceCaps.GetMemoryProperties();
+
+    m_swapChainImages.resize(m_settings.m_offscreenImageCount);
+    m_offscreenMemory.resize(m_settings.m_offscreenImageCount);
+
+    for (uint32_t i = 0; i < m_settings.m_offscreenImageCount; i++)
+    {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_swapChainImageFormat;
+        imageInfo.extent = { m_swapChainExtent.width, m_swapChainExtent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        //Rendered to (or resolved into) and then copied out
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &m_swapChainImages[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create offscreen image!");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(m_device, m_swapChainImages[i], &requirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = Util::FindMemoryType(memProperties, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_offscreenMemory[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate offscreen image memory!");
+        }
+
+        vkBindImageMemory(m_device, m_swapChainImages[i], m_offscreenMemory[i], 0);
+        m_memoryBudget.Track(MemoryCategory::RenderTarget, requirements.size);
+        m_offscreenBytes += requirements.size;
+    }
+
+    //One readback slot per image, command buffer i always copies image i into slot i
+    VkDeviceSize frameSize = static_cast<VkDeviceSize>(m_swapChainExtent.width) * m_swapChainExtent.height * 4;
+    m_readbackRing.Init(m_device, memProperties, m_settings.m_offscreenImageCount, frameSize, &m_graphicsTimeline);
 }
 
 void VulkanBackend::CreateImageViews()
 {
+    TRACE_SCOPE("CreateImageViews");
+
     m_swapChainImageViews.resize(m_swapChainImages.size());
 
     for (size_t i = 0; i < m_swapChainImages.size(); i++) 
@@ -679,75 +1244,141 @@ VkShaderModule VulkanBackend::CreateShaderModule(const std::vector<char>& code)
 
 void VulkanBackend::CreateRenderPass()
 {
-    VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = m_swapChainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    //Dont care about stencil
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    //Outcolor in shader
-    VkAttachmentReference colorAttachmentRef = {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
+    TRACE_SCOPE("CreateRenderPass");
 
-    //Dependency, we need the pipeline to WAIT
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    m_renderPassCache.Init(m_device);
+    m_renderPass = m_renderPassCache.GetRenderPass(GetForwardPassKey());
 
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    if (m_settings.m_depthPrePass)
+    {
+        m_depthPrePassRenderPass = m_renderPassCache.GetRenderPass(GetDepthPrePassKey());
+    }
+}
+
+RenderPassKey VulkanBackend::GetForwardPassKey() const
+{
+    RenderPassKey key;
 
-    if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) 
+    bool multisampled = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
+    //With MSAA this is the multisampled target, it's resolved in the subpass and never stored
+    RenderPassAttachment colorAttachment;
+    colorAttachment.m_format = m_swapChainImageFormat;
+    colorAttachment.m_samples = m_msaaSamples;
+    colorAttachment.m_loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.m_storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    //Dont care about stencil
+    colorAttachment.m_stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.m_stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    //The render graph transitions the image around the pass, so the layout stays put in here
+    colorAttachment.m_initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.m_finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    key.m_colorAttachments[key.m_colorAttachmentCount++] = key.AddAttachment(colorAttachment);
+
+    //Reversed-Z depth, cleared to 0 (the far plane) unless the pre-pass already filled it.
+    //Nothing reads it after the pass so it never has to be written out.
+    RenderPassAttachment depthAttachment;
+    depthAttachment.m_format = m_depthFormat;
+    depthAttachment.m_samples = m_msaaSamples;
+    depthAttachment.m_loadOp = m_settings.m_depthPrePass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.m_storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.m_initialLayout = m_settings.m_depthPrePass ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.m_finalLayout = depthAttachment.m_initialLayout;
+
+    key.m_depthAttachment = key.AddAttachment(depthAttachment);
+    key.m_depthReadOnly = m_settings.m_depthPrePass;
+
+    //Swapchain image the MSAA color resolves into
+    if (multisampled)
     {
-        throw std::runtime_error("Failed to create render pass!");
+        RenderPassAttachment resolveAttachment;
+        resolveAttachment.m_format = m_swapChainImageFormat;
+        resolveAttachment.m_samples = VK_SAMPLE_COUNT_1_BIT;
+        resolveAttachment.m_loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.m_storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        resolveAttachment.m_initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        resolveAttachment.m_finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        key.m_resolveAttachments[key.m_resolveAttachmentCount++] = key.AddAttachment(resolveAttachment);
     }
+
+    return key;
+}
+
+RenderPassKey VulkanBackend::GetDepthPrePassKey() const
+{
+    RenderPassKey key;
+
+    //Depth only, stored so the forward pass can test against it
+    RenderPassAttachment depthAttachment;
+    depthAttachment.m_format = m_depthFormat;
+    depthAttachment.m_samples = m_msaaSamples;
+    depthAttachment.m_loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.m_storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.m_initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.m_finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    key.m_depthAttachment = key.AddAttachment(depthAttachment);
+
+    return key;
 }
 
 void VulkanBackend::CreateGraphicsPipeline()
 {
-    //Vertex and fragment shader code
-    auto vertShaderCode = Util::ReadFile("shaders/vert.spv");
-    auto fragShaderCode = Util::ReadFile("shaders/frag.spv");
+    TRACE_SCOPE("CreateGraphicsPipeline");
+
+    //The shader modules were already built by InitVulkan's worker task
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    //Set 0 is the uniform ring, set 1 the virtual texture when there is one
+    VkDescriptorSetLayout setLayouts[2] = { m_uniformRing.GetSetLayout(), m_virtualTexture.GetSetLayout() };
+    pipelineLayoutInfo.setLayoutCount = m_virtualTexture.IsLoaded() ? 2 : 1;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+    //128 bytes is all the spec guarantees, DrawConstants has to stay well under that
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawConstants);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    //The default permutation is what the command buffers draw with
+    m_graphicsPipelineKey.m_pass = m_settings.m_depthPrePass ? PipelinePass::ForwardDepthEqual : PipelinePass::Forward;
+    m_graphicsPipelineKey.m_permutation.m_lightingModel = m_settings.m_lightingModel;
+    m_graphicsPipeline = GetPipeline(m_graphicsPipelineKey);
+}
+
+VkPipeline VulkanBackend::BuildGraphicsPipeline(const PipelineKey& key)
+{
+    bool depthOnly = key.m_pass == PipelinePass::DepthPrePass;
 
-    VkShaderModule vertShaderModule = CreateShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = CreateShaderModule(fragShaderCode);
+    //Feature toggles for this permutation, shared by both stages
+    SpecializationData specialization(key.m_permutation);
 
     //Vert shader info
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
     //Vert module and call it main
-    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.module = key.m_meshlets ? m_meshletVertShaderModule : m_vertShaderModule;
     vertShaderStageInfo.pName = "main";
+    vertShaderStageInfo.pSpecializationInfo = specialization.GetInfo();
 
     //frag shader info
     VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     //frag module and call it main
-    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.module = m_fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specialization.GetInfo();
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
@@ -761,30 +1392,16 @@ void VulkanBackend::CreateGraphicsPipeline()
     //How things are actually drawn
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.topology = key.m_topology;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    //Viewport physical
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)m_swapChainExtent.width;
-    viewport.height = (float)m_swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    //Scissor (cuts off pixels outside of it, regardless of framebuffer)
-    VkRect2D scissor = {};
-    scissor.offset = { 0, 0 };
-    scissor.extent = m_swapChainExtent;
-
-    //Viewport state info
+    //Viewport and scissor are set when recording, so a resize doesn't touch the pipelines
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
+    viewportState.pViewports = nullptr;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    viewportState.pScissors = nullptr;
 
     //The rasterizer state info
     VkPipelineRasterizationStateCreateInfo rasterizer = {};
@@ -793,8 +1410,10 @@ void VulkanBackend::CreateGraphicsPipeline()
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
     rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.cullMode = key.m_cullMode;
+    //Geometry winds counter-clockwise seen from the front. Camera's projection flips Y for
+    //Vulkan's clip space, which keeps that winding counter-clockwise in framebuffer space.
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rasterizer.depthBiasEnable = VK_FALSE;
     rasterizer.depthBiasConstantFactor = 0.0f; // Optional
     rasterizer.depthBiasClamp = 0.0f; // Optional
@@ -804,13 +1423,21 @@ void VulkanBackend::CreateGraphicsPipeline()
     VkPipelineMultisampleStateCreateInfo multisampling = {};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.rasterizationSamples = m_msaaSamples;
     multisampling.minSampleShading = 1.0f; // Optional
     multisampling.pSampleMask = nullptr; // Optional
     multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
     multisampling.alphaToOneEnable = VK_FALSE; // Optional
 
-    //Can set up depth or stencil tests here actually but don't need one for triangles
+    //Reversed-Z, nearer fragments have the greater depth.
+    //After a pre-pass the depth is final, so only the exact visible fragment passes.
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = key.m_depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = key.m_pass == PipelinePass::ForwardDepthEqual ? VK_FALSE : VK_TRUE;
+    depthStencil.depthCompareOp = key.m_pass == PipelinePass::ForwardDepthEqual ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_GREATER;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
 
     //Allows for color blending
     VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
@@ -828,7 +1455,8 @@ void VulkanBackend::CreateGraphicsPipeline()
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlending.logicOpEnable = VK_FALSE;
     colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-    colorBlending.attachmentCount = 1;
+    //The pre-pass has no color attachment to blend into
+    colorBlending.attachmentCount = depthOnly ? 0 : 1;
     colorBlending.pAttachments = &colorBlendAttachment;
     colorBlending.blendConstants[0] = 0.0f; // Optional
     colorBlending.blendConstants[1] = 0.0f; // Optional
@@ -837,98 +1465,456 @@ void VulkanBackend::CreateGraphicsPipeline()
 
     //Allows you to actually change the viewport or the line width without entirely recreating 
     //the pipeline
-    VkDynamicState dynamicStates[] = {
+    std::vector<VkDynamicState> dynamicStates = {
     VK_DYNAMIC_STATE_VIEWPORT,
+    VK_DYNAMIC_STATE_SCISSOR,
     VK_DYNAMIC_STATE_LINE_WIDTH
     };
 
+#ifdef VK_EXT_extended_dynamic_state
+    //The registry already folded these out of the key, so the values above are just placeholders
+    if (m_extendedDynamicState)
+    {
+        dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT);
+    }
+#endif //VK_EXT_extended_dynamic_state
+
     VkPipelineDynamicStateCreateInfo dynamicState = {};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = 2;
-    dynamicState.pDynamicStates = dynamicStates;
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0; // Optional
-    pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
-    }
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
 
     VkGraphicsPipelineCreateInfo pipelineInfo = {};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
+    //Vertex stage only for the pre-pass, there's nothing for a fragment shader to do
+    pipelineInfo.stageCount = depthOnly ? 1 : 2;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &inputAssembly;
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr; // Optional
-    pipelineInfo.layout = m_pipelineLayout;
-    pipelineInfo.renderPass = m_renderPass;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = key.m_meshlets ? m_meshletPipelineLayout : m_pipelineLayout;
+    pipelineInfo.renderPass = depthOnly ? m_depthPrePassRenderPass : m_renderPass;
     pipelineInfo.subpass = 0;
 
     //They have pipeline inheritance, so you can change small portions and base it off an existing pipeline.
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
     pipelineInfo.basePipelineIndex = -1; // Optional
 
-    if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create graphics pipeline!");
     }
 
-    vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+    return pipeline;
+}
+
+void VulkanBackend::SetDynamicState(VkCommandBuffer cmd, [[maybe_unused]] const PipelineKey& key)
+{
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)m_swapChainExtent.width;
+    viewport.height = (float)m_swapChainExtent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    //Scissor (cuts off pixels outside of it, regardless of framebuffer)
+    VkRect2D scissor = {};
+    scissor.offset = { 0, 0 };
+    scissor.extent = m_swapChainExtent;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdSetLineWidth(cmd, 1.0f);
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (m_extendedDynamicState)
+    {
+        VulkanImport::CmdSetCullModeEXT(cmd, key.m_cullMode);
+        VulkanImport::CmdSetDepthTestEnableEXT(cmd, key.m_depthTest ? VK_TRUE : VK_FALSE);
+        VulkanImport::CmdSetPrimitiveTopologyEXT(cmd, key.m_topology);
+    }
+#endif //VK_EXT_extended_dynamic_state
 }
 
 void VulkanBackend::CreateFramebuffers()
 {
-    m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
+    TRACE_SCOPE("CreateFramebuffers");
 
-    //Create a frame buffer for each image view we have
+    //Enough room for every swapchain image plus the passes that come later
+    m_framebufferCache.Init(m_device, 64, MAX_FRAMES_IN_FLIGHT);
+
+    //The depth buffer lives in the render graph, so it has to be allocated first
+    CompileFrameGraph(0);
+
+    //Create a frame buffer for each image view we have up front, so recording never has to
     for (size_t i = 0; i < m_swapChainImageViews.size(); i++) {
-        VkImageView attachments[] = {
-            m_swapChainImageViews[i]
-        };
+        m_framebufferCache.GetFramebuffer(GetSwapChainFramebufferKey(static_cast<uint32_t>(i)));
+    }
+}
+
+FramebufferKey VulkanBackend::GetSwapChainFramebufferKey(uint32_t imageIndex) const
+{
+    FramebufferKey key;
+    key.m_renderPass = m_renderPass;
+    //Same order as the attachments in GetForwardPassKey
+    if (m_msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+    {
+        key.m_attachments[key.m_attachmentCount++] = m_renderGraph.GetImageView(m_msaaColorResource);
+        key.m_attachments[key.m_attachmentCount++] = m_renderGraph.GetImageView(m_depthResource);
+        key.m_attachments[key.m_attachmentCount++] = m_swapChainImageViews[imageIndex];
+    }
+    else
+    {
+        key.m_attachments[key.m_attachmentCount++] = m_swapChainImageViews[imageIndex];
+        key.m_attachments[key.m_attachmentCount++] = m_renderGraph.GetImageView(m_depthResource);
+    }
+    key.m_width = m_swapChainExtent.width;
+    key.m_height = m_swapChainExtent.height;
+    key.m_layers = 1;
+
+    return key;
+}
+
+FramebufferKey VulkanBackend::GetDepthPrePassFramebufferKey() const
+{
+    FramebufferKey key;
+    key.m_renderPass = m_depthPrePassRenderPass;
+    key.m_attachments[key.m_attachmentCount++] = m_renderGraph.GetImageView(m_depthResource);
+    key.m_width = m_swapChainExtent.width;
+    key.m_height = m_swapChainExtent.height;
+    key.m_layers = 1;
+
+    return key;
+}
+
+VkFormat VulkanBackend::FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+{
+    for (VkFormat format : candidates)
+    {
+        if (m_deviceCaps.SupportsFormat(format, tiling, features))
+        {
+            return format;
+        }
+    }
 
-        VkFramebufferCreateInfo framebufferInfo = {};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = m_renderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = m_swapChainExtent.width;
-        framebufferInfo.height = m_swapChainExtent.height;
-        framebufferInfo.layers = 1;
+    throw std::runtime_error("failed to find supported format!");
+}
+
+void VulkanBackend::FindDepthFormat()
+{
+    TRACE_SCOPE("FindDepthFormat");
+
+    //Reversed-Z only pays off with floating point depth
+    m_depthFormat = FindSupportedFormat(
+        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT },
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+}
 
-        if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_swapChainFramebuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create framebuffer!");
+void VulkanBackend::ChooseSampleCount()
+{
+    TRACE_SCOPE("ChooseSampleCount");
+
+    //Color and depth are both multisampled, so both have to support the count
+    const VkPhysicalDeviceLimits& limits = m_deviceCaps.GetLimits();
+    VkSampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+
+    //Highest supported count that doesn't go over what was asked for, 8x at most
+    m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    for (VkSampleCountFlagBits samples : { VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_2_BIT })
+    {
+        if (samples <= m_settings.m_msaaSamples && (supported & samples))
+        {
+            m_msaaSamples = samples;
+            break;
         }
     }
 }
 
+void VulkanBackend::CreateOverdrawQueries()
+{
+    TRACE_SCOPE("CreateOverdrawQueries");
+
+    if (!m_settings.m_debugOverdraw)
+    {
+        return;
+    }
+
+    //One query per swapchain image, each command buffer owns its own
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+    queryPoolInfo.queryCount = static_cast<uint32_t>(m_swapChainImages.size());
+
+    if (vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &m_overdrawQueryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create overdraw query pool!");
+    }
+}
+
+void VulkanBackend::CreateTimestampQueries()
+{
+    TRACE_SCOPE("CreateTimestampQueries");
+
+    if (!m_settings.m_gpuTimestamps)
+    {
+        return;
+    }
+
+    //One pool per command buffer, like the overdraw queries
+    Profiler::GetInstance()->InitGpu(m_device, m_deviceCaps, m_queueFamilyIndices.m_graphicsFamily.value(), static_cast<uint32_t>(m_swapChainImages.size()));
+}
+
+void VulkanBackend::ReadOverdrawQuery(uint32_t imageIndex)
+{
+    uint64_t samples = 0;
+    if (vkGetQueryPoolResults(m_device, m_overdrawQueryPool, imageIndex, 1, sizeof(samples), &samples, sizeof(samples), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    m_overdrawSamples += samples;
+    m_overdrawFrames++;
+
+    //Every shaded fragment passed the depth test, so samples over pixels is the overdraw
+    const uint32_t reportInterval = 120;
+    if (m_overdrawFrames == reportInterval)
+    {
+        //Occlusion queries count samples, not pixels
+        double pixels = static_cast<double>(m_swapChainExtent.width) * m_swapChainExtent.height * m_msaaSamples * reportInterval;
+        std::cout << "overdraw: " << m_overdrawSamples / pixels << " shaded fragments per pixel"
+            << (m_settings.m_depthPrePass ? " (depth pre-pass)" : "")
+            << (m_preciseOcclusion ? "" : " (imprecise queries)") << std::endl;
+
+        m_overdrawSamples = 0;
+        m_overdrawFrames = 0;
+    }
+}
+
+void VulkanBackend::CreateUniformRing()
+{
+    TRACE_SCOPE("CreateUniformRing");
+
+    //A region per image, since that's what the command buffers are recorded per
+    std::vector<UniformBinding> bindings(2);
+    bindings[0].m_range = sizeof(FrameUniforms);
+    bindings[1].m_range = sizeof(ObjectUniforms);
+    bindings[1].m_stages = VK_SHADER_STAGE_VERTEX_BIT;
+
+    m_uniformRing.Init(m_device, m_deviceCaps.GetMemoryProperties(), m_deviceCaps.GetLimits(),
+        static_cast<uint32_t>(m_swapChainImages.size()), UNIFORM_REGION_SIZE, bindings);
+}
+
+VulkanBackend::UniformOffsets VulkanBackend::WriteUniforms(uint32_t imageIndex)
+{
+    PROFILE_SCOPE("WriteUniforms");
+
+    m_uniformRing.BeginFrame(imageIndex);
+
+    UniformOffsets offsets;
+    offsets.m_frame = m_uniformRing.Write(m_frameUniforms);
+    offsets.m_object = m_uniformRing.Write(m_objectUniforms);
+
+    m_uniformRing.EndFrame();
+
+    return offsets;
+}
+
+void VulkanBackend::BindUniforms(VkCommandBuffer cmd, uint32_t imageIndex)
+{
+    //Dynamic offsets go in binding order
+    const UniformOffsets& offsets = m_uniformOffsets[imageIndex];
+    uint32_t dynamicOffsets[] = { offsets.m_frame, offsets.m_object };
+    VkDescriptorSet set = m_uniformRing.GetDescriptorSet();
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &set, 2, dynamicOffsets);
+
+    if (m_virtualTexture.IsLoaded())
+    {
+        VkDescriptorSet virtualTextureSet = m_virtualTexture.GetDescriptorSet();
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 1, 1, &virtualTextureSet, 0, nullptr);
+    }
+
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &m_drawConstants);
+}
+
+void VulkanBackend::CreateVirtualTexture()
+{
+    TRACE_SCOPE("CreateVirtualTexture");
+
+    //Slots follow the images, that's what the feedback copies are recorded per
+    m_virtualTexture.Init(m_device, &m_deviceCaps, m_graphicsQueue, m_queueFamilyIndices.m_graphicsFamily.value(), &m_graphicsTimeline, &m_samplerCache,
+        m_settings.m_virtualTexturePath, static_cast<uint32_t>(m_swapChainImages.size()), m_swapChainExtent, m_settings.m_virtualTexture);
+
+    if (Log::IsEnabled(LogLevel::Info))
+    {
+        m_virtualTexture.PrintReport(std::cout);
+    }
+}
+
+uint32_t VulkanBackend::PrepareVirtualTexture(uint32_t imageIndex, QueueTimeline::Batch& batch, VkCommandBuffer* commandBuffers)
+{
+    uint32_t count = 0;
+
+    if (m_virtualTexture.IsLoaded())
+    {
+        //Timeline values only go up, so the one this frame is about to get doubles as its frame number
+        VirtualTexture::Update update = m_virtualTexture.BeginFrame(imageIndex, m_graphicsTimeline.GetLastSubmitted() + 1, m_frameArena.GetResource());
+        if (update.m_commandBuffer != VK_NULL_HANDLE)
+        {
+            commandBuffers[count++] = update.m_commandBuffer;
+        }
+        if (update.m_waitSemaphore != VK_NULL_HANDLE)
+        {
+            batch.Wait(update.m_waitSemaphore, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+    }
+
+    commandBuffers[count++] = m_commandBuffers[imageIndex];
+    return count;
+}
+
+void VulkanBackend::CreateMeshletGeometry()
+{
+    TRACE_SCOPE("CreateMeshletGeometry");
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    BuildSphereGrid(m_settings.m_meshletGridSize, positions, indices);
+
+    //No cull shader culls on the CPU
+    std::vector<char> cullShader;
+    if (m_settings.m_meshletGpuCulling)
+    {
+        //The CPU path draws the same meshlets, a missing cull shader only costs CPU time
+        try
+        {
+            cullShader = Util::ReadFile("shaders/meshlet_cull.spv");
+        }
+        catch (const std::runtime_error&)
+        {
+            if (Log::IsEnabled(LogLevel::Warning))
+            {
+                std::cout << "shaders/meshlet_cull.spv is missing, culling meshlets on the CPU" << std::endl;
+            }
+        }
+    }
+
+    //Slots follow the images, like everything else the command buffers are recorded per
+    m_meshletGeometry.Init(m_device, &m_deviceCaps, m_commandPool, &m_graphicsTimeline, &m_deletionQueue, &m_memoryBudget, positions, indices,
+        static_cast<uint32_t>(m_swapChainImages.size()), cullShader, m_drawIndirectCount, m_multiDrawIndirect,
+        m_asyncCompute.GetQueueFamily(), m_queueFamilyIndices.m_graphicsFamily.value());
+
+    //The frame's draws are the first thing the passes need, everything before overlaps the cull
+    if (m_meshletGeometry.IsGpuCulled())
+    {
+        AddComputeJob("MeshletCull", VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            [this](VkCommandBuffer cmd, uint32_t) { m_meshletGeometry.RecordCull(cmd, m_meshletSlot); });
+    }
+
+    m_meshletVertShaderModule = CreateShaderModule(Util::ReadFile("shaders/meshlet_vert.spv"));
+
+    //Same set 0 and push constants as m_pipelineLayout, so the uniforms stay bound across both
+    VkDescriptorSetLayout setLayouts[2] = { m_uniformRing.GetSetLayout(), m_meshletGeometry.GetSetLayout() };
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_meshletPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create meshlet pipeline layout!");
+    }
+
+    if (Log::IsEnabled(LogLevel::Info))
+    {
+        m_meshletGeometry.PrintReport(std::cout);
+    }
+}
+
+void VulkanBackend::UpdateMeshlets(uint32_t imageIndex)
+{
+    if (m_meshletGeometry.IsLoaded())
+    {
+        m_meshletGeometry.Update(imageIndex, m_frameUniforms.m_viewProjection, m_objectUniforms.m_model, glm::vec3(m_frameUniforms.m_cameraPosition));
+        m_meshletSlot = imageIndex;
+    }
+}
+
+void VulkanBackend::DrawMeshlets(VkCommandBuffer cmd, uint32_t imageIndex, PipelinePass pass)
+{
+    if (!m_meshletGeometry.IsLoaded())
+    {
+        return;
+    }
+
+    PipelineKey key = m_graphicsPipelineKey;
+    key.m_pass = pass;
+    key.m_meshlets = true;
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, GetPipeline(key));
+    SetDynamicState(cmd, key);
+
+    //Set 0 and the push constants carry over from BindUniforms, only set 1 changes
+    VkDescriptorSet set = m_meshletGeometry.GetDescriptorSet();
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_meshletPipelineLayout, 1, 1, &set, 0, nullptr);
+
+    m_meshletGeometry.RecordDraw(cmd, imageIndex);
+}
+
 void VulkanBackend::CreateCommandPool()
 {
-    QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(m_physicalDevice);
+    TRACE_SCOPE("CreateCommandPool");
 
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.queueFamilyIndex = queueFamilyIndices.m_graphicsFamily.value();
+    poolInfo.queueFamilyIndex = m_queueFamilyIndices.m_graphicsFamily.value();
     poolInfo.flags = 0; // Optional
 
     if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
 
+    //Uploads are recorded into the same pool
+    m_textureLoader.Init(m_device, &m_deviceCaps, m_commandPool, &m_graphicsTimeline, &m_deletionQueue, &m_memoryBudget);
+    m_textureStreamer.Init(&m_textureLoader, &m_memoryBudget, m_settings.m_textureStreaming);
+}
+
+void VulkanBackend::CreateAsyncCompute()
+{
+    TRACE_SCOPE("CreateAsyncCompute");
+
+    bool dedicated = m_queueFamilyIndices.m_computeFamily.has_value();
+    uint32_t family = dedicated ? m_queueFamilyIndices.m_computeFamily.value() : m_queueFamilyIndices.m_graphicsFamily.value();
+
+    m_asyncCompute.Init(m_device, m_computeQueue, family, dedicated, MAX_FRAMES_IN_FLIGHT, m_timelineSemaphores);
+
+    if (Log::IsEnabled(LogLevel::Verbose))
+    {
+        std::cout << "compute: " << (dedicated ? "dedicated queue family " : "graphics queue family ") << family << std::endl;
+    }
 }
 
 void VulkanBackend::CreateCommandBuffers()
 {
-    m_commandBuffers.resize(m_swapChainFramebuffers.size());
+    TRACE_SCOPE("CreateCommandBuffers");
+
+    m_commandBuffers.resize(m_swapChainImageViews.size());
+    m_uniformOffsets.resize(m_swapChainImageViews.size());
 
     VkCommandBufferAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -951,54 +1937,233 @@ void VulkanBackend::CreateCommandBuffers()
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        //Fills the image's region once, for the offsets the draws bind with
+        m_uniformOffsets[i] = WriteUniforms(static_cast<uint32_t>(i));
+
+        //Same structure for every image, so only the first one actually compiles
+        CompileFrameGraph(static_cast<uint32_t>(i));
+
+        //Whole frame plus every pass on the GPU, does nothing unless timestamps are on
+        uint32_t slot = static_cast<uint32_t>(i);
+        Profiler* profiler = Profiler::GetInstance();
+        profiler->BeginGpuFrame(m_commandBuffers[i], slot);
+        profiler->BeginGpuScope(m_commandBuffers[i], slot, "Frame");
+        //Feedback is written by whatever samples the virtual texture, and copied out for the CPU after
+        if (m_virtualTexture.IsLoaded())
+        {
+            m_virtualTexture.RecordFeedbackClear(m_commandBuffers[i]);
+        }
+        //The cull job wrote the draws the passes read on the compute queue
+        if (m_meshletGeometry.IsLoaded())
+        {
+            m_meshletGeometry.RecordAcquire(m_commandBuffers[i], slot);
+        }
+        m_renderGraph.Execute(m_commandBuffers[i],
+            [profiler, slot](VkCommandBuffer cmd, const std::string& pass) { profiler->BeginGpuScope(cmd, slot, pass); },
+            [profiler, slot](VkCommandBuffer cmd, const std::string&) { profiler->EndGpuScope(cmd, slot); });
+        if (m_virtualTexture.IsLoaded())
+        {
+            m_virtualTexture.RecordFeedbackCopy(m_commandBuffers[i], slot);
+        }
+        profiler->EndGpuScope(m_commandBuffers[i], slot);
+
+        if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS) 
+        {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+
+
+}
+
+void VulkanBackend::BuildFrameGraph(uint32_t imageIndex)
+{
+    m_renderGraph.Reset();
+
+    //Swapchain image, comes in undefined once acquire has signalled and has to leave ready to present
+    RenderResourceDesc backbufferDesc;
+    backbufferDesc.m_name = "Backbuffer";
+    backbufferDesc.m_format = m_swapChainImageFormat;
+    backbufferDesc.m_extent = m_swapChainExtent;
+    backbufferDesc.m_initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    backbufferDesc.m_initialStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    backbufferDesc.m_finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    if (m_settings.m_headless)
+    {
+        //Nothing to wait on, the readback fence already covers the image's last use
+        backbufferDesc.m_initialStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        backbufferDesc.m_finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    }
+
+    RenderResourceHandle backbuffer = m_renderGraph.Import(backbufferDesc, m_swapChainImages[imageIndex], m_swapChainImageViews[imageIndex]);
+    m_renderGraph.MarkOutput(backbuffer);
+
+    //Depth is only needed inside the frame, the graph owns its memory
+    RenderResourceDesc depthDesc;
+    depthDesc.m_name = "Depth";
+    depthDesc.m_format = m_depthFormat;
+    depthDesc.m_extent = m_swapChainExtent;
+    depthDesc.m_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    depthDesc.m_samples = m_msaaSamples;
+    //Without a pre-pass depth never leaves the forward pass, so it can stay on tile
+    depthDesc.m_transientAttachment = !m_settings.m_depthPrePass;
+    if (m_depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT)
+    {
+        depthDesc.m_aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    m_depthResource = m_renderGraph.CreateTransient(depthDesc);
+
+    //Multisampled color, resolved into the backbuffer by the forward subpass
+    if (m_msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+    {
+        RenderResourceDesc msaaColorDesc;
+        msaaColorDesc.m_name = "MsaaColor";
+        msaaColorDesc.m_format = m_swapChainImageFormat;
+        msaaColorDesc.m_extent = m_swapChainExtent;
+        msaaColorDesc.m_samples = m_msaaSamples;
+        msaaColorDesc.m_transientAttachment = true;
+        m_msaaColorResource = m_renderGraph.CreateTransient(msaaColorDesc);
+    }
+
+    if (m_settings.m_depthPrePass)
+    {
+        uint32_t depthPrePass = m_renderGraph.AddPass("DepthPrePass", [this, imageIndex](VkCommandBuffer cmd)
+        {
+            VkRenderPassBeginInfo renderPassInfo = {};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = m_depthPrePassRenderPass;
+            renderPassInfo.framebuffer = m_framebufferCache.GetFramebuffer(GetDepthPrePassFramebufferKey());
+            renderPassInfo.renderArea.offset = { 0, 0 };
+            renderPassInfo.renderArea.extent = m_swapChainExtent;
+
+            //Reversed-Z clears to the far plane
+            VkClearValue clearDepth = {};
+            clearDepth.depthStencil = { 0.0f, 0 };
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearDepth;
+
+            vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            PipelineKey key;
+            key.m_pass = PipelinePass::DepthPrePass;
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, GetPipeline(key));
+            SetDynamicState(cmd, key);
+            BindUniforms(cmd, imageIndex);
+
+            vkCmdDraw(cmd, 3, 1, 0, 0);
+            DrawMeshlets(cmd, imageIndex, PipelinePass::DepthPrePass);
+
+            vkCmdEndRenderPass(cmd);
+        });
+        m_renderGraph.Write(depthPrePass, m_depthResource, RenderResourceUsage::DepthAttachment);
+    }
+
+    uint32_t forwardPass = m_renderGraph.AddPass("Forward", [this, imageIndex](VkCommandBuffer cmd)
+    {
+        //Occlusion queries have to be reset outside of a render pass
+        if (m_overdrawQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(cmd, m_overdrawQueryPool, imageIndex, 1);
+        }
+
         VkRenderPassBeginInfo renderPassInfo = {};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = m_renderPass;
-        renderPassInfo.framebuffer = m_swapChainFramebuffers[i];
+        renderPassInfo.framebuffer = m_framebufferCache.GetFramebuffer(GetSwapChainFramebufferKey(imageIndex));
         renderPassInfo.renderArea.offset = { 0, 0 };
         renderPassInfo.renderArea.extent = m_swapChainExtent;
 
-        VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
+        //Reversed-Z clears depth to the far plane, which is 0.
+        //The resolve target (third with MSAA) isn't cleared, its value is ignored.
+        VkClearValue clearValues[3] = {};
+        clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+        clearValues[1].depthStencil = { 0.0f, 0 };
+        renderPassInfo.clearValueCount = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT ? 3 : 2;
+        renderPassInfo.pClearValues = clearValues;
 
-        vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+        if (m_overdrawQueryPool != VK_NULL_HANDLE)
+        {
+            vkCmdBeginQuery(cmd, m_overdrawQueryPool, imageIndex, m_preciseOcclusion ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+        }
 
-        vkCmdDraw(m_commandBuffers[i], 3, 1, 0, 0);
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+        SetDynamicState(cmd, m_graphicsPipelineKey);
+        BindUniforms(cmd, imageIndex);
 
-        vkCmdEndRenderPass(m_commandBuffers[i]);
+        vkCmdDraw(cmd, 3, 1, 0, 0);
+        DrawMeshlets(cmd, imageIndex, m_graphicsPipelineKey.m_pass);
 
-        if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS) 
+        if (m_overdrawQueryPool != VK_NULL_HANDLE)
         {
-            throw std::runtime_error("failed to record command buffer!");
+            vkCmdEndQuery(cmd, m_overdrawQueryPool, imageIndex);
         }
+
+        vkCmdEndRenderPass(cmd);
+    });
+    m_renderGraph.Write(forwardPass, backbuffer, RenderResourceUsage::ColorAttachment);
+    if (m_msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+    {
+        m_renderGraph.Write(forwardPass, m_msaaColorResource, RenderResourceUsage::ColorAttachment);
+    }
+
+    //After a pre-pass the forward pass only tests against depth
+    if (m_settings.m_depthPrePass)
+    {
+        m_renderGraph.Read(forwardPass, m_depthResource, RenderResourceUsage::DepthRead);
+    }
+    else
+    {
+        m_renderGraph.Write(forwardPass, m_depthResource, RenderResourceUsage::DepthAttachment);
+    }
+
+    //Copies the finished frame into this image's readback slot
+    if (m_settings.m_headless)
+    {
+        uint32_t readbackPass = m_renderGraph.AddPass("Readback", [this, imageIndex](VkCommandBuffer cmd)
+        {
+            m_readbackRing.RecordCopy(cmd, imageIndex, m_swapChainImages[imageIndex], VK_IMAGE_ASPECT_COLOR_BIT, m_swapChainExtent);
+        });
+        m_renderGraph.Read(readbackPass, backbuffer, RenderResourceUsage::TransferSrc);
+        m_renderGraph.MarkSideEffect(readbackPass);
     }
+}
+
+void VulkanBackend::CompileFrameGraph(uint32_t imageIndex)
+{
+    BuildFrameGraph(imageIndex);
+    m_renderGraph.Compile();
 
+    m_renderGraph.AllocateTransients(m_device, m_deviceCaps.GetMemoryProperties(), &m_deletionQueue);
 
+    //Transients are reallocated whenever the graph changes shape, so the count is swapped wholesale
+    m_memoryBudget.Release(MemoryCategory::RenderTarget, m_renderTargetBytes);
+    m_renderTargetBytes = m_renderGraph.GetTransientBytes();
+    m_memoryBudget.Track(MemoryCategory::RenderTarget, m_renderTargetBytes);
 }
 
 void VulkanBackend::CreateSyncObjects()
 {
+    TRACE_SCOPE("CreateSyncObjects");
+
+    //Presentation only takes binary semaphores, everything else is tracked on the graphics timeline
     m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    m_imagesInFlight.resize(m_swapChainImages.size(), VK_NULL_HANDLE);
+    //Value 0 is always complete, so nothing waits before the first submits
+    m_frameTimelineValues.assign(MAX_FRAMES_IN_FLIGHT, 0);
+    m_imageTimelineValues.assign(m_swapChainImages.size(), 0);
+
+    //Scratch memory follows whatever the frame waits on before reuse: the frame slot, or
+    //the image in headless mode where nothing waits on the slots
+    m_frameArena.Init(m_settings.m_headless ? static_cast<uint32_t>(m_swapChainImages.size()) : MAX_FRAMES_IN_FLIGHT);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    //Will wait forever because it sits unsignalled initially
-    //We force signal it initially so that we can run our program
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(m_device, &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
+            vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS) {
 
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
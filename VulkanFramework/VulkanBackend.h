@@ -15,14 +15,41 @@
 #include <set>
 #include <cstdint>
 #include <algorithm>
+#include <future>
+
+#include <glm/glm.hpp>
 
 #include "VulkanImport.h"
 #include "Util.h"
+#include "PipelineRegistry.h"
+#include "RenderGraph.h"
+#include "RenderPassCache.h"
+#include "SamplerCache.h"
+#include "ReadbackRing.h"
+#include "DeviceCaps.h"
+#include "DeviceSelector.h"
+#include "AsyncCompute.h"
+#include "DeletionQueue.h"
+#include "PresentPolicy.h"
+#include "FramePacer.h"
+#include "FrameArena.h"
+#include "UniformRing.h"
+#include "MemoryBudget.h"
+#include "MeshletGeometry.h"
+#include "Texture.h"
+#include "TextureStreamer.h"
+#include "VirtualTexture.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "Log.h"
+#include "StartupTimeline.h"
 
 struct QueueFamilyIndices
 {
     std::optional<uint32_t> m_graphicsFamily;
     std::optional<uint32_t> m_presentFamily;
+    //A family with compute but no graphics, for async compute. Optional, graphics stands in.
+    std::optional<uint32_t> m_computeFamily;
 
     bool IsComplete()
     {
@@ -30,29 +57,149 @@ struct QueueFamilyIndices
     }
 };
 
-struct SwapChainSupportDetails {
-    VkSurfaceCapabilitiesKHR m_capabilities;
-    std::vector<VkSurfaceFormatKHR> m_formats;
-    std::vector<VkPresentModeKHR> m_presentModes;
+//Options that have to be known before the device and passes are created
+struct RenderSettings
+{
+    //Renders opaque depth first so the forward pass shades each pixel once
+    bool m_depthPrePass = false;
+    //Counts shaded fragments with an occlusion query and reports fragments per pixel
+    bool m_debugOverdraw = false;
+    //MSAA sample count (1, 2, 4 or 8), capped by what the device can render to
+    VkSampleCountFlagBits m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    //No window, surface or swapchain. Frames go to offscreen images and are read back.
+    bool m_headless = false;
+    //Offscreen images (and readback slots) frames rotate through in headless mode
+    uint32_t m_offscreenImageCount = 3;
+    //Times every render graph pass on the GPU, results go to the Profiler
+    bool m_gpuTimestamps = false;
+    //Device index or part of its name, overrides scoring. Falls back to the VF_DEVICE environment variable.
+    std::string m_deviceOverride;
+    //Present mode and swapchain image count, see PresentPolicy
+    PresentPolicy m_presentPolicy = PresentPolicy::LowLatency;
+    //Delays the start of each frame so input is sampled as late as possible, see FramePacer
+    bool m_framePacing = true;
+    //Converted texture to stream as a virtual texture, bound as set 1 (see VirtualTexture). None if empty.
+    std::string m_virtualTexturePath;
+    VirtualTextureSettings m_virtualTexture;
+    //Device local memory to stay under in bytes, 0 leaves it to the device (see MemoryBudget)
+    VkDeviceSize m_memoryBudget = 0;
+    TextureStreamerSettings m_textureStreaming;
+    //Grid of n x n spheres drawn as culled meshlets, see MeshletGeometry. None if 0.
+    uint32_t m_meshletGridSize = 0;
+    //Culls meshlets with Shaders/MeshletCull.comp, on the CPU otherwise
+    bool m_meshletGpuCulling = true;
+    //Fragment shader permutation everything is drawn with
+    LightingModel m_lightingModel = LightingModel::Unlit;
+};
+
+//Per frame shader constants, set 0 binding 0. std140, so vec4s only.
+struct FrameUniforms
+{
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+    //w is the time in seconds
+    glm::vec4 m_cameraPosition = glm::vec4(0.0f);
+};
+
+//Per object shader constants, set 0 binding 1
+struct ObjectUniforms
+{
+    glm::mat4 m_model = glm::mat4(1.0f);
+};
+
+//Push constants, for the few bytes that change with every draw
+struct DrawConstants
+{
+    glm::vec4 m_tint = glm::vec4(1.0f);
 };
 
+//Pixels of a finished headless frame, tightly packed rows of 4 byte texels
+using FrameReadbackFunc = std::function<void(uint64_t frame, const uint8_t* pixels, uint32_t width, uint32_t height, VkFormat format)>;
+
 class VulkanBackend
 {
+    //SPIR-V read off disk while the device is still being set up
+    struct ShaderCode
+    {
+        std::vector<char> m_vert;
+        std::vector<char> m_frag;
+        StartupTimeline::StageId m_stage = StartupTimeline::NO_STAGE;
+    };
+
 public:
     //Get singleton vulkan backend instance
     static VulkanBackend* GetInstance();
     
-    //Vulkan initialization
-    void InitVulkan(GLFWwindow* window, const int width, const int height);
+    //Vulkan initialization, window is ignored (and can be null) in headless mode
+    void InitVulkan(GLFWwindow* window, const int width, const int height, const RenderSettings& settings = RenderSettings());
 
     void DrawFrame();
     void WaitForIdle();
 
     void CleanupVulkan();
 
+    //Gets the pipeline for a shader permutation and pass, building it on first use
+    VkPipeline GetPipeline(const PipelineKey& key);
+
+    //Called with every rendered frame in headless mode, a few frames after it was submitted
+    void SetReadbackCallback(FrameReadbackFunc callback) { m_readbackCallback = std::move(callback); }
+
+    //Adds compute work submitted every frame ahead of the graphics that reads it, see AsyncCompute.
+    //Goes to the graphics queue when there is no compute-only family.
+    void AddComputeJob(const std::string& name, VkPipelineStageFlags consumerStage, AsyncCompute::RecordFunc record) { m_asyncCompute.AddJob(name, consumerStage, std::move(record)); }
+    bool HasAsyncCompute() const { return m_asyncCompute.IsDedicated(); }
+    //Sharing lists for resources used by both queues
+    const QueueFamilyIndices& GetQueueFamilyIndices() const { return m_queueFamilyIndices; }
+
+    //Every graphics submit signals the next value, anything retired by a frame can key on it
+    QueueTimeline& GetGraphicsTimeline() { return m_graphicsTimeline; }
+    //Destroys resources once the frames that might use them are done, drained every frame
+    DeletionQueue& GetDeletionQueue() { return m_deletionQueue; }
+
+    //InitVulkan records each of its stages here, Begin it before anything startup related happens
+    StartupTimeline& GetStartupTimeline() { return m_startupTimeline; }
+
+    //What the present policy ended up with, and the intervals between presents under it
+    VkPresentModeKHR GetPresentMode() const { return m_presentMode; }
+    const PresentStats& GetPresentStats() const { return m_presentStats; }
+    //Per frame scratch memory for std::pmr containers, released when the frame slot is reused.
+    //Each thread allocates from its own arena, see FrameArena.
+    FrameArena& GetFrameArena() { return m_frameArena; }
+
+    //What the next DrawFrame writes into the uniform ring once its region is free
+    void SetFrameUniforms(const FrameUniforms& uniforms) { m_frameUniforms = uniforms; }
+    void SetObjectUniforms(const ObjectUniforms& uniforms) { m_objectUniforms = uniforms; }
+    UniformRing& GetUniformRing() { return m_uniformRing; }
+
+    //Textures from converted files, see TextureLoader. Main thread only.
+    Texture LoadTexture(const std::string& path, uint32_t skipLevels = 0) { return m_textureLoader.Load(path, skipLevels); }
+    void DestroyTexture(Texture& texture) { m_textureLoader.Destroy(texture); }
+    //Shared samplers, one per distinct sampler state, see SamplerCache
+    SamplerCache& GetSamplerCache() { return m_samplerCache; }
+    //Textures that start at their lowest mips and stream the rest in, updated at the start of every frame
+    TextureStreamer& GetTextureStreamer() { return m_textureStreamer; }
+    //Device memory per category against RenderSettings::m_memoryBudget
+    const MemoryBudget& GetMemoryBudget() const { return m_memoryBudget; }
+    //Only loaded when RenderSettings::m_virtualTexturePath is set
+    VirtualTexture& GetVirtualTexture() { return m_virtualTexture; }
+    //Only loaded when RenderSettings::m_meshletGridSize is set
+    const MeshletGeometry& GetMeshletGeometry() const { return m_meshletGeometry; }
+
+    //The main loop starts each frame through this, see FramePacer
+    FramePacer& GetFramePacer() { return m_framePacer; }
+
     const int MAX_FRAMES_IN_FLIGHT = 2;
 
 private:
+    //Dynamic offsets of one frame's uniforms
+    struct UniformOffsets
+    {
+        uint32_t m_frame = 0;
+        uint32_t m_object = 0;
+    };
+
+    //Uniform ring space per swapchain image
+    static const VkDeviceSize UNIFORM_REGION_SIZE = 64 * 1024;
+
     //Singleton setup
     VulkanBackend() { };
     VulkanBackend(VulkanBackend&) = delete;
@@ -76,34 +223,83 @@ private:
         void* pUserData);
 
     //Device picking
-    bool IsDeviceSuitable(VkPhysicalDevice device);
+    //Empty if the renderer can run on the device
+    std::string GetUnsuitableReason(const DeviceCaps& caps);
     void PickPhysicalDevice();
-    QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device);
+    QueueFamilyIndices FindQueueFamilies(const DeviceCaps& caps) const;
     void CreateLogicalDevice();
-    bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+    bool CheckDeviceExtensionSupport(const DeviceCaps& caps) const;
+    std::vector<const char*> GetDeviceExtensions() const;
 
     //Rendering setup
     void CreateSurface(GLFWwindow* window);
-    SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
     VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, const int width, const int height);
     void CreateSwapChain(const int width, const int height);
 
+    //Headless
+    void CreateOffscreenTargets(const int width, const int height);
+    void DrawFrameHeadless();
+    void DeliverReadback(uint64_t frame, const void* data, VkDeviceSize size);
+
     //Imaging
     void CreateImageViews();
 
     //Graphics Pipeline
     VkShaderModule CreateShaderModule(const std::vector<char>& code);
     void CreateRenderPass();
+    RenderPassKey GetForwardPassKey() const;
     void CreateGraphicsPipeline();
+    VkPipeline BuildGraphicsPipeline(const PipelineKey& key);
+    //Records the state the pipelines leave dynamic, has to follow every pipeline bind
+    void SetDynamicState(VkCommandBuffer cmd, const PipelineKey& key);
+
+    //Depth
+    VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+    void FindDepthFormat();
+    void ChooseSampleCount();
+    RenderPassKey GetDepthPrePassKey() const;
 
     //Framebuffers
     void CreateFramebuffers();
+    FramebufferKey GetSwapChainFramebufferKey(uint32_t imageIndex) const;
+    FramebufferKey GetDepthPrePassFramebufferKey() const;
+
+    //Overdraw debugging
+    void CreateOverdrawQueries();
+    //Once the image's last submit is done and before the next one resets the query
+    void ReadOverdrawQuery(uint32_t imageIndex);
+
+    //Profiling
+    void CreateTimestampQueries();
+
+    //Uniforms
+    void CreateUniformRing();
+    //Writes the frame's uniforms into imageIndex's region of the ring. Same order every time,
+    //so the offsets always match the ones the image's command buffer was recorded with.
+    UniformOffsets WriteUniforms(uint32_t imageIndex);
+    void BindUniforms(VkCommandBuffer cmd, uint32_t imageIndex);
+
+    //Virtual texturing
+    void CreateVirtualTexture();
+    //Runs the virtual texture's uploads for the frame ahead of the image's command buffer.
+    //commandBuffers needs room for two, returns how many there are.
+    uint32_t PrepareVirtualTexture(uint32_t imageIndex, QueueTimeline::Batch& batch, VkCommandBuffer* commandBuffers);
+
+    //Meshlets
+    void CreateMeshletGeometry();
+    //Culls against the uniforms WriteUniforms just wrote for the image, on the GPU the
+    //frame's compute submit does
+    void UpdateMeshlets(uint32_t imageIndex);
+    //Inside the pass's render pass, after everything else it draws
+    void DrawMeshlets(VkCommandBuffer cmd, uint32_t imageIndex, PipelinePass pass);
 
     //Command stuff
     void CreateCommandPool();
+    void CreateAsyncCompute();
     void CreateCommandBuffers();
+    void BuildFrameGraph(uint32_t imageIndex);
+    void CompileFrameGraph(uint32_t imageIndex);
     
     //Sephamore stuffs
     void CreateSyncObjects();
@@ -113,6 +309,8 @@ private:
 
     //Vulkan Variables
     VkInstance m_instance = VK_NULL_HANDLE;
+    //VK_KHR_get_physical_device_properties2 is enabled on the instance
+    bool m_physicalDeviceProperties2 = false;
     VkDebugUtilsMessengerEXT m_debugMessenger = VK_NULL_HANDLE;
     const std::vector<const char*> m_validationLayers =
     {
@@ -123,25 +321,91 @@ private:
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    //Snapshot of m_physicalDevice, query this instead of the driver
+    DeviceCaps m_deviceCaps;
+    QueueFamilyIndices m_queueFamilyIndices;
     VkDevice m_device = VK_NULL_HANDLE;
     VkQueue m_presentQueue = VK_NULL_HANDLE;
     VkQueue m_graphicsQueue = VK_NULL_HANDLE;
+    //Same as m_graphicsQueue when there is no compute-only family
+    VkQueue m_computeQueue = VK_NULL_HANDLE;
+    AsyncCompute m_asyncCompute;
+    //VK_KHR_timeline_semaphore is enabled, QueueTimeline emulates it with fences otherwise
+    bool m_timelineSemaphores = false;
+    QueueTimeline m_graphicsTimeline;
+    DeletionQueue m_deletionQueue;
+    SamplerCache m_samplerCache;
+    TextureLoader m_textureLoader;
+    TextureStreamer m_textureStreamer;
+    //VK_EXT_memory_budget is enabled, MemoryBudget guesses from the heap sizes otherwise
+    bool m_memoryBudgetExtension = false;
+    MemoryBudget m_memoryBudget;
+    //VK_KHR_draw_indirect_count is enabled and loaded, with multiDrawIndirect
+    bool m_drawIndirectCount = false;
+    bool m_multiDrawIndirect = false;
+    MeshletGeometry m_meshletGeometry;
+    //Slot the cull job records for, the image UpdateMeshlets last wrote
+    uint32_t m_meshletSlot = 0;
     VkSurfaceKHR m_surface = VK_NULL_HANDLE;
     VkSwapchainKHR m_swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> m_swapChainImages;
     VkFormat m_swapChainImageFormat;
     VkExtent2D m_swapChainExtent;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    PresentStats m_presentStats;
+    FramePacer m_framePacer;
+    FrameArena m_frameArena;
+    UniformRing m_uniformRing;
+    VirtualTexture m_virtualTexture;
+    FrameUniforms m_frameUniforms;
+    ObjectUniforms m_objectUniforms;
+    DrawConstants m_drawConstants;
+    //Recorded into each image's command buffer
+    std::vector<UniformOffsets> m_uniformOffsets;
     std::vector<VkImageView> m_swapChainImageViews;
+    //Backs the "swapchain" images in headless mode
+    std::vector<VkDeviceMemory> m_offscreenMemory;
+    //What's been reported to m_memoryBudget as render targets
+    VkDeviceSize m_offscreenBytes = 0;
+    VkDeviceSize m_renderTargetBytes = 0;
+    ReadbackRing m_readbackRing;
+    FrameReadbackFunc m_readbackCallback;
+    uint64_t m_headlessFrame = 0;
+    RenderPassCache m_renderPassCache;
     VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkRenderPass m_depthPrePassRenderPass = VK_NULL_HANDLE;
+    VkFormat m_depthFormat = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
     VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
     VkPipeline m_graphicsPipeline = VK_NULL_HANDLE;
-    std::vector<VkFramebuffer> m_swapChainFramebuffers;
+    PipelineKey m_graphicsPipelineKey;
+    bool m_extendedDynamicState = false;
+    VkShaderModule m_vertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule m_fragShaderModule = VK_NULL_HANDLE;
+    //Set 0 the uniform ring, set 1 the meshlet positions
+    VkPipelineLayout m_meshletPipelineLayout = VK_NULL_HANDLE;
+    VkShaderModule m_meshletVertShaderModule = VK_NULL_HANDLE;
+    //Startup work running off the main thread, see InitVulkan
+    std::future<ShaderCode> m_shaderCodeTask;
+    std::future<StartupTimeline::StageId> m_shaderModuleTask;
+    StartupTimeline m_startupTimeline;
+    PipelineRegistry m_pipelineRegistry;
+    FramebufferCache m_framebufferCache;
     VkCommandPool m_commandPool = VK_NULL_HANDLE;
     std::vector<VkCommandBuffer> m_commandBuffers;
+    RenderGraph m_renderGraph;
+    RenderResourceHandle m_depthResource = INVALID_RENDER_RESOURCE;
+    RenderResourceHandle m_msaaColorResource = INVALID_RENDER_RESOURCE;
+    RenderSettings m_settings;
+    VkQueryPool m_overdrawQueryPool = VK_NULL_HANDLE;
+    bool m_preciseOcclusion = false;
+    uint64_t m_overdrawSamples = 0;
+    uint32_t m_overdrawFrames = 0;
     std::vector<VkSemaphore> m_imageAvailableSemaphores;
     std::vector<VkSemaphore> m_renderFinishedSemaphores;
-    std::vector<VkFence> m_inFlightFences;
-    std::vector<VkFence> m_imagesInFlight;
+    //Graphics timeline value each frame slot and swapchain image was last submitted with
+    std::vector<uint64_t> m_frameTimelineValues;
+    std::vector<uint64_t> m_imageTimelineValues;
     size_t m_currentFrame = 0;
 
 #ifdef NDEBUG
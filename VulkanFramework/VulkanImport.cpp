@@ -21,3 +21,109 @@ void VulkanImport::DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUti
         func(instance, debugMessenger, pAllocator);
     }
 }
+
+#ifdef VK_KHR_get_physical_device_properties2
+void VulkanImport::GetPhysicalDeviceFeatures2KHR(VkInstance instance, VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2KHR* pFeatures)
+{
+    auto func = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+    if (func != nullptr)
+    {
+        func(physicalDevice, pFeatures);
+    }
+}
+
+void VulkanImport::GetPhysicalDeviceMemoryProperties2KHR(VkInstance instance, VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties2KHR* pMemoryProperties)
+{
+    auto func = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+    if (func != nullptr)
+    {
+        func(physicalDevice, pMemoryProperties);
+    }
+}
+#endif //VK_KHR_get_physical_device_properties2
+
+#ifdef VK_EXT_extended_dynamic_state
+namespace
+{
+    PFN_vkCmdSetCullModeEXT s_cmdSetCullMode = nullptr;
+    PFN_vkCmdSetDepthTestEnableEXT s_cmdSetDepthTestEnable = nullptr;
+    PFN_vkCmdSetPrimitiveTopologyEXT s_cmdSetPrimitiveTopology = nullptr;
+}
+
+bool VulkanImport::LoadExtendedDynamicState(VkDevice device)
+{
+    s_cmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(device, "vkCmdSetCullModeEXT");
+    s_cmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(device, "vkCmdSetDepthTestEnableEXT");
+    s_cmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(device, "vkCmdSetPrimitiveTopologyEXT");
+
+    return s_cmdSetCullMode != nullptr && s_cmdSetDepthTestEnable != nullptr && s_cmdSetPrimitiveTopology != nullptr;
+}
+
+void VulkanImport::CmdSetCullModeEXT(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode)
+{
+    s_cmdSetCullMode(commandBuffer, cullMode);
+}
+
+void VulkanImport::CmdSetDepthTestEnableEXT(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable)
+{
+    s_cmdSetDepthTestEnable(commandBuffer, depthTestEnable);
+}
+
+void VulkanImport::CmdSetPrimitiveTopologyEXT(VkCommandBuffer commandBuffer, VkPrimitiveTopology primitiveTopology)
+{
+    s_cmdSetPrimitiveTopology(commandBuffer, primitiveTopology);
+}
+#endif //VK_EXT_extended_dynamic_state
+
+#ifdef VK_KHR_timeline_semaphore
+namespace
+{
+    PFN_vkGetSemaphoreCounterValueKHR s_getSemaphoreCounterValue = nullptr;
+    PFN_vkWaitSemaphoresKHR s_waitSemaphores = nullptr;
+    PFN_vkSignalSemaphoreKHR s_signalSemaphore = nullptr;
+}
+
+bool VulkanImport::LoadTimelineSemaphore(VkDevice device)
+{
+    s_getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+    s_waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+    s_signalSemaphore = (PFN_vkSignalSemaphoreKHR)vkGetDeviceProcAddr(device, "vkSignalSemaphoreKHR");
+
+    return s_getSemaphoreCounterValue != nullptr && s_waitSemaphores != nullptr && s_signalSemaphore != nullptr;
+}
+
+VkResult VulkanImport::GetSemaphoreCounterValueKHR(VkDevice device, VkSemaphore semaphore, uint64_t* pValue)
+{
+    return s_getSemaphoreCounterValue(device, semaphore, pValue);
+}
+
+VkResult VulkanImport::WaitSemaphoresKHR(VkDevice device, const VkSemaphoreWaitInfoKHR* pWaitInfo, uint64_t timeout)
+{
+    return s_waitSemaphores(device, pWaitInfo, timeout);
+}
+
+VkResult VulkanImport::SignalSemaphoreKHR(VkDevice device, const VkSemaphoreSignalInfoKHR* pSignalInfo)
+{
+    return s_signalSemaphore(device, pSignalInfo);
+}
+#endif //VK_KHR_timeline_semaphore
+
+#ifdef VK_KHR_draw_indirect_count
+namespace
+{
+    PFN_vkCmdDrawIndexedIndirectCountKHR s_cmdDrawIndexedIndirectCount = nullptr;
+}
+
+bool VulkanImport::LoadDrawIndirectCount(VkDevice device)
+{
+    s_cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+
+    return s_cmdDrawIndexedIndirectCount != nullptr;
+}
+
+void VulkanImport::CmdDrawIndexedIndirectCountKHR(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer,
+    VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+    s_cmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+#endif //VK_KHR_draw_indirect_count
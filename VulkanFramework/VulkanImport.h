@@ -2,6 +2,30 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+//The vendored headers (1.2.131) predate VK_EXT_extended_dynamic_state. What this tree uses of
+//it, as the registry defines it, so the path builds until the headers are updated. Newer
+//headers define the extension macro and this steps aside.
+#ifndef VK_EXT_extended_dynamic_state
+#define VK_EXT_extended_dynamic_state 1
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_SPEC_VERSION 1
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME "VK_EXT_extended_dynamic_state"
+
+const VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT = static_cast<VkStructureType>(1000267000);
+const VkDynamicState VK_DYNAMIC_STATE_CULL_MODE_EXT = static_cast<VkDynamicState>(1000267000);
+const VkDynamicState VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT = static_cast<VkDynamicState>(1000267002);
+const VkDynamicState VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT = static_cast<VkDynamicState>(1000267006);
+
+typedef struct VkPhysicalDeviceExtendedDynamicStateFeaturesEXT {
+    VkStructureType sType;
+    void* pNext;
+    VkBool32 extendedDynamicState;
+} VkPhysicalDeviceExtendedDynamicStateFeaturesEXT;
+
+typedef void (VKAPI_PTR *PFN_vkCmdSetCullModeEXT)(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode);
+typedef void (VKAPI_PTR *PFN_vkCmdSetPrimitiveTopologyEXT)(VkCommandBuffer commandBuffer, VkPrimitiveTopology primitiveTopology);
+typedef void (VKAPI_PTR *PFN_vkCmdSetDepthTestEnableEXT)(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable);
+#endif //!VK_EXT_extended_dynamic_state
+
 namespace VulkanImport
 {
     VkResult CreateDebugUtilsMessengerEXT(
@@ -14,4 +38,69 @@ namespace VulkanImport
         VkInstance instance, 
         VkDebugUtilsMessengerEXT debugMessenger, 
         const VkAllocationCallbacks* pAllocator);
+
+#ifdef VK_KHR_get_physical_device_properties2
+    //Leaves pFeatures alone if the instance extension isn't enabled
+    void GetPhysicalDeviceFeatures2KHR(
+        VkInstance instance,
+        VkPhysicalDevice physicalDevice,
+        VkPhysicalDeviceFeatures2KHR* pFeatures);
+
+    //Same, for the memory budget query
+    void GetPhysicalDeviceMemoryProperties2KHR(
+        VkInstance instance,
+        VkPhysicalDevice physicalDevice,
+        VkPhysicalDeviceMemoryProperties2KHR* pMemoryProperties);
+#endif //VK_KHR_get_physical_device_properties2
+
+#ifdef VK_EXT_extended_dynamic_state
+    //Looks the command pointers up once, they're called for every draw.
+    //Returns false if the device doesn't expose them.
+    bool LoadExtendedDynamicState(VkDevice device);
+
+    void CmdSetCullModeEXT(
+        VkCommandBuffer commandBuffer,
+        VkCullModeFlags cullMode);
+
+    void CmdSetDepthTestEnableEXT(
+        VkCommandBuffer commandBuffer,
+        VkBool32 depthTestEnable);
+
+    void CmdSetPrimitiveTopologyEXT(
+        VkCommandBuffer commandBuffer,
+        VkPrimitiveTopology primitiveTopology);
+#endif //VK_EXT_extended_dynamic_state
+
+#ifdef VK_KHR_timeline_semaphore
+    //Same as above, returns false if the device doesn't expose them
+    bool LoadTimelineSemaphore(VkDevice device);
+
+    VkResult GetSemaphoreCounterValueKHR(
+        VkDevice device,
+        VkSemaphore semaphore,
+        uint64_t* pValue);
+
+    VkResult WaitSemaphoresKHR(
+        VkDevice device,
+        const VkSemaphoreWaitInfoKHR* pWaitInfo,
+        uint64_t timeout);
+
+    VkResult SignalSemaphoreKHR(
+        VkDevice device,
+        const VkSemaphoreSignalInfoKHR* pSignalInfo);
+#endif //VK_KHR_timeline_semaphore
+
+#ifdef VK_KHR_draw_indirect_count
+    //Same as above, returns false if the device doesn't expose it
+    bool LoadDrawIndirectCount(VkDevice device);
+
+    void CmdDrawIndexedIndirectCountKHR(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer,
+        VkDeviceSize offset,
+        VkBuffer countBuffer,
+        VkDeviceSize countBufferOffset,
+        uint32_t maxDrawCount,
+        uint32_t stride);
+#endif //VK_KHR_draw_indirect_count
 }
@@ -1,9 +1,10 @@
 #include "Game.h"
 
-int main() {
+int main(int argc, char** argv) {
     Game game;
 
     try {
+        game.ParseArguments(argc, argv);
         game.Run();
     }
     catch (const std::exception & e) {
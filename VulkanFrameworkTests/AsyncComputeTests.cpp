@@ -0,0 +1,143 @@
+#include "TestFramework.h"
+
+#include "AsyncCompute.h"
+
+namespace
+{
+    const uint32_t GRAPHICS_FAMILY = 0;
+    const uint32_t COMPUTE_FAMILY = 2;
+
+    //A particle buffer written by a compute job and drawn from by the vertex shader
+    QueueUse MakeComputeWrite(uint32_t family)
+    {
+        QueueUse use;
+        use.m_family = family;
+        use.m_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        use.m_access = VK_ACCESS_SHADER_WRITE_BIT;
+        return use;
+    }
+
+    QueueUse MakeVertexRead(uint32_t family)
+    {
+        QueueUse use;
+        use.m_family = family;
+        use.m_stage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+        use.m_access = VK_ACCESS_SHADER_READ_BIT;
+        return use;
+    }
+}
+
+TEST(AsyncCompute_ExclusiveResourceChangesOwner)
+{
+    QueueOwnershipTransfer transfer = AsyncCompute::PlanTransfer(MakeComputeWrite(COMPUTE_FAMILY), MakeVertexRead(GRAPHICS_FAMILY), VK_SHARING_MODE_EXCLUSIVE);
+
+    CHECK(transfer.m_release);
+    CHECK(transfer.m_acquire);
+
+    VkBufferMemoryBarrier release = transfer.GetBufferRelease(VK_NULL_HANDLE);
+    CHECK_EQUAL(COMPUTE_FAMILY, release.srcQueueFamilyIndex);
+    CHECK_EQUAL(GRAPHICS_FAMILY, release.dstQueueFamilyIndex);
+    CHECK_EQUAL(static_cast<VkAccessFlags>(VK_ACCESS_SHADER_WRITE_BIT), release.srcAccessMask);
+    CHECK_EQUAL(0u, release.dstAccessMask);
+    CHECK_EQUAL(VK_WHOLE_SIZE, release.size);
+
+    //A region changes owner on its own
+    VkBufferMemoryBarrier region = transfer.GetBufferRelease(VK_NULL_HANDLE, 256, 64);
+    CHECK_EQUAL(static_cast<VkDeviceSize>(256), region.offset);
+    CHECK_EQUAL(static_cast<VkDeviceSize>(64), region.size);
+    CHECK_EQUAL(static_cast<VkDeviceSize>(64), transfer.GetBufferAcquire(VK_NULL_HANDLE, 256, 64).size);
+
+    //Same families on both halves, only the access moves to the acquiring side
+    VkBufferMemoryBarrier acquire = transfer.GetBufferAcquire(VK_NULL_HANDLE);
+    CHECK_EQUAL(COMPUTE_FAMILY, acquire.srcQueueFamilyIndex);
+    CHECK_EQUAL(GRAPHICS_FAMILY, acquire.dstQueueFamilyIndex);
+    CHECK_EQUAL(0u, acquire.srcAccessMask);
+    CHECK_EQUAL(static_cast<VkAccessFlags>(VK_ACCESS_SHADER_READ_BIT), acquire.dstAccessMask);
+
+    CHECK_EQUAL(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT), transfer.m_srcStage);
+    CHECK_EQUAL(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT), transfer.m_dstStage);
+}
+
+TEST(AsyncCompute_ConcurrentResourceNeedsNoBarriers)
+{
+    QueueOwnershipTransfer transfer = AsyncCompute::PlanTransfer(MakeComputeWrite(COMPUTE_FAMILY), MakeVertexRead(GRAPHICS_FAMILY), VK_SHARING_MODE_CONCURRENT);
+
+    CHECK(!transfer.m_release);
+    CHECK(!transfer.m_acquire);
+}
+
+TEST(AsyncCompute_SameFamilyNeedsNoBarriers)
+{
+    //No compute-only family, the jobs run on the graphics queue
+    QueueOwnershipTransfer transfer = AsyncCompute::PlanTransfer(MakeComputeWrite(GRAPHICS_FAMILY), MakeVertexRead(GRAPHICS_FAMILY), VK_SHARING_MODE_EXCLUSIVE);
+
+    CHECK(!transfer.m_release);
+    CHECK(!transfer.m_acquire);
+}
+
+TEST(AsyncCompute_ImageTransferCarriesTheLayoutOnBothHalves)
+{
+    QueueUse from = MakeComputeWrite(COMPUTE_FAMILY);
+    from.m_layout = VK_IMAGE_LAYOUT_GENERAL;
+    QueueUse to = MakeVertexRead(GRAPHICS_FAMILY);
+    to.m_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    to.m_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    QueueOwnershipTransfer transfer = AsyncCompute::PlanTransfer(from, to, VK_SHARING_MODE_EXCLUSIVE);
+
+    VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    VkImageMemoryBarrier release = transfer.GetImageRelease(VK_NULL_HANDLE, range);
+    VkImageMemoryBarrier acquire = transfer.GetImageAcquire(VK_NULL_HANDLE, range);
+
+    CHECK(transfer.m_release);
+    CHECK(transfer.m_acquire);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_GENERAL, release.oldLayout);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, release.newLayout);
+    CHECK_EQUAL(release.oldLayout, acquire.oldLayout);
+    CHECK_EQUAL(release.newLayout, acquire.newLayout);
+    CHECK_EQUAL(COMPUTE_FAMILY, acquire.srcQueueFamilyIndex);
+    CHECK_EQUAL(GRAPHICS_FAMILY, acquire.dstQueueFamilyIndex);
+    CHECK_EQUAL(static_cast<VkAccessFlags>(VK_ACCESS_SHADER_READ_BIT), acquire.dstAccessMask);
+    CHECK_EQUAL(1u, acquire.subresourceRange.levelCount);
+}
+
+TEST(AsyncCompute_SharedImageOnlyChangesLayout)
+{
+    QueueUse from = MakeComputeWrite(COMPUTE_FAMILY);
+    from.m_layout = VK_IMAGE_LAYOUT_GENERAL;
+    QueueUse to = MakeVertexRead(GRAPHICS_FAMILY);
+    to.m_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    QueueOwnershipTransfer transfer = AsyncCompute::PlanTransfer(from, to, VK_SHARING_MODE_CONCURRENT);
+
+    CHECK(!transfer.m_release);
+    REQUIRE(transfer.m_acquire);
+
+    VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    VkImageMemoryBarrier acquire = transfer.GetImageAcquire(VK_NULL_HANDLE, range);
+    CHECK_EQUAL(VK_QUEUE_FAMILY_IGNORED, acquire.srcQueueFamilyIndex);
+    CHECK_EQUAL(VK_QUEUE_FAMILY_IGNORED, acquire.dstQueueFamilyIndex);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_GENERAL, acquire.oldLayout);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, acquire.newLayout);
+}
+
+TEST(AsyncCompute_GraphicsToComputeIsTheMirror)
+{
+    //Depth written by graphics, read by a compute job (light binning) the next frame
+    QueueUse from;
+    from.m_family = GRAPHICS_FAMILY;
+    from.m_stage = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    from.m_access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    from.m_layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    QueueUse to = MakeComputeWrite(COMPUTE_FAMILY);
+    to.m_access = VK_ACCESS_SHADER_READ_BIT;
+    to.m_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    QueueOwnershipTransfer transfer = AsyncCompute::PlanTransfer(from, to, VK_SHARING_MODE_EXCLUSIVE);
+
+    CHECK(transfer.m_release);
+    CHECK_EQUAL(GRAPHICS_FAMILY, transfer.m_srcFamily);
+    CHECK_EQUAL(COMPUTE_FAMILY, transfer.m_dstFamily);
+    CHECK_EQUAL(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT), transfer.m_srcStage);
+    CHECK_EQUAL(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT), transfer.m_dstStage);
+}
@@ -0,0 +1,78 @@
+#include "TestFramework.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Camera.h"
+
+namespace
+{
+    const float WIDTH = 1280.0f;
+    const float HEIGHT = 720.0f;
+
+    //Through the projection and a full framebuffer viewport, y down like Vulkan's
+    glm::vec3 ToFramebuffer(const glm::mat4& viewProjection, const glm::vec3& position)
+    {
+        glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3((ndc.x + 1.0f) * 0.5f * WIDTH, (ndc.y + 1.0f) * 0.5f * HEIGHT, ndc.z);
+    }
+
+    //The rasterizer's signed area, positive is front facing with VK_FRONT_FACE_COUNTER_CLOCKWISE
+    float GetSignedArea(const glm::mat4& viewProjection, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        glm::vec3 points[3] = { ToFramebuffer(viewProjection, a), ToFramebuffer(viewProjection, b), ToFramebuffer(viewProjection, c) };
+
+        float area = 0.0f;
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec3& p = points[i];
+            const glm::vec3& q = points[(i + 1) % 3];
+            area += p.x * q.y - q.x * p.y;
+        }
+
+        return -0.5f * area;
+    }
+
+    //Counter-clockwise seen from +z
+    const glm::vec3 TRIANGLE[3] = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+}
+
+TEST(Camera_CounterClockwiseFacesTheCamera)
+{
+    Camera camera;
+    camera.SetPerspective(glm::radians(60.0f), WIDTH / HEIGHT, 0.1f, 100.0f);
+    camera.LookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f));
+
+    glm::mat4 viewProjection = camera.GetViewProjection();
+    CHECK(GetSignedArea(viewProjection, TRIANGLE[0], TRIANGLE[1], TRIANGLE[2]) > 0.0f);
+    CHECK(GetSignedArea(viewProjection, TRIANGLE[0], TRIANGLE[2], TRIANGLE[1]) < 0.0f);
+
+    //Up in the world is up on screen, the projection's Y flip puts it at the top of the framebuffer
+    CHECK(ToFramebuffer(viewProjection, TRIANGLE[2]).y < ToFramebuffer(viewProjection, TRIANGLE[0]).y);
+    CHECK(ToFramebuffer(viewProjection, TRIANGLE[1]).x > ToFramebuffer(viewProjection, TRIANGLE[0]).x);
+}
+
+TEST(Camera_BackSideIsBackFacing)
+{
+    Camera camera;
+    camera.SetPerspective(glm::radians(60.0f), WIDTH / HEIGHT, 0.1f, 100.0f);
+    camera.LookAt(glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(0.0f));
+
+    CHECK(GetSignedArea(camera.GetViewProjection(), TRIANGLE[0], TRIANGLE[1], TRIANGLE[2]) < 0.0f);
+}
+
+TEST(Camera_InfinitePerspectiveKeepsWinding)
+{
+    glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 3.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 finite = Camera::MakeReverseZPerspective(glm::radians(60.0f), WIDTH / HEIGHT, 0.1f, 100.0f) * view;
+    glm::mat4 infinite = Camera::MakeReverseZInfinitePerspective(glm::radians(60.0f), WIDTH / HEIGHT, 0.1f) * view;
+
+    CHECK(GetSignedArea(finite, TRIANGLE[0], TRIANGLE[1], TRIANGLE[2]) > 0.0f);
+    CHECK(GetSignedArea(infinite, TRIANGLE[0], TRIANGLE[1], TRIANGLE[2]) > 0.0f);
+
+    //Reversed-Z, nearer is deeper
+    glm::vec3 nearPoint = ToFramebuffer(infinite, glm::vec3(0.0f));
+    glm::vec3 farPoint = ToFramebuffer(infinite, glm::vec3(-20.0f, -30.0f, -50.0f));
+    CHECK(nearPoint.z > farPoint.z);
+    CHECK(farPoint.z > 0.0f && nearPoint.z < 1.0f);
+}
@@ -0,0 +1,184 @@
+#include "TestFramework.h"
+
+#include <sstream>
+
+#include "DeviceSelector.h"
+
+namespace
+{
+    const VkDeviceSize MIB = 1024 * 1024;
+
+    DeviceCandidate MakeCandidate(const char* name, VkPhysicalDeviceType type, VkDeviceSize deviceLocalMiB)
+    {
+        DeviceCandidate candidate;
+        candidate.m_name = name;
+        candidate.m_type = type;
+        candidate.m_deviceLocalBytes = deviceLocalMiB * MIB;
+        return candidate;
+    }
+
+    //A laptop: an integrated GPU listed first, then the discrete one
+    std::vector<DeviceCandidate> MakeLaptop()
+    {
+        std::vector<DeviceCandidate> candidates;
+        candidates.push_back(MakeCandidate("Intel UHD Graphics 630", VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 256));
+        candidates.push_back(MakeCandidate("NVIDIA GeForce RTX 2060", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 6144));
+        candidates.push_back(MakeCandidate("llvmpipe (LLVM 10.0.0, 256 bits)", VK_PHYSICAL_DEVICE_TYPE_CPU, 0));
+        return candidates;
+    }
+}
+
+TEST(DeviceSelector_NoDevicesChoosesNothing)
+{
+    DeviceSelection selection = DeviceSelector::Select({}, DeviceRequirements(), "");
+
+    CHECK_EQUAL(-1, selection.m_chosen);
+    CHECK(selection.m_scores.empty());
+}
+
+TEST(DeviceSelector_DiscreteBeatsIntegratedWithEverything)
+{
+    std::vector<DeviceCandidate> candidates = MakeLaptop();
+    DeviceCandidate& integrated = candidates[0];
+    integrated.m_deviceLocalBytes = 64 * 1024 * MIB;
+    integrated.m_timelineSemaphore = true;
+    integrated.m_descriptorIndexing = true;
+    integrated.m_drawIndirectCount = true;
+    integrated.m_asyncComputeQueue = true;
+    integrated.m_transferQueue = true;
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), "");
+
+    REQUIRE(selection.m_scores.size() == candidates.size());
+    CHECK_EQUAL(1, selection.m_chosen);
+    CHECK(!selection.m_overridden);
+    CHECK(selection.m_scores[1].m_score > selection.m_scores[0].m_score);
+    CHECK(selection.m_scores[0].m_score > selection.m_scores[2].m_score);
+}
+
+TEST(DeviceSelector_FeaturesAndQueuesBreakTies)
+{
+    std::vector<DeviceCandidate> candidates;
+    candidates.push_back(MakeCandidate("GPU A", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8192));
+    candidates.push_back(MakeCandidate("GPU B", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8192));
+    candidates[1].m_asyncComputeQueue = true;
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), "");
+    CHECK_EQUAL(1, selection.m_chosen);
+    CHECK(selection.m_scores[1].m_reason.find("async compute") != std::string::npos);
+
+    //A feature is worth more than a queue
+    candidates[0].m_timelineSemaphore = true;
+    selection = DeviceSelector::Select(candidates, DeviceRequirements(), "");
+    CHECK_EQUAL(0, selection.m_chosen);
+}
+
+TEST(DeviceSelector_EqualScoresKeepTheDriverOrder)
+{
+    std::vector<DeviceCandidate> candidates;
+    candidates.push_back(MakeCandidate("GPU A", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4096));
+    candidates.push_back(MakeCandidate("GPU B", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4096));
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), "");
+
+    CHECK_EQUAL(0, selection.m_chosen);
+    CHECK_EQUAL(selection.m_scores[0].m_score, selection.m_scores[1].m_score);
+}
+
+TEST(DeviceSelector_VramIsCappedBelowTheDeviceType)
+{
+    std::vector<DeviceCandidate> candidates;
+    candidates.push_back(MakeCandidate("Huge integrated", VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 1024 * 1024));
+    candidates.push_back(MakeCandidate("Small discrete", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 1));
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), "");
+
+    CHECK_EQUAL(1, selection.m_chosen);
+}
+
+TEST(DeviceSelector_MissingRequirementsReject)
+{
+    std::vector<DeviceCandidate> candidates = MakeLaptop();
+    candidates[0].m_timelineSemaphore = true;
+    candidates[0].m_drawIndirectCount = true;
+    candidates[1].m_timelineSemaphore = true;
+    candidates[2].m_unsupportedReason = "no swapchain";
+
+    DeviceRequirements requirements;
+    requirements.m_timelineSemaphore = true;
+    requirements.m_drawIndirectCount = true;
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, requirements, "");
+
+    CHECK_EQUAL(0, selection.m_chosen);
+    CHECK(!selection.m_scores[0].m_rejected);
+    CHECK(selection.m_scores[1].m_rejected);
+    CHECK_EQUAL(std::string("no draw indirect count"), selection.m_scores[1].m_reason);
+    CHECK(selection.m_scores[2].m_rejected);
+    CHECK_EQUAL(std::string("no swapchain"), selection.m_scores[2].m_reason);
+
+    //Nothing left once the last one goes too
+    requirements.m_descriptorIndexing = true;
+    selection = DeviceSelector::Select(candidates, requirements, "");
+    CHECK_EQUAL(-1, selection.m_chosen);
+    CHECK_EQUAL(std::string("no descriptor indexing"), selection.m_scores[0].m_reason);
+}
+
+TEST(DeviceSelector_OverrideByIndex)
+{
+    std::vector<DeviceCandidate> candidates = MakeLaptop();
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), "2");
+
+    CHECK_EQUAL(2, selection.m_chosen);
+    CHECK(selection.m_overridden);
+    CHECK(selection.m_overrideWarning.empty());
+}
+
+TEST(DeviceSelector_OverrideByNameIgnoresCase)
+{
+    std::vector<DeviceCandidate> candidates = MakeLaptop();
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), "intel");
+
+    CHECK_EQUAL(0, selection.m_chosen);
+    CHECK(selection.m_overridden);
+}
+
+TEST(DeviceSelector_UnusableOverrideFallsBackToTheScore)
+{
+    std::vector<DeviceCandidate> candidates = MakeLaptop();
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), "7");
+    CHECK_EQUAL(1, selection.m_chosen);
+    CHECK(!selection.m_overridden);
+    CHECK(selection.m_overrideWarning.find("no device matches") != std::string::npos);
+
+    selection = DeviceSelector::Select(candidates, DeviceRequirements(), "Radeon");
+    CHECK_EQUAL(1, selection.m_chosen);
+    CHECK(!selection.m_overrideWarning.empty());
+
+    //A rejected device can't be forced
+    candidates[0].m_unsupportedReason = "no graphics queue";
+    selection = DeviceSelector::Select(candidates, DeviceRequirements(), "Intel");
+    CHECK_EQUAL(1, selection.m_chosen);
+    CHECK(!selection.m_overridden);
+    CHECK(selection.m_overrideWarning.find("rejected") != std::string::npos);
+}
+
+TEST(DeviceSelector_PrintSelectionNamesEveryDevice)
+{
+    std::vector<DeviceCandidate> candidates = MakeLaptop();
+    candidates[2].m_unsupportedReason = "no swapchain";
+
+    DeviceSelection selection = DeviceSelector::Select(candidates, DeviceRequirements(), "nonexistent");
+    std::ostringstream out;
+    DeviceSelector::PrintSelection(out, candidates, selection);
+    std::string text = out.str();
+
+    CHECK(text.find("device override ignored") != std::string::npos);
+    CHECK(text.find("device 0 passed over: Intel") != std::string::npos);
+    CHECK(text.find("device 1 chosen: NVIDIA") != std::string::npos);
+    CHECK(text.find("device 2 rejected: llvmpipe") != std::string::npos);
+    CHECK(text.find("(no swapchain)") != std::string::npos);
+}
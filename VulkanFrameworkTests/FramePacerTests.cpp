@@ -0,0 +1,187 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "FramePacer.h"
+
+namespace
+{
+    const uint64_t MS = 1000000;
+    //FramePacer.cpp's MAX_HOLD
+    const uint64_t MAX_HOLD = 50 * MS;
+    //Default margin
+    const uint64_t MARGIN = 1 * MS;
+
+    //A main loop against a made up clock, GPU and display. The GPU runs frames back to back
+    //in submit order, the display shows one finished frame per vblank. The loop blocks like
+    //the real one: a frame slot frees up once the frame two back is done (and presented).
+    class Simulation
+    {
+    public:
+        Simulation(uint64_t cpuTime, uint64_t gpuTime, uint64_t refresh, bool pacing)
+            : m_cpuTime(cpuTime), m_gpuTime(gpuTime), m_refresh(refresh)
+        {
+            m_pacer.SetClock([this]() { return m_now; }, [this](uint64_t nanoseconds) { m_now += nanoseconds; });
+            m_pacer.SetGpuProgress([this]() { return CountUpTo(m_done); });
+            if (m_refresh != 0)
+            {
+                m_pacer.SetRefreshLimited(true);
+                m_pacer.SetPresentProgress([this]() { return CountUpTo(m_presented); });
+            }
+            m_pacer.SetEnabled(pacing);
+        }
+
+        void RunFrame()
+        {
+            uint64_t frame = m_pacer.BeginFrame();
+            m_starts.push_back(m_now);
+            m_pacer.MarkInputSampled();
+
+            if (m_done.size() >= 2)
+            {
+                uint64_t free = m_done[m_done.size() - 2];
+                if (m_refresh != 0)
+                {
+                    free = std::max(free, m_presented[m_presented.size() - 2]);
+                }
+                m_pacer.MarkWaitBegin();
+                m_now = std::max(m_now, free);
+                m_pacer.MarkWaitEnd();
+            }
+
+            m_now += m_cpuTime;
+
+            uint64_t gpuStart = m_done.empty() ? m_now : std::max(m_now, m_done.back());
+            m_done.push_back(gpuStart + m_gpuTime);
+            if (m_refresh != 0)
+            {
+                //First vblank after it's done that no earlier frame took
+                uint64_t vblank = (m_done.back() + m_refresh - 1) / m_refresh * m_refresh;
+                if (!m_presented.empty() && vblank <= m_presented.back())
+                {
+                    vblank = m_presented.back() + m_refresh;
+                }
+                m_presented.push_back(vblank);
+            }
+
+            m_pacer.MarkSubmitted(frame);
+        }
+
+        void Run(uint32_t frames)
+        {
+            for (uint32_t i = 0; i < frames; i++)
+            {
+                RunFrame();
+            }
+        }
+
+        FramePacer m_pacer;
+        uint64_t m_now = 1000 * MS;
+        std::vector<uint64_t> m_starts;
+        //Per frame, frame n at n - 1
+        std::vector<uint64_t> m_done;
+        std::vector<uint64_t> m_presented;
+
+    private:
+        //Times are increasing, so the count is also the last frame at or before now
+        uint64_t CountUpTo(const std::vector<uint64_t>& times) const
+        {
+            return static_cast<uint64_t>(std::upper_bound(times.begin(), times.end(), m_now) - times.begin());
+        }
+
+        uint64_t m_cpuTime;
+        uint64_t m_gpuTime;
+        uint64_t m_refresh;
+    };
+}
+
+TEST(FramePacer_NoHistoryStartsNow)
+{
+    Simulation simulation(2 * MS, 10 * MS, 0, true);
+
+    CHECK_EQUAL(simulation.m_now, simulation.m_pacer.PredictStart(simulation.m_now));
+
+    //The first frame has nothing to wait for
+    uint64_t before = simulation.m_now;
+    simulation.RunFrame();
+    CHECK_EQUAL(before, simulation.m_starts[0]);
+}
+
+TEST(FramePacer_GpuBoundStartsAsTheGpuFreesUp)
+{
+    Simulation paced(2 * MS, 10 * MS, 0, true);
+    Simulation unpaced(2 * MS, 10 * MS, 0, false);
+    paced.Run(60);
+    unpaced.Run(60);
+
+    CHECK_NEAR(2.0, paced.m_pacer.GetCpuTimeMs(), 0.01);
+    CHECK_NEAR(10.0, paced.m_pacer.GetGpuTimeMs(), 1.0);
+    CHECK(!paced.m_pacer.HasPresentTiming());
+
+    //Submitted right before the GPU gets to it: starts one CPU time plus margin ahead of the
+    //end of the frame in flight, which only polling late moves
+    uint64_t predicted = paced.m_pacer.PredictStart(paced.m_now);
+    uint64_t gpuFree = paced.m_done.back();
+    CHECK(predicted <= gpuFree - 2 * MS - MARGIN + 1 * MS);
+    CHECK(predicted + 2 * MS >= gpuFree - 2 * MS - MARGIN);
+
+    //No throughput lost, the GPU still never idles for long
+    uint64_t pacedSpan = paced.m_done.back() - paced.m_done[9];
+    uint64_t unpacedSpan = unpaced.m_done.back() - unpaced.m_done[9];
+    CHECK(pacedSpan <= unpacedSpan + unpacedSpan / 20);
+
+    //A frame waits on its own GPU time and little else, unpaced it also sits behind the one before
+    CHECK(paced.m_pacer.GetLatencyMs() < 10.0 + 2.0 + 3.0);
+    CHECK(unpaced.m_pacer.GetLatencyMs() > 10.0 + 10.0);
+    CHECK(paced.m_pacer.GetSleepMs() > 0.0);
+    CHECK_EQUAL(0.0, unpaced.m_pacer.GetSleepMs());
+}
+
+TEST(FramePacer_RefreshLimitedFinishesRightBeforeVblank)
+{
+    const uint64_t refresh = 16 * MS;
+    Simulation paced(2 * MS, 3 * MS, refresh, true);
+    Simulation unpaced(2 * MS, 3 * MS, refresh, false);
+    paced.Run(120);
+    unpaced.Run(120);
+
+    CHECK(paced.m_pacer.HasPresentTiming());
+    CHECK_NEAR(16.0, paced.m_pacer.GetRefreshIntervalMs(), 1.0);
+
+    //Every vblank still gets a frame
+    for (size_t i = 20; i < paced.m_presented.size(); i++)
+    {
+        CHECK_EQUAL(refresh, paced.m_presented[i] - paced.m_presented[i - 1]);
+    }
+
+    //Starts as late as the next vblank allows, not as soon as the GPU is free
+    uint64_t predicted = paced.m_pacer.PredictStart(paced.m_now);
+    uint64_t nextVblank = paced.m_presented.back() + refresh;
+    CHECK(predicted + 2 * MS + 3 * MS + MARGIN <= nextVblank + 1 * MS);
+    CHECK(predicted + 2 * MS + 3 * MS + MARGIN + 3 * MS >= nextVblank);
+
+    //Input to scanout is about one frame's work, unpaced the frames queue up behind vblank
+    CHECK(paced.m_pacer.GetLatencyMs() < 2.0 + 3.0 + 1.0 + 2.0);
+    CHECK(unpaced.m_pacer.GetLatencyMs() > 16.0);
+}
+
+TEST(FramePacer_HoldIsCapped)
+{
+    //A GPU far slower than the CPU, the prediction asks for a long wait
+    Simulation simulation(1 * MS, 200 * MS, 0, true);
+    simulation.Run(4);
+
+    uint64_t before = simulation.m_now;
+    CHECK(simulation.m_pacer.PredictStart(before) > before + MAX_HOLD);
+
+    simulation.RunFrame();
+    CHECK_EQUAL(before + MAX_HOLD, simulation.m_starts.back());
+
+    //Disabled it never holds at all
+    simulation.m_pacer.SetEnabled(false);
+    before = simulation.m_now;
+    CHECK(simulation.m_pacer.PredictStart(before) > before);
+    simulation.RunFrame();
+    CHECK_EQUAL(before, simulation.m_starts.back());
+}
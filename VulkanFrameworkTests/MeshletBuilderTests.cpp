@@ -0,0 +1,222 @@
+#include "TestFramework.h"
+
+#include <set>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "MeshletBuilder.h"
+
+namespace
+{
+    //size x size quads in the z = 0 plane, wound to face +z
+    void BuildGrid(uint32_t size, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+    {
+        for (uint32_t y = 0; y <= size; y++)
+        {
+            for (uint32_t x = 0; x <= size; x++)
+            {
+                positions.push_back(glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f));
+            }
+        }
+
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                uint32_t a = y * (size + 1) + x;
+                uint32_t b = a + 1;
+                uint32_t c = a + size + 1;
+                uint32_t d = c + 1;
+                indices.insert(indices.end(), { a, b, c, b, d, c });
+            }
+        }
+    }
+
+    MeshletData BuildGridMeshlets(uint32_t size, uint32_t maxVertices, uint32_t maxTriangles, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+    {
+        BuildGrid(size, positions, indices);
+        return BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size(), maxVertices, maxTriangles);
+    }
+
+    //No planes, only the cone test
+    MeshletFrustum GetOpenFrustum()
+    {
+        MeshletFrustum frustum;
+        for (glm::vec4& plane : frustum.m_planes)
+        {
+            plane = glm::vec4(0.0f);
+        }
+
+        return frustum;
+    }
+
+    void CheckLimits(const MeshletData& data, uint32_t maxVertices, uint32_t maxTriangles, size_t triangleCount)
+    {
+        REQUIRE(data.m_bounds.size() == data.m_meshlets.size());
+
+        size_t triangles = 0;
+        size_t vertices = 0;
+        for (const Meshlet& meshlet : data.m_meshlets)
+        {
+            CHECK(meshlet.m_vertexCount > 0 && meshlet.m_vertexCount <= maxVertices);
+            CHECK(meshlet.m_triangleCount > 0 && meshlet.m_triangleCount <= maxTriangles);
+
+            //Back to back, in order
+            CHECK_EQUAL(vertices, static_cast<size_t>(meshlet.m_vertexOffset));
+            CHECK_EQUAL(triangles, static_cast<size_t>(meshlet.m_triangleOffset));
+            vertices += meshlet.m_vertexCount;
+            triangles += meshlet.m_triangleCount;
+
+            //Every local index in range, every local vertex used once
+            std::set<uint32_t> meshVertices(data.m_vertices.begin() + meshlet.m_vertexOffset, data.m_vertices.begin() + meshlet.m_vertexOffset + meshlet.m_vertexCount);
+            CHECK_EQUAL(static_cast<size_t>(meshlet.m_vertexCount), meshVertices.size());
+            for (uint32_t i = 0; i < meshlet.m_triangleCount * 3; i++)
+            {
+                CHECK(data.m_triangles[(static_cast<size_t>(meshlet.m_triangleOffset)) * 3 + i] < meshlet.m_vertexCount);
+            }
+        }
+
+        CHECK_EQUAL(triangleCount, triangles);
+        CHECK_EQUAL(data.m_vertices.size(), vertices);
+        CHECK_EQUAL(triangleCount * 3, data.m_triangles.size());
+    }
+}
+
+TEST(MeshletBuilder_DefaultLimitsHold)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    MeshletData data = BuildGridMeshlets(40, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, positions, indices);
+
+    CHECK(data.m_meshlets.size() > 1);
+    CheckLimits(data, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, indices.size() / 3);
+}
+
+TEST(MeshletBuilder_CustomLimitsHold)
+{
+    //Vertex bound on one side, triangle bound on the other
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    MeshletData vertexBound = BuildGridMeshlets(16, 10, 124, positions, indices);
+    CheckLimits(vertexBound, 10, 124, indices.size() / 3);
+
+    positions.clear();
+    indices.clear();
+    MeshletData triangleBound = BuildGridMeshlets(16, 256, 7, positions, indices);
+    CheckLimits(triangleBound, 256, 7, indices.size() / 3);
+    CHECK_EQUAL((indices.size() / 3 + 6) / 7, triangleBound.m_meshlets.size());
+}
+
+TEST(MeshletBuilder_RejectsBadInput)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    BuildGrid(2, positions, indices);
+
+    CHECK_THROWS(BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size(), 2, 124));
+    CHECK_THROWS(BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size(), 257, 124));
+    CHECK_THROWS(BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size() - 1));
+
+    indices[4] = static_cast<uint32_t>(positions.size());
+    CHECK_THROWS(BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size()));
+}
+
+TEST(MeshletBuilder_IndexBufferRoundTrips)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    MeshletData data = BuildGridMeshlets(33, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, positions, indices);
+    CHECK(data.BuildIndexBuffer() == indices);
+
+    //Small limits split the grid at many more places
+    positions.clear();
+    indices.clear();
+    MeshletData small = BuildGridMeshlets(33, 5, 3, positions, indices);
+    CHECK(small.BuildIndexBuffer() == indices);
+}
+
+TEST(MeshletBuilder_BoundsContainVertices)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    MeshletData data = BuildGridMeshlets(24, 32, 40, positions, indices);
+
+    for (size_t i = 0; i < data.m_meshlets.size(); i++)
+    {
+        const Meshlet& meshlet = data.m_meshlets[i];
+        const MeshletBounds& bounds = data.m_bounds[i];
+        for (uint32_t v = 0; v < meshlet.m_vertexCount; v++)
+        {
+            const glm::vec3& position = positions[data.m_vertices[meshlet.m_vertexOffset + v]];
+            CHECK(glm::length(position - bounds.m_center) <= bounds.m_radius + 1e-4f);
+        }
+    }
+}
+
+TEST(MeshletBuilder_FlatMeshletConeFacesNormal)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    MeshletData data = BuildGridMeshlets(8, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, positions, indices);
+
+    //Every triangle faces +z, so the cone is as narrow as it gets
+    for (const MeshletBounds& bounds : data.m_bounds)
+    {
+        CHECK_NEAR(0.0f, bounds.m_coneAxis.x, 1e-5f);
+        CHECK_NEAR(0.0f, bounds.m_coneAxis.y, 1e-5f);
+        CHECK_NEAR(1.0f, bounds.m_coneAxis.z, 1e-5f);
+        CHECK_NEAR(0.0f, bounds.m_coneCutoff, 1e-3f);
+    }
+
+    //Seen from the front it's drawn, from behind it isn't
+    const MeshletBounds& bounds = data.m_bounds[0];
+    MeshletFrustum frustum = GetOpenFrustum();
+    CHECK(IsMeshletVisible(bounds, frustum, bounds.m_center + glm::vec3(0.0f, 0.0f, 10.0f)));
+    CHECK(!IsMeshletVisible(bounds, frustum, bounds.m_center - glm::vec3(0.0f, 0.0f, 100.0f)));
+}
+
+TEST(MeshletBuilder_FoldedMeshletNeverBackfaceCulled)
+{
+    //Two triangles facing opposite ways, some triangle faces every position
+    std::vector<glm::vec3> positions = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+    std::vector<uint32_t> indices = { 0, 1, 2, 0, 2, 1 };
+    MeshletData data = BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size());
+    REQUIRE(data.m_bounds.size() == 1);
+
+    CHECK_EQUAL(1.0f, data.m_bounds[0].m_coneCutoff);
+    MeshletFrustum frustum = GetOpenFrustum();
+    CHECK(IsMeshletVisible(data.m_bounds[0], frustum, glm::vec3(0.0f, 0.0f, 10.0f)));
+    CHECK(IsMeshletVisible(data.m_bounds[0], frustum, glm::vec3(0.0f, 0.0f, -10.0f)));
+}
+
+TEST(MeshletBuilder_FrustumCullsOutsideSpheres)
+{
+    //Looking down -z from the origin, reversed-Z like Camera
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, 100.0f, 0.1f);
+    MeshletFrustum frustum = ExtractFrustum(projection * view);
+
+    for (const glm::vec4& plane : frustum.m_planes)
+    {
+        CHECK_NEAR(1.0f, glm::length(glm::vec3(plane)), 1e-4f);
+    }
+
+    //Wide cone, only the planes decide
+    MeshletBounds bounds;
+    bounds.m_radius = 1.0f;
+    bounds.m_coneCutoff = 1.0f;
+
+    bounds.m_center = glm::vec3(0.0f, 0.0f, -10.0f);
+    CHECK(IsMeshletVisible(bounds, frustum, glm::vec3(0.0f)));
+    //Behind the camera
+    bounds.m_center = glm::vec3(0.0f, 0.0f, 10.0f);
+    CHECK(!IsMeshletVisible(bounds, frustum, glm::vec3(0.0f)));
+    //Past the far plane
+    bounds.m_center = glm::vec3(0.0f, 0.0f, -200.0f);
+    CHECK(!IsMeshletVisible(bounds, frustum, glm::vec3(0.0f)));
+    //Off to the side, and overlapping the side plane
+    bounds.m_center = glm::vec3(30.0f, 0.0f, -10.0f);
+    CHECK(!IsMeshletVisible(bounds, frustum, glm::vec3(0.0f)));
+    bounds.m_center = glm::vec3(10.5f, 0.0f, -10.0f);
+    CHECK(IsMeshletVisible(bounds, frustum, glm::vec3(0.0f)));
+}
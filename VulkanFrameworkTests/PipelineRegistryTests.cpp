@@ -0,0 +1,120 @@
+#include "TestFramework.h"
+
+#include "PipelineRegistry.h"
+
+namespace
+{
+    //Hands out made up handles and remembers the keys it was asked to build
+    struct FakeCreate
+    {
+        VkPipeline operator()(const PipelineKey& key)
+        {
+            m_keys.push_back(key);
+            return reinterpret_cast<VkPipeline>(static_cast<uintptr_t>(m_keys.size()));
+        }
+
+        std::vector<PipelineKey> m_keys;
+    };
+
+    //Keys that only differ in what extended dynamic state can set
+    std::vector<PipelineKey> GetDynamicVariants()
+    {
+        std::vector<PipelineKey> keys;
+        for (VkCullModeFlags cullMode : { VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_NONE })
+        {
+            for (bool depthTest : { true, false })
+            {
+                for (VkPrimitiveTopology topology : { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP })
+                {
+                    PipelineKey key;
+                    key.m_cullMode = cullMode;
+                    key.m_depthTest = depthTest;
+                    key.m_topology = topology;
+                    keys.push_back(key);
+                }
+            }
+        }
+
+        return keys;
+    }
+}
+
+TEST(PipelineRegistry_WithoutDynamicStateEveryVariantIsAPipeline)
+{
+    PipelineRegistry registry;
+    FakeCreate create;
+    auto func = [&create](const PipelineKey& key) { return create(key); };
+
+    std::vector<PipelineKey> keys = GetDynamicVariants();
+    for (const PipelineKey& key : keys)
+    {
+        registry.GetOrCreate(key, func);
+    }
+
+    CHECK_EQUAL(keys.size(), registry.GetPipelineCount());
+    //Built with the state as asked for
+    REQUIRE(create.m_keys.size() == keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        CHECK(create.m_keys[i] == keys[i]);
+    }
+}
+
+TEST(PipelineRegistry_DynamicStateCollapsesKeys)
+{
+    PipelineRegistry registry;
+    registry.SetExtendedDynamicState(true);
+    FakeCreate create;
+    auto func = [&create](const PipelineKey& key) { return create(key); };
+
+    VkPipeline first = VK_NULL_HANDLE;
+    for (const PipelineKey& key : GetDynamicVariants())
+    {
+        VkPipeline pipeline = registry.GetOrCreate(key, func);
+        first = first == VK_NULL_HANDLE ? pipeline : first;
+        CHECK(pipeline == first);
+        CHECK(registry.Find(key) == first);
+    }
+
+    CHECK_EQUAL(static_cast<size_t>(1), registry.GetPipelineCount());
+    REQUIRE(create.m_keys.size() == 1);
+    //What it was built with doesn't matter, the draw sets it, but it has to be a triangle pipeline
+    CHECK_EQUAL(static_cast<uint32_t>(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST), static_cast<uint32_t>(create.m_keys[0].m_topology));
+}
+
+TEST(PipelineRegistry_DynamicStateKeepsBakedState)
+{
+    PipelineRegistry registry;
+    registry.SetExtendedDynamicState(true);
+    FakeCreate create;
+    auto func = [&create](const PipelineKey& key) { return create(key); };
+
+    PipelineKey triangles;
+    registry.GetOrCreate(triangles, func);
+
+    //Topology can only change within its class
+    PipelineKey lines;
+    lines.m_topology = VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+    registry.GetOrCreate(lines, func);
+    PipelineKey points;
+    points.m_topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+    registry.GetOrCreate(points, func);
+    CHECK_EQUAL(static_cast<size_t>(3), registry.GetPipelineCount());
+
+    //Pass, permutation and vertex source are still baked in
+    PipelineKey prePass;
+    prePass.m_pass = PipelinePass::DepthPrePass;
+    registry.GetOrCreate(prePass, func);
+    PipelineKey lambert;
+    lambert.m_permutation.m_lightingModel = LightingModel::Lambert;
+    registry.GetOrCreate(lambert, func);
+    PipelineKey meshlets;
+    meshlets.m_meshlets = true;
+    registry.GetOrCreate(meshlets, func);
+    CHECK_EQUAL(static_cast<size_t>(6), registry.GetPipelineCount());
+
+    CHECK(registry.Find(PipelineKey()) == registry.GetOrCreate(triangles, func));
+    PipelineKey unbuilt;
+    unbuilt.m_pass = PipelinePass::ForwardDepthEqual;
+    CHECK(registry.Find(unbuilt) == VK_NULL_HANDLE);
+}
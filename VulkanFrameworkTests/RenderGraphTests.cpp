@@ -0,0 +1,335 @@
+#include "TestFramework.h"
+
+#include <stdexcept>
+
+#include "RenderGraph.h"
+
+namespace
+{
+    RenderResourceDesc MakeColorDesc(const char* name)
+    {
+        RenderResourceDesc desc;
+        desc.m_name = name;
+        desc.m_format = VK_FORMAT_B8G8R8A8_UNORM;
+        desc.m_extent = { 64, 64 };
+        return desc;
+    }
+
+    RenderResourceDesc MakeDepthDesc(const char* name)
+    {
+        RenderResourceDesc desc;
+        desc.m_name = name;
+        desc.m_format = VK_FORMAT_D32_SFLOAT;
+        desc.m_extent = { 64, 64 };
+        desc.m_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        return desc;
+    }
+
+    //The swapchain image the way the backend imports it
+    RenderResourceHandle ImportBackbuffer(RenderGraph& graph)
+    {
+        RenderResourceDesc desc = MakeColorDesc("Backbuffer");
+        desc.m_initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        desc.m_initialStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        desc.m_finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        return graph.Import(desc);
+    }
+
+    const RenderGraphBarrier* FindBarrier(const std::vector<RenderGraphBarrier>& barriers, RenderResourceHandle resource)
+    {
+        for (const auto& barrier : barriers)
+        {
+            if (barrier.m_resource == resource)
+            {
+                return &barrier;
+            }
+        }
+
+        return nullptr;
+    }
+
+    //Barriers of the compiled pass that runs the declared pass
+    const std::vector<RenderGraphBarrier>& GetPassBarriers(const RenderGraph& graph, uint32_t pass)
+    {
+        for (const auto& compiledPass : graph.GetCompiled().m_passes)
+        {
+            if (compiledPass.m_passIndex == pass)
+            {
+                return compiledPass.m_barriers;
+            }
+        }
+
+        throw std::runtime_error("pass didn't survive compiling");
+    }
+}
+
+TEST(RenderGraph_ImportedImageIsTransitionedAndLeftForPresent)
+{
+    RenderGraph graph;
+    RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+    uint32_t forward = graph.AddPass("Forward", nullptr);
+    graph.Write(forward, backbuffer, RenderResourceUsage::ColorAttachment);
+    graph.MarkOutput(backbuffer);
+
+    REQUIRE(graph.Compile());
+
+    const RenderGraphBarrier* first = FindBarrier(GetPassBarriers(graph, forward), backbuffer);
+    REQUIRE(first != nullptr);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_UNDEFINED, first->m_oldLayout);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, first->m_newLayout);
+    //Waits for the acquire semaphore's stage, nothing to make available
+    CHECK_EQUAL(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT), first->m_srcStage);
+    CHECK_EQUAL(0u, first->m_srcAccess);
+    CHECK((first->m_dstAccess & VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) != 0);
+
+    const auto& finalBarriers = graph.GetCompiled().m_finalBarriers;
+    REQUIRE(finalBarriers.size() == 1);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, finalBarriers[0].m_oldLayout);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, finalBarriers[0].m_newLayout);
+    CHECK_EQUAL(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT), finalBarriers[0].m_srcStage);
+    CHECK_EQUAL(static_cast<VkAccessFlags>(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT), finalBarriers[0].m_srcAccess);
+}
+
+TEST(RenderGraph_ReadAfterWriteMakesTheWriteVisible)
+{
+    RenderGraph graph;
+    RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+    RenderResourceHandle shadow = graph.CreateTransient(MakeDepthDesc("Shadow"));
+
+    uint32_t shadowPass = graph.AddPass("Shadow", nullptr);
+    graph.Write(shadowPass, shadow, RenderResourceUsage::DepthAttachment);
+    uint32_t lighting = graph.AddPass("Lighting", nullptr);
+    graph.Read(lighting, shadow, RenderResourceUsage::ShaderRead);
+    graph.Write(lighting, backbuffer, RenderResourceUsage::ColorAttachment);
+    graph.MarkOutput(backbuffer);
+
+    REQUIRE(graph.Compile());
+
+    const RenderGraphBarrier* barrier = FindBarrier(GetPassBarriers(graph, lighting), shadow);
+    REQUIRE(barrier != nullptr);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, barrier->m_oldLayout);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, barrier->m_newLayout);
+    CHECK((barrier->m_srcStage & VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT) != 0);
+    //Only the write is made available, the read access isn't a source
+    CHECK_EQUAL(static_cast<VkAccessFlags>(VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT), barrier->m_srcAccess);
+    CHECK_EQUAL(static_cast<VkAccessFlags>(VK_ACCESS_SHADER_READ_BIT), barrier->m_dstAccess);
+}
+
+TEST(RenderGraph_ReadAfterReadInTheSameLayoutNeedsNoBarrier)
+{
+    RenderGraph graph;
+    RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+    RenderResourceHandle lut = graph.CreateTransient(MakeColorDesc("Lut"));
+
+    uint32_t bake = graph.AddPass("Bake", nullptr);
+    graph.Write(bake, lut, RenderResourceUsage::ColorAttachment);
+    uint32_t firstRead = graph.AddPass("FirstRead", nullptr);
+    graph.Read(firstRead, lut, RenderResourceUsage::ShaderRead);
+    graph.Write(firstRead, backbuffer, RenderResourceUsage::ColorAttachment);
+    uint32_t secondRead = graph.AddPass("SecondRead", nullptr);
+    graph.Read(secondRead, lut, RenderResourceUsage::ShaderRead);
+    graph.Write(secondRead, backbuffer, RenderResourceUsage::ColorAttachment);
+    graph.MarkOutput(backbuffer);
+
+    REQUIRE(graph.Compile());
+
+    CHECK(FindBarrier(GetPassBarriers(graph, firstRead), lut) != nullptr);
+    CHECK(FindBarrier(GetPassBarriers(graph, secondRead), lut) == nullptr);
+}
+
+TEST(RenderGraph_PassesAreSortedAndUnusedOnesCulled)
+{
+    RenderGraph graph;
+    RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+    RenderResourceHandle scene = graph.CreateTransient(MakeColorDesc("Scene"));
+    RenderResourceHandle unused = graph.CreateTransient(MakeColorDesc("Unused"));
+
+    //Consumer declared before its producer
+    uint32_t tonemap = graph.AddPass("Tonemap", nullptr);
+    graph.Read(tonemap, scene, RenderResourceUsage::ShaderRead);
+    graph.Write(tonemap, backbuffer, RenderResourceUsage::ColorAttachment);
+    uint32_t forward = graph.AddPass("Forward", nullptr);
+    graph.Write(forward, scene, RenderResourceUsage::ColorAttachment);
+    uint32_t debug = graph.AddPass("Debug", nullptr);
+    graph.Write(debug, unused, RenderResourceUsage::ColorAttachment);
+    graph.MarkOutput(backbuffer);
+
+    REQUIRE(graph.Compile());
+
+    const CompiledRenderGraph& compiled = graph.GetCompiled();
+    REQUIRE(compiled.m_passes.size() == 2);
+    CHECK_EQUAL(forward, compiled.m_passes[0].m_passIndex);
+    CHECK_EQUAL(tonemap, compiled.m_passes[1].m_passIndex);
+    CHECK(compiled.m_passCulled[debug]);
+    CHECK_EQUAL(UINT32_MAX, compiled.m_firstUse[unused]);
+}
+
+TEST(RenderGraph_SideEffectPassesSurvive)
+{
+    RenderGraph graph;
+    RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+    RenderResourceHandle scratch = graph.CreateTransient(MakeColorDesc("Scratch"));
+
+    uint32_t readback = graph.AddPass("Readback", nullptr);
+    graph.Write(readback, scratch, RenderResourceUsage::TransferDst);
+    graph.MarkSideEffect(readback);
+    uint32_t forward = graph.AddPass("Forward", nullptr);
+    graph.Write(forward, backbuffer, RenderResourceUsage::ColorAttachment);
+    graph.MarkOutput(backbuffer);
+
+    REQUIRE(graph.Compile());
+
+    CHECK(!graph.GetCompiled().m_passCulled[readback]);
+    CHECK(!graph.GetCompiled().m_passCulled[forward]);
+}
+
+TEST(RenderGraph_InvalidGraphsThrow)
+{
+    RenderGraph graph;
+    RenderResourceHandle a = graph.CreateTransient(MakeColorDesc("A"));
+    RenderResourceHandle b = graph.CreateTransient(MakeColorDesc("B"));
+    uint32_t first = graph.AddPass("First", nullptr);
+    CHECK_THROWS(graph.Write(first, a, RenderResourceUsage::ShaderRead));
+
+    //Each pass reads what the other one writes
+    graph.Write(first, a, RenderResourceUsage::ColorAttachment);
+    graph.Read(first, b, RenderResourceUsage::ShaderRead);
+    uint32_t second = graph.AddPass("Second", nullptr);
+    graph.Write(second, b, RenderResourceUsage::ColorAttachment);
+    graph.Read(second, a, RenderResourceUsage::ShaderRead);
+    graph.MarkOutput(a);
+    graph.MarkOutput(b);
+    CHECK_THROWS(graph.Compile());
+
+    RenderGraph twoLayouts;
+    RenderResourceHandle c = twoLayouts.CreateTransient(MakeColorDesc("C"));
+    uint32_t pass = twoLayouts.AddPass("TwoLayouts", nullptr);
+    twoLayouts.Write(pass, c, RenderResourceUsage::ColorAttachment);
+    twoLayouts.Read(pass, c, RenderResourceUsage::ShaderRead);
+    twoLayouts.MarkOutput(c);
+    CHECK_THROWS(twoLayouts.Compile());
+}
+
+TEST(RenderGraph_TransientFirstUseWaitsForThePreviousFrame)
+{
+    //Depth and MSAA color are shared by every frame, the first write of a frame comes after
+    //the last write of the one before on the same memory
+    RenderGraph graph;
+    RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+    RenderResourceHandle depth = graph.CreateTransient(MakeDepthDesc("Depth"));
+    RenderResourceDesc msaaDesc = MakeColorDesc("MsaaColor");
+    msaaDesc.m_samples = VK_SAMPLE_COUNT_4_BIT;
+    msaaDesc.m_transientAttachment = true;
+    RenderResourceHandle msaa = graph.CreateTransient(msaaDesc);
+
+    uint32_t forward = graph.AddPass("Forward", nullptr);
+    graph.Write(forward, msaa, RenderResourceUsage::ColorAttachment);
+    graph.Write(forward, depth, RenderResourceUsage::DepthAttachment);
+    graph.Write(forward, backbuffer, RenderResourceUsage::ColorAttachment);
+    graph.MarkOutput(backbuffer);
+
+    REQUIRE(graph.Compile());
+    const auto& barriers = GetPassBarriers(graph, forward);
+
+    const RenderGraphBarrier* depthBarrier = FindBarrier(barriers, depth);
+    REQUIRE(depthBarrier != nullptr);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_UNDEFINED, depthBarrier->m_oldLayout);
+    CHECK((depthBarrier->m_srcStage & VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT) != 0);
+    CHECK_EQUAL(static_cast<VkAccessFlags>(VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT), depthBarrier->m_srcAccess);
+
+    const RenderGraphBarrier* msaaBarrier = FindBarrier(barriers, msaa);
+    REQUIRE(msaaBarrier != nullptr);
+    CHECK_EQUAL(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT), msaaBarrier->m_srcStage);
+    CHECK_EQUAL(static_cast<VkAccessFlags>(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT), msaaBarrier->m_srcAccess);
+}
+
+TEST(RenderGraph_DisjointTransientsShareMemory)
+{
+    RenderGraph graph;
+    RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+    RenderResourceHandle first = graph.CreateTransient(MakeColorDesc("First"));
+    RenderResourceHandle second = graph.CreateTransient(MakeColorDesc("Second"));
+    RenderResourceHandle third = graph.CreateTransient(MakeColorDesc("Third"));
+
+    //first: A-B, second: C-D, third: B-C. first and second never overlap, third overlaps both.
+    uint32_t a = graph.AddPass("A", nullptr);
+    graph.Write(a, first, RenderResourceUsage::ColorAttachment);
+    uint32_t b = graph.AddPass("B", nullptr);
+    graph.Read(b, first, RenderResourceUsage::ShaderRead);
+    graph.Write(b, third, RenderResourceUsage::ColorAttachment);
+    uint32_t c = graph.AddPass("C", nullptr);
+    graph.Read(c, third, RenderResourceUsage::ShaderRead);
+    graph.Write(c, second, RenderResourceUsage::ColorAttachment);
+    uint32_t d = graph.AddPass("D", nullptr);
+    graph.Read(d, second, RenderResourceUsage::ShaderRead);
+    graph.Write(d, backbuffer, RenderResourceUsage::ColorAttachment);
+    graph.MarkOutput(backbuffer);
+
+    REQUIRE(graph.Compile());
+    const CompiledRenderGraph& compiled = graph.GetCompiled();
+
+    CHECK_EQUAL(2u, compiled.m_aliasSlotCount);
+    CHECK_EQUAL(compiled.m_aliasSlot[first], compiled.m_aliasSlot[second]);
+    CHECK(compiled.m_aliasSlot[first] != compiled.m_aliasSlot[third]);
+    CHECK_EQUAL(UINT32_MAX, compiled.m_aliasSlot[backbuffer]);
+
+    //The second occupant's first write waits for the first occupant's last read
+    const RenderGraphBarrier* handover = FindBarrier(GetPassBarriers(graph, c), second);
+    REQUIRE(handover != nullptr);
+    CHECK_EQUAL(VK_IMAGE_LAYOUT_UNDEFINED, handover->m_oldLayout);
+    CHECK((handover->m_srcStage & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) != 0);
+}
+
+TEST(RenderGraph_LazyTransientsOnlyAliasLazyOnes)
+{
+    RenderGraph graph;
+    RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+    RenderResourceDesc lazyDesc = MakeColorDesc("Lazy");
+    lazyDesc.m_transientAttachment = true;
+    RenderResourceHandle lazy = graph.CreateTransient(lazyDesc);
+    RenderResourceHandle regular = graph.CreateTransient(MakeColorDesc("Regular"));
+
+    uint32_t a = graph.AddPass("A", nullptr);
+    graph.Write(a, lazy, RenderResourceUsage::ColorAttachment);
+    graph.Write(a, backbuffer, RenderResourceUsage::ColorAttachment);
+    uint32_t b = graph.AddPass("B", nullptr);
+    graph.Write(b, regular, RenderResourceUsage::ColorAttachment);
+    uint32_t c = graph.AddPass("C", nullptr);
+    graph.Read(c, regular, RenderResourceUsage::ShaderRead);
+    graph.Write(c, backbuffer, RenderResourceUsage::ColorAttachment);
+    graph.MarkOutput(backbuffer);
+
+    REQUIRE(graph.Compile());
+    const CompiledRenderGraph& compiled = graph.GetCompiled();
+
+    //Lifetimes don't overlap, the memory types might not match
+    CHECK(compiled.m_lastUse[lazy] < compiled.m_firstUse[regular]);
+    CHECK(compiled.m_aliasSlot[lazy] != compiled.m_aliasSlot[regular]);
+    CHECK_EQUAL(2u, compiled.m_aliasSlotCount);
+}
+
+TEST(RenderGraph_CompileOnlyRebuildsChangedStructure)
+{
+    auto declare = [](RenderGraph& graph, VkFormat format)
+    {
+        graph.Reset();
+        RenderResourceHandle backbuffer = ImportBackbuffer(graph);
+        RenderResourceDesc desc = MakeColorDesc("Scene");
+        desc.m_format = format;
+        RenderResourceHandle scene = graph.CreateTransient(desc);
+        uint32_t forward = graph.AddPass("Forward", nullptr);
+        graph.Write(forward, scene, RenderResourceUsage::ColorAttachment);
+        uint32_t tonemap = graph.AddPass("Tonemap", nullptr);
+        graph.Read(tonemap, scene, RenderResourceUsage::ShaderRead);
+        graph.Write(tonemap, backbuffer, RenderResourceUsage::ColorAttachment);
+        graph.MarkOutput(backbuffer);
+    };
+
+    RenderGraph graph;
+    declare(graph, VK_FORMAT_R16G16B16A16_SFLOAT);
+    CHECK(graph.Compile());
+    declare(graph, VK_FORMAT_R16G16B16A16_SFLOAT);
+    CHECK(!graph.Compile());
+    declare(graph, VK_FORMAT_B10G11R11_UFLOAT_PACK32);
+    CHECK(graph.Compile());
+}
@@ -0,0 +1,577 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+#include <vulkan/spirv.h>
+
+//Checks the shipped SPIR-V against what the C++ side binds and specializes, so a shader that
+//wasn't recompiled after its GLSL changed shows up here instead of as a validation error.
+namespace
+{
+    struct Instruction
+    {
+        SpvOp m_op;
+        std::vector<uint32_t> m_operands;
+    };
+
+    struct SpirvModule
+    {
+        uint32_t m_version = 0;
+        uint32_t m_bound = 0;
+        std::vector<Instruction> m_instructions;
+    };
+
+    //Empty when the file is missing or isn't SPIR-V
+    SpirvModule LoadModule(const std::string& relative)
+    {
+        SpirvModule module;
+
+        std::ifstream file(Test::GetPath(relative), std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (bytes.size() < 5 * sizeof(uint32_t) || bytes.size() % sizeof(uint32_t) != 0)
+        {
+            return module;
+        }
+
+        std::vector<uint32_t> words(bytes.size() / sizeof(uint32_t));
+        std::memcpy(words.data(), bytes.data(), bytes.size());
+        if (words[0] != SpvMagicNumber)
+        {
+            return module;
+        }
+
+        module.m_version = words[1];
+        module.m_bound = words[3];
+
+        size_t i = 5;
+        while (i < words.size())
+        {
+            uint32_t wordCount = words[i] >> SpvWordCountShift;
+            if (wordCount == 0 || i + wordCount > words.size())
+            {
+                //Truncated, fails CheckWellFormed
+                module.m_instructions.clear();
+                return module;
+            }
+
+            Instruction instruction;
+            instruction.m_op = static_cast<SpvOp>(words[i] & SpvOpCodeMask);
+            instruction.m_operands.assign(words.begin() + i + 1, words.begin() + i + wordCount);
+            module.m_instructions.push_back(std::move(instruction));
+            i += wordCount;
+        }
+
+        return module;
+    }
+
+    //Literal string operand starting at operand index first
+    std::string GetString(const Instruction& instruction, size_t first)
+    {
+        std::string result;
+        for (size_t i = first; i < instruction.m_operands.size(); i++)
+        {
+            for (uint32_t byte = 0; byte < 4; byte++)
+            {
+                char c = static_cast<char>((instruction.m_operands[i] >> (byte * 8)) & 0xFF);
+                if (c == '\0')
+                {
+                    return result;
+                }
+                result += c;
+            }
+        }
+
+        return result;
+    }
+
+    //Where the result id sits in the operands, -1 for instructions without one. Only covers
+    //what the shaders in Shaders/ use.
+    int GetResultIndex(SpvOp op)
+    {
+        switch (op)
+        {
+        case SpvOpExtInstImport:
+        case SpvOpString:
+        case SpvOpLabel:
+        case SpvOpTypeVoid:
+        case SpvOpTypeBool:
+        case SpvOpTypeInt:
+        case SpvOpTypeFloat:
+        case SpvOpTypeVector:
+        case SpvOpTypeMatrix:
+        case SpvOpTypeArray:
+        case SpvOpTypeRuntimeArray:
+        case SpvOpTypeStruct:
+        case SpvOpTypePointer:
+        case SpvOpTypeFunction:
+            return 0;
+        case SpvOpName:
+        case SpvOpMemberName:
+        case SpvOpDecorate:
+        case SpvOpMemberDecorate:
+        case SpvOpCapability:
+        case SpvOpMemoryModel:
+        case SpvOpEntryPoint:
+        case SpvOpExecutionMode:
+        case SpvOpSource:
+        case SpvOpSourceExtension:
+        case SpvOpStore:
+        case SpvOpReturn:
+        case SpvOpFunctionEnd:
+        case SpvOpBranch:
+        case SpvOpBranchConditional:
+        case SpvOpSelectionMerge:
+        case SpvOpLoopMerge:
+        case SpvOpControlBarrier:
+        case SpvOpMemoryBarrier:
+            return -1;
+        default:
+            return 1;
+        }
+    }
+
+    const Instruction* FindResult(const SpirvModule& module, uint32_t id)
+    {
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            int resultIndex = GetResultIndex(instruction.m_op);
+            if (resultIndex >= 0 && static_cast<size_t>(resultIndex) < instruction.m_operands.size() && instruction.m_operands[resultIndex] == id)
+            {
+                return &instruction;
+            }
+        }
+
+        return nullptr;
+    }
+
+    //Operands of every OpDecorate of id with decoration, after the decoration itself
+    std::vector<std::vector<uint32_t>> GetDecorations(const SpirvModule& module, uint32_t id, SpvDecoration decoration)
+    {
+        std::vector<std::vector<uint32_t>> result;
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            if (instruction.m_op == SpvOpDecorate && instruction.m_operands.size() >= 2 && instruction.m_operands[0] == id && instruction.m_operands[1] == decoration)
+            {
+                result.emplace_back(instruction.m_operands.begin() + 2, instruction.m_operands.end());
+            }
+        }
+
+        return result;
+    }
+
+    bool HasMemberDecoration(const SpirvModule& module, uint32_t structType, uint32_t member, SpvDecoration decoration)
+    {
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            if (instruction.m_op == SpvOpMemberDecorate && instruction.m_operands.size() >= 3 && instruction.m_operands[0] == structType &&
+                instruction.m_operands[1] == member && instruction.m_operands[2] == decoration)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //Operands of OpMemberDecorate of member with decoration, after the decoration itself
+    std::vector<uint32_t> GetMemberDecoration(const SpirvModule& module, uint32_t structType, uint32_t member, SpvDecoration decoration)
+    {
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            if (instruction.m_op == SpvOpMemberDecorate && instruction.m_operands.size() >= 3 && instruction.m_operands[0] == structType &&
+                instruction.m_operands[1] == member && instruction.m_operands[2] == decoration)
+            {
+                return std::vector<uint32_t>(instruction.m_operands.begin() + 3, instruction.m_operands.end());
+            }
+        }
+
+        return {};
+    }
+
+    //The variable at set and binding, 0 if there's none
+    uint32_t FindBinding(const SpirvModule& module, uint32_t set, uint32_t binding)
+    {
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            if (instruction.m_op != SpvOpVariable)
+            {
+                continue;
+            }
+
+            uint32_t variable = instruction.m_operands[1];
+            if (GetDecorations(module, variable, SpvDecorationDescriptorSet) == std::vector<std::vector<uint32_t>>{ { set } } &&
+                GetDecorations(module, variable, SpvDecorationBinding) == std::vector<std::vector<uint32_t>>{ { binding } })
+            {
+                return variable;
+            }
+        }
+
+        return 0;
+    }
+
+    //The struct a variable of pointer to struct points at, 0 otherwise
+    uint32_t GetPointeeStruct(const SpirvModule& module, uint32_t variable)
+    {
+        const Instruction* var = FindResult(module, variable);
+        const Instruction* pointer = var != nullptr ? FindResult(module, var->m_operands[0]) : nullptr;
+        const Instruction* pointee = pointer != nullptr && pointer->m_op == SpvOpTypePointer ? FindResult(module, pointer->m_operands[2]) : nullptr;
+        return pointee != nullptr && pointee->m_op == SpvOpTypeStruct ? pointee->m_operands[0] : 0;
+    }
+
+    //The variable a pointer was chained from
+    uint32_t GetBaseVariable(const SpirvModule& module, uint32_t pointer)
+    {
+        const Instruction* instruction = FindResult(module, pointer);
+        while (instruction != nullptr && instruction->m_op == SpvOpAccessChain)
+        {
+            instruction = FindResult(module, instruction->m_operands[2]);
+        }
+
+        return instruction != nullptr && instruction->m_op == SpvOpVariable ? instruction->m_operands[1] : 0;
+    }
+
+    //The variable the value was loaded from, 0 if it isn't a load
+    uint32_t GetLoadedVariable(const SpirvModule& module, uint32_t value)
+    {
+        const Instruction* instruction = FindResult(module, value);
+        return instruction != nullptr && instruction->m_op == SpvOpLoad ? GetBaseVariable(module, instruction->m_operands[2]) : 0;
+    }
+
+    //The id decorated with decoration value, 0 if there's none
+    uint32_t FindDecorated(const SpirvModule& module, SpvDecoration decoration, uint32_t value)
+    {
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            if (instruction.m_op == SpvOpDecorate && instruction.m_operands.size() == 3 && instruction.m_operands[1] == decoration && instruction.m_operands[2] == value)
+            {
+                return instruction.m_operands[0];
+            }
+        }
+
+        return 0;
+    }
+
+    //Every OpVariable in storageClass
+    std::vector<uint32_t> GetVariables(const SpirvModule& module, SpvStorageClass storageClass)
+    {
+        std::vector<uint32_t> result;
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            if (instruction.m_op == SpvOpVariable && instruction.m_operands.size() >= 3 && instruction.m_operands[2] == storageClass)
+            {
+                result.push_back(instruction.m_operands[1]);
+            }
+        }
+
+        return result;
+    }
+
+    //Locations of the storageClass variables, built-ins have none
+    std::set<uint32_t> GetLocations(const SpirvModule& module, SpvStorageClass storageClass)
+    {
+        std::set<uint32_t> result;
+        for (uint32_t variable : GetVariables(module, storageClass))
+        {
+            for (const std::vector<uint32_t>& location : GetDecorations(module, variable, SpvDecorationLocation))
+            {
+                result.insert(location[0]);
+            }
+        }
+
+        return result;
+    }
+
+    const Instruction* FindEntryPoint(const SpirvModule& module)
+    {
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            if (instruction.m_op == SpvOpEntryPoint)
+            {
+                return &instruction;
+            }
+        }
+
+        return nullptr;
+    }
+
+    //Header and ids, not a validator: every instruction fits, every result id is below the
+    //bound and defined once, the version is 1.0.
+    void CheckWellFormed(const SpirvModule& module)
+    {
+        REQUIRE(!module.m_instructions.empty());
+        //SPIR-V 1.0, glslc's default for a Vulkan 1.0 target
+        CHECK_EQUAL(0x00010000u, module.m_version);
+
+        std::set<uint32_t> results;
+        for (const Instruction& instruction : module.m_instructions)
+        {
+            int resultIndex = GetResultIndex(instruction.m_op);
+            if (resultIndex < 0)
+            {
+                continue;
+            }
+
+            REQUIRE(static_cast<size_t>(resultIndex) < instruction.m_operands.size());
+            uint32_t id = instruction.m_operands[resultIndex];
+            CHECK(id != 0 && id < module.m_bound);
+            CHECK(results.insert(id).second);
+        }
+
+        const Instruction* entryPoint = FindEntryPoint(module);
+        REQUIRE(entryPoint != nullptr);
+        CHECK_EQUAL(std::string("main"), GetString(*entryPoint, 2));
+    }
+}
+
+TEST(ShaderReflection_FragmentSpecializesLightingModelOnly)
+{
+    SpirvModule module = LoadModule("Shaders/frag.spv");
+    CheckWellFormed(module);
+
+    const Instruction* entryPoint = FindEntryPoint(module);
+    REQUIRE(entryPoint != nullptr);
+    CHECK_EQUAL(static_cast<uint32_t>(SpvExecutionModelFragment), entryPoint->m_operands[0]);
+
+    //SHADER_CONSTANT_LIGHTING_MODEL, an int like LightingModel. Nothing else may be
+    //specialized, ShaderPermutation only fills constant 0.
+    uint32_t lightingModel = FindDecorated(module, SpvDecorationSpecId, 0);
+    REQUIRE(lightingModel != 0);
+    const Instruction* constant = FindResult(module, lightingModel);
+    REQUIRE(constant != nullptr);
+    CHECK_EQUAL(static_cast<uint32_t>(SpvOpSpecConstant), static_cast<uint32_t>(constant->m_op));
+    REQUIRE(constant->m_operands.size() == 3);
+    CHECK_EQUAL(0u, constant->m_operands[2]);
+
+    const Instruction* type = FindResult(module, constant->m_operands[0]);
+    REQUIRE(type != nullptr);
+    CHECK_EQUAL(static_cast<uint32_t>(SpvOpTypeInt), static_cast<uint32_t>(type->m_op));
+    CHECK_EQUAL(32u, type->m_operands[1]);
+
+    for (uint32_t specId = 1; specId < 8; specId++)
+    {
+        CHECK_EQUAL(0u, FindDecorated(module, SpvDecorationSpecId, specId));
+    }
+
+    //Color, normal and view direction from the vertex shader in, the color attachment out
+    CHECK(GetLocations(module, SpvStorageClassInput) == std::set<uint32_t>({ 0, 1, 2 }));
+    CHECK(GetLocations(module, SpvStorageClassOutput) == std::set<uint32_t>({ 0 }));
+}
+
+TEST(ShaderReflection_VertexOutputsFeedFragmentInputs)
+{
+    //Both vertex shaders run with frag.spv, every input it reads has to be written
+    std::set<uint32_t> fragmentInputs = GetLocations(LoadModule("Shaders/frag.spv"), SpvStorageClassInput);
+    REQUIRE(!fragmentInputs.empty());
+
+    for (const char* path : { "Shaders/vert.spv", "Shaders/meshlet_vert.spv" })
+    {
+        std::set<uint32_t> vertexOutputs = GetLocations(LoadModule(path), SpvStorageClassOutput);
+        for (uint32_t location : fragmentInputs)
+        {
+            CHECK(vertexOutputs.count(location) == 1);
+        }
+    }
+}
+
+TEST(ShaderReflection_VertexPositionIsInvariant)
+{
+    SpirvModule module = LoadModule("Shaders/vert.spv");
+    CheckWellFormed(module);
+
+    const Instruction* entryPoint = FindEntryPoint(module);
+    REQUIRE(entryPoint != nullptr);
+    CHECK_EQUAL(static_cast<uint32_t>(SpvExecutionModelVertex), entryPoint->m_operands[0]);
+
+    //The depth pre-pass only matches the EQUAL tested pass if gl_Position is invariant. glslc
+    //puts it in the gl_PerVertex block, a loose gl_Position is decorated directly.
+    bool invariant = false;
+    bool found = false;
+    for (const Instruction& instruction : module.m_instructions)
+    {
+        if (instruction.m_op == SpvOpMemberDecorate && instruction.m_operands.size() == 4 &&
+            instruction.m_operands[2] == SpvDecorationBuiltIn && instruction.m_operands[3] == SpvBuiltInPosition)
+        {
+            found = true;
+            invariant = HasMemberDecoration(module, instruction.m_operands[0], instruction.m_operands[1], SpvDecorationInvariant);
+        }
+        else if (instruction.m_op == SpvOpDecorate && instruction.m_operands.size() == 3 &&
+            instruction.m_operands[1] == SpvDecorationBuiltIn && instruction.m_operands[2] == SpvBuiltInPosition)
+        {
+            found = true;
+            invariant = !GetDecorations(module, instruction.m_operands[0], SpvDecorationInvariant).empty();
+        }
+    }
+    CHECK(found);
+    CHECK(invariant);
+
+    //No vertex input, the triangle comes from gl_VertexIndex
+    uint32_t vertexIndex = FindDecorated(module, SpvDecorationBuiltIn, SpvBuiltInVertexIndex);
+    REQUIRE(vertexIndex != 0);
+    std::vector<uint32_t> inputs = GetVariables(module, SpvStorageClassInput);
+    CHECK(inputs == std::vector<uint32_t>{ vertexIndex });
+
+    uint32_t fragColor = 0;
+    for (uint32_t output : GetVariables(module, SpvStorageClassOutput))
+    {
+        if (GetDecorations(module, output, SpvDecorationLocation) == std::vector<std::vector<uint32_t>>{ { 0 } })
+        {
+            fragColor = output;
+        }
+    }
+    CHECK(fragColor != 0);
+}
+
+TEST(ShaderReflection_VertexTransformsComeFromUniformRing)
+{
+    SpirvModule module = LoadModule("Shaders/vert.spv");
+    CheckWellFormed(module);
+
+    //FrameUniforms and ObjectUniforms in VulkanBackend.h, both std140 blocks of the ring's set
+    uint32_t frame = FindBinding(module, 0, 0);
+    uint32_t object = FindBinding(module, 0, 1);
+    REQUIRE(frame != 0);
+    REQUIRE(object != 0);
+
+    uint32_t frameType = GetPointeeStruct(module, frame);
+    uint32_t objectType = GetPointeeStruct(module, object);
+    REQUIRE(frameType != 0);
+    REQUIRE(objectType != 0);
+    CHECK(!GetDecorations(module, frameType, SpvDecorationBlock).empty());
+    CHECK(!GetDecorations(module, objectType, SpvDecorationBlock).empty());
+    CHECK(GetMemberDecoration(module, frameType, 0, SpvDecorationOffset) == std::vector<uint32_t>{ 0 });
+    CHECK(GetMemberDecoration(module, frameType, 0, SpvDecorationMatrixStride) == std::vector<uint32_t>{ 16 });
+    CHECK(GetMemberDecoration(module, frameType, 1, SpvDecorationOffset) == std::vector<uint32_t>{ 64 });
+    CHECK(GetMemberDecoration(module, objectType, 0, SpvDecorationOffset) == std::vector<uint32_t>{ 0 });
+    CHECK(GetMemberDecoration(module, objectType, 0, SpvDecorationMatrixStride) == std::vector<uint32_t>{ 16 });
+
+    //DrawConstants
+    std::vector<uint32_t> pushConstants = GetVariables(module, SpvStorageClassPushConstant);
+    REQUIRE(pushConstants.size() == 1);
+    uint32_t drawType = GetPointeeStruct(module, pushConstants[0]);
+    REQUIRE(drawType != 0);
+    CHECK(GetMemberDecoration(module, drawType, 0, SpvDecorationOffset) == std::vector<uint32_t>{ 0 });
+
+    //gl_Position = viewProjection * model * position, both matrices loaded from the ring
+    uint32_t positionStores = 0;
+    for (const Instruction& instruction : module.m_instructions)
+    {
+        if (instruction.m_op != SpvOpStore)
+        {
+            continue;
+        }
+
+        const Instruction* value = FindResult(module, instruction.m_operands[1]);
+        if (value == nullptr || value->m_op != SpvOpMatrixTimesVector)
+        {
+            continue;
+        }
+
+        positionStores++;
+        const Instruction* matrix = FindResult(module, value->m_operands[2]);
+        REQUIRE(matrix != nullptr);
+        REQUIRE(matrix->m_op == SpvOpMatrixTimesMatrix);
+        CHECK_EQUAL(frame, GetLoadedVariable(module, matrix->m_operands[2]));
+        CHECK_EQUAL(object, GetLoadedVariable(module, matrix->m_operands[3]));
+
+        uint32_t target = GetBaseVariable(module, instruction.m_operands[0]);
+        std::vector<uint32_t> outputs = GetVariables(module, SpvStorageClassOutput);
+        CHECK(std::find(outputs.begin(), outputs.end(), target) != outputs.end());
+    }
+    CHECK_EQUAL(1u, positionStores);
+}
+
+TEST(ShaderReflection_MeshletVertexPullsPositionsFromSetOne)
+{
+    SpirvModule module = LoadModule("Shaders/meshlet_vert.spv");
+    CheckWellFormed(module);
+
+    //Same ring bindings and push constants as vert.spv, the pipeline layouts share set 0
+    CHECK(FindBinding(module, 0, 0) != 0);
+    CHECK(FindBinding(module, 0, 1) != 0);
+    CHECK_EQUAL(static_cast<size_t>(1), GetVariables(module, SpvStorageClassPushConstant).size());
+
+    //MeshletGeometry::GetSetLayout, a read only storage buffer of vec4
+    uint32_t positions = FindBinding(module, 1, 0);
+    REQUIRE(positions != 0);
+    uint32_t positionsType = GetPointeeStruct(module, positions);
+    REQUIRE(positionsType != 0);
+    CHECK(!GetDecorations(module, positionsType, SpvDecorationBufferBlock).empty());
+    CHECK(HasMemberDecoration(module, positionsType, 0, SpvDecorationNonWritable));
+
+    const Instruction* array = FindResult(module, FindResult(module, positionsType)->m_operands[1]);
+    REQUIRE(array != nullptr);
+    CHECK_EQUAL(static_cast<uint32_t>(SpvOpTypeRuntimeArray), static_cast<uint32_t>(array->m_op));
+    CHECK(GetDecorations(module, array->m_operands[0], SpvDecorationArrayStride) == std::vector<std::vector<uint32_t>>{ { 16 } });
+
+    //Drawn into the same depth pre-pass as the rest
+    bool invariant = false;
+    for (const Instruction& instruction : module.m_instructions)
+    {
+        if (instruction.m_op == SpvOpMemberDecorate && instruction.m_operands.size() == 4 &&
+            instruction.m_operands[2] == SpvDecorationBuiltIn && instruction.m_operands[3] == SpvBuiltInPosition)
+        {
+            invariant = HasMemberDecoration(module, instruction.m_operands[0], instruction.m_operands[1], SpvDecorationInvariant);
+        }
+    }
+    CHECK(invariant);
+}
+
+TEST(ShaderReflection_MeshletCullMatchesCullSetLayout)
+{
+    SpirvModule module = LoadModule("Shaders/meshlet_cull.spv");
+    CheckWellFormed(module);
+
+    const Instruction* entryPoint = FindEntryPoint(module);
+    REQUIRE(entryPoint != nullptr);
+    CHECK_EQUAL(static_cast<uint32_t>(SpvExecutionModelGLCompute), entryPoint->m_operands[0]);
+
+    //CULL_GROUP_SIZE in MeshletGeometry.cpp
+    bool localSize = false;
+    for (const Instruction& instruction : module.m_instructions)
+    {
+        if (instruction.m_op == SpvOpExecutionMode && instruction.m_operands.size() == 5 && instruction.m_operands[1] == SpvExecutionModeLocalSize)
+        {
+            localSize = instruction.m_operands[2] == 64 && instruction.m_operands[3] == 1 && instruction.m_operands[4] == 1;
+        }
+    }
+    CHECK(localSize);
+
+    //COMPACT, filled with a VkBool32 when VK_KHR_draw_indirect_count is on
+    uint32_t compact = FindDecorated(module, SpvDecorationSpecId, 0);
+    REQUIRE(compact != 0);
+    const Instruction* constant = FindResult(module, compact);
+    REQUIRE(constant != nullptr);
+    CHECK_EQUAL(static_cast<uint32_t>(SpvOpSpecConstantFalse), static_cast<uint32_t>(constant->m_op));
+
+    //Meshlets, constants and draws: storage, uniform and storage, MeshletCullData is 48 bytes
+    uint32_t meshlets = FindBinding(module, 0, 0);
+    uint32_t constants = FindBinding(module, 0, 1);
+    uint32_t draws = FindBinding(module, 0, 2);
+    REQUIRE(meshlets != 0);
+    REQUIRE(constants != 0);
+    REQUIRE(draws != 0);
+    CHECK(!GetDecorations(module, GetPointeeStruct(module, meshlets), SpvDecorationBufferBlock).empty());
+    CHECK(!GetDecorations(module, GetPointeeStruct(module, constants), SpvDecorationBlock).empty());
+    CHECK(!GetDecorations(module, GetPointeeStruct(module, draws), SpvDecorationBufferBlock).empty());
+
+    const Instruction* meshletArray = FindResult(module, FindResult(module, GetPointeeStruct(module, meshlets))->m_operands[1]);
+    REQUIRE(meshletArray != nullptr);
+    CHECK(GetDecorations(module, meshletArray->m_operands[0], SpvDecorationArrayStride) == std::vector<std::vector<uint32_t>>{ { 48 } });
+
+    //MeshletCullConstants
+    uint32_t constantsType = GetPointeeStruct(module, constants);
+    CHECK(GetMemberDecoration(module, constantsType, 1, SpvDecorationOffset) == std::vector<uint32_t>{ 96 });
+    CHECK(GetMemberDecoration(module, constantsType, 2, SpvDecorationOffset) == std::vector<uint32_t>{ 112 });
+
+    //Count first, VkDrawIndexedIndirectCommands from DRAW_COMMAND_OFFSET
+    uint32_t drawsType = GetPointeeStruct(module, draws);
+    CHECK(GetMemberDecoration(module, drawsType, 0, SpvDecorationOffset) == std::vector<uint32_t>{ 0 });
+    CHECK(GetMemberDecoration(module, drawsType, 2, SpvDecorationOffset) == std::vector<uint32_t>{ 16 });
+    const Instruction* drawArray = FindResult(module, FindResult(module, drawsType)->m_operands[3]);
+    REQUIRE(drawArray != nullptr);
+    CHECK(GetDecorations(module, drawArray->m_operands[0], SpvDecorationArrayStride) == std::vector<std::vector<uint32_t>>{ { 20 } });
+}
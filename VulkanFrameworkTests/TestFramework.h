@@ -0,0 +1,120 @@
+#ifndef __TEST_FRAMEWORK_H__
+#define __TEST_FRAMEWORK_H__
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Just enough of a test framework for the CPU side of the renderer, nothing to vendor.
+//Tests register themselves with TEST(name). A failed CHECK is recorded and the test goes
+//on, a failed REQUIRE ends the test. Nothing here may need a device.
+namespace Test
+{
+    using TestFunc = std::function<void()>;
+
+    struct TestCase
+    {
+        const char* m_name;
+        const char* m_file;
+        TestFunc m_func;
+    };
+
+    std::vector<TestCase>& GetRegistry();
+
+    struct Registrar
+    {
+        Registrar(const char* name, const char* file, TestFunc func) { GetRegistry().push_back({ name, file, std::move(func) }); }
+    };
+
+    //Thrown by REQUIRE, caught by the runner
+    struct RequireFailed
+    {
+    };
+
+    //Counted against the test that's running
+    void ReportFailure(const char* file, int line, const std::string& message);
+
+    //Runs every test whose name contains filter, returns how many failed
+    uint32_t RunAll(std::ostream& out, const std::string& filter);
+
+    //Where the renderer's files (Shaders/ etc) are, ../VulkanFramework/ unless --root says otherwise
+    void SetRoot(const std::string& root);
+    std::string GetPath(const std::string& relative);
+}
+
+#define TEST_CONCAT_INNER(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_INNER(a, b)
+
+#define TEST(name) \
+    static void TEST_CONCAT(TestBody_, name)(); \
+    static const Test::Registrar TEST_CONCAT(s_testRegistrar_, name)(#name, __FILE__, &TEST_CONCAT(TestBody_, name)); \
+    static void TEST_CONCAT(TestBody_, name)()
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            Test::ReportFailure(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+        } \
+    } while (false)
+
+#define REQUIRE(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            Test::ReportFailure(__FILE__, __LINE__, "REQUIRE(" #condition ")"); \
+            throw Test::RequireFailed(); \
+        } \
+    } while (false)
+
+#define CHECK_EQUAL(expected, actual) \
+    do \
+    { \
+        const auto& testExpected = (expected); \
+        const auto& testActual = (actual); \
+        if (!(testExpected == testActual)) \
+        { \
+            std::ostringstream testMessage; \
+            testMessage << "CHECK_EQUAL(" #expected ", " #actual "): " << testExpected << " != " << testActual; \
+            Test::ReportFailure(__FILE__, __LINE__, testMessage.str()); \
+        } \
+    } while (false)
+
+#define CHECK_NEAR(expected, actual, tolerance) \
+    do \
+    { \
+        double testExpected = static_cast<double>(expected); \
+        double testActual = static_cast<double>(actual); \
+        if (!(std::abs(testExpected - testActual) <= (tolerance))) \
+        { \
+            std::ostringstream testMessage; \
+            testMessage << "CHECK_NEAR(" #expected ", " #actual "): " << testExpected << " vs " << testActual; \
+            Test::ReportFailure(__FILE__, __LINE__, testMessage.str()); \
+        } \
+    } while (false)
+
+#define CHECK_THROWS(expression) \
+    do \
+    { \
+        bool testThrew = false; \
+        try \
+        { \
+            expression; \
+        } \
+        catch (const std::exception&) \
+        { \
+            testThrew = true; \
+        } \
+        if (!testThrew) \
+        { \
+            Test::ReportFailure(__FILE__, __LINE__, "CHECK_THROWS(" #expression ")"); \
+        } \
+    } while (false)
+
+#endif // !__TEST_FRAMEWORK_H__
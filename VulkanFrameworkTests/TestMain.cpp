@@ -0,0 +1,96 @@
+#include "TestFramework.h"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+namespace
+{
+    //Failures of the test that's running
+    uint32_t s_failures = 0;
+    std::string s_root = "../VulkanFramework/";
+}
+
+std::vector<Test::TestCase>& Test::GetRegistry()
+{
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void Test::ReportFailure(const char* file, int line, const std::string& message)
+{
+    std::cout << "  " << file << "(" << line << "): " << message << std::endl;
+    s_failures++;
+}
+
+uint32_t Test::RunAll(std::ostream& out, const std::string& filter)
+{
+    uint32_t run = 0;
+    uint32_t failed = 0;
+
+    for (const TestCase& test : GetRegistry())
+    {
+        if (!filter.empty() && std::string(test.m_name).find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        s_failures = 0;
+        try
+        {
+            test.m_func();
+        }
+        catch (const RequireFailed&)
+        {
+        }
+        catch (const std::exception& e)
+        {
+            ReportFailure(test.m_file, 0, std::string("unexpected exception: ") + e.what());
+        }
+
+        run++;
+        if (s_failures != 0)
+        {
+            failed++;
+            out << "FAILED " << test.m_name << std::endl;
+        }
+    }
+
+    out << run << " tests, " << failed << " failed" << std::endl;
+
+    return failed;
+}
+
+void Test::SetRoot(const std::string& root)
+{
+    s_root = root;
+    if (!s_root.empty() && s_root.back() != '/' && s_root.back() != '\\')
+    {
+        s_root += '/';
+    }
+}
+
+std::string Test::GetPath(const std::string& relative)
+{
+    return s_root + relative;
+}
+
+int main(int argc, char** argv)
+{
+    //VulkanFrameworkTests [--root <dir>] [filter]
+    std::string filter;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--root" && i + 1 < argc)
+        {
+            Test::SetRoot(argv[++i]);
+        }
+        else
+        {
+            filter = arg;
+        }
+    }
+
+    return Test::RunAll(std::cout, filter) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
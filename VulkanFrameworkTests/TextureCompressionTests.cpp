@@ -0,0 +1,221 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "TextureCompression.h"
+
+namespace
+{
+    struct Image
+    {
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        std::vector<uint8_t> m_rgba;
+    };
+
+    //Not a multiple of the block size, so the edge blocks are partial
+    const uint32_t WIDTH = 13;
+    const uint32_t HEIGHT = 9;
+
+    //Grey ramp across, alpha ramp down (opaque unless asked). Grey keeps every block's
+    //colors on a line, which is what the endpoint codecs can represent.
+    Image MakeRamp(bool alpha)
+    {
+        Image image;
+        image.m_width = WIDTH;
+        image.m_height = HEIGHT;
+        image.m_rgba.resize(WIDTH * HEIGHT * 4);
+
+        for (uint32_t y = 0; y < HEIGHT; y++)
+        {
+            for (uint32_t x = 0; x < WIDTH; x++)
+            {
+                uint8_t* texel = &image.m_rgba[(y * WIDTH + x) * 4];
+                texel[0] = static_cast<uint8_t>(x * 255 / (WIDTH - 1));
+                texel[1] = texel[0];
+                texel[2] = texel[0];
+                texel[3] = alpha ? static_cast<uint8_t>(255 - y * 255 / (HEIGHT - 1)) : 255;
+            }
+        }
+
+        return image;
+    }
+
+    //Largest difference over the first channelCount channels
+    int GetMaxError(const Image& image, const std::vector<uint8_t>& decoded, uint32_t channelCount)
+    {
+        int maxError = 0;
+        for (size_t texel = 0; texel < static_cast<size_t>(image.m_width) * image.m_height; texel++)
+        {
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                maxError = std::max(maxError, std::abs(image.m_rgba[texel * 4 + channel] - decoded[texel * 4 + channel]));
+            }
+        }
+
+        return maxError;
+    }
+
+    std::vector<uint8_t> RoundTrip(TextureCodec codec, const Image& image)
+    {
+        std::vector<uint8_t> data = CompressImage(codec, image.m_rgba.data(), image.m_width, image.m_height);
+        REQUIRE(data.size() == GetCodecImageSize(codec, image.m_width, image.m_height));
+
+        std::vector<uint8_t> decoded = DecompressImage(codec, data.data(), image.m_width, image.m_height);
+        REQUIRE(decoded.size() == image.m_rgba.size());
+        return decoded;
+    }
+}
+
+TEST(TextureCompression_ImageSizesCountPartialBlocks)
+{
+    CHECK_EQUAL(static_cast<size_t>(WIDTH * HEIGHT * 4), GetCodecImageSize(TextureCodec::RGBA8, WIDTH, HEIGHT));
+    //4x3 blocks
+    CHECK_EQUAL(static_cast<size_t>(12 * 8), GetCodecImageSize(TextureCodec::BC1, WIDTH, HEIGHT));
+    CHECK_EQUAL(static_cast<size_t>(12 * 16), GetCodecImageSize(TextureCodec::BC7, WIDTH, HEIGHT));
+    CHECK_EQUAL(static_cast<size_t>(8), GetCodecImageSize(TextureCodec::BC4, 1, 1));
+}
+
+TEST(TextureCompression_CodecNamesRoundTrip)
+{
+    const TextureCodec codecs[] = { TextureCodec::RGBA8, TextureCodec::BC1, TextureCodec::BC3, TextureCodec::BC4, TextureCodec::BC5, TextureCodec::BC7, TextureCodec::ASTC4x4 };
+    for (TextureCodec codec : codecs)
+    {
+        TextureCodec parsed = TextureCodec::RGBA8;
+        CHECK(ParseTextureCodec(GetTextureCodecName(codec), parsed));
+        CHECK(parsed == codec);
+    }
+
+    TextureCodec parsed = TextureCodec::RGBA8;
+    CHECK(!ParseTextureCodec("bc6h", parsed));
+}
+
+TEST(TextureCompression_OpaqueRampRoundTripsClosely)
+{
+    Image image = MakeRamp(false);
+
+    //Colors (and alpha where there is one) within a step or two of the 565 and 7 bit endpoints
+    CHECK(GetMaxError(image, RoundTrip(TextureCodec::BC1, image), 4) <= 4);
+    CHECK(GetMaxError(image, RoundTrip(TextureCodec::BC3, image), 4) <= 4);
+    CHECK(GetMaxError(image, RoundTrip(TextureCodec::BC4, image), 1) <= 4);
+    CHECK(GetMaxError(image, RoundTrip(TextureCodec::BC5, image), 2) <= 4);
+    CHECK(GetMaxError(image, RoundTrip(TextureCodec::BC7, image), 4) <= 4);
+    CHECK(RoundTrip(TextureCodec::RGBA8, image) == image.m_rgba);
+}
+
+TEST(TextureCompression_SingleAndDualChannelDecodeToDefaults)
+{
+    Image image = MakeRamp(false);
+
+    std::vector<uint8_t> bc4 = RoundTrip(TextureCodec::BC4, image);
+    std::vector<uint8_t> bc5 = RoundTrip(TextureCodec::BC5, image);
+    for (size_t texel = 0; texel < static_cast<size_t>(WIDTH) * HEIGHT; texel++)
+    {
+        CHECK_EQUAL(0, bc4[texel * 4 + 1]);
+        CHECK_EQUAL(0, bc4[texel * 4 + 2]);
+        CHECK_EQUAL(255, bc4[texel * 4 + 3]);
+        CHECK_EQUAL(0, bc5[texel * 4 + 2]);
+        CHECK_EQUAL(255, bc5[texel * 4 + 3]);
+    }
+}
+
+TEST(TextureCompression_AlphaRampKeepsAlpha)
+{
+    Image image = MakeRamp(true);
+
+    //BC3 alpha is its own BC4 block
+    CHECK(GetMaxError(image, RoundTrip(TextureCodec::BC3, image), 4) <= 6);
+    //BC7 mode 6 fits one line through RGBA. The alpha ramp runs across the grey one, so
+    //a block can't follow both, only land between them.
+    CHECK(GetMaxError(image, RoundTrip(TextureCodec::BC7, image), 4) <= 40);
+
+    //Alpha following the grey is on the line, and comes back as closely as the colors
+    for (size_t texel = 0; texel < static_cast<size_t>(WIDTH) * HEIGHT; texel++)
+    {
+        image.m_rgba[texel * 4 + 3] = image.m_rgba[texel * 4];
+    }
+    CHECK(GetMaxError(image, RoundTrip(TextureCodec::BC7, image), 4) <= 4);
+}
+
+TEST(TextureCompression_BC1PunchesThroughLowAlpha)
+{
+    Image image = MakeRamp(true);
+    std::vector<uint8_t> decoded = RoundTrip(TextureCodec::BC1, image);
+
+    for (size_t texel = 0; texel < static_cast<size_t>(WIDTH) * HEIGHT; texel++)
+    {
+        bool transparent = image.m_rgba[texel * 4 + 3] < 128;
+        CHECK_EQUAL(transparent ? 0 : 255, decoded[texel * 4 + 3]);
+        if (transparent)
+        {
+            CHECK_EQUAL(0, decoded[texel * 4 + 0]);
+        }
+    }
+}
+
+TEST(TextureCompression_SolidBlocksStayOnTheirColor)
+{
+    uint8_t texels[16 * 4];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        texels[i * 4 + 0] = 200;
+        texels[i * 4 + 1] = 100;
+        texels[i * 4 + 2] = 50;
+        texels[i * 4 + 3] = 255;
+    }
+
+    uint8_t block[16];
+    uint8_t decoded[16 * 4];
+
+    EncodeBC1Block(texels, block);
+    DecodeBC1Block(block, decoded);
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        //Within 565 quantization
+        CHECK(std::abs(decoded[i * 4 + 0] - 200) <= 4);
+        CHECK(std::abs(decoded[i * 4 + 1] - 100) <= 2);
+        CHECK(std::abs(decoded[i * 4 + 2] - 50) <= 4);
+        CHECK_EQUAL(255, decoded[i * 4 + 3]);
+    }
+
+    EncodeBC7Block(texels, block);
+    DecodeBC7Block(block, decoded);
+    for (uint32_t i = 0; i < 16 * 4; i++)
+    {
+        CHECK(std::abs(decoded[i] - texels[i]) <= 1);
+    }
+}
+
+TEST(TextureCompression_BC4TwoValuesAreExact)
+{
+    uint8_t values[16 * 4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        values[i * 4] = (i & 1) ? 17 : 230;
+    }
+
+    uint8_t block[8];
+    EncodeBC4Block(values, 4, block);
+
+    uint8_t decoded[16] = {};
+    DecodeBC4Block(block, decoded, 1);
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        CHECK_EQUAL(values[i * 4], decoded[i]);
+    }
+}
+
+TEST(TextureCompression_UnsupportedCodecsThrow)
+{
+    uint8_t texels[16 * 4] = {};
+    CHECK(!CanEncode(TextureCodec::ASTC4x4));
+    CHECK(!CanDecode(TextureCodec::ASTC4x4));
+    CHECK_THROWS(CompressImage(TextureCodec::ASTC4x4, texels, 4, 4));
+    CHECK_THROWS(DecompressImage(TextureCodec::ASTC4x4, texels, 4, 4));
+
+    //Mode 0 (lowest bit set), only mode 6 is decoded
+    uint8_t block[16] = { 0x01 };
+    CHECK_THROWS(DecodeBC7Block(block, texels));
+}
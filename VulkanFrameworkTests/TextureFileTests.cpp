@@ -0,0 +1,208 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "TextureFile.h"
+
+namespace
+{
+    const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const size_t HEADER_SIZE = 80;
+    const size_t LEVEL_INDEX_SIZE = 24;
+
+    //A file in the temp directory, gone at the end of the test
+    struct TempFile
+    {
+        explicit TempFile(const char* name) : m_path((std::filesystem::temp_directory_path() / name).string()) {}
+        ~TempFile() { std::remove(m_path.c_str()); }
+
+        std::string m_path;
+    };
+
+    //Every level filled with its own index, so reads from the wrong level show
+    std::vector<std::vector<uint8_t>> MakeLevels(TextureCodec codec, uint32_t width, uint32_t height, uint32_t levelCount)
+    {
+        std::vector<std::vector<uint8_t>> levels;
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            uint32_t levelWidth = std::max(1u, width >> level);
+            uint32_t levelHeight = std::max(1u, height >> level);
+            levels.emplace_back(GetCodecImageSize(codec, levelWidth, levelHeight), static_cast<uint8_t>(level + 1));
+        }
+
+        return levels;
+    }
+
+    void WriteUint32(std::vector<uint8_t>& bytes, size_t offset, uint32_t value)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            bytes[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+        }
+    }
+
+    //Header fields by their byte offset in the KTX2 layout
+    const size_t VK_FORMAT_OFFSET = 12;
+    const size_t PIXEL_WIDTH_OFFSET = 20;
+    const size_t PIXEL_DEPTH_OFFSET = 28;
+    const size_t FACE_COUNT_OFFSET = 36;
+    const size_t LEVEL_COUNT_OFFSET = 40;
+    const size_t SUPERCOMPRESSION_OFFSET = 44;
+    //Level 0's entry in the index right after the header
+    const size_t LEVEL_BYTE_OFFSET_OFFSET = HEADER_SIZE;
+    const size_t LEVEL_BYTE_LENGTH_OFFSET = HEADER_SIZE + 8;
+
+    std::vector<uint8_t> ReadBytes(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void WriteBytes(const std::string& path, const std::vector<uint8_t>& bytes)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+}
+
+TEST(TextureFile_WrittenLevelsReadBack)
+{
+    TempFile temp("vf_test_levels.ktx2");
+    std::vector<std::vector<uint8_t>> levels = MakeLevels(TextureCodec::BC1, 64, 32, 7);
+    TextureFile::Write(temp.m_path, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 64, 32, levels);
+
+    TextureFile file;
+    file.Open(temp.m_path);
+
+    CHECK_EQUAL(VK_FORMAT_BC1_RGBA_SRGB_BLOCK, file.GetFormat());
+    CHECK_EQUAL(64u, file.GetWidth());
+    CHECK_EQUAL(32u, file.GetHeight());
+    REQUIRE(file.GetLevelCount() == 7);
+    CHECK_EQUAL(1u, file.GetLevelWidth(6));
+    CHECK_EQUAL(1u, file.GetLevelHeight(6));
+
+    for (uint32_t level = 0; level < file.GetLevelCount(); level++)
+    {
+        REQUIRE(file.GetLevelSize(level) == levels[level].size());
+        std::vector<uint8_t> data(file.GetLevelSize(level));
+        file.ReadLevel(level, data.data());
+        CHECK(data == levels[level]);
+    }
+
+    //Part of a level
+    uint8_t range[8] = {};
+    file.ReadLevelRange(0, 16, sizeof(range), range);
+    CHECK_EQUAL(1, range[0]);
+    CHECK_EQUAL(1, range[7]);
+    CHECK_THROWS(file.ReadLevelRange(6, 4, 8, range));
+}
+
+TEST(TextureFile_LevelsAreStoredSmallestFirstAndAligned)
+{
+    TempFile temp("vf_test_layout.ktx2");
+    std::vector<std::vector<uint8_t>> levels = MakeLevels(TextureCodec::RGBA8, 8, 8, 4);
+    TextureFile::Write(temp.m_path, VK_FORMAT_R8G8B8A8_UNORM, 8, 8, levels);
+
+    std::vector<uint8_t> bytes = ReadBytes(temp.m_path);
+    REQUIRE(bytes.size() > HEADER_SIZE + LEVEL_INDEX_SIZE * levels.size());
+    CHECK(std::equal(std::begin(KTX2_IDENTIFIER), std::end(KTX2_IDENTIFIER), bytes.begin()));
+
+    uint64_t previousOffset = 0;
+    for (size_t level = levels.size(); level-- > 0;)
+    {
+        uint64_t offset = 0;
+        std::memcpy(&offset, &bytes[HEADER_SIZE + LEVEL_INDEX_SIZE * level], sizeof(offset));
+
+        CHECK_EQUAL(0u, offset % 16);
+        CHECK(offset > previousOffset);
+        CHECK_EQUAL(static_cast<uint8_t>(level + 1), bytes[offset]);
+        previousOffset = offset;
+    }
+}
+
+TEST(TextureFile_ZeroLevelsMeansOne)
+{
+    TempFile temp("vf_test_zero_levels.ktx2");
+    TextureFile::Write(temp.m_path, VK_FORMAT_R8G8B8A8_UNORM, 4, 4, MakeLevels(TextureCodec::RGBA8, 4, 4, 1));
+
+    std::vector<uint8_t> bytes = ReadBytes(temp.m_path);
+    WriteUint32(bytes, LEVEL_COUNT_OFFSET, 0);
+    WriteBytes(temp.m_path, bytes);
+
+    TextureFile file;
+    file.Open(temp.m_path);
+    CHECK_EQUAL(1u, file.GetLevelCount());
+    CHECK_EQUAL(static_cast<uint64_t>(64), file.GetLevelSize(0));
+}
+
+TEST(TextureFile_UnsupportedFilesThrow)
+{
+    TempFile temp("vf_test_bad.ktx2");
+    TextureFile::Write(temp.m_path, VK_FORMAT_R8G8B8A8_UNORM, 4, 4, MakeLevels(TextureCodec::RGBA8, 4, 4, 3));
+    const std::vector<uint8_t> good = ReadBytes(temp.m_path);
+
+    TextureFile file;
+    CHECK_THROWS(file.Open(temp.m_path + ".missing"));
+
+    auto openPatched = [&](size_t offset, uint32_t value)
+    {
+        std::vector<uint8_t> bytes = good;
+        WriteUint32(bytes, offset, value);
+        WriteBytes(temp.m_path, bytes);
+        file.Open(temp.m_path);
+    };
+
+    //Not KTX2 at all
+    CHECK_THROWS(openPatched(0, 0x20585444));
+    //Cube map, 3D, supercompressed, no format
+    CHECK_THROWS(openPatched(FACE_COUNT_OFFSET, 6));
+    CHECK_THROWS(openPatched(PIXEL_DEPTH_OFFSET, 4));
+    CHECK_THROWS(openPatched(SUPERCOMPRESSION_OFFSET, 2));
+    CHECK_THROWS(openPatched(VK_FORMAT_OFFSET, VK_FORMAT_UNDEFINED));
+    //A format level sizes can't be checked for, no width
+    CHECK_THROWS(openPatched(VK_FORMAT_OFFSET, VK_FORMAT_R16G16B16A16_SFLOAT));
+    CHECK_THROWS(openPatched(PIXEL_WIDTH_OFFSET, 0));
+
+    //More levels than 4x4 has
+    CHECK_THROWS(openPatched(LEVEL_COUNT_OFFSET, 4));
+    //A level shorter or longer than its extent, or past the end of the file
+    const uint32_t levelSize = static_cast<uint32_t>(GetCodecImageSize(TextureCodec::RGBA8, 4, 4));
+    CHECK_THROWS(openPatched(LEVEL_BYTE_LENGTH_OFFSET, levelSize - 1));
+    CHECK_THROWS(openPatched(LEVEL_BYTE_LENGTH_OFFSET, levelSize + 4));
+    CHECK_THROWS(openPatched(LEVEL_BYTE_OFFSET_OFFSET, static_cast<uint32_t>(good.size() - levelSize + 4)));
+    CHECK_THROWS(openPatched(LEVEL_BYTE_OFFSET_OFFSET, 0xFFFFFFF0u));
+
+    //Index cut short
+    std::vector<uint8_t> truncated(good.begin(), good.begin() + HEADER_SIZE + LEVEL_INDEX_SIZE);
+    WriteBytes(temp.m_path, truncated);
+    CHECK_THROWS(file.Open(temp.m_path));
+
+    //And the untouched one still opens
+    WriteBytes(temp.m_path, good);
+    file.Open(temp.m_path);
+    CHECK_EQUAL(3u, file.GetLevelCount());
+}
+
+TEST(TextureFile_FormatsMapToCodecs)
+{
+    TextureCodec codec = TextureCodec::RGBA8;
+    bool srgb = false;
+
+    CHECK(GetFormatCodec(VK_FORMAT_BC7_SRGB_BLOCK, codec, srgb));
+    CHECK(codec == TextureCodec::BC7);
+    CHECK(srgb);
+
+    //No sRGB BC4/BC5, both map to the unorm format
+    CHECK(GetFormatCodec(VK_FORMAT_BC5_UNORM_BLOCK, codec, srgb));
+    CHECK(codec == TextureCodec::BC5);
+    CHECK(!srgb);
+    CHECK_EQUAL(VK_FORMAT_BC4_UNORM_BLOCK, GetCodecFormat(TextureCodec::BC4, true));
+
+    CHECK_EQUAL(VK_FORMAT_BC1_RGBA_UNORM_BLOCK, GetCodecFormat(TextureCodec::BC1, false));
+    CHECK(!GetFormatCodec(VK_FORMAT_R16G16B16A16_SFLOAT, codec, srgb));
+}
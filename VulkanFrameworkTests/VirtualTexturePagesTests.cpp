@@ -0,0 +1,296 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+
+#include "VirtualTexturePages.h"
+
+namespace
+{
+    uint32_t Insert(PageCache& cache, uint32_t page, uint64_t frame)
+    {
+        uint32_t evicted = VirtualPage::INVALID;
+        return cache.Insert(page, frame, evicted);
+    }
+
+    uint32_t InsertEvicting(PageCache& cache, uint32_t page, uint64_t frame)
+    {
+        uint32_t evicted = VirtualPage::INVALID;
+        cache.Insert(page, frame, evicted);
+        return evicted;
+    }
+
+    std::vector<uint32_t> Prioritize(PagePrioritizer& prioritizer, PageCache& cache, uint64_t frame, uint32_t maxPages)
+    {
+        std::pmr::vector<uint32_t> pages = prioritizer.Prioritize(cache, frame, maxPages);
+        return std::vector<uint32_t>(pages.begin(), pages.end());
+    }
+}
+
+TEST(VirtualPage_PackingRoundTrips)
+{
+    uint32_t page = VirtualPage::Pack(3, 1234, 16383);
+
+    CHECK_EQUAL(3u, VirtualPage::GetMip(page));
+    CHECK_EQUAL(1234u, VirtualPage::GetX(page));
+    CHECK_EQUAL(16383u, VirtualPage::GetY(page));
+    CHECK_EQUAL(VirtualPage::Pack(4, 617, 8191), VirtualPage::GetParent(page));
+}
+
+TEST(PageCache_FillsFreeSlotsLowestFirst)
+{
+    PageCache cache;
+    cache.Init(3, 2);
+
+    uint32_t a = VirtualPage::Pack(0, 0, 0);
+    uint32_t b = VirtualPage::Pack(0, 1, 0);
+    uint32_t evicted = 0;
+
+    CHECK_EQUAL(0u, cache.Insert(a, 1, evicted));
+    CHECK_EQUAL(VirtualPage::INVALID, evicted);
+    CHECK_EQUAL(1u, Insert(cache, b, 1));
+    CHECK_EQUAL(1u, cache.Find(b));
+    CHECK(!cache.IsResident(VirtualPage::Pack(0, 2, 0)));
+    CHECK_EQUAL(2u, cache.GetResidentCount());
+
+    //Already resident, same slot and nothing moves
+    CHECK_EQUAL(0u, Insert(cache, a, 2));
+    CHECK_EQUAL(2u, cache.GetResidentCount());
+    CHECK_EQUAL(static_cast<uint64_t>(0), cache.GetEvictionCount());
+}
+
+TEST(PageCache_EvictsTheLeastRecentlyUsed)
+{
+    PageCache cache;
+    cache.Init(2, 2);
+
+    uint32_t a = VirtualPage::Pack(0, 0, 0);
+    uint32_t b = VirtualPage::Pack(0, 1, 0);
+    uint32_t c = VirtualPage::Pack(0, 2, 0);
+    uint32_t d = VirtualPage::Pack(0, 3, 0);
+    Insert(cache, a, 1);
+    Insert(cache, b, 2);
+
+    //a is older but touched since, b goes
+    cache.Touch(a, 5);
+    uint32_t slotB = cache.Find(b);
+    uint32_t evicted = VirtualPage::INVALID;
+    CHECK_EQUAL(slotB, cache.Insert(c, 10, evicted));
+    CHECK_EQUAL(b, evicted);
+    CHECK(!cache.IsResident(b));
+    CHECK(cache.IsResident(c));
+
+    CHECK_EQUAL(a, InsertEvicting(cache, d, 11));
+    CHECK_EQUAL(static_cast<uint64_t>(2), cache.GetEvictionCount());
+}
+
+TEST(PageCache_NeverEvictsPagesOfFramesInFlight)
+{
+    PageCache cache;
+    cache.Init(2, 2);
+
+    Insert(cache, VirtualPage::Pack(0, 0, 0), 8);
+    Insert(cache, VirtualPage::Pack(0, 1, 0), 9);
+
+    //Used 2 frames ago, possibly still being sampled
+    CHECK(Insert(cache, VirtualPage::Pack(0, 2, 0), 10) == PageCache::INVALID_SLOT);
+    CHECK_EQUAL(2u, cache.GetResidentCount());
+
+    //One frame later the oldest is free to go
+    CHECK(Insert(cache, VirtualPage::Pack(0, 2, 0), 11) != PageCache::INVALID_SLOT);
+    CHECK(!cache.IsResident(VirtualPage::Pack(0, 0, 0)));
+}
+
+TEST(PageCache_PinnedPagesStay)
+{
+    PageCache cache;
+    cache.Init(2, 0);
+
+    uint32_t root = VirtualPage::Pack(4, 0, 0);
+    Insert(cache, root, 0);
+    cache.Pin(root);
+    Insert(cache, VirtualPage::Pack(0, 0, 0), 1);
+
+    for (uint32_t x = 1; x < 5; x++)
+    {
+        CHECK(Insert(cache, VirtualPage::Pack(0, x, 0), 10 + x) != PageCache::INVALID_SLOT);
+        CHECK(cache.IsResident(root));
+    }
+
+    //Only the pinned page left and not evictable, nothing to give
+    PageCache full;
+    full.Init(1, 0);
+    Insert(full, root, 0);
+    full.Pin(root);
+    CHECK(Insert(full, VirtualPage::Pack(0, 0, 0), 100) == PageCache::INVALID_SLOT);
+}
+
+TEST(PagePrioritizer_CoarseFirstThenMostRequested)
+{
+    PageCache cache;
+    cache.Init(16, 2);
+    PagePrioritizer prioritizer;
+
+    //Mips 0-2 paged, 3 and up is the tail. Parents of everything get requested too.
+    uint32_t fine = VirtualPage::Pack(0, 0, 0);
+    uint32_t busy = VirtualPage::Pack(1, 1, 1);
+    uint32_t tail = VirtualPage::Pack(3, 0, 0);
+    std::vector<uint32_t> feedback = { fine, VirtualPage::INVALID, busy, busy, busy, tail };
+    prioritizer.AddFeedback(feedback.data(), feedback.size(), 3);
+
+    std::vector<uint32_t> pages = Prioritize(prioritizer, cache, 1, 16);
+
+    //fine, its parent (1,0,0), their parent (2,0,0) which busy shares, and busy
+    REQUIRE(pages.size() == 4);
+    CHECK_EQUAL(VirtualPage::Pack(2, 0, 0), pages[0]);
+    CHECK_EQUAL(busy, pages[1]);
+    CHECK_EQUAL(VirtualPage::Pack(1, 0, 0), pages[2]);
+    CHECK_EQUAL(fine, pages[3]);
+    CHECK(std::find(pages.begin(), pages.end(), tail) == pages.end());
+    CHECK_EQUAL(2u, prioritizer.GetLastRequestCount());
+
+    //Requests are used up
+    CHECK(Prioritize(prioritizer, cache, 2, 16).empty());
+}
+
+TEST(PagePrioritizer_ResidentPagesAreTouchedNotRequested)
+{
+    PageCache cache;
+    cache.Init(2, 1);
+    PagePrioritizer prioritizer;
+
+    uint32_t page = VirtualPage::Pack(0, 2, 2);
+    uint32_t parent = VirtualPage::GetParent(page);
+    uint32_t other = VirtualPage::Pack(1, 0, 0);
+    Insert(cache, parent, 1);
+    Insert(cache, other, 2);
+
+    prioritizer.AddFeedback(&page, 1, 2);
+    std::vector<uint32_t> pages = Prioritize(prioritizer, cache, 20, 8);
+
+    REQUIRE(pages.size() == 1);
+    CHECK_EQUAL(page, pages[0]);
+
+    //The parent was touched by the request, so the other page is the older one now
+    CHECK_EQUAL(other, InsertEvicting(cache, page, 21));
+}
+
+TEST(PagePrioritizer_KeepsOnlyTheMostImportant)
+{
+    PageCache cache;
+    cache.Init(4, 1);
+    PagePrioritizer prioritizer;
+
+    std::vector<uint32_t> feedback;
+    for (uint32_t x = 0; x < 4; x++)
+    {
+        for (uint32_t count = 0; count <= x; count++)
+        {
+            feedback.push_back(VirtualPage::Pack(0, x, 0));
+        }
+    }
+    prioritizer.AddFeedback(feedback.data(), feedback.size(), 1);
+
+    std::vector<uint32_t> pages = Prioritize(prioritizer, cache, 1, 2);
+
+    REQUIRE(pages.size() == 2);
+    CHECK_EQUAL(VirtualPage::Pack(0, 3, 0), pages[0]);
+    CHECK_EQUAL(VirtualPage::Pack(0, 2, 0), pages[1]);
+}
+
+TEST(PageTable_StartsAtTheFallbackAndDirty)
+{
+    PageTable table;
+    uint32_t fallback = PageTable::PackEntry(7, 0, 2);
+    table.Init(3, 4, 2, fallback);
+
+    CHECK_EQUAL(4u, table.GetWidth(0));
+    CHECK_EQUAL(2u, table.GetHeight(0));
+    CHECK_EQUAL(1u, table.GetWidth(2));
+    CHECK_EQUAL(1u, table.GetHeight(2));
+    CHECK_EQUAL(fallback, table.GetEntry(0, 3, 1));
+    CHECK(table.IsDirty());
+
+    const PageTable::DirtyRect& dirty = table.GetDirty(0);
+    CHECK_EQUAL(0u, dirty.m_x0);
+    CHECK_EQUAL(4u, dirty.m_x1);
+    CHECK_EQUAL(2u, dirty.m_y1);
+
+    for (uint32_t level = 0; level < table.GetLevelCount(); level++)
+    {
+        table.ClearDirty(level);
+    }
+    CHECK(!table.IsDirty());
+}
+
+TEST(PageTable_MapCoversFinerEntriesThatFallBack)
+{
+    PageTable table;
+    uint32_t root = PageTable::PackEntry(0, 0, 2);
+    table.Init(3, 4, 4, root);
+    for (uint32_t level = 0; level < table.GetLevelCount(); level++)
+    {
+        table.ClearDirty(level);
+    }
+
+    //A fine page first, then the mip 1 page above it
+    uint32_t fineEntry = PageTable::PackEntry(1, 0, 0);
+    table.Map(VirtualPage::Pack(0, 1, 1), fineEntry);
+    uint32_t coarseEntry = PageTable::PackEntry(2, 0, 1);
+    table.Map(VirtualPage::Pack(1, 0, 0), coarseEntry);
+
+    CHECK_EQUAL(coarseEntry, table.GetEntry(1, 0, 0));
+    CHECK_EQUAL(coarseEntry, table.GetEntry(0, 0, 0));
+    CHECK_EQUAL(coarseEntry, table.GetEntry(0, 1, 0));
+    CHECK_EQUAL(fineEntry, table.GetEntry(0, 1, 1));
+    //Outside the page
+    CHECK_EQUAL(root, table.GetEntry(0, 2, 0));
+    CHECK_EQUAL(root, table.GetEntry(1, 1, 0));
+    CHECK_EQUAL(root, table.GetEntry(2, 0, 0));
+
+    //Only the page's area is dirty
+    const PageTable::DirtyRect& dirty = table.GetDirty(0);
+    CHECK_EQUAL(0u, dirty.m_x0);
+    CHECK_EQUAL(0u, dirty.m_y0);
+    CHECK_EQUAL(2u, dirty.m_x1);
+    CHECK_EQUAL(2u, dirty.m_y1);
+    CHECK(table.GetDirty(2).IsEmpty());
+}
+
+TEST(PageTable_UnmapFallsBackToTheParent)
+{
+    PageTable table;
+    uint32_t root = PageTable::PackEntry(0, 0, 2);
+    table.Init(3, 4, 4, root);
+
+    uint32_t coarse = VirtualPage::Pack(1, 1, 0);
+    uint32_t coarseEntry = PageTable::PackEntry(3, 0, 1);
+    uint32_t fine = VirtualPage::Pack(0, 2, 1);
+    uint32_t fineEntry = PageTable::PackEntry(4, 0, 0);
+    table.Map(coarse, coarseEntry);
+    table.Map(fine, fineEntry);
+
+    //The evicted fine page's entries go back to the coarse one
+    table.Unmap(fine);
+    CHECK_EQUAL(coarseEntry, table.GetEntry(0, 2, 1));
+
+    //And then the coarse one's to the root
+    table.Map(fine, fineEntry);
+    table.Unmap(coarse);
+    CHECK_EQUAL(root, table.GetEntry(1, 1, 0));
+    CHECK_EQUAL(root, table.GetEntry(0, 3, 0));
+    //A finer resident page keeps its entry
+    CHECK_EQUAL(fineEntry, table.GetEntry(0, 2, 1));
+}
+
+TEST(PageTable_UnmappingTheLastLevelFallsToTheMipTail)
+{
+    PageTable table;
+    table.Init(2, 2, 2, PageTable::PackEntry(0, 0, 2));
+
+    uint32_t top = VirtualPage::Pack(1, 0, 0);
+    table.Map(top, PageTable::PackEntry(5, 5, 1));
+    table.Unmap(top);
+
+    CHECK_EQUAL(PageTable::PackEntry(0, 0, 2), table.GetEntry(1, 0, 0));
+    CHECK_EQUAL(2u, PageTable::GetEntryMip(table.GetEntry(0, 1, 1)));
+}